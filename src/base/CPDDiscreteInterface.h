@@ -49,6 +49,9 @@ public:
     
     /// Returns an (index of a) x drawn according to \f$ P(x|y) \f$
     virtual Index Sample(Index y) const = 0;
+    /// Returns an x drawn according to \f$ P(x|y) \f$ using rand_r(seed).
+    /** This makes sampling thread-safe, if seed is 0 rand() is used. */
+    virtual Index Sample(Index y, unsigned int *seed) const = 0;
 
     virtual void SanityCheck() const = 0;
     
@@ -35,6 +35,8 @@ public:
     /// Returns an (index of a) x drawn according to \f$ P(x|y) \f$
     Index Sample (Index y) const
     { return y; }
+    Index Sample (Index y, unsigned int *seed) const
+    { return y; }
 
     ///Sets P(x|y)
     /**Doesn't apply to Kronecker delta function.*/
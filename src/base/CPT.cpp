@@ -62,7 +62,12 @@ void CPT::SanityCheck() const
 
 Index CPT::Sample(Index y) const
 {
-    double randNr=rand() / (RAND_MAX + 1.0);
+    return(Sample(y, 0));
+}
+
+Index CPT::Sample(Index y, unsigned int *seed) const
+{
+    double randNr=(seed ? rand_r(seed) : rand()) / (RAND_MAX + 1.0);
     double cumprob = 0.0;
     Index x;
     for(x=0; x < nrX(); x++)
@@ -60,6 +60,8 @@ public:
     
     /// Returns an (index of a) x drawn according to \f$ P(x|y) \f$
     Index Sample (Index y) const;
+    /// Returns an x drawn according to \f$ P(x|y) \f$ using rand_r(seed).
+    Index Sample (Index y, unsigned int *seed) const;
 
     //data manipulation funtions:
     ///Sets P(x|y)
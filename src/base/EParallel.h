@@ -0,0 +1,135 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _EPARALLEL_H_
+#define _EPARALLEL_H_ 1
+
+/* the include directives */
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include "E.h"
+#include "EDeadline.h"
+
+/**\brief EParallel passes an exception thrown inside an OpenMP parallel
+ * region on to the thread that started the region.
+ *
+ * Exceptions may not leave a parallel region (that calls std::terminate),
+ * so the loop body catches everything and hands it to Catch():
+ * \code
+ * EParallel error;
+ * #pragma omp parallel for
+ * for(...)
+ * {
+ *     try { ... }
+ *     catch(...) { error.Catch(); }
+ * }
+ * error.Rethrow();
+ * \endcode
+ * Rethrow() throws the first exception that was caught, if any. With
+ * C++11 the exception itself is rethrown, otherwise an exception of the
+ * same kind (E, EDeadline, std::bad_alloc, std::out_of_range or another
+ * std::exception) with the same message.
+ */
+class EParallel
+{
+    private:
+
+    enum Kind { NONE, MADP, DEADLINE, BAD_ALLOC, OUT_OF_RANGE, STD, OTHER };
+
+    Kind _m_kind;
+    std::string _m_what;
+    double _m_expectedTimeForCompletion;
+#if __cplusplus >= 201103L
+    std::exception_ptr _m_exception;
+#endif
+
+    /// Stores the exception that is currently handled.
+    void Store()
+    {
+#if __cplusplus >= 201103L
+        _m_exception=std::current_exception();
+#endif
+        try { throw; }
+        catch(EDeadline& e)
+        {
+            _m_kind=DEADLINE;
+            _m_what=e.SoftPrint();
+            _m_expectedTimeForCompletion=e._m_expectedTimeForCompletion;
+        }
+        catch(E& e) { _m_kind=MADP; _m_what=e.SoftPrint(); }
+        catch(std::bad_alloc& e) { _m_kind=BAD_ALLOC; _m_what=e.what(); }
+        catch(std::out_of_range& e) { _m_kind=OUT_OF_RANGE; _m_what=e.what(); }
+        catch(std::exception& e) { _m_kind=STD; _m_what=e.what(); }
+        catch(...) { _m_kind=OTHER; _m_what="unknown exception"; }
+    }
+
+    protected:
+
+    public:
+
+    // Constructor, destructor and copy assignment.
+    /// Constructor
+    EParallel() : _m_kind(NONE), _m_expectedTimeForCompletion(0) {}
+
+    /// Stores the exception being handled, unless one was stored before.
+    /** Has to be called from a catch block. */
+    void Catch()
+    {
+#pragma omp critical(EParallel_Catch)
+        {
+            if(_m_kind==NONE)
+                Store();
+        }
+    }
+
+    /// Whether an exception has been caught (after the parallel region).
+    bool Caught() const { return(_m_kind!=NONE); }
+
+    /// Rethrows the exception that was caught, if any.
+    void Rethrow() const
+    {
+        if(_m_kind==NONE)
+            return;
+#if __cplusplus >= 201103L
+        std::rethrow_exception(_m_exception);
+#else
+        switch(_m_kind)
+        {
+        case DEADLINE:
+            throw(EDeadline(_m_what,_m_expectedTimeForCompletion));
+        case BAD_ALLOC:
+            throw(std::bad_alloc());
+        case OUT_OF_RANGE:
+            throw(std::out_of_range(_m_what));
+        case STD:
+            throw(std::runtime_error(_m_what));
+        default:
+            throw(E(_m_what));
+        }
+#endif
+    }
+
+};
+
+
+#endif /* !_EPARALLEL_H_ */
+
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
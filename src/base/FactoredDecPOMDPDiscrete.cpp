@@ -16,11 +16,17 @@
 #include "FactoredDecPOMDPDiscrete.h"
 #include "DecPOMDPDiscrete.h"
 #include "StateFactorDiscrete.h"
+#include "FactoredFlatModelEvaluator.h"
+#include "PrintTools.h"
 #include <fstream>
 #include <algorithm>
 
 #include <RGet.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #define DEBUG_SETR 0
 
 using namespace std;
@@ -100,6 +106,10 @@ void FactoredDecPOMDPDiscrete::InitializeStorage()
     _m_nrAIs.resize(_m_nrLRFs);
     _m_nrSFVals.resize(_m_nrLRFs);
     _m_nrActionVals.resize(_m_nrLRFs);
+    _m_sfStepSizes.clear();
+    _m_actionStepSizes.clear();
+    _m_sfStepSizes.resize(_m_nrLRFs);
+    _m_actionStepSizes.resize(_m_nrLRFs);
 }
 
 void FactoredDecPOMDPDiscrete::SetScopeForLRF(Index LRF, 
@@ -142,6 +152,7 @@ void FactoredDecPOMDPDiscrete::InitializeInstantiationInformation()
         vector< size_t> restrXVals(X.size());
         IndexTools::RestrictIndividualIndicesToScope(nrVals, X, restrXVals);
         _m_nrSFVals.at(e) = restrXVals;
+        _m_sfStepSizes.at(e) = IndexTools::CalculateStepSizeVector(restrXVals);
         size_t nrXIs = 1;
         for( vector< size_t >::const_iterator it = restrXVals.begin();
                 it != restrXVals.end();
@@ -153,6 +164,8 @@ void FactoredDecPOMDPDiscrete::InitializeInstantiationInformation()
         vector< size_t> restrAVals(A.size());
         IndexTools::RestrictIndividualIndicesToScope(nrActions, A, restrAVals);
         _m_nrActionVals.at(e) = restrAVals;
+        _m_actionStepSizes.at(e) =
+            IndexTools::CalculateStepSizeVector(restrAVals);
         size_t nrAIs = 1;
         for( vector< size_t >::const_iterator it = restrAVals.begin();
                 it != restrAVals.end();
@@ -294,12 +307,35 @@ double FactoredDecPOMDPDiscrete::GetReward(Index sI, Index jaI) const
     if(_m_cached_FlatRM)
         return _m_p_rModel->Get(sI,jaI);
 
+    const FactoredFlatModelEvaluator* eval = GetFlatModelEvaluator();
+    vector<Index> bufX, bufA;
+    const Index *X = 0, *A = 0;
+    if(eval)
+    {
+        //decompose sI and jaI once (memoised) for all LRFs
+        X = eval->GetStateFactorValues(sI, bufX);
+        A = eval->GetIndividualActions(jaI, bufA);
+    }
+
     //sum over local reward functions
     double r = 0.0;
     for(Index e=0; e < GetNrLRFs(); e++)
     {
-        double this_e_r = GetLRFRewardFlat(e, sI, jaI);
-        r += this_e_r;
+        const Scope &Xsc = _m_sfScopes[e];
+        const Scope &Asc = _m_agScopes[e];
+        const vector<size_t> &sfStep = _m_sfStepSizes[e];
+        const vector<size_t> &aStep = _m_actionStepSizes[e];
+        if(!eval || sfStep.size() != Xsc.size() || aStep.size() != Asc.size())
+        {
+            r += GetLRFRewardFlat(e, sI, jaI);
+            continue;
+        }
+        Index s_e = 0, a_e = 0;
+        for(Index k=0; k < Xsc.size(); k++)
+            s_e += X[Xsc[k]] * sfStep[k];
+        for(Index k=0; k < Asc.size(); k++)
+            a_e += A[Asc[k]] * aStep[k];
+        r += GetLRFReward(e, s_e, a_e);
     }
     return(r);
 }
@@ -409,27 +445,63 @@ void FactoredDecPOMDPDiscrete::CacheFlatRewardModel(bool sparse)
                                 // and return only zeroes
         delete(_m_p_rModel);
     }
+    size_t nrS = GetNrStates(), nrJA = GetNrJointActions();
+    RewardModelMappingSparse *rms = 0;
     _m_sparse_FlatRM = sparse;
     if(sparse)
-        _m_p_rModel=new RewardModelMappingSparse(GetNrStates(),
-                                                     GetNrJointActions());
+        _m_p_rModel = rms = new RewardModelMappingSparse(nrS, nrJA);
     else
-        _m_p_rModel=new RewardModelMapping(GetNrStates(),
-                                               GetNrJointActions());
-
+        _m_p_rModel = new RewardModelMapping(nrS, nrJA);
+
+    // as in CacheFlatTransitionModel(), windows of blocks of states are
+    // computed in parallel and then appended to the model in order
+    const size_t blockSize = 256;
+    long nrBlocks = static_cast<long>((nrS + blockSize - 1) / blockSize);
+    long windowSize = 1;
+    // GetReward() is safe for concurrent use with the flat model evaluator
+    bool parallel = GetFlatModelEvaluator() != 0;
+#ifdef _OPENMP
+    parallel = parallel && omp_get_max_threads() > 1 && !omp_in_parallel();
+    if(parallel)
+        windowSize = 4 * omp_get_max_threads();
+#endif
+    vector< vector<double> > rewards(windowSize);
 
-    //cout << "caching rewards"<<endl;
-    for(Index sI=0; sI<GetNrStates(); sI++)
-        for(Index jaI=0; jaI<GetNrJointActions(); jaI++)
+    timeval start_time;
+    gettimeofday(&start_time, NULL);
+    double lastPrint = 0;
+    for(long w = 0; w < nrBlocks; w += windowSize)
+    {
+        long wEnd = min(w + windowSize, nrBlocks);
+#pragma omp parallel for schedule(dynamic) if(parallel)
+        for(long b = w; b < wEnd; b++)
         {
-            double r = GetReward(sI, jaI);
-            //cout << "R(s=" << sI << ",jaI=" <<jaI <<") = " << r;
-            if( abs(r) >= REWARD_PRECISION )                
-                _m_p_rModel->Set(sI, jaI, r);
-
-            //cout << " - from cache:" << _m_p_rModel->Get(sI, jaI) << endl;
+            Index sBegin = b * blockSize, sEnd = min(sBegin + blockSize, nrS);
+            rewards[b-w].resize((sEnd - sBegin) * nrJA);
+            for(Index sI = sBegin; sI < sEnd; sI++)
+                for(Index jaI = 0; jaI < nrJA; jaI++)
+                    rewards[b-w][(sI - sBegin) * nrJA + jaI] =
+                        GetReward(sI, jaI);
+        }
 
+        for(long b = w; b < wEnd; b++)
+        {
+            Index sBegin = b * blockSize;
+            for(Index k = 0; k < rewards[b-w].size(); k++)
+            {
+                Index sI = sBegin + k / nrJA, jaI = k % nrJA;
+                double r = rewards[b-w][k];
+                if( abs(r) < REWARD_PRECISION )
+                    continue;
+                if(rms)
+                    rms->Append(sI, jaI, r);
+                else
+                    _m_p_rModel->Set(sI, jaI, r);
+            }
         }
+        PrintTools::PrintProgressETA("Caching flat reward model, block",
+                                     wEnd, nrBlocks, start_time, lastPrint);
+    }
 
     _m_cached_FlatRM = true;
 }
@@ -87,6 +87,12 @@ private:
     std::vector< std::vector<size_t> > _m_nrSFVals;
     ///For each LRF, we maintain the nr of actions for each agent in its scope
     std::vector< std::vector<size_t> > _m_nrActionVals;
+    ///For each LRF, the step sizes of the factors in its state scope
+    /**With these GetReward() computes the local state index directly from
+     * the (full) vector of state factor values.*/
+    std::vector< std::vector<size_t> > _m_sfStepSizes;
+    ///For each LRF, the step sizes of the agents in its agent scope
+    std::vector< std::vector<size_t> > _m_actionStepSizes;
 
     //variables for caching flat rewards: 
     /// Pointer to model
@@ -0,0 +1,291 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "FactoredFlatModelEvaluator.h"
+#include "MultiAgentDecisionProcessDiscreteFactoredStates.h"
+#include "TwoStageDynamicBayesianNetwork.h"
+#include "CPDDiscreteInterface.h"
+#include "IndexTools.h"
+#include <algorithm>
+#include <pthread.h>
+
+using namespace std;
+
+namespace {
+
+/// The key of the thread-specific memos.
+pthread_key_t memoKey;
+pthread_once_t memoKeyOnce = PTHREAD_ONCE_INIT;
+bool memoKeyCreated = false;
+
+/// Protects the counter of evaluator ids.
+pthread_mutex_t idMutex = PTHREAD_MUTEX_INITIALIZER;
+unsigned long nextId = 1;
+
+}
+
+FactoredFlatModelEvaluator::FactoredFlatModelEvaluator(
+    const MultiAgentDecisionProcessDiscreteFactoredStates &madp,
+    const TwoStageDynamicBayesianNetwork &twoDBN) :
+    _m_nrSF(madp.GetNrStateFactors()),
+    _m_nrAgents(madp.GetNrAgents()),
+    _m_nrValues(madp.GetNrValuesPerFactor()),
+    _m_CPDs(_m_nrSF),
+    _m_XParents(_m_nrSF),
+    _m_AParents(_m_nrSF),
+    _m_YParents(_m_nrSF),
+    _m_XStrides(_m_nrSF),
+    _m_AStrides(_m_nrSF),
+    _m_YStrides(_m_nrSF)
+{
+    _m_stateStepSize=IndexTools::CalculateStepSizeVector(_m_nrValues);
+    _m_actionStepSize=IndexTools::CalculateStepSizeVector(madp.GetNrActions());
+
+    for(Index y=0;y!=_m_nrSF;++y)
+    {
+        _m_CPDs[y]=twoDBN.GetCPD_Y(y);
+        if(_m_CPDs[y]==0)
+            throw(E("FactoredFlatModelEvaluator: no CPD has been set for a state factor"));
+
+        // the ii index of y is the joint index of the concatenation
+        // [XSoI, ASoI, YSoI] of its (sorted) parent scopes
+        const Scope &XSoI=twoDBN.GetXSoI_Y(y),
+            &ASoI=twoDBN.GetASoI_Y(y),
+            &YSoI=twoDBN.GetYSoI_Y(y);
+        vector<size_t> nrVals;
+        for(Index k=0;k!=XSoI.size();++k)
+            nrVals.push_back(_m_nrValues[XSoI[k]]);
+        for(Index k=0;k!=ASoI.size();++k)
+            nrVals.push_back(madp.GetNrActions(ASoI[k]));
+        for(Index k=0;k!=YSoI.size();++k)
+            nrVals.push_back(_m_nrValues[YSoI[k]]);
+        vector<size_t> strides=IndexTools::CalculateStepSizeVector(nrVals);
+
+        vector<size_t>::const_iterator it=strides.begin();
+        _m_XParents[y].assign(XSoI.begin(),XSoI.end());
+        _m_XStrides[y].assign(it,it+XSoI.size());
+        it+=XSoI.size();
+        _m_AParents[y].assign(ASoI.begin(),ASoI.end());
+        _m_AStrides[y].assign(it,it+ASoI.size());
+        it+=ASoI.size();
+        _m_YParents[y].assign(YSoI.begin(),YSoI.end());
+        _m_YStrides[y].assign(it,it+YSoI.size());
+    }
+
+    // order the successor factors such that each one comes after its
+    // within-stage parents
+    vector<bool> placed(_m_nrSF,false);
+    while(_m_order.size()!=_m_nrSF)
+    {
+        size_t nrPlaced=_m_order.size();
+        for(Index y=0;y!=_m_nrSF;++y)
+        {
+            if(placed[y])
+                continue;
+            bool ready=true;
+            for(Index k=0;k!=_m_YParents[y].size() && ready;++k)
+                ready=placed[_m_YParents[y][k]];
+            if(ready)
+            {
+                placed[y]=true;
+                _m_order.push_back(y);
+            }
+        }
+        if(_m_order.size()==nrPlaced)
+            throw(E("FactoredFlatModelEvaluator: the within-stage dependencies of the 2DBN are cyclic"));
+    }
+    _m_orderIsIdentity=true;
+    for(Index d=0;d!=_m_nrSF;++d)
+        if(_m_order[d]!=d)
+            _m_orderIsIdentity=false;
+
+    // the ids identify the evaluator of a thread's memo, also when a
+    // new evaluator is constructed at the address of a deleted one
+    pthread_mutex_lock(&idMutex);
+    _m_id=nextId++;
+    pthread_mutex_unlock(&idMutex);
+}
+
+FactoredFlatModelEvaluator::~FactoredFlatModelEvaluator()
+{
+}
+
+void FactoredFlatModelEvaluator::CreateMemoKey()
+{
+    memoKeyCreated =
+        pthread_key_create(&memoKey, &FactoredFlatModelEvaluator::DeleteMemo)==0;
+}
+
+void FactoredFlatModelEvaluator::DeleteMemo(void *memo)
+{
+    delete static_cast<Memo*>(memo);
+}
+
+FactoredFlatModelEvaluator::Memo* FactoredFlatModelEvaluator::GetMemo() const
+{
+    pthread_once(&memoKeyOnce, &FactoredFlatModelEvaluator::CreateMemoKey);
+    if(!memoKeyCreated)
+        return(0);
+
+    Memo *memo=static_cast<Memo*>(pthread_getspecific(memoKey));
+    if(memo==0)
+    {
+        memo=new Memo;
+        memo->evaluatorId=0;
+        if(pthread_setspecific(memoKey, memo)!=0)
+        {
+            delete memo;
+            return(0);
+        }
+    }
+    // a thread keeps the memo of the last evaluator it used
+    if(memo->evaluatorId!=_m_id)
+    {
+        for(Index k=STATE;k<=ACTION;++k)
+        {
+            size_t n = k==ACTION ? _m_nrAgents : _m_nrSF;
+            memo->keys[k].assign(_m_nrMemoSlots,INDEX_MAX);
+            memo->values[k].resize(_m_nrMemoSlots*n);
+        }
+        memo->evaluatorId=_m_id;
+    }
+    return(memo);
+}
+
+const Index* FactoredFlatModelEvaluator::Decompose(MemoKind kind, Index i,
+                                                   vector<Index> &buffer) const
+{
+    const vector<size_t> &stepSize =
+        kind==ACTION ? _m_actionStepSize : _m_stateStepSize;
+    size_t n=stepSize.size();
+
+    Memo *memo=GetMemo();
+
+    Index *values;
+    if(memo)
+    {
+        Index slot=i%_m_nrMemoSlots;
+        values=&memo->values[kind][slot*n];
+        if(memo->keys[kind][slot]==i)
+            return(values);
+        memo->keys[kind][slot]=i;
+    }
+    else
+    {
+        buffer.resize(n);
+        values=&buffer[0];
+    }
+
+    for(Index k=0;k!=n;++k)
+    {
+        values[k]=i/stepSize[k];
+        i%=stepSize[k];
+    }
+    return(values);
+}
+
+Index FactoredFlatModelEvaluator::GetXAIndex(Index y, const Index *X,
+                                             const Index *A) const
+{
+    Index ii=0;
+    for(Index k=0;k!=_m_XParents[y].size();++k)
+        ii+=X[_m_XParents[y][k]]*_m_XStrides[y][k];
+    for(Index k=0;k!=_m_AParents[y].size();++k)
+        ii+=A[_m_AParents[y][k]]*_m_AStrides[y][k];
+    return(ii);
+}
+
+double FactoredFlatModelEvaluator::GetTransitionProbability(Index sI, Index jaI,
+                                                            Index sucSI) const
+{
+    vector<Index> bufX, bufA, bufY;
+    const Index *X=Decompose(STATE,sI,bufX),
+        *A=Decompose(ACTION,jaI,bufA),
+        *Y=Decompose(SUCCESSOR,sucSI,bufY);
+
+    double p=1;
+    for(Index y=0;y!=_m_nrSF && p>0;++y)
+    {
+        Index ii=GetXAIndex(y,X,A);
+        for(Index k=0;k!=_m_YParents[y].size();++k)
+            ii+=Y[_m_YParents[y][k]]*_m_YStrides[y][k];
+        p*=_m_CPDs[y]->Get(Y[y],ii);
+    }
+    return(p);
+}
+
+void FactoredFlatModelEvaluator::AddSuccessors(Index depth,
+                                               const vector<size_t> &XAIndex,
+                                               vector<Index> &Y, Index sucSI,
+                                               double p,
+                                               vector<Index> &sucSIs,
+                                               vector<double> &probs) const
+{
+    if(depth==_m_nrSF)
+    {
+        sucSIs.push_back(sucSI);
+        probs.push_back(p);
+        return;
+    }
+
+    Index y=_m_order[depth];
+    Index ii=XAIndex[y];
+    for(Index k=0;k!=_m_YParents[y].size();++k)
+        ii+=Y[_m_YParents[y][k]]*_m_YStrides[y][k];
+
+    for(Index v=0;v!=_m_nrValues[y];++v)
+    {
+        double pv=_m_CPDs[y]->Get(v,ii);
+        if(pv>0)
+        {
+            Y[y]=v;
+            AddSuccessors(depth+1,XAIndex,Y,sucSI+v*_m_stateStepSize[y],
+                          p*pv,sucSIs,probs);
+        }
+    }
+}
+
+void FactoredFlatModelEvaluator::GetSuccessors(Index sI, Index jaI,
+                                               vector<Index> &sucSIs,
+                                               vector<double> &probs) const
+{
+    vector<Index> bufX, bufA;
+    const Index *X=Decompose(STATE,sI,bufX),
+        *A=Decompose(ACTION,jaI,bufA);
+
+    vector<size_t> XAIndex(_m_nrSF);
+    for(Index y=0;y!=_m_nrSF;++y)
+        XAIndex[y]=GetXAIndex(y,X,A);
+
+    sucSIs.clear();
+    probs.clear();
+    vector<Index> Y(_m_nrSF,0);
+    AddSuccessors(0,XAIndex,Y,0,1.0,sucSIs,probs);
+
+    // assigning factors in index order enumerates successors in
+    // increasing order, otherwise they have to be sorted
+    if(!_m_orderIsIdentity)
+    {
+        vector<pair<Index,double> > row(sucSIs.size());
+        for(Index k=0;k!=row.size();++k)
+            row[k]=make_pair(sucSIs[k],probs[k]);
+        sort(row.begin(),row.end());
+        for(Index k=0;k!=row.size();++k)
+        {
+            sucSIs[k]=row[k].first;
+            probs[k]=row[k].second;
+        }
+    }
+}
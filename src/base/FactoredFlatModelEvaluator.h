@@ -0,0 +1,143 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _FACTOREDFLATMODELEVALUATOR_H_
+#define _FACTOREDFLATMODELEVALUATOR_H_ 1
+
+/* the include directives */
+#include <vector>
+#include "Globals.h"
+
+class MultiAgentDecisionProcessDiscreteFactoredStates;
+class TwoStageDynamicBayesianNetwork;
+class CPDDiscreteInterface;
+
+/**\brief FactoredFlatModelEvaluator evaluates the transition model of a
+ * MultiAgentDecisionProcessDiscreteFactoredStates for flat state and
+ * joint action indices, without caching the flat model.
+ *
+ * For every state factor y the index of the instantiation of its parents
+ * (its column in the CPT) is a sum of parent values times strides. These
+ * stride tables are computed once, so evaluating P(s'|s,a) only
+ * requires the factor values of s, a and s'.
+ *
+ * The decomposition of flat indices into factor values is memoised: each
+ * thread owns a small direct-mapped table of recent decompositions for
+ * states, successor states and joint actions, so the repeated conversions
+ * of a loop over successors (or over local reward functions) are done
+ * only once. The tables are thread-specific data (not indexed by OpenMP
+ * thread number), so the evaluator can be used concurrently from any
+ * threads, also from nested parallel regions. A thread keeps the table of
+ * the last evaluator it used.
+ *
+ * GetSuccessors() evaluates a whole row P(.|s,a) by assigning the
+ * successor factors one at a time (parents before children) and only
+ * following values with non-zero probability, so it enumerates the
+ * reachable successors only.
+ *
+ * The evaluator refers to the CPDs of the 2DBN it was constructed from,
+ * so it has to be recreated when the 2DBN's structure changes.
+ */
+class FactoredFlatModelEvaluator
+{
+private:
+
+    /// A per-thread memo of flat index decompositions.
+    struct Memo
+    {
+        /// The id of the evaluator whose indices are stored.
+        unsigned long evaluatorId;
+        /// The flat index stored in each slot (per kind of index).
+        std::vector<Index> keys[3];
+        /// The values of each slot, nrSlots x nrValues.
+        std::vector<Index> values[3];
+    };
+    enum MemoKind { STATE=0, SUCCESSOR=1, ACTION=2 };
+
+    static const size_t _m_nrMemoSlots=64;
+
+    size_t _m_nrSF;
+    size_t _m_nrAgents;
+    std::vector<size_t> _m_nrValues;
+    std::vector<size_t> _m_stateStepSize;
+    std::vector<size_t> _m_actionStepSize;
+
+    std::vector<const CPDDiscreteInterface*> _m_CPDs;
+    /// For each y, the parent factors in X, A and Y and their strides in
+    /// the CPT's instantiation index.
+    std::vector<std::vector<Index> > _m_XParents, _m_AParents, _m_YParents;
+    std::vector<std::vector<size_t> > _m_XStrides, _m_AStrides, _m_YStrides;
+    /// An order of the successor factors in which within-stage parents
+    /// come first.
+    std::vector<Index> _m_order;
+    bool _m_orderIsIdentity;
+
+    /// Identifies this evaluator in the memos of the threads.
+    unsigned long _m_id;
+
+    static void CreateMemoKey();
+    static void DeleteMemo(void *memo);
+    /// Returns the memo of the calling thread, set up for this evaluator,
+    /// or 0 if no thread-specific data can be stored.
+    Memo* GetMemo() const;
+    /// Returns the values for flat index i, from the memo if possible.
+    const Index* Decompose(MemoKind kind, Index i,
+                           std::vector<Index> &buffer) const;
+    Index GetXAIndex(Index y, const Index *X, const Index *A) const;
+    void AddSuccessors(Index depth, const std::vector<size_t> &XAIndex,
+                       std::vector<Index> &Y, Index sucSI, double p,
+                       std::vector<Index> &sucSIs,
+                       std::vector<double> &probs) const;
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /// Constructor which computes the stride tables of madp's 2DBN.
+    FactoredFlatModelEvaluator(
+        const MultiAgentDecisionProcessDiscreteFactoredStates &madp,
+        const TwoStageDynamicBayesianNetwork &twoDBN);
+    /// Destructor.
+    ~FactoredFlatModelEvaluator();
+
+    /// Returns P(sucSI|sI,jaI).
+    double GetTransitionProbability(Index sI, Index jaI, Index sucSI) const;
+
+    /// Returns the successors of sI under jaI with non-zero probability
+    /// (in increasing order) and their probabilities.
+    void GetSuccessors(Index sI, Index jaI,
+                       std::vector<Index> &sucSIs,
+                       std::vector<double> &probs) const;
+
+    /// Returns the state factor values of sI.
+    /** The pointer remains valid until the next call on the same
+     * thread, buffer is used when no memo is available. */
+    const Index* GetStateFactorValues(Index sI,
+                                      std::vector<Index> &buffer) const
+        { return(Decompose(STATE,sI,buffer)); }
+    /// Returns the individual actions of jaI, see GetStateFactorValues().
+    const Index* GetIndividualActions(Index jaI,
+                                      std::vector<Index> &buffer) const
+        { return(Decompose(ACTION,jaI,buffer)); }
+
+};
+
+
+#endif /* !_FACTOREDFLATMODELEVALUATOR_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
@@ -25,6 +25,12 @@
 #include "VectorTools.h"
 #include "CPT.h"
 #include "StateFactorDiscrete.h"
+#include "FactoredFlatModelEvaluator.h"
+#include "PrintTools.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -45,12 +51,14 @@ MultiAgentDecisionProcessDiscreteFactoredStates(
     ,_m_sparse_FlatOM(false)
     ,_m_eventObservability(false)
     ,_m_2dbn(*this)
+    ,_m_flatEvaluator(0)
 {
 }
 //Copy constructor.    
 MultiAgentDecisionProcessDiscreteFactoredStates::MultiAgentDecisionProcessDiscreteFactoredStates(const MultiAgentDecisionProcessDiscreteFactoredStates& o) 
     :
         _m_2dbn(o._m_2dbn)
+        ,_m_flatEvaluator(0)
 {
 }
 //Destructor
@@ -58,6 +66,7 @@ MultiAgentDecisionProcessDiscreteFactoredStates::~MultiAgentDecisionProcessDiscr
 {
     delete _m_p_tModel;
     delete _m_p_oModel;
+    delete _m_flatEvaluator;
 }
 //Copy assignment operator
 MultiAgentDecisionProcessDiscreteFactoredStates& MultiAgentDecisionProcessDiscreteFactoredStates::operator= (const MultiAgentDecisionProcessDiscreteFactoredStates& o)
@@ -294,6 +303,8 @@ GetTransitionProbability (Index sI, Index jaI, Index sucSI) const
 {
     if(_m_cached_FlatTM)
         return _m_p_tModel->Get(sI, jaI, sucSI);
+    if(_m_flatEvaluator)
+        return _m_flatEvaluator->GetTransitionProbability(sI, jaI, sucSI);
 
     vector<Index> X = StateIndexToFactorValueIndices(sI);
     vector<Index> Y = StateIndexToFactorValueIndices(sucSI);
@@ -387,7 +398,16 @@ SampleSuccessorState(const std::vector<Index> &sIs,
                      const std::vector<Index> &aIs,
                      std::vector<Index> &sucIs) const
 {
-    sucIs=_m_2dbn.SampleY(sIs,aIs);
+    _m_2dbn.SampleY(sIs,aIs,sucIs,0);
+}
+
+void  MultiAgentDecisionProcessDiscreteFactoredStates::
+SampleSuccessorState(const std::vector<Index> &sIs,
+                     const std::vector<Index> &aIs,
+                     std::vector<Index> &sucIs,
+                     unsigned int *seed) const
+{
+    _m_2dbn.SampleY(sIs,aIs,sucIs,seed);
 }
 
 Index MultiAgentDecisionProcessDiscreteFactoredStates::
@@ -424,7 +444,17 @@ SampleJointObservation(const std::vector<Index> &sIs,
                        const std::vector<Index> &sucIs,
                        std::vector<Index> &oIs) const
 {
-    oIs=_m_2dbn.SampleO(sIs, aIs,sucIs);
+    _m_2dbn.SampleO(sIs,aIs,sucIs,oIs,0);
+}
+
+void MultiAgentDecisionProcessDiscreteFactoredStates::
+SampleJointObservation(const std::vector<Index> &sIs,
+                       const std::vector<Index> &aIs,
+                       const std::vector<Index> &sucIs,
+                       std::vector<Index> &oIs,
+                       unsigned int *seed) const
+{
+    _m_2dbn.SampleO(sIs,aIs,sucIs,oIs,seed);
 }
 
 void MultiAgentDecisionProcessDiscreteFactoredStates::
@@ -470,27 +500,112 @@ void MultiAgentDecisionProcessDiscreteFactoredStates::CacheFlatTransitionModel(b
         throw EOverflow("MultiAgentDecisionProcessDiscreteFactoredStates::CacheFlatTransitionModel() joint action indices are not available, overflow detected");
 
     if(_m_cached_FlatTM)
+    {
+        _m_cached_FlatTM = false; // otherwise the rows below would be
+                                  // read from the (new, empty) model
         delete(_m_p_tModel);
+    }
 
+    size_t nrS = GetNrStates(), nrJA = GetNrJointActions();
+    TransitionModelMappingSparse *tms = 0;
     _m_sparse_FlatTM = sparse;
     if(sparse)
-        _m_p_tModel=new TransitionModelMappingSparse(GetNrStates(),
-                                                     GetNrJointActions());
+        _m_p_tModel = tms = new TransitionModelMappingSparse(nrS, nrJA);
     else
-        _m_p_tModel=new TransitionModelMapping(GetNrStates(),
-                                               GetNrJointActions());
+        _m_p_tModel = new TransitionModelMapping(nrS, nrJA);
+
+    // The rows are computed in blocks of consecutive states for one joint
+    // action. A window of blocks is computed in parallel, after which
+    // its rows are appended to the model in order, which lets the sparse
+    // model be filled at the end of its storage.
+    const size_t blockSize = 256;
+    size_t nrBlocksPerA = (nrS + blockSize - 1) / blockSize;
+    long nrBlocks = static_cast<long>(nrBlocksPerA * nrJA);
+    long windowSize = 1;
+    // without the evaluator, the 2DBN is not safe for concurrent use
+    bool parallel = _m_flatEvaluator != 0;
+#ifdef _OPENMP
+    parallel = parallel && omp_get_max_threads() > 1 && !omp_in_parallel();
+    if(parallel)
+        windowSize = 4 * omp_get_max_threads();
+#endif
+    vector< vector<size_t> > rowEnds(windowSize);
+    vector< vector<Index> > sucSIs(windowSize);
+    vector< vector<double> > probs(windowSize);
+
+    timeval start_time;
+    gettimeofday(&start_time, NULL);
+    double lastPrint = 0;
+    for(long w = 0; w < nrBlocks; w += windowSize)
+    {
+        long wEnd = min(w + windowSize, nrBlocks);
+#pragma omp parallel for schedule(dynamic) if(parallel)
+        for(long b = w; b < wEnd; b++)
+        {
+            Index sBegin = (b % nrBlocksPerA) * blockSize;
+            ComputeFlatTransitionRows(b / nrBlocksPerA, sBegin,
+                                      min(sBegin + blockSize, nrS),
+                                      rowEnds[b-w], sucSIs[b-w], probs[b-w]);
+        }
 
+        for(long b = w; b < wEnd; b++)
+        {
+            Index jaI = b / nrBlocksPerA, sBegin = (b % nrBlocksPerA) * blockSize;
+            const vector<size_t> &rowEnd = rowEnds[b-w];
+            size_t k = 0;
+            for(Index r = 0; r < rowEnd.size(); r++)
+                for(; k < rowEnd[r]; k++)
+                {
+                    if(tms)
+                        tms->Append(sBegin + r, jaI, sucSIs[b-w][k],
+                                    probs[b-w][k]);
+                    else
+                        _m_p_tModel->Set(sBegin + r, jaI, sucSIs[b-w][k],
+                                         probs[b-w][k]);
+                }
+        }
+        PrintTools::PrintProgressETA("Caching flat transition model, block",
+                                     wEnd, nrBlocks, start_time, lastPrint);
+    }
 
-    for(Index sI=0; sI<GetNrStates(); sI++)
-        for(Index jaI=0; jaI<GetNrJointActions(); jaI++)
-            for(Index sucsI=0; sucsI<GetNrStates(); sucsI++)
+    _m_cached_FlatTM = true;
+}
+
+void MultiAgentDecisionProcessDiscreteFactoredStates::
+ComputeFlatTransitionRows(Index jaI, Index sBegin, Index sEnd,
+                          vector<size_t> &rowEnd,
+                          vector<Index> &sucSIs,
+                          vector<double> &probs) const
+{
+    rowEnd.clear();
+    sucSIs.clear();
+    probs.clear();
+    vector<Index> rowSucSIs;
+    vector<double> rowProbs;
+    for(Index sI = sBegin; sI < sEnd; sI++)
+    {
+        if(_m_flatEvaluator)
+            // only enumerates the successors within the CPTs' support
+            _m_flatEvaluator->GetSuccessors(sI, jaI, rowSucSIs, rowProbs);
+        else
+        {
+            rowSucSIs.clear();
+            rowProbs.clear();
+            for(Index sucsI = 0; sucsI < GetNrStates(); sucsI++)
             {
                 double p = GetTransitionProbability(sI, jaI, sucsI);
-                if(! Globals::EqualProbability(p, 0) )                
-                    _m_p_tModel->Set(sI, jaI, sucsI, p);
+                rowSucSIs.push_back(sucsI);
+                rowProbs.push_back(p);
             }
-
-    _m_cached_FlatTM = true;
+        }
+        for(Index k = 0; k < rowSucSIs.size(); k++)
+            if(! Globals::EqualProbability(rowProbs[k], 0) )
+            {
+                sucSIs.push_back(rowSucSIs[k]);
+                probs.push_back(rowProbs[k]);
+            }
+        rowEnd.push_back(sucSIs.size());
+    }
 }
 
 void MultiAgentDecisionProcessDiscreteFactoredStates::CacheFlatObservationModel(bool sparse)
@@ -803,10 +918,17 @@ void MultiAgentDecisionProcessDiscreteFactoredStates::Initialize2DBN(ScopeFuncto
         cout << ">>>Skipping addition of Observation model CPTs." << endl;
 #endif
     }
-    
+
+    CreateFlatModelEvaluator();
     SetInitialized(true);
 }
 
+void MultiAgentDecisionProcessDiscreteFactoredStates::CreateFlatModelEvaluator()
+{
+    delete _m_flatEvaluator;
+    _m_flatEvaluator = new FactoredFlatModelEvaluator(*this, _m_2dbn);
+}
+
 void MultiAgentDecisionProcessDiscreteFactoredStates::MarginalizeTransitionObservationModel(const Index sf, bool sparse)
 {
     const Scope& YSoI_sf = _m_2dbn.GetYSoI_Y(sf);
@@ -1112,4 +1234,5 @@ void MultiAgentDecisionProcessDiscreteFactoredStates::RemoveStateFactor(Index sf
         _m_2dbn.SetCPD_Y(i, Y_cpts[i]);
     }
     _m_2dbn.InitializeIIs();
+    CreateFlatModelEvaluator();
 }
@@ -29,6 +29,8 @@
 #include "TwoStageDynamicBayesianNetwork.h"
 #include "FSDist_COF.h"
 
+class FactoredFlatModelEvaluator;
+
 #define MADP_DFS_WARNINGS 0
 
 /**\brief MultiAgentDecisionProcessDiscreteFactoredStates is a class that 
@@ -83,6 +85,17 @@ private:
 
     TwoStageDynamicBayesianNetwork _m_2dbn;
 
+    /// Evaluates the flat transition model when it is not cached.
+    FactoredFlatModelEvaluator* _m_flatEvaluator;
+    /// (Re)creates _m_flatEvaluator for the current 2DBN.
+    void CreateFlatModelEvaluator();
+    /// Computes the non-zero entries of rows sBegin..sEnd-1 of jaI.
+    /** The entries of row sI end at rowEnd[sI-sBegin]. */
+    void ComputeFlatTransitionRows(Index jaI, Index sBegin, Index sEnd,
+                                   std::vector<size_t> &rowEnd,
+                                   std::vector<Index> &sucSIs,
+                                   std::vector<double> &probs) const;
+
     virtual void SetYScopes() = 0;
     virtual void SetOScopes() = 0;
     virtual void SetScopes()
@@ -338,6 +351,10 @@ public:
     //
     const TwoStageDynamicBayesianNetwork* Get2DBN() const
     {return &_m_2dbn;}
+    /// Returns the evaluator of the flat transition model (0 before
+    /// the 2DBN has been initialized).
+    const FactoredFlatModelEvaluator* GetFlatModelEvaluator() const
+    {return _m_flatEvaluator;}
 
 //implement the MultiAgentDecisionProcessDiscreteFactoredStatesInterface
 //(i.e., the functions not handled by MADPComponentFactoredStates )
@@ -368,6 +385,11 @@ public:
     void SampleSuccessorState(const std::vector<Index> &sIs,
                               const std::vector<Index> &aIs,
                               std::vector<Index> &sucIs) const;
+    /// Thread-safe version, samples using rand_r(seed).
+    void SampleSuccessorState(const std::vector<Index> &sIs,
+                              const std::vector<Index> &aIs,
+                              std::vector<Index> &sucIs,
+                              unsigned int *seed) const;
     Index SampleJointObservation(Index jaI, Index sucI) const;
     Index SampleJointObservation(Index sI, Index jaI, Index sucI) const;
     void SampleJointObservation(const std::vector<Index> &aIs,
@@ -378,6 +400,12 @@ public:
                                 const std::vector<Index> &aIs,
                                 const std::vector<Index> &sucIs,
                                 std::vector<Index> &oIs) const;
+    /// Thread-safe version, samples using rand_r(seed).
+    void SampleJointObservation(const std::vector<Index> &sIs,
+                                const std::vector<Index> &aIs,
+                                const std::vector<Index> &sucIs,
+                                std::vector<Index> &oIs,
+                                unsigned int *seed) const;
 
     //the following are implemented by MADPComponentFactoredStates 
     //double GetInitialStateProbability(Globals::Index) const;
@@ -0,0 +1,96 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "ObservationModelTOI.h"
+#include "TransitionObservationIndependentMADPDiscrete.h"
+#include "IndexTools.h"
+
+using namespace std;
+
+ObservationModelTOI::
+ObservationModelTOI(const TransitionObservationIndependentMADPDiscrete &toi) :
+    ObservationModelDiscrete(toi.GetNrJointStates(),toi.GetNrJointActions(),
+                             toi.GetNrJointObservations()),
+    _m_nrAgents(toi.GetNrAgents()),
+    _m_nrStates(_m_nrAgents),
+    _m_nrActions(toi.GetNrActions()),
+    _m_nrObservations(toi.GetNrObservations()),
+    _m_O(_m_nrAgents)
+{
+    for(Index i=0;i!=_m_nrAgents;++i)
+    {
+        const MultiAgentDecisionProcessDiscrete *m=toi.GetIndividualMADPD(i);
+        size_t nrS=m->GetNrStates(), nrA=_m_nrActions[i],
+            nrO=_m_nrObservations[i];
+        _m_nrStates[i]=nrS;
+
+        _m_O[i].resize(nrA*nrS*nrO);
+        for(Index a=0;a!=nrA;++a)
+            for(Index s1=0;s1!=nrS;++s1)
+                for(Index o=0;o!=nrO;++o)
+                    _m_O[i][(a*nrS+s1)*nrO+o]=
+                        m->GetObservationProbability(a,s1,o);
+    }
+    _m_stateStepSize=IndexTools::CalculateStepSizeVector(_m_nrStates);
+    _m_actionStepSize=IndexTools::CalculateStepSizeVector(_m_nrActions);
+    _m_observationStepSize=
+        IndexTools::CalculateStepSizeVector(_m_nrObservations);
+}
+
+ObservationModelTOI::~ObservationModelTOI()
+{
+}
+
+double ObservationModelTOI::Get(Index ja_i, Index suc_s_i, Index jo_i) const
+{
+    double p=1;
+    for(Index i=0;i!=_m_nrAgents && p>0;++i)
+    {
+        Index a=ja_i/_m_actionStepSize[i],
+            s1=suc_s_i/_m_stateStepSize[i],
+            o=jo_i/_m_observationStepSize[i];
+        ja_i%=_m_actionStepSize[i];
+        suc_s_i%=_m_stateStepSize[i];
+        jo_i%=_m_observationStepSize[i];
+        p*=_m_O[i][(a*_m_nrStates[i]+s1)*_m_nrObservations[i]+o];
+    }
+    return(p);
+}
+
+void ObservationModelTOI::Set(Index ja_i, Index suc_s_i, Index jo_i, double prob)
+{
+    throw(E("ObservationModelTOI::Set() the joint observation model of a TOI model is implicit, set the individual models instead"));
+}
+
+void ObservationModelTOI::GetProbabilities(Index ja_i, Index jo_i,
+                                           vector<double> &probs) const
+{
+    probs.assign(1,1.0);
+    vector<double> probsNew;
+    for(Index i=0;i!=_m_nrAgents;++i)
+    {
+        Index a=ja_i/_m_actionStepSize[i],
+            o=jo_i/_m_observationStepSize[i];
+        ja_i%=_m_actionStepSize[i];
+        jo_i%=_m_observationStepSize[i];
+        size_t nrS=_m_nrStates[i], nrO=_m_nrObservations[i];
+
+        probsNew.resize(probs.size()*nrS);
+        for(Index k=0;k!=probs.size();++k)
+            for(Index s1=0;s1!=nrS;++s1)
+                probsNew[k*nrS+s1]=probs[k]*_m_O[i][(a*nrS+s1)*nrO+o];
+        probs.swap(probsNew);
+    }
+}
@@ -0,0 +1,81 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _OBSERVATIONMODELTOI_H_
+#define _OBSERVATIONMODELTOI_H_ 1
+
+/* the include directives */
+#include <vector>
+#include "Globals.h"
+#include "ObservationModelDiscrete.h"
+
+class TransitionObservationIndependentMADPDiscrete;
+
+/**\brief ObservationModelTOI implements the joint observation model of a
+ * TransitionObservationIndependentMADPDiscrete implicitly.
+ *
+ * P(jo|ja,s') is the product of the agents' local observation
+ * probabilities, so only the local models are stored. The column
+ * P(jo|ja,.) over all joint successor states is the Kronecker product of
+ * the local columns, which GetProbabilities() computes in O(|S|).
+ */
+class ObservationModelTOI : public ObservationModelDiscrete
+{
+private:
+
+    size_t _m_nrAgents;
+    std::vector<size_t> _m_nrStates;
+    std::vector<size_t> _m_nrActions;
+    std::vector<size_t> _m_nrObservations;
+    std::vector<size_t> _m_stateStepSize;
+    std::vector<size_t> _m_actionStepSize;
+    std::vector<size_t> _m_observationStepSize;
+
+    /// _m_O[i][(a_i*nrS_i+s'_i)*nrO_i+o_i] is agent i's local model.
+    std::vector<std::vector<double> > _m_O;
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /// Constructor that copies the local models of toi.
+    ObservationModelTOI(const TransitionObservationIndependentMADPDiscrete &toi);
+
+    /// Destructor.
+    ~ObservationModelTOI();
+
+    /// Returns P(jo|ja,s')
+    double Get(Index ja_i, Index suc_s_i, Index jo_i) const;
+
+    /// The implicit model cannot be changed, this throws an E.
+    void Set(Index ja_i, Index suc_s_i, Index jo_i, double prob);
+
+    /// Computes probs(s') = P(jo|ja,s') for all joint states s'.
+    void GetProbabilities(Index ja_i, Index jo_i,
+                          std::vector<double> &probs) const;
+
+    /// Returns a pointer to a copy of this class.
+    virtual ObservationModelTOI* Clone() const
+        { return new ObservationModelTOI(*this); }
+
+};
+
+#endif /* !_OBSERVATIONMODELTOI_H_ */
+
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
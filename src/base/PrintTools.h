@@ -20,6 +20,7 @@
 #include <set>
 #include <sstream>
 #include <iomanip>
+#include "TimeTools.h"
 #include "boost/numeric/ublas/vector.hpp"
 #include "boost/numeric/ublas/vector_sparse.hpp"
 #include "boost/bimap.hpp"
@@ -329,6 +330,31 @@ static void PrintProgress(T prefix, LIndex i,
     }
 }
 
+/// Prints the progress of a long computation with an estimate of the
+/// remaining time.
+/** Prints at most once per interval seconds since start_time, so short
+ * computations remain silent. lastPrint (initially 0) holds the time of
+ * the previous print. */
+template <class T>
+static void PrintProgressETA(T prefix, LIndex i,
+                             LIndex nr, timeval start_time,
+                             double &lastPrint, double interval=10.0)
+{
+    timeval cur_time;
+    gettimeofday(&cur_time, NULL);
+    double elapsed=TimeTools::GetDeltaTimeDouble(start_time, cur_time)/1e6;
+    if(i==0 || elapsed-lastPrint < interval)
+        return;
+    lastPrint=elapsed;
+    double fraction=CastLIndexToDouble(i) / CastLIndexToDouble(nr);
+    std::streamsize precision=std::cout.precision();
+    std::cout << prefix << " "<< i << " of " << nr << " - "
+              << std::setprecision(4) << fraction * 100 << "%, "
+              << elapsed << "s elapsed, ETA "
+              << elapsed * (1 - fraction) / fraction << "s" << std::endl;
+    std::cout.precision(precision);
+}
+
 }
 
 #endif /* !_PRINTTOOLS_H_ */
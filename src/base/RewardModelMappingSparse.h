@@ -81,6 +81,15 @@ public:
 
         }
 
+    /// Sets R(s_i,ja_i) for an entry beyond all entries set so far.
+    /** Entries have to be appended in increasing order of (s_i,ja_i),
+     * see TransitionModelMappingSparse::Append(). */
+    void Append(Index s_i, Index ja_i, double rew)
+        {
+            if(fabs(rew) > REWARD_PRECISION)
+                _m_R.push_back(s_i,ja_i,rew);
+        }
+
     /// Returns a pointer to a copy of this class.
     virtual RewardModelMappingSparse* Clone() const
         { return new RewardModelMappingSparse(*this); }
@@ -75,6 +75,16 @@ public:
                 (*_m_T[jaI]).erase_element(sI,sucSI);
         }
 
+    /// Sets P(s'|s,ja) for an entry beyond all entries of ja's matrix.
+    /** Entries have to be appended in increasing order of (sI,sucSI)
+     * for every jaI. This fills the compressed matrix at the end of its
+     * storage, instead of inserting each entry as Set() does. */
+    void Append(Index sI, Index jaI, Index sucSI, double prob)
+        {
+            if(prob > PROB_PRECISION)
+                _m_T[jaI]->push_back(sI,sucSI,prob);
+        }
+
     /// Get a pointer to a transition matrix for a particular action.
     const SparseMatrix* GetMatrixPtr(Index a) const
         { return(_m_T.at(a)); }
@@ -0,0 +1,178 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "TransitionModelTOI.h"
+#include "TransitionObservationIndependentMADPDiscrete.h"
+#include "IndexTools.h"
+
+using namespace std;
+
+TransitionModelTOI::
+TransitionModelTOI(const TransitionObservationIndependentMADPDiscrete &toi) :
+    TransitionModelDiscrete(toi.GetNrJointStates(),toi.GetNrJointActions()),
+    _m_nrAgents(toi.GetNrAgents()),
+    _m_nrStates(_m_nrAgents),
+    _m_nrActions(toi.GetNrActions()),
+    _m_T(_m_nrAgents),
+    _m_rowStart(_m_nrAgents),
+    _m_successor(_m_nrAgents),
+    _m_probability(_m_nrAgents)
+{
+    for(Index i=0;i!=_m_nrAgents;++i)
+    {
+        const MultiAgentDecisionProcessDiscrete *m=toi.GetIndividualMADPD(i);
+        size_t nrS=m->GetNrStates(), nrA=_m_nrActions[i];
+        _m_nrStates[i]=nrS;
+
+        _m_T[i].resize(nrA*nrS*nrS);
+        _m_rowStart[i].push_back(0);
+        for(Index a=0;a!=nrA;++a)
+            for(Index s=0;s!=nrS;++s)
+            {
+                for(Index s1=0;s1!=nrS;++s1)
+                {
+                    double p=m->GetTransitionProbability(s,a,s1);
+                    _m_T[i][(a*nrS+s)*nrS+s1]=p;
+                    if(p>0)
+                    {
+                        _m_successor[i].push_back(s1);
+                        _m_probability[i].push_back(p);
+                    }
+                }
+                _m_rowStart[i].push_back(_m_successor[i].size());
+            }
+    }
+    _m_stateStepSize=IndexTools::CalculateStepSizeVector(_m_nrStates);
+    _m_actionStepSize=IndexTools::CalculateStepSizeVector(_m_nrActions);
+}
+
+TransitionModelTOI::~TransitionModelTOI()
+{
+}
+
+double TransitionModelTOI::Get(Index sI, Index jaI, Index sucSI) const
+{
+    double p=1;
+    for(Index i=0;i!=_m_nrAgents && p>0;++i)
+    {
+        Index s=sI/_m_stateStepSize[i],
+            s1=sucSI/_m_stateStepSize[i],
+            a=jaI/_m_actionStepSize[i];
+        sI%=_m_stateStepSize[i];
+        sucSI%=_m_stateStepSize[i];
+        jaI%=_m_actionStepSize[i];
+        p*=_m_T[i][(a*_m_nrStates[i]+s)*_m_nrStates[i]+s1];
+    }
+    return(p);
+}
+
+void TransitionModelTOI::Set(Index sI, Index jaI, Index sucSI, double prob)
+{
+    throw(E("TransitionModelTOI::Set() the joint transition model of a TOI model is implicit, set the individual models instead"));
+}
+
+void TransitionModelTOI::GetSuccessors(Index sI, Index jaI,
+                                       vector<Index> &sucSIs,
+                                       vector<double> &probs) const
+{
+    sucSIs.assign(1,0);
+    probs.assign(1,1.0);
+    vector<Index> sucSIsNew;
+    vector<double> probsNew;
+    // extend the partial successors agent by agent, agent 0 being the
+    // most significant, which keeps them in increasing order
+    for(Index i=0;i!=_m_nrAgents;++i)
+    {
+        Index s=sI/_m_stateStepSize[i],
+            a=jaI/_m_actionStepSize[i];
+        sI%=_m_stateStepSize[i];
+        jaI%=_m_actionStepSize[i];
+        Index row=a*_m_nrStates[i]+s;
+        size_t begin=_m_rowStart[i][row], end=_m_rowStart[i][row+1];
+
+        sucSIsNew.clear();
+        probsNew.clear();
+        for(Index k=0;k!=sucSIs.size();++k)
+            for(size_t e=begin;e!=end;++e)
+            {
+                sucSIsNew.push_back(sucSIs[k]+
+                                    _m_successor[i][e]*_m_stateStepSize[i]);
+                probsNew.push_back(probs[k]*_m_probability[i][e]);
+            }
+        sucSIs.swap(sucSIsNew);
+        probs.swap(probsNew);
+    }
+}
+
+void TransitionModelTOI::MultiplyAxis(Index agI, Index aI, bool transposed,
+                                      const vector<double> &in,
+                                      vector<double> &out) const
+{
+    // view in as a [L, nrS_i, R] tensor, with R the step size of agent i
+    size_t n=_m_nrStates[agI],
+        R=_m_stateStepSize[agI],
+        L=in.size()/(n*R);
+    out.assign(in.size(),0.0);
+    for(Index l=0;l!=L;++l)
+        for(Index s=0;s!=n;++s)
+        {
+            Index row=aI*n+s;
+            for(size_t e=_m_rowStart[agI][row];e!=_m_rowStart[agI][row+1];++e)
+            {
+                double p=_m_probability[agI][e];
+                Index s1=_m_successor[agI][e];
+                const double *x;
+                double *y;
+                if(transposed)
+                {
+                    x=&in[(l*n+s)*R];
+                    y=&out[(l*n+s1)*R];
+                }
+                else
+                {
+                    x=&in[(l*n+s1)*R];
+                    y=&out[(l*n+s)*R];
+                }
+                for(Index r=0;r!=R;++r)
+                    y[r]+=p*x[r];
+            }
+        }
+}
+
+void TransitionModelTOI::Multiply(Index jaI, const vector<double> &v,
+                                  vector<double> &Tv) const
+{
+    vector<double> tmp(v);
+    for(Index i=0;i!=_m_nrAgents;++i)
+    {
+        MultiplyAxis(i,jaI/_m_actionStepSize[i],false,tmp,Tv);
+        jaI%=_m_actionStepSize[i];
+        if(i+1!=_m_nrAgents)
+            tmp.swap(Tv);
+    }
+}
+
+void TransitionModelTOI::MultiplyTransposed(Index jaI, const vector<double> &b,
+                                            vector<double> &bT) const
+{
+    vector<double> tmp(b);
+    for(Index i=0;i!=_m_nrAgents;++i)
+    {
+        MultiplyAxis(i,jaI/_m_actionStepSize[i],true,tmp,bT);
+        jaI%=_m_actionStepSize[i];
+        if(i+1!=_m_nrAgents)
+            tmp.swap(bT);
+    }
+}
@@ -0,0 +1,109 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _TRANSITIONMODELTOI_H_
+#define _TRANSITIONMODELTOI_H_ 1
+
+/* the include directives */
+#include <vector>
+#include "Globals.h"
+#include "TransitionModelDiscrete.h"
+
+class TransitionObservationIndependentMADPDiscrete;
+
+/**\brief TransitionModelTOI implements the joint transition model of a
+ * TransitionObservationIndependentMADPDiscrete implicitly.
+ *
+ * In a transition-independent model the joint transition matrix for
+ * joint action a=<a_1,...,a_n> is the Kronecker product
+ * \f$ T_a = T^1_{a_1} \otimes \dots \otimes T^n_{a_n} \f$ of the
+ * agents' local transition matrices (agent 0 being the most significant
+ * index of the joint state). Only the local matrices are stored, so
+ * memory is linear in the number of agents rather than quadratic in the
+ * number of joint states.
+ *
+ * Get() multiplies local probabilities, GetSuccessors() enumerates the
+ * non-zero entries of a row as the product of the local rows, and
+ * Multiply() and MultiplyTransposed() compute \f$ T_a v \f$ and
+ * \f$ T_a^\top b \f$ by applying one local matrix per agent to the
+ * corresponding axis of v, in \f$ O(|S| \sum_i nnz(T^i)/|S_i|) \f$
+ * instead of \f$ O(|S|^2) \f$.
+ */
+class TransitionModelTOI : public TransitionModelDiscrete
+{
+private:
+
+    size_t _m_nrAgents;
+    std::vector<size_t> _m_nrStates;
+    std::vector<size_t> _m_nrActions;
+    std::vector<size_t> _m_stateStepSize;
+    std::vector<size_t> _m_actionStepSize;
+
+    /// _m_T[i][(a_i*nrS_i+s_i)*nrS_i+s'_i] is agent i's local model.
+    std::vector<std::vector<double> > _m_T;
+    /// The non-zero entries of the local rows, row (s_i,a_i) being
+    /// _m_rowStart[i][a_i*nrS_i+s_i].
+    std::vector<std::vector<size_t> > _m_rowStart;
+    std::vector<std::vector<Index> > _m_successor;
+    std::vector<std::vector<double> > _m_probability;
+
+    /// Applies T^i_{a_i} (or its transpose) to axis i of in.
+    void MultiplyAxis(Index agI, Index aI, bool transposed,
+                      const std::vector<double> &in,
+                      std::vector<double> &out) const;
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /// Constructor that copies the local models of toi.
+    TransitionModelTOI(const TransitionObservationIndependentMADPDiscrete &toi);
+
+    /// Destructor.
+    ~TransitionModelTOI();
+
+    /// Returns P(s'|s,ja)
+    double Get(Index sI, Index jaI, Index sucSI) const;
+
+    /// The implicit model cannot be changed, this throws an E.
+    void Set(Index sI, Index jaI, Index sucSI, double prob);
+
+    /// Returns the successors of sI under jaI with non-zero probability
+    /// (in increasing order) and their probabilities.
+    void GetSuccessors(Index sI, Index jaI,
+                       std::vector<Index> &sucSIs,
+                       std::vector<double> &probs) const;
+
+    /// Computes Tv(s) = \sum_{s'} P(s'|s,ja) v(s').
+    void Multiply(Index jaI, const std::vector<double> &v,
+                  std::vector<double> &Tv) const;
+
+    /// Computes bT(s') = \sum_{s} P(s'|s,ja) b(s).
+    void MultiplyTransposed(Index jaI, const std::vector<double> &b,
+                            std::vector<double> &bT) const;
+
+    /// Returns a pointer to a copy of this class.
+    virtual TransitionModelTOI* Clone() const
+        { return new TransitionModelTOI(*this); }
+
+};
+
+#endif /* !_TRANSITIONMODELTOI_H_ */
+
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
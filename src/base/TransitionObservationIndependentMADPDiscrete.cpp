@@ -18,6 +18,8 @@
 #include "TransitionModelMapping.h"
 #include "ObservationModelMappingSparse.h"
 #include "ObservationModelMapping.h"
+#include "TransitionModelTOI.h"
+#include "ObservationModelTOI.h"
 
 #include "VectorTools.h"
 
@@ -92,6 +94,9 @@ TransitionObservationIndependentMADPDiscrete::
         it2++;
     }
     _m_jointActionVec.clear();
+
+    delete _m_p_tModel;
+    delete _m_p_oModel;
 }
 
 
@@ -627,6 +632,15 @@ bool TransitionObservationIndependentMADPDiscrete::SetInitialized(bool b)
             else
                 CreateCentralizedFullModels();
         }
+        else
+        {
+            // represent the joint models implicitly by the Kronecker
+            // product of the individual models
+            delete _m_p_tModel;
+            delete _m_p_oModel;
+            _m_p_tModel = new TransitionModelTOI(*this);
+            _m_p_oModel = new ObservationModelTOI(*this);
+        }
 
 
     }
@@ -967,6 +981,7 @@ void TransitionObservationIndependentMADPDiscrete::CreateCentralizedSparseTransi
     a=b;
 #endif
 
+    delete _m_p_tModel;
     _m_p_tModel = new TransitionModelMappingSparse(_m_nrJointStates,
                                                    _m_nrJointActions);
 
@@ -1131,6 +1146,7 @@ void TransitionObservationIndependentMADPDiscrete::CreateCentralizedObservationT
         return;
     }
 
+    delete _m_p_oModel;
     _m_p_oModel = new ObservationModelMappingSparse(_m_nrJointStates,
                                                     _m_nrJointActions,
                                                     _m_nrJointObservations);
@@ -1257,6 +1273,8 @@ TransitionObservationIndependentMADPDiscrete::CreateCentralizedFullModels()
         return;
     }
 
+    delete _m_p_tModel;
+    delete _m_p_oModel;
     _m_p_tModel = new TransitionModelMapping(_m_nrJointStates,
                                              _m_nrJointActions);
     _m_p_oModel = new ObservationModelMapping(_m_nrJointStates,
@@ -28,12 +28,6 @@ TwoStageDynamicBayesianNetwork::TwoStageDynamicBayesianNetwork(
                 ,_m_nrO(0)
 {
     _m_SoIStorageInitialized = false;
-    _m_IndividualToJointYiiIndices_catVector = 0;
-    _m_IndividualToJointOiiIndices_catVector = 0;
-    _m_SampleY = 0;
-    _m_SampleO = 0;
-    _m_SampleNrO = 0;
-
 }
 /*
 //Copy constructor.    
@@ -51,35 +45,12 @@ TwoStageDynamicBayesianNetwork::~TwoStageDynamicBayesianNetwork()
 
     // delete by iterator, as temporary data may not be allocated when
     // reading from disk
-    { std::vector<std::vector<Index>* >::iterator it;
-        for (it=_m_X_restr_perY.begin();it!=_m_X_restr_perY.end();it++)
-            delete *it;
-        for (it=_m_A_restr_perY.begin();it!=_m_A_restr_perY.end();it++)
-            delete *it;
-        for (it=_m_Y_restr_perY.begin();it!=_m_Y_restr_perY.end();it++)
-            delete *it;
-
-        for (it=_m_X_restr_perO.begin();it!=_m_X_restr_perO.end();it++)
-            delete *it;
-        for (it=_m_A_restr_perO.begin();it!=_m_A_restr_perO.end();it++)
-            delete *it;
-        for (it=_m_Y_restr_perO.begin();it!=_m_Y_restr_perO.end();it++)
-            delete *it;
-        for (it=_m_O_restr_perO.begin();it!=_m_O_restr_perO.end();it++)
-            delete *it;
-    }
     { std::vector<size_t*>::iterator it;
         for (it=_m_nrVals_SoI_Y_stepsize.begin();it!=_m_nrVals_SoI_Y_stepsize.end();it++)
             delete [] *it;
         for (it=_m_nrVals_SoI_O_stepsize.begin();it!=_m_nrVals_SoI_O_stepsize.end();it++)
             delete [] *it;
     }
-
-    delete _m_IndividualToJointYiiIndices_catVector;
-    delete _m_IndividualToJointOiiIndices_catVector;
-    delete _m_SampleY;
-    delete _m_SampleO;
-    delete _m_SampleNrO;
 }
 /*
 //Copy assignment operator
@@ -417,75 +388,59 @@ GetYOProbability(       const Scope& X, const vector<Index>& Xs,
     }
     return(p);
 }
+const size_t* TwoStageDynamicBayesianNetwork::
+AddToIIIndex(const vector<Index>& vals,
+             const Scope& sc,
+             const size_t* stepsize,
+             Index& iiI) const
+{
+    size_t scSize = sc.size();
+    for(Index s_I = 0; s_I < scSize; s_I++)
+        iiI += vals[sc[s_I]] * stepsize[s_I];
+    return(stepsize + scSize);
+}
+
+const size_t* TwoStageDynamicBayesianNetwork::
+AddToIIIndex(const vector<Index>& restrVals,
+             const size_t* stepsize,
+             Index& iiI) const
+{
+    size_t n = restrVals.size();
+    for(Index s_I = 0; s_I < n; s_I++)
+        iiI += restrVals[s_I] * stepsize[s_I];
+    return(stepsize + n);
+}
+
 ///Sample a NS state
 vector<Index> TwoStageDynamicBayesianNetwork::
 SampleY(  const vector<Index>& X,
                         const vector<Index>& A) const
 {
-    for(Index y=0; y < _m_nrY; y++)
-    {
-        IndexTools::RestrictIndividualIndicesToScope(X, GetXSoI_Y(y), 
-                *_m_X_restr_perY[y]);
-        IndexTools::RestrictIndividualIndicesToScope(A, GetASoI_Y(y), 
-                *_m_A_restr_perY[y]);
-        //because Y->Y dependencies can only depend on lower index, we have already
-        //sampled the relevant Y's in _m_SampleY:
-        IndexTools::RestrictIndividualIndicesToScope(*_m_SampleY, GetYSoI_Y(y), 
-                *_m_Y_restr_perY[y]);
-        Index iiI = IndividualToJointYiiIndices(y,
-                                                *_m_X_restr_perY[y],
-                                                *_m_A_restr_perY[y],
-                                                *_m_Y_restr_perY[y]);
-        Index sampledYVal = _m_Y_CPDs[y]->Sample(iiI);
-        (*_m_SampleY)[y] = sampledYVal;    
-    }
-    return(*_m_SampleY);
-    /*
-    double randNr=rand() / (RAND_MAX + 1.0);
-
-    double sum=0;
-
+    vector<Index> Y;
+    SampleY(X, A, Y, 0);
+    return(Y);
+}
 
+void TwoStageDynamicBayesianNetwork::
+SampleY(  const vector<Index>& X,
+          const vector<Index>& A,
+          vector<Index>& Y,
+          unsigned int *seed) const
+{
+    Y.resize(_m_nrY);
     for(Index y=0; y < _m_nrY; y++)
     {
-        IndexTools::RestrictIndividualIndicesToScope(X, GetXSoI_Y(y), 
-                *_m_X_restr_perY[y]);
-        IndexTools::RestrictIndividualIndicesToScope(A, GetASoI_Y(y), 
-                *_m_A_restr_perY[y]);
-        (*_m_SampleY)[y]=0;    
+        // the ii index is computed from the full vectors, which avoids
+        // any (shared) temporary storage
+        Index iiI = 0;
+        const size_t* stepsize = _m_nrVals_SoI_Y_stepsize[y];
+        stepsize = AddToIIIndex(X, GetXSoI_Y(y), stepsize, iiI);
+        stepsize = AddToIIIndex(A, GetASoI_Y(y), stepsize, iiI);
+        //because Y->Y dependencies can only depend on lower index, we have
+        //already sampled the relevant Y's:
+        AddToIIIndex(Y, GetYSoI_Y(y), stepsize, iiI);
+        Y[y] = _m_Y_CPDs[y]->Sample(iiI, seed);
     }
-
-    do {
-        
-        double p = 1.0;
-        for(Index y=0; y < _m_SampleY->size(); y++)
-        {
-            IndexTools::RestrictIndividualIndicesToScope(*_m_SampleY, GetYSoI_Y(y),
-                                                         *_m_Y_restr_perY[y] );
-            Index iiI = IndividualToJointYiiIndices(y,
-                                                    *_m_X_restr_perY[y],
-                                                    *_m_A_restr_perY[y],
-                                                    *_m_Y_restr_perY[y]);
-            Index yVal = (*_m_SampleY)[y];
-            double p_y = _m_Y_CPDs[y]->Get(yVal, iiI);
-            p *= p_y;
-            // if the probability is 0, there is no need to check the
-            // rest of the Ys
-            //if(EqualProbability(p,0.0))
-            //    break;
-        }
-        sum+=p;
-#if 0
-        cout << "Y " << SoftPrintVector(Y) << " : " << p << " sum " 
-             << sum << " rand " << randNr << endl;
-#endif
-        if(randNr<=sum)
-            break;
-
-    } while(! IndexTools::Increment( *_m_SampleY,_m_madp->GetNrValuesPerFactor()));// _m_Yii_size_Y) );
-
-    return(*_m_SampleY);
-    */
 }
 
 ///Sample an observation.
@@ -494,73 +449,31 @@ SampleO(  const vector<Index>& X,
           const vector<Index>& A,
           const vector<Index>& Y) const
 {
-    for(Index o=0; o < _m_nrO; o++)
-    {
-        IndexTools::RestrictIndividualIndicesToScope(X, GetXSoI_O(o), 
-                *_m_X_restr_perO[o]);
-        IndexTools::RestrictIndividualIndicesToScope(A, GetASoI_O(o), 
-                *_m_A_restr_perO[o]);
-        IndexTools::RestrictIndividualIndicesToScope(Y, GetYSoI_O(o), 
-                *_m_Y_restr_perO[o] );
-        //because O->O dependencies can only depend on lower index, we have already
-        //sampled the relevant O's in _m_SampleO:
-        IndexTools::RestrictIndividualIndicesToScope(
-                *_m_SampleO, GetOSoI_O(o), *_m_O_restr_perO[o] );
-        Index iiI = IndividualToJointOiiIndices(o,
-                                                *_m_X_restr_perO[o],
-                                                *_m_A_restr_perO[o],
-                                                *_m_Y_restr_perO[o],
-                                                *_m_O_restr_perO[o]);
-        Index sampledOVal = _m_O_CPDs[o]->Sample(iiI);
-        (*_m_SampleO)[o] = sampledOVal;    
-    }
-    return(*_m_SampleO);
-/*    
-    double randNr=rand() / (RAND_MAX + 1.0);
+    vector<Index> O;
+    SampleO(X, A, Y, O, 0);
+    return(O);
+}
 
-    double sum=0;
-    
+void TwoStageDynamicBayesianNetwork::
+SampleO(  const vector<Index>& X,
+          const vector<Index>& A,
+          const vector<Index>& Y,
+          vector<Index>& O,
+          unsigned int *seed) const
+{
+    O.resize(_m_nrO);
     for(Index o=0; o < _m_nrO; o++)
     {
-        IndexTools::RestrictIndividualIndicesToScope(A, GetASoI_O(o), 
-                *_m_A_restr_perO[o] );
-        IndexTools::RestrictIndividualIndicesToScope(Y, GetYSoI_O(o), 
-                *_m_Y_restr_perO[o] );
-        (*_m_SampleO)[o]=0;    
+        Index iiI = 0;
+        const size_t* stepsize = _m_nrVals_SoI_O_stepsize[o];
+        stepsize = AddToIIIndex(X, GetXSoI_O(o), stepsize, iiI);
+        stepsize = AddToIIIndex(A, GetASoI_O(o), stepsize, iiI);
+        stepsize = AddToIIIndex(Y, GetYSoI_O(o), stepsize, iiI);
+        //because O->O dependencies can only depend on lower index, we have
+        //already sampled the relevant O's:
+        AddToIIIndex(O, GetOSoI_O(o), stepsize, iiI);
+        O[o] = _m_O_CPDs[o]->Sample(iiI, seed);
     }
-
-    do {
-        
-        double p = 1.0;
-        for(Index o=0; o < _m_SampleO->size(); o++)
-        {
-            IndexTools::RestrictIndividualIndicesToScope(
-                    *_m_SampleO, GetOSoI_O(o), *_m_O_restr_perO[o] );
-            Index iiI = IndividualToJointOiiIndices(o,
-                                                    *_m_A_restr_perO[o],
-                                                    *_m_Y_restr_perO[o],
-                                                    *_m_O_restr_perO[o]);
-            Index oVal = (*_m_SampleO)[o];
-            double p_o = _m_O_CPDs[o]->Get(oVal, iiI);
-            p *= p_o;
-            // if the probability is 0, there is no need to check the
-            // rest of the Os
-            if(EqualProbability(p,0.0))
-                break;
-        }
-
-        sum+=p;
-#if 0
-        cout << "O " << SoftPrintVector(O) << " : " << p << " sum " 
-             << sum << " rand " << randNr << endl;
-#endif
-        if(randNr<=sum)
-            break;
-
-    } while(! IndexTools::Increment( *_m_SampleO, *_m_SampleNrO) );
-
-    return(*_m_SampleO);
-    */
 }
 
 #define DEBUG_INIT_SOIs 0
@@ -601,12 +514,6 @@ void TwoStageDynamicBayesianNetwork::InitializeStorage()
     cout << this->SoftPrint() << "<<<<<<<<"<<endl;
 #endif
 
-    _m_SampleY=new vector<Index>(_m_nrY);
-    _m_SampleO=new vector<Index>(_m_nrO);
-    _m_SampleNrO=new vector<size_t>(_m_nrO);
-    for(Index o=0; o < _m_SampleNrO->size(); o++)
-        (*_m_SampleNrO)[o]=_m_madp->GetNrObservations(o);
-
     _m_SoIStorageInitialized = true;
 }
 
@@ -831,58 +738,18 @@ void TwoStageDynamicBayesianNetwork::InitializeIIs()
         _m_nrVals_SoI_O.at(oI).insert(  pos, it1, it2 );
     }
 
-    // initialize some memory and variables used to speed up index
-    // conversion functions
-    _m_IndividualToJointYiiIndices_catVector=new vector<Index>(_m_nrVals_SoI_Y.size());
-    _m_IndividualToJointOiiIndices_catVector=new vector<Index>(_m_nrVals_SoI_O.size());
-
+    // initialize the step sizes used to speed up index conversion functions
     _m_nrVals_SoI_Y_stepsize.resize(_m_nrY);
     for(Index yI=0; yI < _m_nrY; yI++)
         _m_nrVals_SoI_Y_stepsize[yI]=
             IndexTools::CalculateStepSize(_m_nrVals_SoI_Y[yI]);
 
-    for(size_t i = 0; i < _m_X_restr_perY.size(); i++)
-      delete(_m_X_restr_perY[i]);
-    _m_X_restr_perY.clear();
-    for(size_t i = 0; i < _m_A_restr_perY.size(); i++)
-      delete(_m_A_restr_perY[i]);
-    _m_A_restr_perY.clear();
-    for(size_t i = 0; i < _m_Y_restr_perY.size(); i++)
-      delete(_m_Y_restr_perY[i]);
-    _m_Y_restr_perY.clear();
-    for(Index y=0; y < _m_nrY; y++)
-    {
-        _m_X_restr_perY.push_back(new vector<Index>(GetXSoI_Y(y).size()));
-        _m_A_restr_perY.push_back(new vector<Index>(GetASoI_Y(y).size()));
-        _m_Y_restr_perY.push_back(new vector<Index>(GetYSoI_Y(y).size()));
-    }
-
     _m_nrVals_SoI_O_stepsize.resize(_m_nrO);
     
     for(Index oI=0; oI < _m_nrO; oI++)
         _m_nrVals_SoI_O_stepsize[oI]=
             IndexTools::CalculateStepSize(_m_nrVals_SoI_O[oI]);
 
-    for(size_t i = 0; i < _m_X_restr_perO.size(); i++)
-      delete(_m_X_restr_perO[i]);
-    _m_X_restr_perO.clear();
-    for(size_t i = 0; i < _m_A_restr_perO.size(); i++)
-      delete(_m_A_restr_perO[i]);
-    _m_A_restr_perO.clear();
-    for(size_t i = 0; i < _m_Y_restr_perO.size(); i++)
-      delete(_m_Y_restr_perO[i]);
-    _m_Y_restr_perO.clear();    
-    for(size_t i = 0; i < _m_O_restr_perO.size(); i++)
-      delete(_m_O_restr_perO[i]);
-    _m_O_restr_perO.clear();
-    for(Index o=0; o < _m_nrO; o++)
-    {
-        _m_X_restr_perO.push_back(new vector<Index>(GetXSoI_O(o).size()));
-        _m_A_restr_perO.push_back(new vector<Index>(GetASoI_O(o).size()));
-        _m_Y_restr_perO.push_back(new vector<Index>(GetYSoI_O(o).size()));
-        _m_O_restr_perO.push_back(new vector<Index>(GetOSoI_O(o).size()));
-    }
-
     _m_ii_initialized = true;
 }
 
@@ -1043,27 +910,11 @@ IndividualToJointYiiIndices(Index y,
         const vector<Index>& As, 
         const vector<Index>& Ys) const
 {
-    _m_IndividualToJointYiiIndices_catVector->clear();
-    _m_IndividualToJointYiiIndices_catVector->insert(
-        _m_IndividualToJointYiiIndices_catVector->end(), Xs.begin(), Xs.end() );
-    _m_IndividualToJointYiiIndices_catVector->insert(
-        _m_IndividualToJointYiiIndices_catVector->end(), As.begin(), As.end() );
-    _m_IndividualToJointYiiIndices_catVector->insert(
-        _m_IndividualToJointYiiIndices_catVector->end(), Ys.begin(), Ys.end() );
-        
-    Index iiI = IndexTools::IndividualToJointIndicesStepSize(
-        *_m_IndividualToJointYiiIndices_catVector,
-        _m_nrVals_SoI_Y_stepsize[y] );
-
-#if 0    
-    size_t iiS = GetiiSize_Y(y);
-    if( iiI >= iiS)
-    {
-        cerr << "error in index computation, let's see what happened"<<endl;
-        iiI = IndexTools::IndividualToJointIndices(catVector,
-            _m_nrVals_SoI_Y[y] );
-    }
-#endif
+    Index iiI = 0;
+    const size_t* stepsize = _m_nrVals_SoI_Y_stepsize[y];
+    stepsize = AddToIIIndex(Xs, stepsize, iiI);
+    stepsize = AddToIIIndex(As, stepsize, iiI);
+    AddToIIIndex(Ys, stepsize, iiI);
     return iiI;
 
 }
@@ -1136,17 +987,11 @@ IndividualToJointOiiIndices(Index o,
         const vector<Index>& Ys, 
         const vector<Index>& Os) const
 {
-    _m_IndividualToJointOiiIndices_catVector->clear();
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), As.begin(), As.end() );
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), Ys.begin(), Ys.end() );
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), Os.begin(), Os.end() );
-
-    Index iiI = IndexTools::IndividualToJointIndicesStepSize(
-        *_m_IndividualToJointOiiIndices_catVector,
-        _m_nrVals_SoI_O_stepsize[o] );
+    Index iiI = 0;
+    const size_t* stepsize = _m_nrVals_SoI_O_stepsize[o];
+    stepsize = AddToIIIndex(As, stepsize, iiI);
+    stepsize = AddToIIIndex(Ys, stepsize, iiI);
+    AddToIIIndex(Os, stepsize, iiI);
     return iiI;
 
 }
@@ -1158,19 +1003,12 @@ IndividualToJointOiiIndices(Index o,
         const vector<Index>& Ys, 
         const vector<Index>& Os) const
 {
-    _m_IndividualToJointOiiIndices_catVector->clear();
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), Xs.begin(), Xs.end() );
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), As.begin(), As.end() );
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), Ys.begin(), Ys.end() );
-    _m_IndividualToJointOiiIndices_catVector->insert(
-        _m_IndividualToJointOiiIndices_catVector->end(), Os.begin(), Os.end() );
-
-    Index iiI = IndexTools::IndividualToJointIndicesStepSize(
-        *_m_IndividualToJointOiiIndices_catVector,
-        _m_nrVals_SoI_O_stepsize[o] );
+    Index iiI = 0;
+    const size_t* stepsize = _m_nrVals_SoI_O_stepsize[o];
+    stepsize = AddToIIIndex(Xs, stepsize, iiI);
+    stepsize = AddToIIIndex(As, stepsize, iiI);
+    stepsize = AddToIIIndex(Ys, stepsize, iiI);
+    AddToIIIndex(Os, stepsize, iiI);
     return iiI;
 
 }
@@ -181,28 +181,23 @@ class TwoStageDynamicBayesianNetwork
         ///Computes the 'closure' of NS variables Y and O.
         void ComputeWithinNextStageClosure(Scope& Y, Scope& O) const;
 
-        /// Temporary storage used in IndividualToJointYiiIndices.
-        std::vector<Index> *_m_IndividualToJointYiiIndices_catVector;
         /// Cache the step size for speed.
         std::vector<size_t*> _m_nrVals_SoI_Y_stepsize;
-        /// Temporary storage used in IndividualToJointOiiIndices.
-        std::vector<Index> *_m_IndividualToJointOiiIndices_catVector;
         /// Cache the step size for speed.
         std::vector<size_t*> _m_nrVals_SoI_O_stepsize;
-        /// Temporary storage used in SampleY.
-        std::vector<Index> *_m_SampleY;
-        std::vector<std::vector<Index>* > _m_X_restr_perY;
-        std::vector<std::vector<Index>* > _m_A_restr_perY;
-        std::vector<std::vector<Index>* > _m_Y_restr_perY;
-
-        /// Temporary storage used in SampleO.
-        std::vector<Index> *_m_SampleO;
-        std::vector<std::vector<Index>* > _m_X_restr_perO;
-        std::vector<std::vector<Index>* > _m_A_restr_perO;
-        std::vector<std::vector<Index>* > _m_Y_restr_perO;
-        std::vector<std::vector<Index>* > _m_O_restr_perO;
-        /// Temporary storage used in SampleO.
-        std::vector<size_t> *_m_SampleNrO;
+
+        /// Adds the values of the variables in sc to iiI, with the step
+        /// sizes starting at stepsize.
+        /**vals holds the values of all variables (not only those in sc).
+         * Returns the step sizes following those of sc.*/
+        const size_t* AddToIIIndex(const std::vector<Index>& vals,
+                                   const Scope& sc,
+                                   const size_t* stepsize,
+                                   Index& iiI) const;
+        /// As above, for values restricted to the scope already.
+        const size_t* AddToIIIndex(const std::vector<Index>& restrVals,
+                                   const size_t* stepsize,
+                                   Index& iiI) const;
 
     protected:
     
@@ -356,6 +351,8 @@ class TwoStageDynamicBayesianNetwork
 
         CPDDiscreteInterface* GetCPD_Y(Index yI)
         { return(_m_Y_CPDs.at(yI)); }
+        const CPDDiscreteInterface* GetCPD_Y(Index yI) const
+        { return(_m_Y_CPDs.at(yI)); }
         ///Set the CPDDiscreteInterface for O
         CPDDiscreteInterface* GetCPD_O(Index oI)
         { return(_m_O_CPDs.at(oI)); }
@@ -446,6 +443,15 @@ class TwoStageDynamicBayesianNetwork
         ///Sample a NS state
         std::vector<Index> SampleY(  const std::vector<Index>& X,
                                      const std::vector<Index>& A) const;
+        ///Sample a NS state into Y, using rand_r(seed).
+        /**Sampling does not modify the 2DBN, so different threads can
+         * sample concurrently, each with its own Y and seed. Y is resized
+         * to the number of state factors, so no memory is allocated when
+         * it is reused. If seed is 0, rand() is used instead.*/
+        void SampleY(  const std::vector<Index>& X,
+                       const std::vector<Index>& A,
+                       std::vector<Index>& Y,
+                       unsigned int *seed) const;
         ///Sample an observation.
         std::vector<Index> SampleO(  const std::vector<Index>& A,
                                      const std::vector<Index>& Y) const
@@ -454,6 +460,13 @@ class TwoStageDynamicBayesianNetwork
         std::vector<Index> SampleO(  const std::vector<Index>& X,
                                      const std::vector<Index>& A,
                                      const std::vector<Index>& Y) const;
+        ///Sample an observation into O, using rand_r(seed).
+        /**See SampleY(X, A, Y, seed).*/
+        void SampleO(  const std::vector<Index>& X,
+                       const std::vector<Index>& A,
+                       const std::vector<Index>& Y,
+                       std::vector<Index>& O,
+                       unsigned int *seed) const;
 
         ///Perfom the Stat and Agent Scope backup
         /**this function is called by StateScopeBackup and  
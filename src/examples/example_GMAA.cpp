@@ -257,14 +257,16 @@ void GetBGIPSolverCreatorInstances(
                     args.maxplus_maxiter, args.maxplus_updateT, 
                     args.maxplus_verbose, args.maxplus_damping, 
                     args.k,//<- nr solutions to return by BG solver
-                    args.maxplus_nrRestarts
+                    args.maxplus_nrRestarts,
+                    args.maxplus_nrThreads
                     );
             else
                 bgipsc_p = new BGIP_SolverCreator_MP<JointPolicyPureVector> (
                     args.maxplus_maxiter, args.maxplus_updateT, 
                     args.maxplus_verbose, args.maxplus_damping, 
                     args.k,//<- nr solutions to return by BG solver
-                    args.maxplus_nrRestarts
+                    args.maxplus_nrRestarts,
+                    args.maxplus_nrThreads
                     );
             break;
         case BnB:
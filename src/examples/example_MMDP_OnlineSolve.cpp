@@ -21,6 +21,8 @@
 #include "directories.h"
 
 #include "AgentQLearner.h"
+#include "AgentOnlinePlanningMDP.h"
+#include "OnlineMDPPlannerMCTS.h"
 
 #include "MDPValueIteration.h"
 #include "QTable.h"
@@ -36,6 +38,7 @@ const char *argp_program_version = "example_MMDP_OnlineSolve";
 // Program documentation
 static char doc[] =
 "example_MMDP_OnlineSolve - loads an MMDP problem, and learns a policy online with Q-learning. \
+It also plans online with Monte-Carlo tree search. \
 This only works for infinite horizon, so you have the specify a discount < 1. \
 \vFor more information please consult the MADP documentation. \
 \
@@ -87,6 +90,25 @@ double runSimulations(const PlanningUnitDecPOMDPDiscrete *pu,
     return avgReward;
 }
 
+double runMCTSSimulations(const PlanningUnitDecPOMDPDiscrete *pu,
+                          const SimulationDecPOMDPDiscrete &sim)
+{
+    // all agents share one planner, which only agent 0 uses to search
+    OnlineMDPPlannerMCTS planner(pu);
+    planner.SetIterationBudget(200);
+
+    vector<AgentFullyObservable*> agents;
+    for(Index i=0; i < pu->GetNrAgents(); i++)
+        agents.push_back(new AgentOnlinePlanningMDP(pu, i, &planner));
+    SimulationResult result = sim.RunSimulations(agents);
+
+    double avgReward = result.GetAvgReward();
+    for(Index i=0; i < pu->GetNrAgents(); i++)
+        delete agents[i];
+
+    return avgReward;
+}
+
 int main(int argc, char **argv)
 {
     ArgumentHandlers::Arguments args;
@@ -124,6 +146,10 @@ int main(int argc, char **argv)
         r = runSimulations(np, sim);
         cout << "Avg reward of "<< nrRuns << " simulations: " << r << endl << endl;
 
+        r = runMCTSSimulations(np, sim);
+        cout << "Avg reward of "<< nrRuns << " simulations with MCTS: "
+             << r << endl << endl;
+
     }
     catch(E& e){ e.Print(); }
 
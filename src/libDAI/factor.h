@@ -404,6 +404,23 @@ namespace libDAI {
 
         TFactor<T> res( ns, 0.0 );
 
+        if( ns.size() == 1 ) {
+            // marginal of a single variable: loop over contiguous blocks
+            // rather than stepping an Index (same order of additions)
+            VarStride st( *ns.begin(), _vs );
+            const T* p = &(_p.p()[0]);
+            std::vector<T> & r = res._p.p();
+            for( size_t hi = 0; hi < st.outer; hi++ )
+                for( size_t s = 0; s < st.states; s++ ) {
+                    const T* block = p + st.offset(s, hi);
+                    T sum = r[s];
+                    for( size_t lo = 0; lo < st.stride; lo++ )
+                        sum += block[lo];
+                    r[s] = sum;
+                }
+            return res;
+        }
+
         Index i_res( ns, _vs );
         for( size_t i = 0; i < _p.size(); i++, ++i_res )
             res._p[i_res] += _p[i];
@@ -419,6 +436,22 @@ namespace libDAI {
         //TFactor<T> res( ns, 0.0 );
         TFactor<T> res( ns, -INFINITY); //initialize on -infty for maximization
 
+        if( ns.size() == 1 ) {
+            // as in partSum: contiguous max-reduction per state of ns
+            VarStride st( *ns.begin(), _vs );
+            const T* p = &(_p.p()[0]);
+            std::vector<T> & r = res._p.p();
+            for( size_t hi = 0; hi < st.outer; hi++ )
+                for( size_t s = 0; s < st.states; s++ ) {
+                    const T* block = p + st.offset(s, hi);
+                    T m = r[s];
+                    for( size_t lo = 0; lo < st.stride; lo++ )
+                        m = std::max(m, block[lo]);
+                    r[s] = m;
+                }
+            return res;
+        }
+
         Index i_res( ns, _vs );
         for( size_t i = 0; i < _p.size(); i++, ++i_res )
             res._p[i_res] = std::max(res._p[i_res], _p[i]);
@@ -439,6 +472,36 @@ namespace libDAI {
     template<typename T> TFactor<T> TFactor<T>::operator* (const TFactor<T>& Q) const {
         TFactor<T> prod( _vs | Q._vs, 0.0 );
 
+        // the common shapes (equal variables, or one of the factors over a
+        // single variable of the other) are done without Index
+        if( _vs == Q._vs ) {
+            for( size_t i = 0; i < prod._p.size(); i++ )
+                prod._p[i] += _p[i] * Q._p[i];
+            return prod;
+        }
+        if( Q._vs.size() == 1 && (_vs && *Q._vs.begin()) ) {
+            VarStride st( *Q._vs.begin(), _vs );
+            for( size_t hi = 0; hi < st.outer; hi++ )
+                for( size_t s = 0; s < st.states; s++ ) {
+                    size_t o = st.offset(s, hi);
+                    T q = Q._p[s];
+                    for( size_t lo = o; lo < o + st.stride; lo++ )
+                        prod._p[lo] += _p[lo] * q;
+                }
+            return prod;
+        }
+        if( _vs.size() == 1 && (Q._vs && *_vs.begin()) ) {
+            VarStride st( *_vs.begin(), Q._vs );
+            for( size_t hi = 0; hi < st.outer; hi++ )
+                for( size_t s = 0; s < st.states; s++ ) {
+                    size_t o = st.offset(s, hi);
+                    T p = _p[s];
+                    for( size_t lo = o; lo < o + st.stride; lo++ )
+                        prod._p[lo] += p * Q._p[lo];
+                }
+            return prod;
+        }
+
         Index i1(_vs, prod._vs);
         Index i2(Q._vs, prod._vs);
 
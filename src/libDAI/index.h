@@ -156,6 +156,55 @@ namespace libDAI {
             // FIXME add an iterator, which increases a vector index just using addition
     };
 
+    /** VarStride describes where a single variable v lives in the linear
+     * index of the joint states of a VarSet vs that contains it.
+     *
+     * Since vs is ordered by label, the linear index r of a joint state
+     * can be written as r = lo + stride * (s + states * hi), with s the
+     * state of v, lo < stride the joint state of the variables with a
+     * smaller label and hi < outer that of the variables with a larger
+     * label. With st = VarStride(v, vs), loops over a factor can thus be
+     * written as
+     *
+     * for( size_t hi = 0; hi < st.outer; hi++ )
+     *     for( size_t s = 0; s < st.states; s++ )
+     *         for( size_t lo = 0; lo < st.stride; lo++ )
+     *             // r = st.offset(s, hi) + lo
+     *
+     * where the innermost loop runs over contiguous entries (and can be
+     * vectorized by the compiler), rather than stepping an Index.
+     */
+    class VarStride {
+        public:
+            size_t stride;
+            size_t states;
+            size_t outer;
+
+            VarStride() : stride(1), states(1), outer(1) {}
+            VarStride(const Var& v, const VarSet& vs) :
+                stride(1), states(v.states()), outer(1)
+            {
+#ifdef DEBUG
+                assert( vs && v );
+#endif
+                for( VarSet::const_iterator n = vs.begin(); n != vs.end(); n++ )
+                    if( n->label() < v.label() )
+                        stride *= n->states();
+                    else if( n->label() > v.label() )
+                        outer *= n->states();
+            }
+
+            /// the linear index of the first entry with v in state s and
+            /// the variables with a larger label in joint state hi
+            size_t offset(size_t s, size_t hi) const
+            { return( stride * (s + states * hi) ); }
+
+            /// converts the linear index r of a joint state of vs \ v to
+            /// the index of that joint state with v in state 0 in vs
+            size_t embed(size_t r) const
+            { return( (r % stride) + stride * states * (r / stride) ); }
+    };
+
 }
 
 
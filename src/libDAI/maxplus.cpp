@@ -38,6 +38,10 @@
 #include "exceptions.h"
 #include "MADP_util.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 //verboseness levels:
 //0 - silent
@@ -57,6 +61,16 @@ namespace libDAI {
     const char *MaxPlus::Name = "MaxPlus";
 
 
+    namespace {
+        /// Random number generator for random_shuffle that uses rand_r()
+        struct SeededRandom {
+            unsigned int* seed;
+            SeededRandom( unsigned int* s ) : seed(s) {}
+            ptrdiff_t operator()( ptrdiff_t n ) { return rand_r(seed) % n; }
+        };
+    }
+
+
     bool MaxPlus::initProps() {
         if( !HasProperty("updates") )
             return false;
@@ -75,6 +89,10 @@ namespace libDAI {
             Props.damping = FromStringTo<double>("damping");
         else
             Props.damping = 0.0;
+        if( HasProperty("threads") )
+            Props.threads = FromStringTo<size_t>("threads");
+        else
+            Props.threads = 1;
 
         return true;
     }
@@ -82,12 +100,14 @@ namespace libDAI {
 
     MaxPlus::MaxPlus(const FactorGraph & fg, const Properties &opts, size_t k ) 
         : 
-            DAIAlgFG(fg, opts), Props(), _maxdiff(0.0), _iterations(0UL), 
-            _indices(), _messages(), _newmessages(),
+            //fg is not copied into DAIAlgFG: all access goes via _g
+            DAIAlgFG(opts), Props(), _maxdiff(0.0), _iterations(0UL), 
+            _strides(), _messages(), _newmessages(),
             _g(&fg) , bestConfiguration( fg.nrVars() ), 
             _k(k),
             _k_th_Val(-DBL_MAX),
-            writeAnyTimeResults(false), results_f(NULL), timings_f(NULL)
+            writeAnyTimeResults(false), results_f(NULL), timings_f(NULL),
+            _useSeed(false), _seed(0)
     {
         if( !initProps() )
             DAI_THROW(NOT_ALL_PROPERTIES_SPECIFIED);
@@ -96,22 +116,17 @@ namespace libDAI {
         _messages.clear();
         _messages.reserve(grm().nrEdges());
 
-        // clear indices
-        _indices.clear();
-        _indices.reserve(grm().nrEdges());
+        // clear strides
+        _strides.clear();
+        _strides.reserve(grm().nrEdges());
 
-        // create messages and indices
+        // create messages and strides
         for( size_t iI = 0; iI < grm().nrEdges(); iI++ ) {
             size_t i = grm().edge(iI).first;
             size_t I = grm().edge(iI).second;
 
             _messages.push_back( Prob( grm().var(i).states() ) );
-
-            vector<size_t> ind( grm().factor(I).stateSpace(), 0 );
-            Index indi (grm().var(i), grm().factor(I).vars() );
-            for( size_t j = 0; indi >= 0; ++indi,++j )
-                ind[j] = indi; 
-            _indices.push_back( ind );
+            _strides.push_back( VarStride( grm().var(i), grm().factor(I).vars() ) );
         }
 
         // create new_messages
@@ -127,11 +142,25 @@ namespace libDAI {
             //mij->fill(0.0 ); //FRANS Max-plus initialized on 0.0
             mij->fill( (double) rand() * 50 / RAND_MAX ); //FRANS Max-plus initialized on 0.0
         _newmessages = _messages;
+        _useSeed = false;
         if( Props.verbose >= 1)
             cout << "Max-plus initialized at verbose="<<Props.verbose<<endl;
     }
 
 
+    void MaxPlus::initWithSeed( unsigned int seed ) {
+        if( !initProps() )
+            DAI_THROW(NOT_ALL_PROPERTIES_SPECIFIED);
+        _useSeed = true;
+        _seed = seed;
+        for( vector<Prob>::iterator mij = _messages.begin(); mij != _messages.end(); mij++ )
+            mij->fill( (double) rand_r(&_seed) * 50 / RAND_MAX );
+        _newmessages = _messages;
+        if( Props.verbose >= 1)
+            cout << "Max-plus initialized at verbose="<<Props.verbose<<" with seed "<<seed<<endl;
+    }
+
+
     void MaxPlus::calcNewMessage (size_t iI) 
     { 
         const FactorGraph& g = grm();
@@ -158,8 +187,8 @@ namespace libDAI {
                 //if( Props.verbose >= 5)
                     //cout << "\t\tneighbor variable v"<<*j<<" of factor F"<<I<<endl;
 
-                // ind is the precalculated Index(j,I) i.e. to x_I == k corresponds x_j == ind[k]
-                _ind_t* ind = &(index(*j,I));
+                // st is the precalculated position of x_j in x_I
+                const VarStride & st = stride(*j,I);
                 // sum_j will be the sum of messages coming into j
                 Prob sum_j( g.var(*j).states(), 0.0 ); 
                 //if( Props.verbose >= 8)
@@ -184,14 +213,17 @@ namespace libDAI {
                     //cout << "\tadding sum_j = "<< sum_j << " to sum = " << sum << endl;
                     
                 //we need to add sum_j[k] to all entries sum[r] in sum that are consistent with sum_j[k],
-                //i.e., all entries where variable j has state k.
-                for( size_t r = 0; r < sum.size(); r++ )
-                {
-                    //size_t sum_j_index = (*ind)[r];
-                    //if( Props.verbose >= 9)
-                        //cout << "\t\tr="<<r<<", sum_j_index="<<sum_j_index<<endl;
-                    sum[r] += sum_j[(*ind)[r]];
-                }
+                //i.e., all entries where variable j has state k. These
+                //form st.outer contiguous blocks of st.stride entries.
+                double* sum_p = &(sum.p()[0]);
+                for( size_t hi = 0; hi < st.outer; hi++ )
+                    for( size_t k = 0; k < st.states; k++ )
+                    {
+                        double* block = sum_p + st.offset(k, hi);
+                        double add = sum_j[k];
+                        for( size_t lo = 0; lo < st.stride; lo++ )
+                            block[lo] += add;
+                    }
         
             }
      
@@ -209,16 +241,28 @@ namespace libDAI {
             newm[i] = -INFINITY;
 
         //now we compute the max inline (it's an inline version of factor::partMax )
-        const VarSet & ns = g.var(i);
-        const VarSet & vs = g.factor( I ).vars();
+        //const VarSet & ns = g.var(i);
+        //const VarSet & vs = g.factor( I ).vars();
         //Prob res( g.var(i).states(), -INFINITY );
         //Index i_res( ns, vs );
         //for( size_t i = 0; i < sum.size(); i++, ++i_res )
             //res[i_res] = std::max(res[i_res], sum[i]);
 
-        Index i_newm( ns, vs );
-        for( size_t i = 0; i < sum.size(); i++, ++i_newm )
-            newm[i_newm] = std::max(newm[i_newm], sum[i]);
+        //Index i_newm( ns, vs );
+        //for( size_t i = 0; i < sum.size(); i++, ++i_newm )
+            //newm[i_newm] = std::max(newm[i_newm], sum[i]);
+        //the same max, over the contiguous blocks of each state of i:
+        const VarStride & st = _strides[iI];
+        const double* sum_p = &(sum.p()[0]);
+        for( size_t hi = 0; hi < st.outer; hi++ )
+            for( size_t k = 0; k < st.states; k++ )
+            {
+                const double* block = sum_p + st.offset(k, hi);
+                double m = newm[k];
+                for( size_t lo = 0; lo < st.stride; lo++ )
+                    m = std::max(m, block[lo]);
+                newm[k] = m;
+            }
 
         //Prob max = max_f.p(); //here we get the desired vector (Prob) repres.
         //Prob & max = res; 
@@ -361,15 +405,37 @@ namespace libDAI {
                 }
             } else if( Props.updates == UpdateType::PARALL ) {
                 // Parallel updates 
+#ifdef _OPENMP
+                // each new message only depends on the old messages, and
+                // each edge's message is written by one thread only
+                bool parallel = Props.threads > 1 && !omp_in_parallel();
+                size_t nrEdges = g.nrEdges();
+#pragma omp parallel num_threads(Props.threads) if(parallel)
+                {
+#pragma omp for schedule(static)
+                    for( size_t t = 0; t < nrEdges; t++ )
+                        calcNewMessage(t);
+
+#pragma omp for schedule(static)
+                    for( size_t t = 0; t < nrEdges; t++ )
+                        updateMessage( t );
+                }
+#else
                 for( size_t t = 0; t < g.nrEdges(); t++ )
                     calcNewMessage(t);
 
                 for( size_t t = 0; t < g.nrEdges(); t++ )
                     updateMessage( t );
+#endif
             } else {
                 // Sequential updates
-                if( Props.updates == UpdateType::SEQRND )
-                    random_shuffle( edge_seq.begin(), edge_seq.end() );
+                if( Props.updates == UpdateType::SEQRND ) {
+                    if( _useSeed ) {
+                        SeededRandom r( &_seed );
+                        random_shuffle( edge_seq.begin(), edge_seq.end(), r );
+                    } else
+                        random_shuffle( edge_seq.begin(), edge_seq.end() );
+                }
                 
                 for( size_t t = 0; t < g.nrEdges(); t++ ) {
                     size_t k = edge_seq[t]; //FRANS: k is what?
@@ -674,8 +740,8 @@ namespace libDAI {
         Prob prod( grm().factor(I).p() );
 
         for( FactorGraph::nb_cit j = grm().nbF(I).begin(); j != grm().nbF(I).end(); j++ ) {
-            // ind is the precalculated Index(j,I) i.e. to x_I == k corresponds x_j == ind[k]
-            const _ind_t *ind = &(index(*j, I));
+            // st is the precalculated position of x_j in x_I
+            const VarStride & st = stride(*j, I);
 
             // prod_j will be the product of messages coming into j
             Prob prod_j( grm().var(*j).states() ); 
@@ -684,8 +750,13 @@ namespace libDAI {
                     prod_j *= newMessage(*j,*J);
 
             // multiply prod with prod_j
-            for( size_t r = 0; r < prod.size(); r++ )
-                prod[r] *= prod_j[(*ind)[r]];
+            for( size_t hi = 0; hi < st.outer; hi++ )
+                for( size_t k = 0; k < st.states; k++ )
+                {
+                    size_t o = st.offset(k, hi);
+                    for( size_t lo = o; lo < o + st.stride; lo++ )
+                        prod[lo] *= prod_j[k];
+                }
         }
 
         Factor result( grm().factor(I).vars(), prod );
@@ -51,14 +51,16 @@ namespace libDAI {
                 size_t     maxiter;
                 size_t     verbose;
                 double     damping;
+                /// the number of threads used for the PARALL updates
+                size_t     threads;
             } Props;
             /// Maximum difference encountered so far
             double                       _maxdiff;
             /// Number of iterations needed
             size_t                       _iterations;
 
-            typedef std::vector<size_t>  _ind_t;
-            std::vector<_ind_t>          _indices;
+            /// for each edge iI, where variable i is found in the states of factor I
+            std::vector<VarStride>       _strides;
             std::vector<Prob>            _messages, _newmessages;    //vector of probability vectors (Prob = TProb< Real > and Real = double)
 
 
@@ -67,16 +69,24 @@ namespace libDAI {
         public:
             /// Default constructor
             MaxPlus() : 
-                DAIAlgFG(), Props(), _maxdiff(0.0), _iterations(0UL), _indices(),
+                DAIAlgFG(), Props(), _maxdiff(0.0), _iterations(0UL), _strides(),
                 _messages(), _newmessages(), _g(NULL),_k(1),
                 _k_th_Val(-DBL_MAX),  writeAnyTimeResults(false),  
-                results_f(NULL), timings_f(NULL){};
+                results_f(NULL), timings_f(NULL), _useSeed(false), _seed(0){};
             
             /// Construct MaxPlus object using the specified properties
+            /** fg is not copied, so it should exist as long as this
+             * object. Several MaxPlus objects can share (read) the same
+             * fg, for instance to perform restarts concurrently.
+             *
+             * Besides the usual properties, "threads" (optional, default
+             * 1) sets the number of threads that compute the messages of
+             * the PARALL updates (when libDAI is compiled with OpenMP).
+             */
             MaxPlus( const FactorGraph & fg, const Properties &opts, size_t k=1 );
             
             /// Copy constructor
-            MaxPlus( const MaxPlus & x ) : DAIAlgFG(x), Props(x.Props), _maxdiff(x._maxdiff), _iterations(x._iterations), _indices(x._indices), _messages(x._messages), _newmessages(x._newmessages), _g(x._g) {};
+            MaxPlus( const MaxPlus & x ) : DAIAlgFG(x), Props(x.Props), _maxdiff(x._maxdiff), _iterations(x._iterations), _strides(x._strides), _messages(x._messages), _newmessages(x._newmessages), _g(x._g), _useSeed(x._useSeed), _seed(x._seed) {};
 
             /// Assignment operator
             MaxPlus & operator=( const MaxPlus & x ) {
@@ -85,7 +95,7 @@ namespace libDAI {
                     Props        = x.Props;
                     _maxdiff     = x._maxdiff;
                     _iterations  = x._iterations;
-                    _indices     = x._indices;
+                    _strides     = x._strides;
                     _messages    = x._messages;
                     _newmessages = x._newmessages;
                 }
@@ -138,6 +148,12 @@ namespace libDAI {
 
             /// Clear messages and beliefs corresponding to the nodes in ns
             virtual void init( const VarSet &ns );
+            /// Like init(), but draws the random initial messages (and the
+            /// SEQRND update orders) from a generator seeded with seed,
+            /// rather than from rand(). This allows MaxPlus objects to be
+            /// run concurrently, with results that do not depend on the order
+            /// in which they run.
+            void initWithSeed( unsigned int seed );
 
             /// The actual approximate inference algorithm
             virtual double run();
@@ -195,8 +211,7 @@ namespace libDAI {
             Prob & message(size_t i, size_t I) { return( _messages[_g->edge(i,I)] ); }  
             Prob & newMessage(size_t i, size_t I) { return( _newmessages[_g->edge(i,I)] ); }    
             const Prob & newMessage(size_t i, size_t I) const { return( _newmessages[_g->edge(i,I)] ); }    
-            _ind_t & index(size_t i, size_t I) { return( _indices[_g->edge(i,I)] ); }
-            const _ind_t & index(size_t i, size_t I) const { return( _indices[_g->edge(i,I)] ); }
+            const VarStride & stride(size_t i, size_t I) const { return( _strides[_g->edge(i,I)] ); }
         
             ///calling grm() from superclass over and over is costly!, we store a pointer here and implement
             ///a local version of this function
@@ -225,8 +240,10 @@ namespace libDAI {
             std::ofstream* results_f;
             ///the file to which writes the timings of the results are written
             std::ofstream* timings_f;
-
-
+            ///whether the random numbers are drawn from _seed (see initWithSeed())
+            bool _useSeed;
+            ///the state of the random number generator used if _useSeed
+            unsigned int _seed;
     };
 
 
@@ -296,8 +296,12 @@ namespace libDAI {
         //and store as a new factor.
         
         //make an index(vs_F, neighVs) for each factor F in neighFs
+        //and a VarStride that gives the position of v in F, such that
+        //the slice of F for a state of vs_F is found without calling
+        //F.slice() (which loops over all of F)
         vector< Index > index_vec(num_Fs);
-        vector< VarSet > vs_vec(num_Fs);
+        vector< VarStride > stride_vec(num_Fs);
+        vector< const Factor* > fac_vec(num_Fs);
         for(size_t i=0; i < num_Fs; i++)
         {
             size_t fI = neighFIs.at(i);
@@ -305,14 +309,16 @@ namespace libDAI {
             VarSet vs_F = F.vars();
             //remove variable varIndex:
             vs_F /= v;
-            vs_vec.at(i) = vs_F;
             index_vec.at(i) = Index(vs_F, neighVs);
+            stride_vec.at(i) = VarStride(v, F.vars());
+            fac_vec.at(i) = &F;
         }
+        //here we will store the amount that v can achieve by
+        //selecting each of its states (for the current joint state jI)
+        vector<double> contribution_vec_v(v.states());
         for( size_t jI=0; jI < neighVs.stateSpace(); jI++)
         {//compute best response against joint state jI.
-            //here we will store the amount that v can achieve by
-            //selecting each of its states when neighVs have state jI:
-            Factor contribution_vec_v(v, 0.0);
+            std::fill(contribution_vec_v.begin(), contribution_vec_v.end(), 0.0);
 
             //loop over all neighFs
             //-get the slice that corresponds to the assignment of 'states'
@@ -320,32 +326,20 @@ namespace libDAI {
             //-add to contribution_vec_v 
             for(size_t i=0; i < num_Fs; i++)
             {
-                //process the i-th neighboring factor, corresponding to 
-                size_t fI = neighFIs.at(i);
-                const Factor& f = GetFactor( fI );
-                VarSet & vs_i = vs_vec.at(i);
-                Index & index_i = index_vec.at(i);
-                Factor sliced_Fi = f.slice( vs_i, index_i);
-                //sliced_Fi should be a factor depending only on v now...
-                //and thus we add it to the contribution_vec_v
-                contribution_vec_v += sliced_Fi;
+                //process the i-th neighboring factor
+                const Factor& f = *fac_vec[i];
+                const VarStride & st = stride_vec[i];
+                Index & index_i = index_vec[i];
+                //the slice of f for index_i is found at offset base, 
+                //with stride st.stride between the states of v
+                size_t base = st.embed(index_i);
+                for(size_t s=0; s < st.states; s++)
+                    contribution_vec_v[s] += f[base + st.offset(s, 0)];
                 
                 //update its index:
                 ++index_i;
             }
 
-            //sanity check:
-            if( contribution_vec_v.stateSpace() != v.states() )
-            {
-                stringstream ss;
-                ss << "contribution_vec_v.stateSpace() = "<<
-                   contribution_vec_v.stateSpace() <<
-                   " != v.states() = "<< 
-                   v.states() << endl;
-
-                throw ( ss.str().c_str() );
-            }
-
             //now the state of v that has the highest value in 
             //contribution_vec_v is the best response:
             double val = -DBL_MAX;
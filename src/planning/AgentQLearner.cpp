@@ -40,6 +40,8 @@ AgentQLearner::AgentQLearner(const PlanningUnitDecPOMDPDiscrete *pu, Index id,
     _m_epsilon = epsilon;
     _m_temp = temp;
     _m_t = 0;
+    _m_batchSize = 0;
+    _m_nrBatches = 0;
 }
 
 AgentQLearner::AgentQLearner(const AgentQLearner& a) :
@@ -54,8 +56,13 @@ AgentQLearner::AgentQLearner(const AgentQLearner& a) :
     _m_exploration(a._m_exploration),
     _m_epsilon(a._m_epsilon),
     _m_temp(a._m_temp),
+    _m_t(a._m_t),
     _m_firstAgent(a._m_firstAgent),
-    _m_t(a._m_t)
+    _m_replay(a._m_replay),
+    _m_batchSize(a._m_batchSize),
+    _m_nrBatches(a._m_nrBatches),
+    _m_batch(a._m_batch),
+    _m_batchMaxNext(a._m_batchMaxNext)
 {
 }
 
@@ -76,6 +83,13 @@ void AgentQLearner::Learn(Index jaI, double r, Index sI, Index prevSI)
     // Perform one iteration of Q-learning in joint action & state space
     if(_m_t > 0 && isFirstAgent()) // we only need to learn once
     {
+        if(_m_replay.GetCapacity() > 0)
+        {
+            _m_replay.Add(prevSI, jaI, r, sI);
+            LearnFromReplay();
+            return;
+        }
+
         // get the maximum value of the next state
         double maxNextState = getMaxState(sI);
 
@@ -98,6 +112,61 @@ void AgentQLearner::Learn(Index jaI, double r, Index sI, Index prevSI)
     }
 }
 
+void AgentQLearner::SetExperienceReplay(size_t capacity, size_t batchSize,
+                                        size_t nrBatches, bool prioritized)
+{
+    _m_replay = ExperienceReplayBuffer(capacity, prioritized);
+    _m_batchSize = batchSize;
+    _m_nrBatches = nrBatches;
+    _m_batch.resize(batchSize);
+    _m_batchMaxNext.resize(batchSize);
+}
+
+double AgentQLearner::GetMaxQ(Index sI) const
+{
+    // read the row directly, QTable being a row-major ublas matrix
+    size_t nrA = _m_Q.GetNrActions();
+    const double *row = &_m_Q.data()[sI*nrA];
+    double dMax = row[0];
+    for(Index j = 1; j < nrA; ++j)
+        if(row[j] > dMax)
+            dMax = row[j];
+    return dMax;
+}
+
+/**
+ * This method applies the minibatch updates of experience replay. The
+ * maximum Q-values of the next states of a minibatch are computed
+ * before any of its updates, so all its updates use the same Q-values
+ * of the next states.
+ */
+void AgentQLearner::LearnFromReplay()
+{
+    size_t nrA = _m_Q.GetNrActions();
+    double *Q = &_m_Q.data()[0];
+    for(Index b = 0; b < _m_nrBatches; ++b)
+    {
+        for(Index k = 0; k < _m_batchSize; ++k)
+        {
+            _m_batch[k] = _m_replay.Sample(rand()/(RAND_MAX+1.0));
+            _m_batchMaxNext[k] =
+                GetMaxQ(_m_replay.GetSuccessorState(_m_batch[k]));
+        }
+
+        for(Index k = 0; k < _m_batchSize; ++k)
+        {
+            Index e = _m_batch[k];
+            double &q = Q[_m_replay.GetState(e)*nrA +
+                          _m_replay.GetJointAction(e)];
+            double td = _m_replay.GetReward(e) +
+                _m_gamma * _m_batchMaxNext[k] - q;
+            q += _m_alpha * td;
+            // the small constant keeps every transition sampleable
+            _m_replay.SetPriority(e, std::abs(td) + 1e-6);
+        }
+    }
+}
+
 /**
  * This method returns the next action for state \a sI. Based on
  * the member variables either a greedy action or an exploration
@@ -132,13 +201,14 @@ Index AgentQLearner::Act(Index sI, Index /*joI*/, double r)
         else if( _m_exploration == EXPL_BOLTZMANN )
         {
             row_t row   = _m_Q.GetRow(sI);
-            // calculate the normalization factor
-            //FIXME parallelize
+            // calculate the normalization factor, computing each exp()
+            // only once
+            vector<double> b(row.size());
             double sum  = 0.0, sum2 = 0.0;
             for(unsigned j = 0; j < row.size(); ++j)
             {
-                double b = exp( row(j) / _m_temp );
-                sum += b;
+                b[j] = exp( row(j) / _m_temp );
+                sum += b[j];
             }
 
             double d = rand()/(RAND_MAX+1.0);
@@ -146,10 +216,9 @@ Index AgentQLearner::Act(Index sI, Index /*joI*/, double r)
 
             do
             {
-                double b = exp( row(j) / _m_temp )/sum;
-                sum2 += b;
+                sum2 += b[j]/sum;
                 j++;
-            } while( d > sum2 );
+            } while( d > sum2 && j < row.size() );
             j--;
             jaInew = (Index)j;
         }
@@ -19,6 +19,7 @@
 
 #include "AgentFullyObservable.h"
 #include "QTable.h"
+#include "ExperienceReplayBuffer.h"
 
 #include "Globals.h"
 
@@ -32,6 +33,11 @@ enum ExplorationT
 
 /** \brief AgentQLearner applies standard single-agent Q-learning in the joint action and state space.
  *
+ * By default every step applies one update for the transition just
+ * made. With SetExperienceReplay(), the transitions are stored in an
+ * ExperienceReplayBuffer instead, and every step applies minibatches of
+ * updates for transitions sampled from it, so that each (possibly
+ * expensive) simulated step is learned from several times.
  **/
 class AgentQLearner : public AgentFullyObservable
 {
@@ -56,6 +62,17 @@ private:
 
     const AgentQLearner* _m_firstAgent;    //!< agent with id 0 for last action lookup
 
+    ExperienceReplayBuffer _m_replay; //!< empty unless replay is enabled
+    size_t _m_batchSize;   //!< number of transitions per minibatch
+    size_t _m_nrBatches;   //!< number of minibatches per step
+    std::vector<Index> _m_batch;          //!< scratch: sampled transitions
+    std::vector<double> _m_batchMaxNext;  //!< scratch: their max next Q
+
+    /// Applies the minibatch updates of experience replay.
+    void LearnFromReplay();
+    /// Returns max_a Q(sI,a), without collecting the maximizing actions.
+    double GetMaxQ(Index sI) const;
+
     Index GetLastActionChosen() const
         { return _m_firstAgent->_m_selJaI; }
 
@@ -83,6 +100,14 @@ public:
     Index getNonGreedyAction(Index sI) const
         { return (Index)(rand()/(RAND_MAX+1.0)*_m_Q.GetNrActions()); }
 
+    /**Enables experience replay: the transitions are stored in a buffer
+     * of the given capacity, and every step applies nrBatches
+     * minibatches of batchSize updates, for transitions sampled
+     * uniformly, or proportional to their last TD error when
+     * prioritized. */
+    void SetExperienceReplay(size_t capacity, size_t batchSize,
+                             size_t nrBatches=1, bool prioritized=false);
+
     void SetFirstAgent(const AgentQLearner* firstAgent)
         { _m_firstAgent = firstAgent; }
 
@@ -68,6 +68,9 @@ AlphaVectorPlanning::AlphaVectorPlanning(const
     _m_OsForBackup(0),
     _m_eventOsForBackup(0),
     _m_TsOsForBackup(0),
+    _m_Ttoi(0),
+    _m_Otoi(0),
+    _m_useTOI(false),
     _m_acceleratedPruningThreshold(200)
 {
     const TransitionModelMappingSparse *tms;
@@ -78,6 +81,11 @@ AlphaVectorPlanning::AlphaVectorPlanning(const
         _m_useSparse=true;
     else if((tm=dynamic_cast<const TransitionModelMapping *>(td)))
         _m_useSparse=false;
+    else if(dynamic_cast<const TransitionModelTOI *>(td))
+    {
+        _m_useSparse=false;
+        _m_useTOI=true;
+    }
     else 
         throw(E("AlphaVectorPlanning::Ctor() TransitionModelDiscretePtr not handled. Use the --cache-flat-models option."));
 
@@ -91,7 +99,10 @@ AlphaVectorPlanning::AlphaVectorPlanning(const boost::shared_ptr<const
     _m_TsForBackup(0),
     _m_OsForBackup(0),
     _m_eventOsForBackup(0),
-    _m_TsOsForBackup(0)
+    _m_TsOsForBackup(0),
+    _m_Ttoi(0),
+    _m_Otoi(0),
+    _m_useTOI(false)
 {
     const TransitionModelMappingSparse *tms;
     const TransitionModelMapping *tm;
@@ -101,6 +112,11 @@ AlphaVectorPlanning::AlphaVectorPlanning(const boost::shared_ptr<const
         _m_useSparse=true;
     else if((tm=dynamic_cast<const TransitionModelMapping *>(td)))
         _m_useSparse=false;
+    else if(dynamic_cast<const TransitionModelTOI *>(td))
+    {
+        _m_useSparse=false;
+        _m_useTOI=true;
+    }
     else 
         throw(E("AlphaVectorPlanning::Ctor() TransitionModelDiscretePtr not handled. Use the --cache-flat-models option."));
 
@@ -112,7 +128,10 @@ AlphaVectorPlanning::AlphaVectorPlanning(const
     _m_TsForBackup(0),
     _m_OsForBackup(0),
     _m_eventOsForBackup(0),
-    _m_TsOsForBackup(0)
+    _m_TsOsForBackup(0),
+    _m_Ttoi(0),
+    _m_Otoi(0),
+    _m_useTOI(false)
 {
   //cout << "AlphaVectorPlanning Constructor Factored Version 1" << endl;
 
@@ -127,7 +146,10 @@ AlphaVectorPlanning::AlphaVectorPlanning(const boost::shared_ptr<const
     _m_TsForBackup(0),
     _m_OsForBackup(0),
     _m_eventOsForBackup(0),
-    _m_TsOsForBackup(0)
+    _m_TsOsForBackup(0),
+    _m_Ttoi(0),
+    _m_Otoi(0),
+    _m_useTOI(false)
 {
   //cout << "AlphaVectorPlanning Constructor Factored Version 2" << endl;
 }
@@ -146,7 +168,16 @@ void AlphaVectorPlanning::Initialize()
     const TransitionModelDiscrete *td=GetPU()->GetTransitionModelDiscretePtr();
     const ObservationModelDiscrete *od=GetPU()->GetObservationModelDiscretePtr();
 
-    if(!(GetPU()->GetParams().GetEventObservability())) //standard, synchronous MADP
+    if(_m_useTOI)
+    {
+        if(GetPU()->GetParams().GetEventObservability())
+            throw(E("AlphaVectorPlanning::Initialize() event-driven observations are not supported for TOI models, use the --cache-flat-models option"));
+        _m_Ttoi=dynamic_cast<const TransitionModelTOI *>(td);
+        _m_Otoi=dynamic_cast<const ObservationModelTOI *>(od);
+        if(!_m_Otoi)
+            throw(E("AlphaVectorPlanning::Initialize() ObservationModelDiscretePtr not handled"));
+    }
+    else if(!(GetPU()->GetParams().GetEventObservability())) //standard, synchronous MADP
     { 
         if(_m_useSparse)
         {
@@ -368,10 +399,7 @@ AlphaVectorPlanning::BackProject(const ValueFunctionPOMDPDiscrete &v) const
             for(int s=0;s!=nrS;s++)
                 v1(k,s)=v[k].GetValue(s);
 	}
-        if(_m_useSparse)
-            return(BackProjectSparse(v1));
-        else
-	    return(BackProjectFull(v1));
+        return(BackProject(v1));
     }
     else
     {
@@ -386,52 +414,9 @@ AlphaVectorPlanning::BackProject(const ValueFunctionPOMDPDiscrete &v) const
  */
 GaoVectorSet AlphaVectorPlanning::BackProject(const VectorSet &v) const
 {
-#if 0
-    TOIDecPOMDPDiscrete* toi=0;
-    // check for TOI
-    if((toi=const_cast<TOIDecPOMDPDiscrete*>(GetPU()->GetDPOMDPD()))!=0)
-    {
-        unsigned int nrJA=GetPU()->GetNrJointActions(),
-            nrJO=GetPU()->GetNrJointObservations(),
-            nrS=GetPU()->GetNrStates(),
-            nrInV=v.size1();
-        
-        StartTimer("BackProjectTOI");
-
-        GaoVectorSet G(boost::extents[nrA][nrO]);
-        vector<GaoVectorSet> Gs;
-
-        VectorSet v1(nrInV,nrS);
-#if AlphaVectorPlanning_UseUBLASinBackProject
-        VectorSet vv=v;
-#endif
-        double x;
-
-        using namespace boost::numeric::ublas;
-
-        for(unsigned int a=0;a!=nrJA;a++)
-        {
-            for(unsigned int o=0;o!=nrJO;o++)
-            {
-            for(unsigned int k=0;k!=nrInV;k++)
-            {
-                    for(unsigned int s=0;s!=nrS;s++)
-                    {
-                        x=0;
-                        for(unsigned int s1=0;s1!=nrS;s1++)
-                            x+=(*_m_O[a])(s1,o)*(*_m_T[a])(s,s1)*v(k,s1);
-                        v1(k,s)=x;
-                    }
-            }
-            G[a][o]=new VectorSet(v1);
-        }
-
-    StopTimer("BackProjectTOI");
-        
-    }
-        else
-#endif
-    if(_m_useSparse)
+    if(_m_useTOI)
+        return(BackProjectTOI(v));
+    else if(_m_useSparse)
         return(BackProjectSparse(v));
     else
         return(BackProjectFull(v));
@@ -662,6 +647,74 @@ GaoVectorSet AlphaVectorPlanning::BackProjectSparse(const VectorSet &v) const
     return(G);
 }
 
+/**
+ * Implements equation (3.11) of PhD thesis Matthijs, for a
+ * transition-observation independent model: for each (a,o) the vector
+ * O(.,o) .* v is multiplied by the Kronecker product of the individual
+ * transition matrices, one agent's axis at a time.
+ */
+GaoVectorSet AlphaVectorPlanning::BackProjectTOI(const VectorSet &v) const
+{
+    unsigned int nrA=GetPU()->GetNrJointActions(),
+        nrO=GetPU()->GetNrJointObservations(),
+        nrS=GetPU()->GetNrStates(),
+        nrInV=v.size1();
+
+    if(nrInV==0)
+        throw(E("AlphaVectorPlanning::BackProjectTOI attempting to backproject empty value function"));
+
+    StartTimer("BackProjectTOI");
+    
+    GaoVectorSet G(boost::extents[nrA][nrO]);
+    VectorSet v1(nrInV,nrS);
+
+#if AlphaVectorPlanning_CheckForDuplicates
+    vector<int> duplicates=GetDuplicateIndices(v);
+#else
+    vector<int> duplicates(nrInV,-1);
+#endif
+    int dup;
+
+    vector<double> Os, Ov(nrS), TOv;
+    for(unsigned int a=0;a!=nrA;a++)
+        for(unsigned int o=0;o!=nrO;o++)
+        {
+            _m_Otoi->GetProbabilities(a,o,Os);
+            bool possible=false;
+            for(unsigned int s1=0;s1!=nrS && !possible;s1++)
+                if(Os[s1]>0)
+                    possible=true;
+
+            for(unsigned int k=0;k!=nrInV;k++)
+            {
+                if(!possible)
+                {
+                    for(unsigned int s=0;s!=nrS;s++)
+                        v1(k,s)=0;
+                }
+                else if(duplicates[k]==-1)
+                {
+                    for(unsigned int s1=0;s1!=nrS;s1++)
+                        Ov[s1]=Os[s1]*v(k,s1);
+                    _m_Ttoi->Multiply(a,Ov,TOv);
+                    for(unsigned int s=0;s!=nrS;s++)
+                        v1(k,s)=TOv[s];
+                }
+                else
+                {
+                    dup=duplicates[k];
+                    for(unsigned int s=0;s!=nrS;s++)
+                        v1(k,s)=v1(dup,s);
+                }
+            }
+            G[a][o]=new VectorSet(v1);
+        }
+
+    StopTimer("BackProjectTOI");
+
+    return(G);
+}
+
 BeliefSet AlphaVectorPlanning::SampleBeliefs(
     const ArgumentHandlers::Arguments &args) const
 {
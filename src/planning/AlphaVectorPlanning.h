@@ -36,6 +36,8 @@
 #include "ObservationModelMappingSparse.h"
 #include "EventObservationModelMapping.h"
 #include "EventObservationModelMappingSparse.h"
+#include "TransitionModelTOI.h"
+#include "ObservationModelTOI.h"
 
 #include "boost/shared_ptr.hpp"
 
@@ -79,11 +81,20 @@ private:
     std::vector<std::vector<std::vector<SparseVector* > > > _m_eventOsForBackup;
     std::vector<std::vector<std::vector<SparseVector* > > > _m_TsOsForBackup;
 
+    /// The implicit models of a transition-observation independent
+    /// problem, used instead of the matrices above.
+    const TransitionModelTOI* _m_Ttoi;
+    const ObservationModelTOI* _m_Otoi;
+
     bool _m_useSparse;
+    bool _m_useTOI;
     size_t _m_acceleratedPruningThreshold;
 
     GaoVectorSet BackProjectFull(const VectorSet &v) const;
     GaoVectorSet BackProjectSparse(const VectorSet &v) const;
+    /// Back-projects using Kronecker-structured products of the
+    /// individual TOI models, without forming joint matrices.
+    GaoVectorSet BackProjectTOI(const VectorSet &v) const;
 
     bool _m_initialized;
 
@@ -17,10 +17,94 @@
 #include "BayesianGameIdenticalPayoffInterface.h"
 #include <float.h>
 #include <numeric>
+#include <new>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
-BGIP_BnB_Node::BGIP_BnB_Node(size_t nrAgents) :
+namespace {
+
+/// The number of nodes a BGIP_BnB_NodePool allocates at once.
+const size_t BNB_NODE_SLAB_SIZE=4096;
+
+}
+
+BGIP_BnB_NodePool::BGIP_BnB_NodePool() :
+    _m_threadPools(1),
+    _m_nrThreads(1)
+{
+}
+
+BGIP_BnB_NodePool::~BGIP_BnB_NodePool()
+{
+    for(Index t=0;t!=_m_threadPools.size();++t)
+        for(Index s=0;s!=_m_threadPools[t].slabs.size();++s)
+            ::operator delete(_m_threadPools[t].slabs[s]);
+}
+
+size_t BGIP_BnB_NodePool::GetNrBytes() const
+{
+    size_t nrSlabs=0;
+    for(Index t=0;t!=_m_threadPools.size();++t)
+        nrSlabs+=_m_threadPools[t].slabs.size();
+    return(sizeof(*this) + _m_threadPools.size()*sizeof(ThreadPool) +
+           nrSlabs*BNB_NODE_SLAB_SIZE*sizeof(BGIP_BnB_Node));
+}
+
+void BGIP_BnB_NodePool::SetNrThreads(size_t nrThreads)
+{
+    if(nrThreads==0)
+        throw(E("BGIP_BnB_NodePool::SetNrThreads needs at least one thread"));
+    // free lists are never discarded, they hold nodes
+    if(nrThreads>_m_threadPools.size())
+        _m_threadPools.resize(nrThreads);
+    _m_nrThreads=nrThreads;
+}
+
+BGIP_BnB_NodePool::ThreadPool& BGIP_BnB_NodePool::GetThreadPool()
+{
+#ifdef _OPENMP
+    if(_m_nrThreads>1)
+        return(_m_threadPools[omp_get_thread_num()]);
+#endif
+    return(_m_threadPools[0]);
+}
+
+void* BGIP_BnB_NodePool::Allocate(size_t size)
+{
+    if(size!=sizeof(BGIP_BnB_Node))
+        throw(E("BGIP_BnB_NodePool::Allocate can only allocate BGIP_BnB_Node"));
+
+    ThreadPool &pool=GetThreadPool();
+    if(pool.freeNodes==0)
+    {
+        char *slab=static_cast<char*>(::operator new(BNB_NODE_SLAB_SIZE*size));
+        pool.slabs.push_back(slab);
+        for(Index i=0;i!=BNB_NODE_SLAB_SIZE;++i)
+        {
+            FreeNode *n=reinterpret_cast<FreeNode*>(slab+i*size);
+            n->next=pool.freeNodes;
+            pool.freeNodes=n;
+        }
+    }
+    FreeNode *n=pool.freeNodes;
+    pool.freeNodes=n->next;
+    return(n);
+}
+
+void BGIP_BnB_NodePool::Free(void *p)
+{
+    if(p==0)
+        return;
+    ThreadPool &pool=GetThreadPool();
+    FreeNode *n=static_cast<FreeNode*>(p);
+    n->next=pool.freeNodes;
+    pool.freeNodes=n;
+}
+
+BGIP_BnB_Node::BGIP_BnB_Node(BGIP_BnB_NodePool *pool) :
 //    _m_parent(0),
 #if 0
     _m_f(0),
@@ -28,7 +112,9 @@ BGIP_BnB_Node::BGIP_BnB_Node(size_t nrAgents) :
     _m_g(0.0),
     _m_h(0.0),
     _m_depth(0),
-    _m_specifiedActions(nrAgents, UNSPECIFIED_ACTION )
+    _m_jaI(UNSPECIFIED_ACTION),
+    _m_refCount(0),
+    _m_pool(pool)
 #if DYNAMIC_JT_INDEX_MAPPING
     ,    _m_jtIndexMapping(0) // we don't keep a jtIndexMapping per node
 #endif
@@ -59,7 +145,7 @@ BGIP_BnB_Node::BGIP_BnB_Node(
     _m_h(0.0),
     _m_depth(0),
     _m_maxDepth(maxdepth),
-    _m_specifiedActions( _m_bgip->GetNrAgents(), UNSPECIFIED_ACTION ),
+    _m_jaI(UNSPECIFIED_ACTION),
     _m_jtIndexMapping(new vector<Index>(jtIndexMapping)) // make a copy of it
 #if INCR_EXPAND
     ,
@@ -82,7 +168,9 @@ BGIP_BnB_Node::BGIP_BnB_Node(const BGIP_BnB_Node& n) :
     _m_g(n._m_g),
     _m_h(n._m_h),
     _m_depth(n._m_depth),
-    _m_specifiedActions(n._m_specifiedActions)
+    _m_jaI(n._m_jaI),
+    _m_refCount(0),
+    _m_pool(n._m_pool)
 #if MAINTAIN_FULL_POL        
     , _m_policy(n._m_policy)
 #endif
@@ -112,7 +200,30 @@ void BGIP_BnB_Node::UpdateF()
 #endif
 }
 
-string BGIP_BnB_Node::SoftPrint() const 
+bool BGIP_BnB_Node::PrecedesOnTie(const BGIP_BnB_Node *x,
+                                  const BGIP_BnB_Node *y)
+{
+    while(x!=y)
+    {
+        const BGIP_BnB_Node *xParent=x->_m_parent.get(),
+            *yParent=y->_m_parent.get();
+        // the root is created first
+        if(xParent==0)
+            return(true);
+        if(yParent==0)
+            return(false);
+        if(xParent==yParent)
+            return(x->_m_jaI < y->_m_jaI);
+        // the parent with the highest F was selected first
+        if(xParent->GetF()!=yParent->GetF())
+            return(xParent->GetF() > yParent->GetF());
+        x=xParent;
+        y=yParent;
+    }
+    return(false);
+}
+
+string BGIP_BnB_Node::SoftPrint() const
 {
     std::stringstream ss;
     ss << "BGIP_BnB_Node[" << this << "] depth(=nr. spec. jtypes)= " << _m_depth
@@ -187,8 +298,12 @@ string BGIP_BnB_Node::SoftPrintPartiallySpecifiedPolicy(
             bgip->JointToIndividualTypeIndices( jt );
         for(Index i=0;i!=indTypes.size();++i)
         {
-            ss << " (" << indTypes[i] << "->"
-               << GetAction(i) << ")";
+            ss << " (" << indTypes[i] << "->";
+            if(_m_jaI==UNSPECIFIED_ACTION)
+                ss << _m_jaI;
+            else
+                ss << bgip->JointToIndividualActionIndices(_m_jaI)[i];
+            ss << ")";
         }
         ss << "]" << "\n";
     }
@@ -309,14 +424,14 @@ void BGIP_BnB_Node::GetImpliedJPol(
 #if 0
     std::cout << "GetImpliedJPol at depth="<<depth;
     std::cout << " (that specifies jt_bgI="<<jt_bgI<<"="<<SoftPrintVector(indTypes)<<")";
-    std::cout << " the specified joint action is " << SoftPrintVector(_m_specifiedActions)<<endl;
+    std::cout << " the specified joint action is " << _m_jaI <<endl;
 #endif
-    for(Index agI=0; agI < nrAg; agI++)
+    if(_m_jaI != UNSPECIFIED_ACTION)
     {
-        Index tI = indTypes.at(agI);
-        Index acI =  _m_specifiedActions[agI];
-        if(acI != UNSPECIFIED_ACTION)
-            impliedJPol.at(agI).at(tI) = acI;
+        const std::vector<Index> &indActions=
+            bgip->JointToIndividualActionIndices(_m_jaI);
+        for(Index agI=0; agI < nrAg; agI++)
+            impliedJPol.at(agI).at(indTypes.at(agI)) = indActions[agI];
     }
     if(_m_parent == 0)
         throw E("depth>0, expected parent!");
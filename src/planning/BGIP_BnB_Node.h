@@ -22,7 +22,8 @@
 #include "BnB_JointTypeOrdering.h"
 #include <limits.h>
 #include <sstream>
-#include "boost/shared_ptr.hpp"
+#include <vector>
+#include "boost/intrusive_ptr.hpp"
 
 #define INCR_EXPAND 0
 #define MAINTAIN_FULL_POL 0
@@ -35,10 +36,82 @@ using BGIP_BnB::UNSPECIFIED_ACTION;
 //is specified in BnB_JointTypeOrdering ?!?! need to have less files where this stuff is scattered,
 
 class BGIP_BnB_Node;
-typedef boost::shared_ptr<BGIP_BnB_Node> BGIP_BnB_NodePtr;
+typedef boost::intrusive_ptr<BGIP_BnB_Node> BGIP_BnB_NodePtr;
+
+void intrusive_ptr_add_ref(BGIP_BnB_Node *node);
+void intrusive_ptr_release(BGIP_BnB_Node *node);
+
+/**\brief BGIP_BnB_NodePool allocates the nodes of one
+ * BGIP_SolverBranchAndBound.
+ *
+ * Memory is taken from the system a slab of nodes at a time, and freed
+ * nodes are kept on a free list for reuse. Each thread searching
+ * concurrently has its own free list (see SetNrThreads()), so no lock
+ * is needed: a thread allocates from and frees to its own list. The
+ * slabs are released when the pool is destructed, so the pool has to
+ * outlive all its nodes.
+ */
+class BGIP_BnB_NodePool
+{
+private:
+
+    /// An unused node on a free list.
+    struct FreeNode
+    {
+        FreeNode *next;
+    };
+
+    /// The free list and the slabs of one thread.
+    struct ThreadPool
+    {
+        FreeNode *freeNodes;
+        std::vector<char*> slabs;
+        /// Keeps the free lists of different threads on different
+        /// cache lines.
+        char padding[64];
+
+        ThreadPool() : freeNodes(0) {}
+    };
+
+    std::vector<ThreadPool> _m_threadPools;
+    /// The number of threads that currently use the pool.
+    size_t _m_nrThreads;
+
+    /// The pool of the calling thread.
+    ThreadPool& GetThreadPool();
+
+    // a pool owns its slabs, so it cannot be copied
+    BGIP_BnB_NodePool(const BGIP_BnB_NodePool&);
+    BGIP_BnB_NodePool& operator=(const BGIP_BnB_NodePool&);
+
+public:
+
+    BGIP_BnB_NodePool();
+    /// Releases all slabs.
+    ~BGIP_BnB_NodePool();
+
+    /**Sets the number of threads that will allocate and free nodes
+     * concurrently; thread t then uses free list t. Has to be called
+     * outside the parallel region, and with 1 after it.*/
+    void SetNrThreads(size_t nrThreads);
+
+    /// Returns memory for one node.
+    void* Allocate(size_t size);
+    /// Returns memory obtained by Allocate() to the free list.
+    void Free(void *p);
+
+    /// Returns the memory held by the pool (in use or free) in bytes.
+    size_t GetNrBytes() const;
+};
 
 /**\brief BGIP_BnB_Node represents a node in the search tree of
  * BGIP_SolverBranchAndBound.
+ *
+ * Nodes are small, since a search can keep millions of them open: a
+ * node only stores the joint action it specifies, and the rest of its
+ * partial policy is found through its parent. Nodes are reference
+ * counted (intrusively) and are allocated from the BGIP_BnB_NodePool of
+ * the solver, see operator new().
  */
 class BGIP_BnB_Node
 {
@@ -61,11 +134,18 @@ private:
     /// joint action is specified
     Index _m_depth;
 
-    /**_m_specifiedActions[agentI] contains the index of the individual action
-     * this node specifies for agentI (for the typeI implied by the joint type
-     * of this node)
+    /**The index of the joint action this node specifies (for the joint
+     * type at its depth), or UNSPECIFIED_ACTION for the root. The
+     * individual actions follow from
+     * BayesianGameIdenticalPayoffInterface::JointToIndividualActionIndices().
      */
-    std::vector< Index > _m_specifiedActions;
+    Index _m_jaI;
+
+    /// The number of BGIP_BnB_NodePtr referring to this node.
+    unsigned int _m_refCount;
+
+    /// The pool the node is allocated from.
+    BGIP_BnB_NodePool *_m_pool;
 
 #if DYNAMIC_JT_INDEX_MAPPING
     std::vector<Index> *_m_jtIndexMapping;
@@ -80,9 +160,14 @@ private:
 
     void UpdateF();
 
+    friend void intrusive_ptr_add_ref(BGIP_BnB_Node *node);
+    friend void intrusive_ptr_release(BGIP_BnB_Node *node);
+
 public:
 
-    BGIP_BnB_Node(size_t nrAgents);
+    /**Constructs a root node, which does not specify any action. The
+     * node has to be allocated from pool, see operator new().*/
+    BGIP_BnB_Node(BGIP_BnB_NodePool *pool);
 
 #if 0
     BGIP_BnB_Node(BayesianGameIdenticalPayoffInterface *bgip,
@@ -92,10 +177,21 @@ public:
                   const std::vector<Index> &jtIndexMapping);
 #endif
 
+    /// Copy constructor. The copy is not referred to by any pointer yet.
     BGIP_BnB_Node(const BGIP_BnB_Node& n);
 
     ~BGIP_BnB_Node();
 
+    /**Allocates a node from pool: new(pool) BGIP_BnB_Node(...). A copy
+     * of a node has to be allocated from the pool of the original. The
+     * node is returned to its pool when the last BGIP_BnB_NodePtr to it
+     * goes away.*/
+    static void* operator new(size_t size, BGIP_BnB_NodePool &pool)
+    { return(pool.Allocate(size)); }
+    /// Called when a constructor throws.
+    static void operator delete(void *p, BGIP_BnB_NodePool &pool)
+    { pool.Free(p); }
+
     double GetF() const { return(_m_g+_m_h); }
     double GetG() const { return(_m_g); }
     double GetH() const { return(_m_h); }
@@ -107,27 +203,8 @@ public:
     }
 #endif
 
-    Index GetAction(Index agentI) const 
-    {   return _m_specifiedActions[agentI]; }
-
-    Index GetSpecifiedAction(Index agI, Index depth_tI) const
-    { 
-        size_t d = this->GetDepth();
-        if( depth_tI == d )
-            return _m_specifiedActions[agI];
-        else if (depth_tI < d)
-        {
-            if(_m_parent == 0)
-            {
-                std::stringstream ss;
-                ss << "asking parent value, but this node (at depth/that specifies "<<_m_depth<<" joint actions (for as many joint types) ) has no parent!";
-                throw E(ss);
-            }
-            return _m_parent->GetSpecifiedAction(agI, depth_tI);
-        }
-        else
-            throw E("Error asking node for action at a deeper level!");
-    }
+    /// Returns the index of the joint action specified by this node.
+    Index GetJointAction() const { return(_m_jaI); }
 
     void GetImpliedJPol(BayesianGameIdenticalPayoffInterface *bgip,
                         const std::vector< Index >& jtIndexMapping, 
@@ -139,7 +216,7 @@ public:
         { return(_m_alreadyExpandedJA.at(ja)); }
 #endif
     bool IsFullySpecifiedPolicy(Index maxDepth) const;
-    BGIP_BnB_NodePtr GetParent() const { return(_m_parent); }
+    const BGIP_BnB_NodePtr& GetParent() const { return(_m_parent); }
 
     void SetParent(const BGIP_BnB_NodePtr &parent) { _m_parent=parent; }
 #if MAINTAIN_FULL_POL        
@@ -151,14 +228,8 @@ public:
         _m_policy[agentI][indType]=action;
     }
 #endif
-    void SetAction(const std::vector<Index> &ja)
-    {
-        _m_specifiedActions = ja;
-    }
-    void SetAction(Index agentI, Index action)
-    {
-        _m_specifiedActions[agentI] = action;
-    }
+    /// Sets the index of the joint action specified by this node.
+    void SetJointAction(Index jaI) { _m_jaI=jaI; }
     void UpdateG(double dG);
     void UpdateH(double dH);
     void SetH(double h);
@@ -213,6 +284,17 @@ public:
     void SetAlreadyExpanded(Index ja);
     void ClearAlreadyExpanded();
 
+    /**Whether x precedes y in the search when both have the same F:
+     * the node that the serial search creates first goes first (first
+     * in, first out). That is the node whose parent was selected first,
+     * in the order of the open queue, and of two children of the same
+     * node the one with the lowest joint action index. The order is
+     * found from the search tree rather than from a counter, so it is
+     * the same when several threads create the nodes. It costs O(1) for
+     * siblings and nodes whose parents differ in F, otherwise the
+     * parents are compared in turn.*/
+    static bool PrecedesOnTie(const BGIP_BnB_Node *x, const BGIP_BnB_Node *y);
+
     std::string SoftPrint() const;
     std::string SoftPrint(
         const std::vector<Index> & jtIndexMapping
@@ -224,6 +306,72 @@ public:
 
 };
 
+inline void intrusive_ptr_add_ref(BGIP_BnB_Node *node)
+{
+#ifdef _OPENMP
+    __sync_fetch_and_add(&node->_m_refCount,1);
+#else
+    ++node->_m_refCount;
+#endif
+}
+
+inline void intrusive_ptr_release(BGIP_BnB_Node *node)
+{
+#ifdef _OPENMP
+    if(__sync_sub_and_fetch(&node->_m_refCount,1)==0)
+#else
+    if(--node->_m_refCount==0)
+#endif
+    {
+        BGIP_BnB_NodePool *pool=node->_m_pool;
+        node->~BGIP_BnB_Node();
+        pool->Free(node);
+    }
+}
+
+/**\brief BGIP_BnB_ImpliedJointActions stores the joint actions specified
+ * by a node and its ancestors, indexed by depth.
+ *
+ * This replaces walking up the parent chain for every action that is
+ * looked up. SetNode() only visits the ancestors that differ from the
+ * previous node, so moving to a child or a sibling of that node is
+ * cheap. The stored nodes are referenced, so they cannot be freed (and
+ * their memory reused) while they are in the table.
+ */
+class BGIP_BnB_ImpliedJointActions
+{
+private:
+    /// _m_nodes[d] is the ancestor at depth d of the current node.
+    std::vector<BGIP_BnB_NodePtr> _m_nodes;
+    /// _m_jaIs[d] is the joint action specified by _m_nodes[d].
+    std::vector<Index> _m_jaIs;
+
+public:
+    /// Makes the table refer to node and its ancestors.
+    void SetNode(const BGIP_BnB_NodePtr &node)
+    {
+        size_t depth=node->GetDepth();
+        _m_nodes.resize(depth+1);
+        _m_jaIs.resize(depth+1);
+        const BGIP_BnB_Node *n=node.get();
+        while(n!=0 && _m_nodes[n->GetDepth()].get()!=n)
+        {
+            _m_nodes[n->GetDepth()]=const_cast<BGIP_BnB_Node*>(n);
+            _m_jaIs[n->GetDepth()]=n->GetJointAction();
+            n=n->GetParent().get();
+        }
+    }
+    /// Releases the nodes referred to.
+    void Clear()
+    {
+        _m_nodes.clear();
+        _m_jaIs.clear();
+    }
+    /**Returns the joint action specified at depth (0 < depth <= the
+     * depth of the node).*/
+    Index GetJointAction(Index depth) const { return(_m_jaIs[depth]); }
+};
+
 namespace std{
     /**\brief Overload the less<Type> template for BGIP_BnB_Node* (we want less
      * to give an ordering according to values, not addresses...).*/
@@ -233,17 +381,21 @@ namespace std{
         bool operator()(const BGIP_BnB_Node* x,
                         const BGIP_BnB_Node* y) const
         { 
-            return( x->GetF() < y->GetF() );
+            return( x->GetF() < y->GetF() ||
+                    (x->GetF() == y->GetF() &&
+                     BGIP_BnB_Node::PrecedesOnTie(y,x)) );
         }
 
     };
     template <> 
     struct less< BGIP_BnB_NodePtr > //struct, so operator() is public by def. 
     {
-        bool operator()(const BGIP_BnB_NodePtr x,
-                        const BGIP_BnB_NodePtr y) const
+        bool operator()(const BGIP_BnB_NodePtr &x,
+                        const BGIP_BnB_NodePtr &y) const
         { 
-            return( x->GetF() < y->GetF() );
+            return( x->GetF() < y->GetF() ||
+                    (x->GetF() == y->GetF() &&
+                     BGIP_BnB_Node::PrecedesOnTie(y.get(),x.get())) );
         }
 
     };
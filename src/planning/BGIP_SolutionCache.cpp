@@ -0,0 +1,453 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <limits.h>
+#include <math.h>
+#include "BGIP_SolutionCache.h"
+#include "JointPolicyPureVector.h"
+#include "JPPVValuePair.h"
+
+using namespace std;
+
+namespace {
+
+/// Orders solutions best first.
+bool BetterSolution(const boost::shared_ptr<JPPVValuePair> &a,
+                    const boost::shared_ptr<JPPVValuePair> &b)
+{
+    return(a->GetValue() > b->GetValue());
+}
+
+}
+
+//Default constructor
+BGIP_SolutionCache::BGIP_SolutionCache(size_t maxNrBytes, double quantum) :
+    _m_maxNrBytes(maxNrBytes),
+    _m_nrBytes(0),
+    _m_quantum(quantum),
+    _m_nrLookups(0),
+    _m_nrHits(0)
+{
+    if(quantum<=0)
+        throw(E("BGIP_SolutionCache: quantum should be positive"));
+}
+
+long long BGIP_SolutionCache::Quantize(double x) const
+{
+    return(static_cast<long long>(floor(x/_m_quantum + 0.5)));
+}
+
+unsigned long long BGIP_SolutionCache::Hash(const vector<long long>& key)
+{
+    //FNV-1a
+    unsigned long long h=14695981039346656037ULL;
+    for(vector<long long>::const_iterator it=key.begin(); it!=key.end(); ++it)
+    {
+        unsigned long long x=static_cast<unsigned long long>(*it);
+        for(int byte=0; byte!=8; byte++)
+        {
+            h^=(x & 0xff);
+            h*=1099511628211ULL;
+            x>>=8;
+        }
+    }
+    return(h);
+}
+
+void BGIP_SolutionCache::Canonicalize(
+    const BayesianGameIdenticalPayoff& bg,
+    vector<long long>& key,
+    vector<vector<Index> >& typeOrder) const
+{
+    size_t nrAgents=bg.GetNrAgents();
+    const vector<size_t>& nrTypes=bg.GetNrTypes();
+    size_t nrJT=bg.GetNrJointTypes();
+    size_t nrJA=bg.GetNrJointActions();
+
+    //the signature of a type is its marginal probability and the
+    //probability-weighted sum of the payoffs of the joint types it is in
+    vector<vector<double> > prob(nrAgents), payoff(nrAgents);
+    for(Index agI=0; agI < nrAgents; agI++)
+    {
+        prob[agI].resize(nrTypes[agI],0.0);
+        payoff[agI].resize(nrTypes[agI],0.0);
+    }
+    for(Index jtI=0; jtI < nrJT; jtI++)
+    {
+        double p=bg.GetProbability(jtI);
+        if(p==0)
+            continue;
+        double u=0;
+        for(Index jaI=0; jaI < nrJA; jaI++)
+            u+=bg.GetUtility(jtI,jaI);
+        const vector<Index>& types=bg.JointToIndividualTypeIndices(jtI);
+        for(Index agI=0; agI < nrAgents; agI++)
+        {
+            prob[agI][types[agI]]+=p;
+            payoff[agI][types[agI]]+=p*u;
+        }
+    }
+
+    typeOrder.resize(nrAgents);
+    for(Index agI=0; agI < nrAgents; agI++)
+    {
+        vector<TypeSignature> signatures(nrTypes[agI]);
+        for(Index tI=0; tI < nrTypes[agI]; tI++)
+            signatures[tI]=make_pair(make_pair(Quantize(prob[agI][tI]),
+                                               Quantize(payoff[agI][tI])),
+                                     tI);
+        sort(signatures.begin(),signatures.end());
+        BreakTies(bg,agI,signatures);
+        typeOrder[agI].resize(nrTypes[agI]);
+        for(Index pos=0; pos < nrTypes[agI]; pos++)
+            typeOrder[agI][pos]=signatures[pos].second;
+    }
+
+    key.clear();
+    key.push_back(nrAgents);
+    for(Index agI=0; agI < nrAgents; agI++)
+    {
+        key.push_back(bg.GetNrActions(agI));
+        key.push_back(nrTypes[agI]);
+    }
+    //the joint types in canonical order, the payoffs of joint types that
+    //have probability 0 do not influence the solutions
+    vector<Index> positions(nrAgents,0), types(nrAgents);
+    for(Index c=0; c < nrJT; c++)
+    {
+        for(Index agI=0; agI < nrAgents; agI++)
+            types[agI]=typeOrder[agI][positions[agI]];
+        Index jtI=bg.IndividualToJointTypeIndices(types);
+        double p=bg.GetProbability(jtI);
+        key.push_back(Quantize(p));
+        if(p!=0)
+            for(Index jaI=0; jaI < nrJA; jaI++)
+                key.push_back(Quantize(bg.GetUtility(jtI,jaI)));
+
+        for(Index agI=nrAgents; agI-- > 0;)
+        {
+            if(++positions[agI] < nrTypes[agI])
+                break;
+            positions[agI]=0;
+        }
+    }
+}
+
+void BGIP_SolutionCache::BreakTies(const BayesianGameIdenticalPayoff& bg,
+                                   Index agI,
+                                   vector<TypeSignature>& sorted) const
+{
+    size_t nrJT=bg.GetNrJointTypes();
+    size_t nrJA=bg.GetNrJointActions();
+    for(Index first=0; first < sorted.size();)
+    {
+        Index last=first+1;
+        while(last < sorted.size() && sorted[last].first==sorted[first].first)
+            last++;
+        if(last-first > 1)
+        {
+            //the content of a type: the probability and payoffs of each
+            //joint type it is in, sorted such that the order of the types
+            //of the other agents does not matter
+            vector<pair<vector<long long>, Index> > contents;
+            for(Index pos=first; pos < last; pos++)
+            {
+                Index tI=sorted[pos].second;
+                vector<vector<long long> > jointTypes;
+                for(Index jtI=0; jtI < nrJT; jtI++)
+                {
+                    if(bg.JointToIndividualTypeIndices(jtI)[agI]!=tI)
+                        continue;
+                    vector<long long> jt(1,Quantize(bg.GetProbability(jtI)));
+                    for(Index jaI=0; jaI < nrJA; jaI++)
+                        jt.push_back(Quantize(bg.GetUtility(jtI,jaI)));
+                    jointTypes.push_back(jt);
+                }
+                sort(jointTypes.begin(),jointTypes.end());
+                vector<long long> content;
+                for(Index i=0; i < jointTypes.size(); i++)
+                    content.insert(content.end(),jointTypes[i].begin(),
+                                   jointTypes[i].end());
+                contents.push_back(make_pair(content,tI));
+            }
+            //types with equal content are interchangeable, for those the
+            //index is used
+            sort(contents.begin(),contents.end());
+            for(Index pos=first; pos < last; pos++)
+                sorted[pos].second=contents[pos-first].second;
+        }
+        first=last;
+    }
+}
+
+BGIP_SolutionCache::EntryList::iterator
+BGIP_SolutionCache::Find(unsigned long long hash, const vector<long long>& key)
+{
+    pair<EntryIndex::iterator,EntryIndex::iterator> range=
+        _m_index.equal_range(hash);
+    for(EntryIndex::iterator it=range.first; it!=range.second; ++it)
+        if(it->second->key==key)
+            return(it->second);
+    return(_m_entries.end());
+}
+
+size_t BGIP_SolutionCache::ComputeNrBytes(const Entry& e)
+{
+    //the entry, its node in _m_entries and in _m_index
+    size_t bytes=sizeof(Entry) + 2*sizeof(void*) +
+        sizeof(EntryIndex::value_type) + 4*sizeof(void*);
+    bytes+=e.key.capacity()*sizeof(long long);
+    for(Index solI=0; solI < e.solutions.size(); solI++)
+    {
+        bytes+=sizeof(vector<vector<Index> >);
+        for(Index agI=0; agI < e.solutions[solI].size(); agI++)
+            bytes+=sizeof(vector<Index>) +
+                e.solutions[solI][agI].capacity()*sizeof(Index);
+    }
+    return(bytes);
+}
+
+void BGIP_SolutionCache::Add(const Entry& e)
+{
+    EntryList::iterator old=Find(e.hash,e.key);
+    if(old!=_m_entries.end())
+        Remove(old);
+    _m_entries.push_front(e);
+    _m_entries.front().nrBytes=ComputeNrBytes(_m_entries.front());
+    _m_nrBytes+=_m_entries.front().nrBytes;
+    _m_index.insert(make_pair(e.hash,_m_entries.begin()));
+    Evict();
+}
+
+void BGIP_SolutionCache::Remove(EntryList::iterator it)
+{
+    pair<EntryIndex::iterator,EntryIndex::iterator> range=
+        _m_index.equal_range(it->hash);
+    for(EntryIndex::iterator i=range.first; i!=range.second; ++i)
+        if(i->second==it)
+        {
+            _m_index.erase(i);
+            break;
+        }
+    _m_nrBytes-=it->nrBytes;
+    _m_entries.erase(it);
+}
+
+void BGIP_SolutionCache::Evict()
+{
+    while(!_m_entries.empty() && _m_nrBytes > _m_maxNrBytes)
+        Remove(--_m_entries.end());
+}
+
+bool BGIP_SolutionCache::Lookup(
+    const BGIP_constPtr &bg,
+    size_t nrSolutions,
+    double lowerBound,
+    double upperBound,
+    vector<boost::shared_ptr<JPPVValuePair> >& solutions)
+{
+    vector<long long> key;
+    vector<vector<Index> > typeOrder;
+    Canonicalize(*bg,key,typeOrder);
+    unsigned long long hash=Hash(key);
+
+    bool found=false;
+    vector<vector<vector<Index> > > actions;
+#pragma omp critical(BGIP_SolutionCache)
+    {
+        _m_nrLookups++;
+        EntryList::iterator it=Find(hash,key);
+        if(it!=_m_entries.end() &&
+           it->nrSolutions >= nrSolutions &&
+           it->lowerBound <= lowerBound &&
+           it->upperBound >= upperBound)
+        {
+            found=true;
+            _m_nrHits++;
+            actions=it->solutions;
+            //this is now the most recently used entry
+            _m_entries.splice(_m_entries.begin(),_m_entries,it);
+        }
+    }
+    if(!found)
+        return(false);
+
+    solutions.clear();
+    for(Index solI=0; solI < actions.size(); solI++)
+    {
+        boost::shared_ptr<JointPolicyPureVector> jpol(
+            new JointPolicyPureVector(bg, PolicyGlobals::TYPE_INDEX));
+        for(Index agI=0; agI < typeOrder.size(); agI++)
+            for(Index pos=0; pos < typeOrder[agI].size(); pos++)
+                jpol->SetAction(agI, typeOrder[agI][pos],
+                                actions[solI][agI][pos]);
+        solutions.push_back(boost::shared_ptr<JPPVValuePair>(
+                                new JPPVValuePair(jpol,
+                                                  bg->ComputeValueJPol(*jpol))));
+    }
+    //the values can differ (within the quantum) from the stored ones
+    stable_sort(solutions.begin(),solutions.end(),BetterSolution);
+    return(true);
+}
+
+void BGIP_SolutionCache::Store(
+    const BGIP_constPtr &bg,
+    double lowerBound,
+    double upperBound,
+    const vector<boost::shared_ptr<JPPVValuePair> >& solutions,
+    bool exhausted)
+{
+    if(_m_maxNrBytes==0)
+        return;
+
+    Entry e;
+    vector<vector<Index> > typeOrder;
+    Canonicalize(*bg,e.key,typeOrder);
+    e.hash=Hash(e.key);
+    e.nrSolutions=exhausted ? INT_MAX : solutions.size();
+    e.lowerBound=lowerBound;
+    e.upperBound=upperBound;
+    e.solutions.resize(solutions.size());
+    for(Index solI=0; solI < solutions.size(); solI++)
+    {
+        const JointPolicyPureVector& jpol=*solutions[solI]->GetJPPV();
+        e.solutions[solI].resize(typeOrder.size());
+        for(Index agI=0; agI < typeOrder.size(); agI++)
+            for(Index pos=0; pos < typeOrder[agI].size(); pos++)
+                e.solutions[solI][agI].push_back(
+                    jpol.GetActionIndex(agI,typeOrder[agI][pos]));
+    }
+
+#pragma omp critical(BGIP_SolutionCache)
+    Add(e);
+}
+
+void BGIP_SolutionCache::Clear()
+{
+#pragma omp critical(BGIP_SolutionCache)
+    {
+        _m_entries.clear();
+        _m_index.clear();
+        _m_nrBytes=0;
+    }
+}
+
+void BGIP_SolutionCache::SetMaxNrBytes(size_t maxNrBytes)
+{
+#pragma omp critical(BGIP_SolutionCache)
+    {
+        _m_maxNrBytes=maxNrBytes;
+        Evict();
+    }
+}
+
+void BGIP_SolutionCache::Save(const string &filename) const
+{
+    ofstream fp(filename.c_str());
+    if(!fp)
+    {
+        stringstream ss;
+        ss << "BGIP_SolutionCache::Save: failed to open file " << filename
+           << endl;
+        throw E(ss.str());
+    }
+
+    //17 digits, such that the bounds (possibly +-DBL_MAX) are read back
+    //exactly
+    fp.precision(17);
+
+    fp << "BGIP_SolutionCache " << _m_quantum << " " << _m_entries.size()
+       << endl;
+    //least recently used first, such that Load() restores the order
+    for(EntryList::const_reverse_iterator it=_m_entries.rbegin();
+        it!=_m_entries.rend(); ++it)
+    {
+        fp << it->nrSolutions << " " << it->lowerBound << " "
+           << it->upperBound << " " << it->key.size();
+        for(Index i=0; i < it->key.size(); i++)
+            fp << " " << it->key[i];
+        fp << endl;
+        fp << it->solutions.size();
+        for(Index solI=0; solI < it->solutions.size(); solI++)
+            for(Index agI=0; agI < it->solutions[solI].size(); agI++)
+            {
+                fp << " " << it->solutions[solI][agI].size();
+                for(Index pos=0; pos < it->solutions[solI][agI].size(); pos++)
+                    fp << " " << it->solutions[solI][agI][pos];
+            }
+        fp << endl;
+    }
+}
+
+void BGIP_SolutionCache::Load(const string &filename)
+{
+    ifstream fp(filename.c_str());
+    if(!fp)
+    {
+        stringstream ss;
+        ss << "BGIP_SolutionCache::Load: failed to open file " << filename
+           << endl;
+        throw E(ss.str());
+    }
+
+    string header;
+    double quantum;
+    size_t nrEntries;
+    fp >> header >> quantum >> nrEntries;
+    if(!fp || header!="BGIP_SolutionCache")
+        throw(E("BGIP_SolutionCache::Load: file is not a BG solution cache"));
+    if(quantum!=_m_quantum)
+        throw(E("BGIP_SolutionCache::Load: file uses a different quantum"));
+
+    for(Index entryI=0; entryI < nrEntries; entryI++)
+    {
+        Entry e;
+        size_t keySize, nrSolutions;
+        fp >> e.nrSolutions >> e.lowerBound >> e.upperBound >> keySize;
+        e.key.resize(keySize);
+        for(Index i=0; i < keySize; i++)
+            fp >> e.key[i];
+        if(!fp || keySize==0)
+            throw(E("BGIP_SolutionCache::Load: error reading BG"));
+        size_t nrAgents=e.key[0];
+        fp >> nrSolutions;
+        e.solutions.resize(nrSolutions,vector<vector<Index> >(nrAgents));
+        for(Index solI=0; solI < nrSolutions; solI++)
+            for(Index agI=0; agI < nrAgents; agI++)
+            {
+                size_t nrTypes;
+                fp >> nrTypes;
+                e.solutions[solI][agI].resize(nrTypes);
+                for(Index pos=0; pos < nrTypes; pos++)
+                    fp >> e.solutions[solI][agI][pos];
+            }
+        if(!fp)
+            throw(E("BGIP_SolutionCache::Load: error reading solutions"));
+        e.hash=Hash(e.key);
+#pragma omp critical(BGIP_SolutionCache)
+        Add(e);
+    }
+}
+
+string BGIP_SolutionCache::SoftPrint() const
+{
+    stringstream ss;
+    ss << "BGIP_SolutionCache: " << _m_entries.size() << " BGs ("
+       << _m_nrBytes << " of max " << _m_maxNrBytes << " bytes), " << _m_nrLookups << " lookups, "
+       << _m_nrHits << " hits (hit rate " << GetHitRate() << ")" << endl;
+    return(ss.str());
+}
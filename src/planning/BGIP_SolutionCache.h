@@ -0,0 +1,210 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _BGIP_SOLUTIONCACHE_H_
+#define _BGIP_SOLUTIONCACHE_H_ 1
+
+/* the include directives */
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+#include "Globals.h"
+#include "BayesianGameIdenticalPayoff.h"
+#include "boost/shared_ptr.hpp"
+
+class JPPVValuePair;
+
+class BGIP_SolutionCache;
+typedef boost::shared_ptr<BGIP_SolutionCache> BGIP_SolutionCache_sharedPtr;
+
+/**\brief BGIP_SolutionCache stores the solutions of Bayesian games with
+ * identical payoffs, such that a BG that has been solved before does not
+ * need to be solved again.
+ *
+ * In GMAA and in QBG many BGs are constructed that are equal, for
+ * instance when different past policies lead to the same distribution
+ * over joint types. A BG is looked up by a canonical form: the types of
+ * each agent are sorted by their probability and (probability-weighted)
+ * payoff, and probabilities and payoffs are rounded to a multiple of the
+ * quantum. Two BGs that have the same canonical form are considered the
+ * same, such that the solutions of one are also used for the other
+ * (mapped to its own type order). The values returned are always those
+ * of the solutions in the BG that is looked up.
+ *
+ * For each BG the best k solutions are stored, together with the CBG
+ * bounds (see BayesianGameIdenticalPayoffSolver::SetCBGlowerBound()) that
+ * the solver used. A lookup only succeeds if the stored solutions are
+ * at least those that a solver using the requested bounds would return.
+ *
+ * Types with the same probability and payoff are ordered by the
+ * (sorted) probabilities and payoffs of the joint types they are in, so
+ * that the order does not depend on their index.
+ *
+ * The cache uses a limited number of bytes, the least recently used BGs
+ * are removed when a new one is stored. It can be saved to and loaded from a
+ * file, which should only be used for runs that use the same BG solver.
+ */
+class BGIP_SolutionCache
+{
+    private:
+
+        /// The solutions stored for a BG (in the canonical type order).
+        struct Entry
+        {
+            unsigned long long hash;
+            /// The canonical form of the BG.
+            std::vector<long long> key;
+            /// The actions of each solution, for each agent and type.
+            std::vector<std::vector<std::vector<Index> > > solutions;
+            /// The number of solutions for which the entry can be used.
+            size_t nrSolutions;
+            double lowerBound;
+            double upperBound;
+            /// The (estimated) number of bytes used by the entry.
+            size_t nrBytes;
+        };
+        typedef std::list<Entry> EntryList;
+        /// The signature of a type (probability and payoff) and its index.
+        typedef std::pair<std::pair<long long, long long>, Index>
+            TypeSignature;
+        typedef std::multimap<unsigned long long, EntryList::iterator>
+            EntryIndex;
+
+        /// The entries, most recently used first.
+        EntryList _m_entries;
+        /// The entries indexed by the hash of their canonical form.
+        EntryIndex _m_index;
+
+        /// The maximum number of bytes used by the entries.
+        size_t _m_maxNrBytes;
+        /// The number of bytes used by the entries.
+        size_t _m_nrBytes;
+        /// The precision with which probabilities and payoffs are compared.
+        double _m_quantum;
+
+        size_t _m_nrLookups;
+        size_t _m_nrHits;
+
+        /// Computes the canonical form of bg.
+        /** typeOrder gives for each agent the (original) type at each
+         * position of the canonical type order. */
+        void Canonicalize(const BayesianGameIdenticalPayoff& bg,
+                          std::vector<long long>& key,
+                          std::vector<std::vector<Index> >& typeOrder) const;
+        /// Orders types with equal signatures by their content.
+        /** sorted holds the types of agent agI ordered by signature,
+         * those with equal signature are reordered by the sorted
+         * probabilities and payoffs of the joint types they are in. */
+        void BreakTies(const BayesianGameIdenticalPayoff& bg, Index agI,
+                       std::vector<TypeSignature>& sorted) const;
+        /// Rounds x to a multiple of the quantum.
+        long long Quantize(double x) const;
+        /// Computes the hash of a canonical form.
+        static unsigned long long Hash(const std::vector<long long>& key);
+
+        /// Returns the entry for key, or _m_entries.end().
+        EntryList::iterator Find(unsigned long long hash,
+                                 const std::vector<long long>& key);
+        /// Returns the number of bytes used by e, including the lists.
+        static size_t ComputeNrBytes(const Entry& e);
+        /// Adds e as the most recently used entry.
+        void Add(const Entry& e);
+        /// Removes the entry it.
+        void Remove(EntryList::iterator it);
+        /// Removes the least recently used entries while they use too
+        /// many bytes.
+        void Evict();
+
+    protected:
+
+    public:
+        // Constructor, destructor and copy assignment.
+        /// (default) Constructor
+        /** maxNrBytes is the number of bytes that the stored solutions
+         * (and canonical forms of the BGs) may use, quantum the
+         * precision used to compare BGs. */
+        BGIP_SolutionCache(size_t maxNrBytes=64*1024*1024,
+                           double quantum=1e-9);
+
+        /**\brief Looks up the solutions of bg.
+         *
+         * Returns true if at least nrSolutions solutions are stored for
+         * bg (or all solutions, if bg has fewer) that were found with
+         * CBG bounds that are not tighter than lowerBound and
+         * upperBound. In that case solutions contains them, best
+         * first, with their value in bg.
+         */
+        bool Lookup(const BGIP_constPtr &bg,
+                    size_t nrSolutions,
+                    double lowerBound,
+                    double upperBound,
+                    std::vector<boost::shared_ptr<JPPVValuePair> >& solutions);
+
+        /**\brief Stores the solutions of bg.
+         *
+         * solutions should be ordered best first, and are the first
+         * solutions returned by the solver using the given bounds. If
+         * exhausted is true the solver returned no more solutions than
+         * these, otherwise more may exist.
+         */
+        void Store(const BGIP_constPtr &bg,
+                   double lowerBound,
+                   double upperBound,
+                   const std::vector<boost::shared_ptr<JPPVValuePair> >& solutions,
+                   bool exhausted);
+
+        /// Removes all entries (the statistics are kept).
+        void Clear();
+
+        /// Sets the maximum number of bytes used by the entries.
+        void SetMaxNrBytes(size_t maxNrBytes);
+
+        /// Saves the entries to a file.
+        void Save(const std::string &filename) const;
+        /// Adds the entries in a file written by Save().
+        void Load(const std::string &filename);
+
+        //get (data) functions:
+        size_t GetNrEntries() const
+        { return(_m_entries.size()); }
+        /// Returns the number of bytes used by the entries.
+        size_t GetNrBytes() const
+        { return(_m_nrBytes); }
+        size_t GetMaxNrBytes() const
+        { return(_m_maxNrBytes); }
+        size_t GetNrLookups() const
+        { return(_m_nrLookups); }
+        size_t GetNrHits() const
+        { return(_m_nrHits); }
+        /// Returns the fraction of lookups that succeeded.
+        double GetHitRate() const
+        { return(_m_nrLookups>0 ?
+                 static_cast<double>(_m_nrHits)/_m_nrLookups : 0.0); }
+
+        /// Prints the statistics of the cache to a string.
+        std::string SoftPrint() const;
+        void Print() const
+        { std::cout << SoftPrint(); }
+
+};
+
+
+#endif /* !_BGIP_SOLUTIONCACHE_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
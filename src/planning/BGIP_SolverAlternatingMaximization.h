@@ -64,6 +64,8 @@ private:
             boost::shared_ptr<const BayesianGameIdenticalPayoffInterface> bgip=
                 this->GetBGIPI();
             const BayesianGameIdenticalPayoffInterface* bgipRawPtr=bgip.get();
+            const BayesianGameIdenticalPayoff *bgDense=
+                BayesianGameIdenticalPayoff::GetDenseBG(bgipRawPtr);
             Index agI = optimizingAgentI;
             std::vector< std::vector<double> > v (bgip->GetNrTypes(agI), std::vector<double>(
                                             bgipRawPtr->GetNrActions(agI), 0.0) );
@@ -82,7 +84,8 @@ private:
                 {
                     avec.at(agI) = acI;
                     Index jaInew = bgipRawPtr->IndividualToJointActionIndices(avec);
-                    double u =  bgipRawPtr->GetUtility(jt, jaInew);
+                    double u = bgDense ? bgDense->GetUtilityDense(jt, jaInew) :
+                        bgipRawPtr->GetUtility(jt, jaInew);
                     v[type][acI] +=  jtProb * u;
                     if(DEBUG_CBR)
                         std::cout << "updated v[type][acI]="<<v[type][acI]<< 
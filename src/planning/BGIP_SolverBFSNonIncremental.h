@@ -163,11 +163,14 @@ public:
                 bgip= this->GetBGIPI();
             const BayesianGameIdenticalPayoffInterface *bgipRawPtr=
                 bgip.get();
+            const BayesianGameIdenticalPayoff *bgDense=
+                BayesianGameIdenticalPayoff::GetDenseBG(bgipRawPtr);
             for(Index jt = 0; jt < nrJT; ++jt)
             {
                 double P_jt = bgipRawPtr->GetProbability(jt);
                 Index ja = jpolRawPtr->GetJointActionIndex(jt);  
-                v += P_jt * bgipRawPtr->GetUtility(jt, ja);
+                v += P_jt * (bgDense ? bgDense->GetUtilityDense(jt, ja) :
+                             bgipRawPtr->GetUtility(jt, ja));
             }
 
             if(DEBUG_BGIP_SOLVER_BFS) std::cout << "Expected value = "<< v;
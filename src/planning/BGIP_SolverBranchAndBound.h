@@ -30,6 +30,12 @@
 #include "JPPVValuePair.h"
 #include "PartialJPDPValuePair.h"
 #include "VectorTools.h"
+#include "EDeadline.h"
+#include "EParallel.h"
+#ifdef _OPENMP
+#include <omp.h>
+#include <pthread.h>
+#endif
 
 //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 // compute _m_impliedJPol when a new node is selected:
@@ -41,6 +47,8 @@
 
 #define DEBUG_VALID_ACTIONS 0
 #define CHECK_VALID_JA 0
+/// The number of open nodes per thread before a parallel search starts.
+#define BNB_PARALLEL_NODES_PER_THREAD 8
 
 //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
@@ -68,6 +76,12 @@ private:
 
     /// Pointer to the BG we're solving.
     boost::shared_ptr<const BayesianGameIdenticalPayoffInterface> _m_bgip;
+    /// The BG if it stores its utilities in a dense table (otherwise 0).
+    const BayesianGameIdenticalPayoff *_m_bgDense;
+
+    /**The pool the search nodes are allocated from. Declared before
+     * all members that refer to nodes, so it is destructed after them.*/
+    BGIP_BnB_NodePool _m_nodePool;
 
     /// The priority queue keeping track of all the open nodes in the search.
     std::priority_queue<BGIP_BnB_NodePtr> *_m_openQueue;
@@ -129,6 +143,12 @@ private:
 
     std::vector<std::vector<Index> > _m_jaToIndCache;
 
+    /**The joint actions implied by the node that is being processed,
+     * one table per thread (see GetImpliedJointActions()).*/
+    std::vector<BGIP_BnB_ImpliedJointActions> _m_impliedJAs;
+    /// Whether ParallelExpand() is running.
+    bool _m_searchingConcurrently;
+
     double ReSolve()
     {
         if(_m_verbosity>=1)
@@ -156,6 +176,13 @@ private:
         }
 #endif
 
+#ifdef _OPENMP
+        // expand the promising nodes concurrently, the loop below then
+        // finishes the search
+        if(SolveConcurrently())
+            ParallelExpand();
+#endif
+
         Index i=0;
         // keep on expanding the open queue until it's empty
         while(!_m_openQueue->empty())
@@ -270,6 +297,261 @@ private:
                GetPayoff());
     };
 
+#ifdef _OPENMP
+    /**Whether ReSolve() searches with several threads, see
+     * ParallelExpand(). This is the case when compiled with OpenMP
+     * (configure --enable-openmp), more than one thread is available, we
+     * are not already inside a parallel region, only the best solution
+     * is desired, and the joint type ordering is fixed.*/
+    bool SolveConcurrently() const
+    {
+#if CACHE_IMPLIED_JPOL || INCR_EXPAND
+        return(false);
+#else
+        return(this->GetNrDesiredSolutions()==1 &&
+               !_m_reComputeJTIndexMapping &&
+               omp_get_max_threads()>1 && !omp_in_parallel());
+#endif
+    }
+
+    /**Expands the open nodes with several threads, as far as the
+     * serial search in ReSolve() would.
+     *
+     * The most promising nodes are expanded serially until there are
+     * BNB_PARALLEL_NODES_PER_THREAD open nodes per thread, which are
+     * then dealt out over per-thread priority queues. Each thread
+     * expands the best node of its own queue and pushes the children
+     * on it; when its queue is empty it steals the best node of another
+     * thread's queue, and when all queues are empty it waits until
+     * another thread pushes children. The value of the best policy
+     * found so far is shared by all threads, and nodes with a lower F
+     * are put aside instead of being expanded. Fully specified nodes are
+     * always put aside, and all threads stop when one of them hits
+     * the CBG upper bound (as in ReSolve(), by its F).
+     *
+     * All nodes that were put aside and the ones left in the queues go
+     * back in the open queue, and ReSolve() selects the solution from
+     * them. Nothing is dropped, so the open queue still holds the
+     * next-best solutions when the search is resumed by
+     * GetNextJointPolicyAndValue(), as GMAA-ICE does. The queue orders
+     * the nodes by F and then in the order of
+     * BGIP_BnB_Node::PrecedesOnTie(), which does not depend on the
+     * thread that created a node. The serial loop of ReSolve() therefore
+     * processes the fully specified nodes in the same order as a
+     * search with one thread, and returns the same policies.*/
+    void ParallelExpand()
+    {
+        size_t nrThreads=omp_get_max_threads();
+
+        // get enough work for all threads
+        while(!_m_openQueue->empty() &&
+              _m_openQueue->size() < BNB_PARALLEL_NODES_PER_THREAD*nrThreads)
+        {
+            BGIP_BnB_NodePtr top=_m_openQueue->top();
+            if(top->IsFullySpecifiedPolicy(_m_maxDepth) ||
+               top->GetF() < _m_CBGlowerBound)
+                return; // ReSolve() takes it from here
+            ExpandAllExtensions(top);
+        }
+        if(_m_openQueue->empty() ||
+           _m_openQueue->top()->IsFullySpecifiedPolicy(_m_maxDepth))
+            return;
+
+        // the BG caches the individual type indices on first use, so
+        // fill that cache before the threads read it
+        for(Index jt=0;jt!=_m_nrJTs;++jt)
+            _m_bgip->JointToIndividualTypeIndices(jt);
+
+        std::vector<std::priority_queue<BGIP_BnB_NodePtr> > queues(nrThreads);
+        std::vector<std::vector<BGIP_BnB_NodePtr> > putAside(nrThreads);
+        std::vector<omp_lock_t> locks(nrThreads);
+        for(Index q=0;q!=nrThreads;++q)
+            omp_init_lock(&locks[q]);
+        _m_impliedJAs.resize(nrThreads);
+        _m_nodePool.SetNrThreads(nrThreads);
+        _m_searchingConcurrently=true;
+        for(Index q=0;!_m_openQueue->empty();++q)
+        {
+            queues[q % nrThreads].push(_m_openQueue->top());
+            _m_openQueue->pop();
+        }
+
+        // the value of the best fully specified node found
+        double lowerBound=-DBL_MAX;
+
+        // threads without work wait for workAvailable; workGeneration
+        // counts the pushes of children while threads were waiting
+        pthread_mutex_t workMutex;
+        pthread_cond_t workAvailable;
+        pthread_mutex_init(&workMutex,0);
+        pthread_cond_init(&workAvailable,0);
+        size_t nrWaiting=0;
+        unsigned long workGeneration=0;
+        int stop=0;
+        EParallel error;
+        size_t nrExpanded=0;
+
+#pragma omp parallel num_threads(nrThreads) reduction(+:nrExpanded)
+        {
+            Index me=omp_get_thread_num();
+            size_t nrInTeam=omp_get_num_threads();
+            std::vector<Index> JAs;
+            std::vector<BGIP_BnB_NodePtr> children;
+            BGIP_BnB_NodePtr node;
+            Index i=0;
+            while(true)
+            {
+                unsigned long seenGeneration;
+                pthread_mutex_lock(&workMutex);
+                seenGeneration=workGeneration;
+                bool stopNow=stop;
+                pthread_mutex_unlock(&workMutex);
+                if(stopNow)
+                    break;
+
+                // take the best node of the own queue, or else steal
+                // the best node of another thread's queue
+                bool gotWork=false;
+                for(Index k=0;k!=nrThreads && !gotWork;++k)
+                {
+                    Index q=(me+k) % nrThreads;
+                    omp_set_lock(&locks[q]);
+                    if(!queues[q].empty())
+                    {
+                        node=queues[q].top();
+                        queues[q].pop();
+                        gotWork=true;
+                    }
+                    omp_unset_lock(&locks[q]);
+                }
+
+                if(!gotWork)
+                {
+                    // wait until children are pushed, unless that
+                    // happened meanwhile; all threads are done when all
+                    // of them wait, as only busy threads create work
+                    bool finished=false;
+                    pthread_mutex_lock(&workMutex);
+                    if(workGeneration==seenGeneration && !stop)
+                    {
+                        nrWaiting++;
+                        if(nrWaiting==nrInTeam)
+                        {
+                            stop=1;
+                            pthread_cond_broadcast(&workAvailable);
+                        }
+                        while(workGeneration==seenGeneration && !stop)
+                            pthread_cond_wait(&workAvailable,&workMutex);
+                        nrWaiting--;
+                    }
+                    finished=stop;
+                    pthread_mutex_unlock(&workMutex);
+                    if(finished)
+                        break;
+                    continue;
+                }
+
+                try {
+                    if(++i % 100 == 0)
+                        this->CheckDeadline("BnB deadline exceeded");
+
+                    double lb;
+#pragma omp atomic read
+                    lb=lowerBound;
+                    if(node->IsFullySpecifiedPolicy(_m_maxDepth))
+                    {
+                        double value=ComputeValueOfFullySpecifiedPolicy(node);
+                        // ReSolve() processes it, also when it is not
+                        // the best, as it can be a next-best solution
+                        putAside[me].push_back(node);
+                        if(value>lb)
+                        {
+#pragma omp critical(BGIP_SolverBranchAndBound_lowerBound)
+                            if(value>lowerBound)
+                            {
+#pragma omp atomic write
+                                lowerBound=value;
+                            }
+                        }
+                        if(node->GetF() > (_m_CBGupperBound-PROB_PRECISION))
+                        {
+                            pthread_mutex_lock(&workMutex);
+                            stop=1;
+                            pthread_cond_broadcast(&workAvailable);
+                            pthread_mutex_unlock(&workMutex);
+                        }
+                    }
+                    else if(node->GetF() < lb ||
+                            node->GetF() < _m_CBGlowerBound)
+                        putAside[me].push_back(node);
+                    else
+                    {
+                        ComputeValidJointActionExtensions(node, JAs);
+                        children.clear();
+                        for(Index j=0;j!=JAs.size();++j)
+                            children.push_back(CreateExtension(node,JAs[j]));
+                        nrExpanded+=children.size();
+                        omp_set_lock(&locks[me]);
+                        for(Index j=0;j!=children.size();++j)
+                            queues[me].push(children[j]);
+                        omp_unset_lock(&locks[me]);
+                        if(!children.empty())
+                        {
+                            pthread_mutex_lock(&workMutex);
+                            if(nrWaiting>0)
+                            {
+                                workGeneration++;
+                                pthread_cond_broadcast(&workAvailable);
+                            }
+                            pthread_mutex_unlock(&workMutex);
+                        }
+                    }
+                }
+                catch(...)
+                {
+                    error.Catch();
+                    // the node was not replaced by its children
+                    putAside[me].push_back(node);
+                    pthread_mutex_lock(&workMutex);
+                    stop=1;
+                    pthread_cond_broadcast(&workAvailable);
+                    pthread_mutex_unlock(&workMutex);
+                }
+            }
+        }
+
+        pthread_cond_destroy(&workAvailable);
+        pthread_mutex_destroy(&workMutex);
+        _m_searchingConcurrently=false;
+        _m_nodePool.SetNrThreads(1);
+        for(Index t=0;t!=_m_impliedJAs.size();++t)
+            _m_impliedJAs[t].Clear();
+
+        _m_nrNodesExpanded+=nrExpanded;
+
+        // all nodes go back in the open queue
+        for(Index q=0;q!=nrThreads;++q)
+        {
+            while(!queues[q].empty())
+            {
+                _m_openQueue->push(queues[q].top());
+                queues[q].pop();
+            }
+            for(Index n=0;n!=putAside[q].size();++n)
+                _m_openQueue->push(putAside[q][n]);
+            omp_destroy_lock(&locks[q]);
+        }
+
+        if(_m_verbosity>=1)
+            std::cout << "BGIP_SolverBranchAndBound expanded "
+                      << nrExpanded << " nodes with " << nrThreads
+                      << " threads, open queue size: "
+                      << _m_openQueue->size() << std::endl;
+
+        error.Rethrow();
+    };
+#endif
+
     /// Computes the "complete information" heuristic values for all joint types.
     void ComputeCompleteInformationValues()
     {
@@ -546,10 +828,18 @@ private:
     _m_maxDepth=depth;
 };
 
+    /// Get the utility of a (joint type,joint action) pair.
+    double GetUtility(Index jtI, Index jaI) const
+        {
+            if(_m_bgDense)
+                return(_m_bgDense->GetUtilityDense(jtI,jaI));
+            return(_m_bgip->GetUtility(jtI,jaI));
+        }
+
     /// Get the contribution of a (joint type,joint action) pair.
     double GetContribution(Index jtI, Index jaI) const
         {
-            return(_m_bgip->GetProbability(jtI)*_m_bgip->GetUtility(jtI,jaI));
+            return(_m_bgip->GetProbability(jtI)*GetUtility(jtI,jaI));
         }
 
     /**\brief Orders the joint type mapping origJTIndexMapping (with
@@ -631,6 +921,10 @@ private:
             std::vector<Index>& valid_JAs ){
     const std::vector<Index> &indTypes=
         _m_bgip->JointToIndividualTypeIndices(jt_bgI);
+#if !CACHE_IMPLIED_JPOL
+    const BGIP_BnB_ImpliedJointActions &impliedJAs=
+        GetImpliedJointActions(node);
+#endif
     // we loop over all joint actions and check whether 
     // they are valid
     for(Index ja=0;ja!=_m_jaToIndCache.size();++ja)
@@ -652,7 +946,10 @@ private:
             acI = _m_impliedJPol[agI][tI];
 #else          
             Index depth_tI = GetDepthFirstSpecified(agI,tI,node);
-            acI = node->GetSpecifiedAction(agI, depth_tI);
+            if(depth_tI <= node->GetDepth())
+                acI = GetSpecifiedAction(impliedJAs, agI, depth_tI);
+            else
+                acI = UNSPECIFIED_ACTION;
 #endif
             if(acI!=UNSPECIFIED_ACTION && 
                aI[agI] != acI)
@@ -690,6 +987,10 @@ private:
         SoftPrintVector(indTypes) << std::endl;
 #endif
 
+#if !CACHE_IMPLIED_JPOL
+    const BGIP_BnB_ImpliedJointActions &impliedJAs=
+        GetImpliedJointActions(node);
+#endif
     //  valid_action_set[agI] stores the valid action for agent i
     std::vector< Index > valid_action_set(_m_nrAgents, UNSPECIFIED_ACTION);
     for(Index agI=0; agI < _m_nrAgents; agI++)
@@ -711,7 +1012,7 @@ private:
             //action for tI. This means that the valid joint actions that 
             //can be assigned to children nodes of this node, are 
             //constrained!
-            valid_action_set.at(agI) = node->GetSpecifiedAction(agI, depth_tI);
+            valid_action_set.at(agI) = GetSpecifiedAction(impliedJAs, agI, depth_tI);
         else
         {
             ;
@@ -841,7 +1142,7 @@ private:
         for(Index val_jaI=0; val_jaI < valid_JAs.size(); val_jaI++)
         {
             Index ja = valid_JAs[val_jaI];
-            double c=_m_bgip->GetUtility(jt_bgI,ja);
+            double c=GetUtility(jt_bgI,ja);
             bestValue=std::max(c,bestValue);
         }
         h+=_m_bgip->GetProbability(jt_bgI)*bestValue;
@@ -967,6 +1268,8 @@ private:
     double ComputeValueOfFullySpecifiedPolicy(BGIP_BnB_NodePtr node)
     {
         std::vector<Index> aIs(_m_bgip->GetNrAgents());
+        const BGIP_BnB_ImpliedJointActions &impliedJAs=
+            GetImpliedJointActions(node);
         
         // For the already specified joint types, G contains their value
         double value=node->GetG();
@@ -993,7 +1296,7 @@ private:
                 acI = _m_impliedJPol[agI][tI];
 #else          
                 Index depth_tI = GetDepthFirstSpecified(agI,tI,node);
-                acI = node->GetSpecifiedAction(agI, depth_tI);
+                acI = GetSpecifiedAction(impliedJAs, agI, depth_tI);
 #endif
 #endif                    
                 aIs[agI] = acI;
@@ -1009,6 +1312,8 @@ private:
     void ConvertNodeToPolicyAndAddToSolution(BGIP_BnB_NodePtr node, double value)
     {
         boost::shared_ptr<JP> jpol =  boost::dynamic_pointer_cast<JP>( this->GetNewJpol() );
+        const BGIP_BnB_ImpliedJointActions &impliedJAs=
+            GetImpliedJointActions(node);
         for(Index agI=0;agI!=_m_nrAgents;++agI)
             for(Index tI=0;tI!=_m_bgip->GetNrTypes(agI);++tI)
             {
@@ -1023,7 +1328,7 @@ private:
                 acI = _m_impliedJPol[agI][tI];
 #else          
                 Index depth_tI = GetDepthFirstSpecified(agI,tI,node);
-                acI = node->GetSpecifiedAction(agI, depth_tI);
+                acI = GetSpecifiedAction(impliedJAs, agI, depth_tI);
 #endif
 #endif
                 jpol->SetAction(agI,tI,acI);
@@ -1158,7 +1463,10 @@ private:
             {
                 //Index a=node->GetAction(i,currentTs[i]);
                 Index depth_tI = GetDepthFirstSpecified(i,currentTs[i]);
-                Index a = node->GetSpecifiedAction(agI, depth_tI);
+                Index a = UNSPECIFIED_ACTION;
+                if(depth_tI <= node->GetDepth())
+                    a = GetSpecifiedAction(GetImpliedJointActions(node),
+                                           i, depth_tI);
                 if(a!=UNSPECIFIED_ACTION && 
                    aI[i] != a)
                 {
@@ -1197,31 +1505,55 @@ private:
 
     void Expand(BGIP_BnB_NodePtr node, Index JA)
     {
-        const std::vector<Index> &ja=_m_jaToIndCache[JA];
+        BGIP_BnB_NodePtr nodeExtend=CreateExtension(node,JA);
+        _m_nrNodesExpanded++;
+
+        if(_m_verbosity>4)
+            std::cout << "BGIP_SolverBranchAndBound Adding node: "
+                      << nodeExtend->SoftPrint() << std::endl;
         
+#if INCR_EXPAND
+        // keep track of already expanded nodes
+        node->SetAlreadyExpanded(JA);
+#endif
+
+        if(node->GetF() < _m_CBGlowerBound)
+            _m_nrNodesPruned++; // do nothing, by not putting it on the
+                                // queue it will be deleted
+        else
+            // add the node to the queue
+            _m_openQueue->push(nodeExtend);
+    };
+
+    /**Creates the child of node that specifies joint action JA for the
+     * next joint type, and computes its G and H values. The open queue
+     * and the statistics are not touched, so ParallelExpand() can call
+     * this concurrently.*/
+    BGIP_BnB_NodePtr CreateExtension(BGIP_BnB_NodePtr node, Index JA)
+    {
         // Create a new node, copy from its parent
-        BGIP_BnB_NodePtr nodeExtend=BGIP_BnB_NodePtr(new BGIP_BnB_Node(*node));
+        BGIP_BnB_NodePtr nodeExtend=BGIP_BnB_NodePtr(new(_m_nodePool) BGIP_BnB_Node(*node));
 
         nodeExtend->SetDepth( node->GetDepth() + 1 );
 #if INCR_EXPAND
         nodeExtend->ClearAlreadyExpanded();
 #endif
         nodeExtend->SetParent(node);
-        _m_nrNodesExpanded++;
         
         //jt_oI of *nodeExtended* is *node*->GetDepth
         Index jt_oI = node->GetDepth();
         Index jt_bgI = _m_jtIndexMapping[jt_oI];
         
         // update the new nodes joint policy
+        nodeExtend->SetJointAction(JA);
+#if MAINTAIN_FULL_POL || CACHE_IMPLIED_JPOL
+        const std::vector<Index> &ja=_m_jaToIndCache[JA];
         const std::vector<Index> &indTypes=
             _m_bgip->JointToIndividualTypeIndices(jt_bgI);
         for(Index agI=0;agI!=indTypes.size();++agI)
         {
 #if MAINTAIN_FULL_POL        
             nodeExtend->SetAction(agI,indTypes[agI],ja[agI]);
-#else
-            nodeExtend->SetAction(agI,ja[agI]);
 #endif
 
 #if CACHE_IMPLIED_JPOL
@@ -1230,6 +1562,7 @@ private:
             _m_impliedJPol[agI][ indTypes[agI] ] = ja[agI];
 #endif
         }
+#endif
         
         // update the G and H values, which automatically updates F:
         if(_m_reComputeH)
@@ -1242,22 +1575,8 @@ private:
         }
         // then we add the real value to G
         nodeExtend->UpdateG(GetContribution(jt_bgI,JA));
-                
-        if(_m_verbosity>4)
-            std::cout << "BGIP_SolverBranchAndBound Adding node: "
-                      << nodeExtend->SoftPrint() << std::endl;
-        
-#if INCR_EXPAND
-        // keep track of already expanded nodes
-        node->SetAlreadyExpanded(JA);
-#endif
 
-        if(node->GetF() < _m_CBGlowerBound)
-            _m_nrNodesPruned++; // do nothing, by not putting it on the
-                                // queue it will be deleted
-        else
-            // add the node to the queue
-            _m_openQueue->push(nodeExtend);
+        return(nodeExtend);
     };
 
     void Prune(double value)
@@ -1323,6 +1642,27 @@ private:
         }
 
     
+    /**Returns the joint actions specified by node and its ancestors,
+     * using the table of the calling thread.*/
+    const BGIP_BnB_ImpliedJointActions&
+    GetImpliedJointActions(const BGIP_BnB_NodePtr &node)
+        {
+            Index t=0;
+#ifdef _OPENMP
+            if(_m_searchingConcurrently)
+                t=omp_get_thread_num();
+#endif
+            _m_impliedJAs[t].SetNode(node);
+            return(_m_impliedJAs[t]);
+        }
+
+    /// Returns the action of agI specified at depth_tI by impliedJAs.
+    Index GetSpecifiedAction(const BGIP_BnB_ImpliedJointActions &impliedJAs,
+                             Index agI, Index depth_tI) const
+        {
+            return(_m_jaToIndCache[impliedJAs.GetJointAction(depth_tI)][agI]);
+        }
+
     Index GetDepthFirstSpecified(Index agentI, Index typeI, 
                                  BGIP_BnB_NodePtr node) const 
         {
@@ -1414,6 +1754,7 @@ public:
         _m_nrSolutionsComputed(0),
         _m_solved(false),
         _m_bgip(bg),
+        _m_bgDense(BayesianGameIdenticalPayoff::GetDenseBG(bg.get())),
         _m_openQueue(new std::priority_queue<BGIP_BnB_NodePtr>()),
     //    _m_bestNode(0),
         _m_jtOrdering(jtOrdering),
@@ -1433,7 +1774,9 @@ public:
         _m_nrNodesFullySpecified(0),
         _m_nrAgents(bg->GetNrAgents() ),
         _m_nrActions( bg->GetNrActions() ),
-        _m_nrJTs(bg->GetNrJointTypes() )
+        _m_nrJTs(bg->GetNrJointTypes() ),
+        _m_impliedJAs(1),
+        _m_searchingConcurrently(false)
     {
         // set up a cache for quick joint action conversions
         for(Index ja=0;ja!=_m_bgip->GetNrJointActions();++ja)
@@ -1491,7 +1834,7 @@ public:
                                      _m_jtIndexMapping);
         else
 #endif
-            root = BGIP_BnB_NodePtr(new BGIP_BnB_Node(_m_bgip->GetNrAgents()));
+            root = BGIP_BnB_NodePtr(new(_m_nodePool) BGIP_BnB_Node(&_m_nodePool));
         // G is initialized to 0,
         // H is also initialized to 0, so we now *add* the contributions for each joint type
         for(Index jt_bgI=0;jt_bgI!=_m_bgip->GetNrJointTypes();++jt_bgI)
@@ -1509,6 +1852,15 @@ public:
 
     size_t GetNrNodesExpanded() const { return(_m_nrNodesExpanded); }
 
+    /// Counts the search nodes and the open queue.
+    size_t GetNrBytes() const
+    {
+        return(sizeof(*this) + _m_nodePool.GetNrBytes() +
+               _m_openQueue->size()*sizeof(BGIP_BnB_NodePtr) +
+               _m_jaToIndCache.size()*
+               (sizeof(std::vector<Index>) + _m_nrAgents*sizeof(Index)));
+    }
+
     bool IsExactSolver() const { return(true); }
 
     bool GetNextJointPolicyAndValueSpecific(boost::shared_ptr<JointPolicyDiscretePure> &jpol, double &value)
@@ -25,18 +25,38 @@
 #include <float.h>
 #include "TimeTools.h"
 #include "EDeadline.h"
-#include <sys/times.h>
+#include "EParallel.h"
 #include "JPPVValuePair.h"
 #include "PartialJPDPValuePair.h"
+#include <cmath>
+#include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define DEBUG_BGIP_SOLVER_BFS 0
 #define DEBUG_BGIP_SOLVER_BFS_PRINTOUTPROGRESS 0
 
+/// The relative round-off allowed in incrementally computed values.
+#define BFS_GRAYCODE_TOLERANCE 1e-9
+/// The number of incremental steps after which a value is recomputed.
+#define BFS_GRAYCODE_RESYNC 4096
+
 #include <typeinfo>
 
 /**\brief BGIP_SolverBruteForceSearch is a class that performs Brute
  * force search for identical payoff Bayesian Games.
  *
+ * The joint policies are enumerated in Gray code order, such that the
+ * value of each can be computed from the previous one by only
+ * considering the joint types of the individual type whose action
+ * changed. When compiled with OpenMP and only the best solution is
+ * desired, the joint policies are split in ranges that are searched
+ * concurrently. The result is the same as for enumeration in the order
+ * of JointPolicyPureVector::Increment(): ties are broken in favor of
+ * the lexicographically smallest actions, and when the CBG upper bound
+ * is hit the first joint policy in that order that hits it is returned.
+ *
  * The template argument JP represents the joint policy class the
  * solver should return.
  */
@@ -57,76 +77,341 @@ private:
     double _m_CBGlowerBound;
     double _m_CBGupperBound;
 
-protected:
-    
-public:
-    // Constructor, destructor and copy assignment.
-    // (default) Constructor
-    //BGIP_SolverBruteForceSearch();
-    /**Constructor. Directly Associates a problem with the planner
-     * Information regarding the problem is used to construct a joint policy
-     * of the proper shape.*/
-    BGIP_SolverBruteForceSearch(const boost::shared_ptr<const BayesianGameIdenticalPayoffInterface> &bg,
-                                size_t verbose = 0, size_t nrDesiredSolutions = INT_MAX,
-                                size_t deadlineInSeconds = 0) :
-        BGIP_IncrementalSolverInterface_T<JP>(bg,nrDesiredSolutions),
-        _m_verbosity(verbose),
-        _m_deadlineInSeconds(deadlineInSeconds),
-        _m_solved(false),
-        _m_CBGupperBound(DBL_MAX)
-        {}
+    /**\name Gray code enumeration
+     * The joint policies are enumerated in (reflected, mixed-radix) Gray
+     * code order: each digit is the action of one individual type, and
+     * each step changes one digit by one. So only the joint types that
+     * involve the changed type need to be re-evaluated.*/
+    //@{
+    /// The number of actions for each digit (agent, type), agent-major.
+    std::vector<Index> _m_radix;
+    /// The agent of each digit.
+    std::vector<Index> _m_digitAgent;
+    /// The type of each digit.
+    std::vector<Index> _m_digitType;
+    /**The joint types that contain the type of digit k are
+     * _m_jtList[_m_jtListStart[k]] up to _m_jtList[_m_jtListStart[k+1]].*/
+    std::vector<Index> _m_jtListStart;
+    /// See _m_jtListStart.
+    std::vector<Index> _m_jtList;
+    /// The digits of the individual types of joint type jt start at jt*nrAgents.
+    std::vector<Index> _m_jtDigits;
+    /// The change of the joint action index if an agent's action increases by one.
+    std::vector<Index> _m_jaStep;
+    /// The probability of each joint type.
+    std::vector<double> _m_jtProbs;
+    /// The BG if it stores its utilities in a dense table (otherwise 0).
+    const BayesianGameIdenticalPayoff *_m_bgDense;
+    /// The maximum round-off of incrementally computed values.
+    double _m_tolerance;
+    //@}
+
+    double GetUtility(Index jt, Index ja) const
+    {
+        return(_m_bgDense ? _m_bgDense->GetUtilityDense(jt, ja) :
+               this->GetBGIPI()->GetUtility(jt, ja));
+    }
 
-    double Solve()
-    {    
-        _m_solved = true;
-        struct timeval start_time, cur_time;
-        if(gettimeofday(&start_time, NULL) != 0)
-            throw "Error with gettimeofday";
+    /// Computes the lists of joint types per individual type, etc.
+    void InitGrayCode()
+    {
+        const BayesianGameIdenticalPayoffInterface *bgip=
+            this->GetBGIPI().get();
+        size_t nrAgents=bgip->GetNrAgents();
+        size_t nrJT=bgip->GetNrJointTypes();
+        _m_bgDense=BayesianGameIdenticalPayoff::GetDenseBG(bgip);
+
+        std::vector<Index> firstDigit(nrAgents);
+        _m_radix.clear();
+        _m_digitAgent.clear();
+        _m_digitType.clear();
+        for(Index agI=0;agI!=nrAgents;++agI)
+        {
+            firstDigit[agI]=_m_radix.size();
+            for(Index tI=0;tI!=bgip->GetNrTypes(agI);++tI)
+            {
+                _m_radix.push_back(bgip->GetNrActions(agI));
+                _m_digitAgent.push_back(agI);
+                _m_digitType.push_back(tI);
+            }
+        }
 
-        tms ts_before, ts_after;
-        times(&ts_before);
-        LIndex checkPointForDeadline = 1000000;
+        _m_jaStep.resize(nrAgents);
+        std::vector<Index> actions(nrAgents,0);
+        for(Index agI=0;agI!=nrAgents;++agI)
+        {
+            _m_jaStep[agI]=0;
+            if(bgip->GetNrActions(agI)>1)
+            {
+                actions[agI]=1;
+                _m_jaStep[agI]=bgip->IndividualToJointActionIndices(actions);
+                actions[agI]=0;
+            }
+        }
 
-        bool round = false;
+        // count the joint types per digit, then fill the lists
+        _m_jtDigits.resize(nrJT*nrAgents);
+        _m_jtListStart.assign(_m_radix.size()+1,0);
+        _m_jtProbs.resize(nrJT);
+        double maxAbsValue=0;
+        for(Index jt=0;jt!=nrJT;++jt)
+        {
+            const std::vector<Index> &indTypes=
+                bgip->JointToIndividualTypeIndices(jt);
+            for(Index agI=0;agI!=nrAgents;++agI)
+            {
+                Index k=firstDigit[agI]+indTypes[agI];
+                _m_jtDigits[jt*nrAgents+agI]=k;
+                _m_jtListStart[k+1]++;
+            }
+            _m_jtProbs[jt]=bgip->GetProbability(jt);
+            double maxAbsU=0;
+            for(Index ja=0;ja!=bgip->GetNrJointActions();++ja)
+                maxAbsU=std::max(maxAbsU,std::abs(GetUtility(jt,ja)));
+            maxAbsValue+=_m_jtProbs[jt]*maxAbsU;
+        }
+        for(Index k=0;k!=_m_radix.size();++k)
+            _m_jtListStart[k+1]+=_m_jtListStart[k];
+        _m_jtList.resize(_m_jtListStart.back());
+        std::vector<Index> fill(_m_jtListStart.begin(),_m_jtListStart.end()-1);
+        for(Index jt=0;jt!=nrJT;++jt)
+            for(Index agI=0;agI!=nrAgents;++agI)
+                _m_jtList[fill[_m_jtDigits[jt*nrAgents+agI]]++]=jt;
+
+        _m_tolerance=BFS_GRAYCODE_TOLERANCE*(1.0+maxAbsValue);
+    }
 
-        boost::shared_ptr<JP> jpol = 
-            boost::dynamic_pointer_cast<JP>(this->GetNewJpol());
-        boost::shared_ptr<JP> best = 
-            boost::dynamic_pointer_cast<JP>(this->GetNewJpol());
+    /**Sets digits (and the direction in which each digit moves) to the
+     * rank-th code in Gray code order.*/
+    void SetGrayCode(unsigned long long rank,
+                     std::vector<Index> &digits,
+                     std::vector<char> &up) const
+    {
+        size_t n=_m_radix.size();
+        std::vector<Index> b(n);
+        for(Index k=n;k-- > 0;)
+        {
+            b[k]=rank % _m_radix[k];
+            rank/=_m_radix[k];
+        }
+        // digit k moves up when the number formed by the more
+        // significant digits is even
+        bool odd=false;
+        for(Index k=0;k!=n;++k)
+        {
+            up[k]=!odd;
+            digits[k]=up[k] ? b[k] : _m_radix[k]-1-b[k];
+            odd=(odd && _m_radix[k] % 2) != (b[k] % 2 == 1);
+        }
+    }
 
-        double v_best = -DBL_MAX;
-        double v = 0.0;
+    /**Moves digits to the next code in Gray code order. Returns the
+     * digit that changed, or INDEX_MAX if digits was the last code.*/
+    Index NextGrayCode(std::vector<Index> &digits,
+                       std::vector<char> &up) const
+    {
+        for(Index k=digits.size();k-- > 0;)
+        {
+            if(up[k])
+            {
+                if(digits[k]+1<_m_radix[k])
+                {
+                    digits[k]++;
+                    return(k);
+                }
+            }
+            else if(digits[k]>0)
+            {
+                digits[k]--;
+                return(k);
+            }
+            up[k]=!up[k];
+        }
+        return(INDEX_MAX);
+    }
 
-        int i = 0;
-        if(DEBUG_BGIP_SOLVER_BFS)
-            std::cout<<"Starting Bruteforce search - v_best is init to "<<v_best<<std::endl;
-#if DEBUG_BGIP_SOLVER_BFS_PRINTOUTPROGRESS
-        LIndex nrJPols = this->GetBGIPI()->GetNrJointPolicies();
-#endif
+    /**Computes the value of the joint policy that takes joint action
+     * jaOfJT[jt] for each joint type jt, summing in the same order as
+     * a full evaluation.*/
+    double ComputeValue(const std::vector<Index> &jaOfJT) const
+    {
+        double v=0.0;
+        for(Index jt=0;jt!=jaOfJT.size();++jt)
+            v+=_m_jtProbs[jt]*GetUtility(jt,jaOfJT[jt]);
+        return(v);
+    }
+
+    /// The best joint policy found by SearchGrayCode().
+    struct BestFound
+    {
+        double value;
+        std::vector<Index> actions;
+        bool hitUpperBound;
+    };
 
-        size_t nrJT = this->GetBGIPI()->
-            GetNrJointTypes();
-        size_t nrDesiredSolutions = this->GetNrDesiredSolutions();
-        
-        while(!round)
+    /// What the concurrent searches of SearchGrayCode() share.
+    struct SharedSearchState
+    {
+        /// Set when a search failed, the others then stop.
+        int abort;
+        /// Whether a joint policy that hits the CBG upper bound was found.
+        bool hit;
+        /// The lexicographically smallest such joint policy.
+        std::vector<Index> hitActions;
+    };
+
+    /**Returns whether a code that follows digits in Gray code order can
+     * be lexicographically smaller than hit. The code that follows first
+     * differs from digits in some digit m, which moved in direction
+     * up[m] while the more significant digits are unchanged.*/
+    bool CanFollowSmaller(const std::vector<Index> &digits,
+                          const std::vector<char> &up,
+                          const std::vector<Index> &hit) const
+    {
+        for(Index m=0;m!=digits.size();++m)
         {
-            if(DEBUG_BGIP_SOLVER_BFS){std::cout << "Jpol#"<< i << " - ";}
-#if DEBUG_BGIP_SOLVER_BFS_PRINTOUTPROGRESS
-            if(i % 1000 == 0&& i > 1000)
+            if(!up[m] && digits[m]>0)
+                return(true);
+            if(digits[m]!=hit[m])
+                return(digits[m]<hit[m]);
+        }
+        return(false);
+    }
+
+    /**Stores actions in shared if it is the first, or lexicographically
+     * smallest, joint policy that hits the CBG upper bound. Returns the
+     * smallest one found so far (by any search) in hit.*/
+    void UpdateHit(SharedSearchState *shared,
+                   const std::vector<Index> *actions,
+                   std::vector<Index> &hit) const
+    {
+#pragma omp critical(BGIP_SolverBruteForceSearch_hit)
+        {
+            if(actions && (!shared->hit || *actions < shared->hitActions))
             {
-                std::cout << "Jpol #"<< i << " of " << nrJPols<< " - ";
-                printf("%.4f", ((double)i / nrJPols) * 100 );
-                std::cout << "%" << std::endl;
+                shared->hit=true;
+                shared->hitActions=*actions;
             }
-#endif
+            if(shared->hit)
+                hit=shared->hitActions;
+        }
+    }
+
+    /**Evaluates the joint policies with Gray code rank begin up to
+     * begin+count (or all from begin, if count is 0), and stores the
+     * best in best. Ties are broken in favor of the joint policy that
+     * comes first in the order of JointPolicyPureVector::Increment(),
+     * i.e., with the lexicographically smallest actions. When more
+     * than one solution is desired, all joint policies are added to the
+     * solution.
+     *
+     * thread0 reports whether this search checks the deadline, for
+     * which the work is assumed to be split over nrThreads searches.
+     *
+     * When the CBG upper bound is hit, the lexicographically smallest
+     * joint policy that hits it is desired (the first one
+     * JointPolicyPureVector::Increment() would reach). The hits are
+     * shared with the concurrent searches, and a search stops once none
+     * of its remaining joint policies can be lexicographically smaller
+     * than the smallest hit, or when shared->abort is set.*/
+    void SearchGrayCode(unsigned long long begin, unsigned long long count,
+                        BestFound &best, bool thread0, size_t nrThreads,
+                        double nrJPols, SharedSearchState *shared)
+    {
+        size_t nrAgents=this->GetBGIPI()->GetNrAgents();
+        size_t nrJT=_m_jtProbs.size();
+        size_t nrDesiredSolutions=this->GetNrDesiredSolutions();
+
+        std::vector<Index> digits(_m_radix.size());
+        std::vector<char> up(_m_radix.size());
+        SetGrayCode(begin,digits,up);
+
+        boost::shared_ptr<JP> jpol;
+        if(nrDesiredSolutions>1)
+        {
+            jpol=boost::dynamic_pointer_cast<JP>(this->GetNewJpol());
+            for(Index k=0;k!=digits.size();++k)
+                jpol->SetAction(_m_digitAgent[k],_m_digitType[k],digits[k]);
+        }
+
+        std::vector<Index> jaOfJT(nrJT,0);
+        for(Index jt=0;jt!=nrJT;++jt)
+            for(Index agI=0;agI!=nrAgents;++agI)
+                jaOfJT[jt]+=_m_jaStep[agI]*digits[_m_jtDigits[jt*nrAgents+agI]];
+
+        best.value=-DBL_MAX;
+        best.hitUpperBound=false;
+
+        struct timeval start_time, cur_time;
+        if(gettimeofday(&start_time, NULL) != 0)
+            throw "Error with gettimeofday";
+        unsigned long long checkPointForDeadline = 1000000;
+        // the smallest hit of the CBG upper bound known to this search
+        std::vector<Index> hit;
+
+        double v=ComputeValue(jaOfJT);
+        bool exact=true;
+        for(unsigned long long i=0; ; )
+        {
+            // only compute the exact value of possibly good policies
+            if(!exact && (nrDesiredSolutions>1 ||
+                          v >= std::min(best.value,
+                                        _m_CBGupperBound-PROB_PRECISION)
+                          - _m_tolerance))
+            {
+                v=ComputeValue(jaOfJT);
+                exact=true;
+            }
+            if(exact)
+            {
+                if(DEBUG_BGIP_SOLVER_BFS) std::cout << "Expected value = "<< v;
+                if(nrDesiredSolutions == 1 &&
+                   (v >= (_m_CBGupperBound-PROB_PRECISION)))
+                {
+                    if(!best.hitUpperBound || digits < best.actions)
+                    {
+                        best.value=v;
+                        best.actions=digits;
+                        best.hitUpperBound=true;
+                        UpdateHit(shared,&digits,hit);
+                        if(!CanFollowSmaller(digits,up,hit))
+                            return;
+                    }
+                }
+                else if(!best.hitUpperBound &&
+                        (v > best.value ||
+                         (v == best.value && digits < best.actions)))
+                {
+                    if(DEBUG_BGIP_SOLVER_BFS) std::cout << " -> new best policy!!!";
+                    best.value=v;
+                    best.actions=digits;
+                    if(nrThreads==1 && this->GetWriteAnyTimeResults()){
+                        gettimeofday(&cur_time, NULL);
+                        double delta  = TimeTools::GetDeltaTimeDouble(start_time, cur_time);
+                        (*this->GetResultsOFStream()) << best.value << "\t";
+                        (*this->GetTimingsOFStream()) << delta << "\t";
+                    }
+                }
+                // if we want more than just the single best solution,
+                // try to add all to the solution
+                if(nrDesiredSolutions>1)
+                    this->AddSolution( *jpol, v );
+            }
+
+            ++i;
+            if(count>0 && i>=count)
+                break;
+
             //this checks whether BFS has used more time then allowed 
             //(the deadline) and throws an exception if it has.
-            if(_m_deadlineInSeconds && (i % checkPointForDeadline) == 0)
+            if(thread0 && _m_deadlineInSeconds &&
+               (i % checkPointForDeadline) == 0)
             {
-                times(&ts_after);
-                clock_t utime = ts_after.tms_utime -
-                    ts_before.tms_utime;
-                double timeSpentInS = static_cast<double>(utime) / sysconf(_SC_CLK_TCK);
+                // wall-clock time, as the deadline is: the nrThreads
+                // searches progress at about the same rate
+                gettimeofday(&cur_time, NULL);
+                double timeSpentInS =
+                    TimeTools::GetDeltaTimeDouble(start_time, cur_time) / 1e6;
 
                 // we don't want to base our estimate on too few
                 // time, so make it run at least 2s
@@ -134,17 +419,14 @@ public:
                     checkPointForDeadline *= 2;
                 else
                 {
-                    LIndex nrJPols = this->
-                        GetBGIPI()->GetNrJointPolicies();
                     double expectedTimeNeeded=
-                        (CastLIndexToDouble(nrJPols)/
-                         CastLIndexToDouble(checkPointForDeadline))*
+                        (nrJPols/(static_cast<double>(i)*nrThreads))*
                         timeSpentInS;
                     if(expectedTimeNeeded > (1.5*_m_deadlineInSeconds))
                     {
                         std::stringstream ss;
                         ss << "BGIP_SolverBruteForceSearch::Solve after " 
-                           << checkPointForDeadline
+                           << i*nrThreads
                            << " we spent " << timeSpentInS << "s, for all " << nrJPols
                            << " jpols we expect to take " << expectedTimeNeeded
                            << "s, which is above the deadline (>1.5*" 
@@ -154,57 +436,166 @@ public:
                     }
                 }
             }
-            ++i;
-            
-            v = 0.0;
-
-            JP *jpolRawPtr = jpol.get();
-            boost::shared_ptr<const BayesianGameIdenticalPayoffInterface> 
-                bgip= this->GetBGIPI();
-            const BayesianGameIdenticalPayoffInterface *bgipRawPtr=
-                bgip.get();
-            for(Index jt = 0; jt < nrJT; ++jt)
+
+            // limit the accumulated round-off
+            bool resync=(i % BFS_GRAYCODE_RESYNC == 0);
+            if(resync)
             {
-                double P_jt = bgipRawPtr->GetProbability(jt);
-                Index ja = jpolRawPtr->GetJointActionIndex(jt);  
-                v += P_jt * bgipRawPtr->GetUtility(jt, ja);
+                int abort;
+#pragma omp atomic read
+                abort=shared->abort;
+                if(abort)
+                    break;
+                if(nrDesiredSolutions == 1)
+                {
+                    UpdateHit(shared,0,hit);
+                    if(!hit.empty() && !CanFollowSmaller(digits,up,hit))
+                        break;
+                }
             }
 
-            if(DEBUG_BGIP_SOLVER_BFS) std::cout << "Expected value = "<< v;
-            if(v > v_best)
+            Index k=NextGrayCode(digits,up);
+            if(k==INDEX_MAX)
+                break;
+            if(jpol)
+                jpol->SetAction(_m_digitAgent[k],_m_digitType[k],digits[k]);
+
+            // update the joint types that involve the changed type
+            Index agI=_m_digitAgent[k];
+            bool increased=up[k];
+            for(Index l=_m_jtListStart[k];l!=_m_jtListStart[k+1];++l)
             {
-                if(DEBUG_BGIP_SOLVER_BFS) std::cout << " -> new best policy!!!";
-                v_best = v;
-                *best = *jpol; 
-                if(this->GetWriteAnyTimeResults()){
-                    double delta  = TimeTools::GetDeltaTimeDouble(start_time, cur_time);
-                    (*this->GetResultsOFStream()) << v_best << "\t";
-                    (*this->GetTimingsOFStream()) << delta << "\t";
-                }
+                Index jt=_m_jtList[l];
+                Index jaOld=jaOfJT[jt];
+                Index jaNew=increased ? jaOld+_m_jaStep[agI] :
+                    jaOld-_m_jaStep[agI];
+                jaOfJT[jt]=jaNew;
+                v+=_m_jtProbs[jt]*(GetUtility(jt,jaNew)-GetUtility(jt,jaOld));
             }
+            exact=resync;
+            if(exact)
+                v=ComputeValue(jaOfJT);
+        }
+    }
 
-            if(nrDesiredSolutions == 1 &&
-               (v >= (_m_CBGupperBound-PROB_PRECISION)))
+protected:
+    
+public:
+    // Constructor, destructor and copy assignment.
+    // (default) Constructor
+    //BGIP_SolverBruteForceSearch();
+    /**Constructor. Directly Associates a problem with the planner
+     * Information regarding the problem is used to construct a joint policy
+     * of the proper shape.*/
+    BGIP_SolverBruteForceSearch(const boost::shared_ptr<const BayesianGameIdenticalPayoffInterface> &bg,
+                                size_t verbose = 0, size_t nrDesiredSolutions = INT_MAX,
+                                size_t deadlineInSeconds = 0) :
+        BGIP_IncrementalSolverInterface_T<JP>(bg,nrDesiredSolutions),
+        _m_verbosity(verbose),
+        _m_deadlineInSeconds(deadlineInSeconds),
+        _m_solved(false),
+        _m_CBGlowerBound(-DBL_MAX),
+        _m_CBGupperBound(DBL_MAX),
+        _m_bgDense(0),
+        _m_tolerance(0)
+        {}
+
+    double Solve()
+    {    
+        _m_solved = true;
+        InitGrayCode();
+
+        if(DEBUG_BGIP_SOLVER_BFS)
+            std::cout<<"Starting Bruteforce search"<<std::endl;
+
+        // the number of joint policies, if it fits in an unsigned long long
+        unsigned long long nrJPols=1;
+        double nrJPolsD=1;
+        bool overflow=false;
+        for(Index k=0;k!=_m_radix.size();++k)
+        {
+            nrJPolsD*=_m_radix[k];
+            if(nrJPols > std::numeric_limits<unsigned long long>::max() /
+               _m_radix[k])
+                overflow=true;
+            else
+                nrJPols*=_m_radix[k];
+        }
+
+        // split the joint policies in ranges, one per thread
+        size_t nrThreads=1;
+#ifdef _OPENMP
+        if(this->GetNrDesiredSolutions()==1 && !overflow &&
+           !omp_in_parallel())
+            nrThreads=std::min(static_cast<unsigned long long>(
+                                   omp_get_max_threads()), nrJPols);
+#endif
+        std::vector<BestFound> best(nrThreads);
+        SharedSearchState shared;
+        shared.abort=0;
+        shared.hit=false;
+        if(nrThreads==1)
+            SearchGrayCode(0,0,best[0],true,1,nrJPolsD,&shared);
+#ifdef _OPENMP
+        else
+        {
+            EParallel error;
+#pragma omp parallel for schedule(static,1) num_threads(nrThreads)
+            for(int t=0;t<static_cast<int>(nrThreads);++t)
             {
-                std::cout << "Hit CBG upperbound" << std::endl;
-                this->AddSolution( *jpol, v );
-                return(v);
-                break;
+                unsigned long long begin=(nrJPols/nrThreads)*t+
+                    std::min<unsigned long long>(t, nrJPols % nrThreads);
+                unsigned long long count=nrJPols/nrThreads+
+                    (static_cast<unsigned long long>(t) < nrJPols % nrThreads ? 1 : 0);
+                try {
+                    SearchGrayCode(begin,count,best[t],t==0,nrThreads,
+                                   nrJPolsD,&shared);
+                }
+                catch(...)
+                {
+                    error.Catch();
+#pragma omp atomic write
+                    shared.abort=1;
+                }
             }
+            error.Rethrow();
+        }
+#endif
 
-            // if we want more than just the single best solution, try to add all to the solution
-            if(nrDesiredSolutions>1)
+        // combine the results of the ranges: the smallest hit of the
+        // upper bound, or else the best value
+        Index b=0;
+        for(Index t=1;t!=nrThreads;++t)
+        {
+            if(best[t].hitUpperBound != best[b].hitUpperBound)
             {
-                this->AddSolution( *jpol, v );
-//                      std::cout << "added solution with value " << v << ", best is "
-//                                << this->GetPayoff() << std::endl;
-//                      std::cout << this->GetSolution().SoftPrint();
+                if(best[t].hitUpperBound)
+                    b=t;
             }
-            if(DEBUG_BGIP_SOLVER_BFS) {    
-                std::cout <<  std::endl << "Incrementing joint policy..."<<std::endl; 
-            }    
-            round = ++(*jpol);
+            else if(best[t].hitUpperBound)
+            {
+                if(best[t].actions < best[b].actions)
+                    b=t;
+            }
+            else if(best[t].value > best[b].value ||
+                    (best[t].value == best[b].value &&
+                     best[t].actions < best[b].actions))
+                b=t;
         }
+        double v_best=best[b].value;
+        boost::shared_ptr<JP> jpolBest = 
+            boost::dynamic_pointer_cast<JP>(this->GetNewJpol());
+        for(Index k=0;k!=best[b].actions.size();++k)
+            jpolBest->SetAction(_m_digitAgent[k],_m_digitType[k],
+                                best[b].actions[k]);
+
+        if(best[b].hitUpperBound)
+        {
+            std::cout << "Hit CBG upperbound" << std::endl;
+            this->AddSolution( *jpolBest, v_best );
+            return(v_best);
+        }
+
         //end the line in the results file
         if(this->GetWriteAnyTimeResults()){
             (*this->GetResultsOFStream()) << std::endl;
@@ -212,8 +603,8 @@ public:
         } 
 
         // if _m_nrSolutions>1 then we already added this to the queue
-        if(nrDesiredSolutions == 1)
-            this->AddSolution( *best, v_best );
+        if(this->GetNrDesiredSolutions() == 1)
+            this->AddSolution( *jpolBest, v_best );
 
         return(v_best);
     }
@@ -278,6 +278,8 @@ public:
                         double v = 0.0;        
 
                         const BayesianGameIdenticalPayoffInterface* bgipRawPtr=this->GetBGIPI().get();
+                        const BayesianGameIdenticalPayoff *bgDense=
+                            BayesianGameIdenticalPayoff::GetDenseBG(bgipRawPtr);
                         for(Index jt = 0; jt < nrJT; jt++)
                         {
                             if(jt % 10000 == 0)
@@ -295,7 +297,9 @@ public:
                                         GetActionIndex(indTypes.at(agentI));
                                 
                                 Index ja = bgipRawPtr->IndividualToJointActionIndices(indAcs);
-                                v += P_jt * bgipRawPtr->GetUtility(jt, ja);
+                                v += P_jt * (bgDense ?
+                                    bgDense->GetUtilityDense(jt, ja) :
+                                    bgipRawPtr->GetUtility(jt, ja));
                             }
                         }
 #if DEBUG_BGIP_SOLVER_CE
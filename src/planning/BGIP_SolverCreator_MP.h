@@ -38,6 +38,7 @@ private:
     double _m_damping; 
     size_t _m_nrSolutions;
     size_t _m_nrRestarts;
+    size_t _m_nrThreads;
 
 protected:
     
@@ -49,14 +50,17 @@ public:
                            size_t verbose=1,
                            double damping=0.0,
                            size_t nrSolutions=1,
-                           size_t nrRestarts=10 
+                           size_t nrRestarts=10,
+                           size_t nrThreads=1
         )
         :
         _m_maxiter(maxiter),
         _m_updateType(updateT),
         _m_verbose(verbose),
+        _m_damping(damping),
         _m_nrSolutions(nrSolutions),
-        _m_nrRestarts(nrRestarts)        
+        _m_nrRestarts(nrRestarts),
+        _m_nrThreads(nrThreads)
         {}
     
     //operators:
@@ -71,7 +75,8 @@ public:
                     _m_verbose,
                     _m_damping,
                     _m_nrSolutions,
-                    _m_nrRestarts
+                    _m_nrRestarts,
+                    _m_nrThreads
                     )
                 );
         };
@@ -86,7 +91,7 @@ public:
                 ", _m_updateType=" << _m_updateType <<
                 ", _m_verbose="<<_m_verbose <<", _m_damping="<< _m_damping <<
                 ", _m_nrSolutions="<<_m_nrSolutions<<", _m_nrRestarts="<<
-                _m_nrRestarts;
+                _m_nrRestarts << ", _m_nrThreads=" << _m_nrThreads;
             return (ss.str());
         }
 
@@ -19,19 +19,31 @@
 
 /* the include directives */
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
 #include "Globals.h"
 #include "JointPolicyPureVector.h"
 #include "BayesianGameIdenticalPayoffSolver_T.h"
 #include "MaxPlusSolverForBGs.h"
+#include "EParallel.h"
 #include "var.h"
 #include "maxplus.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /** 
  * BGIP_SolverMaxPlus is a class that performs max plus for BGIPs (without agents independence)
  *
  * Note: if there is agent independence, you want to use BGCG_SolverMaxPlus instead!
  *
- *
+ * The factor graph is constructed once, after which nrRestarts runs of
+ * max plus are performed from random initial messages, and the best
+ * solution found is returned. When compiled with OpenMP the restarts are
+ * performed concurrently (all reading the same factor graph), and
+ * nrThreads > 1 also computes the messages of the PARALL updates in
+ * parallel, which pays off for large BGs solved with a single restart.
  */
 template<class JP>
 class BGIP_SolverMaxPlus : 
@@ -57,10 +69,12 @@ public:
             size_t verbosity = 2,
             double damping = 0.0,
             size_t nrSolutions = 1,
-            size_t nrRestarts = 1
+            size_t nrRestarts = 1,
+            size_t nrThreads = 1
         ) :
         BayesianGameIdenticalPayoffSolver_T<JP>(bg),
-        MaxPlusSolverForBGs(maxiter, updateType, verbosity, damping, nrSolutions, nrRestarts)
+        MaxPlusSolverForBGs(maxiter, updateType, verbosity, damping, nrSolutions, nrRestarts,
+                            nrThreads)
         {}
 
     ///Solve the BayesianGameIdenticalPayoffInterface
@@ -104,17 +118,68 @@ public:
             props.Set("damping",_m_damping);
             double  tol = 1e-4;
             props.Set("tol",tol);
-            libDAI::MaxPlus mp (fg, props);
-            mp.init();
-            if(BayesianGameIdenticalPayoffSolver_T<JP>::GetWriteAnyTimeResults())
-                mp.SetAnyTimeResults(true,
-                                     BayesianGameIdenticalPayoffSolver_T<JP>::GetResultsOFStream(),
-                                     BayesianGameIdenticalPayoffSolver_T<JP>::GetTimingsOFStream());
-            double value = mp.run();
+            props.Set("threads",_m_nrThreads);
+
+            bool anyTime = 
+                BayesianGameIdenticalPayoffSolver_T<JP>::GetWriteAnyTimeResults();
+            size_t nrRestarts = std::max(_m_nrRestarts, static_cast<size_t>(1));
+            std::vector<double> values(nrRestarts);
+            std::vector< std::vector<size_t> > configs(nrRestarts);
+            if(nrRestarts == 1)
+            {
+                libDAI::MaxPlus mp (fg, props);
+                mp.init();
+                if(anyTime)
+                    mp.SetAnyTimeResults(true,
+                                         BayesianGameIdenticalPayoffSolver_T<JP>::GetResultsOFStream(),
+                                         BayesianGameIdenticalPayoffSolver_T<JP>::GetTimingsOFStream());
+                values[0] = mp.run();
+                configs[0] = mp.GetBestConfiguration();
+            }
+            else
+            {
+                // the seeds of the restarts are drawn beforehand, such that
+                // the solution does not depend on the number of threads
+                std::vector<unsigned int> seeds(nrRestarts);
+                for(Index r = 0; r < nrRestarts; r++)
+                    seeds[r] = static_cast<unsigned int>(rand());
+
+                // the anytime results and verbose output (which libDAI
+                // does not print thread-safely) require sequential restarts
+                bool parallel = false;
+#ifdef _OPENMP
+                parallel = omp_get_max_threads() > 1 && !omp_in_parallel() &&
+                    !anyTime && _m_verbosity < 2;
+#endif
+                EParallel error;
+#pragma omp parallel for schedule(dynamic,1) if(parallel)
+                for(Index r = 0; r < nrRestarts; r++)
+                {
+                    try {
+                        libDAI::MaxPlus mp (fg, props);
+                        mp.initWithSeed(seeds[r]);
+                        if(anyTime)
+                            mp.SetAnyTimeResults(true,
+                                                 BayesianGameIdenticalPayoffSolver_T<JP>::GetResultsOFStream(),
+                                                 BayesianGameIdenticalPayoffSolver_T<JP>::GetTimingsOFStream());
+                        values[r] = mp.run();
+                        configs[r] = mp.GetBestConfiguration();
+                    }
+                    catch(...) { error.Catch(); }
+                }
+                error.Rethrow();
+            }
+
+            // the first of the best restarts is used
+            Index bestRestart = 0;
+            for(Index r = 1; r < nrRestarts; r++)
+                if(values[r] > values[bestRestart])
+                    bestRestart = r;
+            double value = values[bestRestart];
             
             //Create the BG policy as computed by MaxPlus...
             
-            const std::vector<size_t> & config = mp.GetBestConfiguration();
+            const std::vector<size_t> & config = configs[bestRestart];
             // construct the JP with the bgip now
             //JP jpolBG( BayesianGameIdenticalPayoffSolver_T<JP>::_m_solution.GetJointPolicyPureVector() );
             boost::shared_ptr<JP> temp = 
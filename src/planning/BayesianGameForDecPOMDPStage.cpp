@@ -23,6 +23,13 @@
 #include "JointBeliefInterface.h"
 #include "QFunctionJAOHInterface.h"
 #include "BeliefIteratorGeneric.h"
+#include "TGet.h"
+#include "OGet.h"
+#include "EParallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define DEBUG_BG4DECPOMDP1 0
 #define DEBUG_BG4DECPOMDP2 0
@@ -60,6 +67,25 @@ BayesianGameForDecPOMDPStage::BayesianGameForDecPOMDPStage(
     Initialize();
 
 }
+BayesianGameForDecPOMDPStage::BayesianGameForDecPOMDPStage(
+        const boost::shared_ptr<const BayesianGameForDecPOMDPStage> &prevBG,
+        const boost::shared_ptr<const PartialJointPolicyDiscretePure> &pastJPol
+    )
+        :
+            BayesianGameForDecPOMDPStageInterface(pastJPol),
+            BayesianGameIdenticalPayoff( 
+                prevBG->GetNrAgents(), 
+                prevBG->GetNrActions(), 
+                prevBG->_m_pu->GetNrObservationHistoriesVector(
+                    pastJPol->GetDepth() )
+            )           
+            ,_m_pu(prevBG->_m_pu)
+            ,_m_qHeuristic(prevBG->_m_qHeuristic)
+            ,_m_JBs( GetNrJointTypes() )
+            ,_m_areCachedImmediateRewards(false)
+{
+    InitializeFromPreviousBG(*prevBG);
+}
 BayesianGameForDecPOMDPStage::BayesianGameForDecPOMDPStage(
         const PlanningUnitDecPOMDPDiscrete* pu
     )
@@ -111,6 +137,7 @@ BayesianGameForDecPOMDPStage::BayesianGameForDecPOMDPStage(const BayesianGameFor
         ,_m_qHeuristic(o._m_qHeuristic)
         ,_m_areCachedImmediateRewards(o._m_areCachedImmediateRewards)
         ,_m_immR(o._m_immR) //does this work for std::vector< std::vector<double> > ? gues so?
+        ,_m_jaohIs(o._m_jaohIs)
 {
     //make deep copy of beliefs in _m_JB
     _m_JBs=std::vector< JointBeliefInterface* >(o._m_JBs.size(),0);
@@ -485,20 +512,37 @@ void BayesianGameForDecPOMDPStage::Initialize()
 
 
     BayesianGameIdenticalPayoff *bg_ts=this;
+    size_t nrJA = GetNrJointActions();
+
+    //the probabilities and utilities are first computed for all joint types
+    //and only then stored in the BG: neither the utility function nor the
+    //joint->individual type cache of the BG supports concurrent writes.
+    vector<double> probs(nrJOHts, 0.0);
+    vector<double> utils(nrJOHts * nrJA, 0.0);
+    _m_jaohIs = vector<Index>(nrJOHts, 0);
+    bool parallel = ConstructConcurrently(nrJOHts);
+    EParallel error;
+
     //for each joint obs. history (type of the BG), we determine the actions
     //that jpolPrevTs would have specified (i.e., we determine JAOH, the 
     //act-obs. history). This is then used to compute:
     //  -the probability of this joint obs. history (given jpolPrevTs)
     //  -the expected reward over 0...ts-1 GIVEN that this JAOH occurs
+    //
+    //The joint types are independent, so (when compiled with OpenMP) they
+    //are partitioned over the available threads.
+#pragma omp parallel for schedule(dynamic,16) if(parallel)
     for(Index jtI = 0; jtI < nrJOHts; jtI++)
     {
+      try {
         if(DEBUG_BG4DECPOMDP2)
             PrintProgress("jtI",jtI,nrJOHts, 10);
         
         //we loop over Joint Type indices - these correspond to 
         //joint observation history indices, but non-trivially, so let's first
         //compute the joint observation history 
-        const vector<Index> indTypes = bg_ts->JointToIndividualTypeIndices(jtI);
+        const vector<Index> indTypes = 
+            IndexTools::JointToIndividualIndices(jtI, GetNrTypes());
 
         //array for the joint observations at ts=1,...,ts
         Index joI_arr[ts];
@@ -539,8 +583,13 @@ void BayesianGameForDecPOMDPStage::Initialize()
             if(jb->SanityCheck())
                 _m_JBs.at(jtI) = jb;
             else
+            {
+                delete jb;
                 throw(E("BayesianGameForDecPOMDPStage::Initialize() joint belief not valid"));
+            }
         }
+        else
+            delete jb;
 
 /*        //old:
         ProbRewardForjoahI(ts, jtI, jaI_arr,joI_arr, jaohI, PjaohI, 
@@ -551,28 +600,209 @@ void BayesianGameForDecPOMDPStage::Initialize()
         //now we have found the jaohI corresponding to johI (jtI) and 
         //previous policy jpolPrevTs, so we can get the Q-value and prob. for 
         //the BG.
-        bg_ts->SetProbability(jtI, PjaohI);
-        for(Index jaI=0; jaI < GetNrJointActions(); jaI++)
+        probs[jtI] = PjaohI;
+        _m_jaohIs[jtI] = jaohI;
+        if(PjaohI>0) // asking for a heuristic Q for a history
+                     // that cannot have occurred might lead to
+                     // problems (QMDP cannot compute a belief for
+                     // instance, so just leave it 0
         {
-            if(PjaohI>0) // asking for a heuristic Q for a history
-                         // that cannot have occurred might lead to
-                         // problems (QMDP cannot compute a belief for
-                         // instance, so just put 0
-            {
-                double ut = _m_qHeuristic->GetQ(jaohI, jaI);
-                bg_ts->SetUtility(jtI, jaI, ut );
-            }
-            else
-                bg_ts->SetUtility(jtI, jaI, 0);
+            double* utilsThisJT = &utils[jtI * nrJA];
+            for(Index jaI=0; jaI < nrJA; jaI++)
+                utilsThisJT[jaI] = _m_qHeuristic->GetQ(jaohI, jaI);
         }
-    
+      } catch(...) {
+            //exceptions cannot leave a parallel region, so they are
+            //re-thrown after the loop
+            error.Catch();
+      }
     }//end for jtI
+    error.Rethrow();
+
+    for(Index jtI = 0; jtI < nrJOHts; jtI++)
+    {
+        bg_ts->SetProbability(jtI, probs[jtI]);
+        for(Index jaI=0; jaI < nrJA; jaI++)
+            bg_ts->SetUtility(jtI, jaI, utils[jtI * nrJA + jaI]);
+    }
     //now the Bayesian game is constructed completely.
 
     //perhaps store the previous reward somewhere?
     //_m_pastReward = ExpR_0_prevTS;
 }
 
+void BayesianGameForDecPOMDPStage::InitializeFromPreviousBG(
+        const BayesianGameForDecPOMDPStage& prevBG)
+{
+    Index ts = GetStage();
+    if(GetPastJointPolicy() == 0)
+        throw(E("BayesianGameForDecPOMDPStage::InitializeFromPreviousBG called without past joint policy"));
+    if(ts == 0 || prevBG.GetStage() + 1 != ts ||
+       prevBG._m_jaohIs.size() != prevBG.GetNrJointTypes())
+        throw(E("BayesianGameForDecPOMDPStage::InitializeFromPreviousBG previous BG is not an initialized BG for the preceding stage"));
+
+    const MultiAgentDecisionProcessDiscreteInterface* madp = 
+        _m_pu->GetMADPDI();
+    size_t nrAgents = GetNrAgents();
+    size_t nrS = madp->GetNrStates();
+    size_t nrJA = GetNrJointActions();
+    size_t nrJO = _m_pu->GetNrJointObservations();
+    size_t nrJT = GetNrJointTypes();
+    size_t nrPrevJT = prevBG.GetNrJointTypes();
+    vector<size_t> nrO(nrAgents);
+    for(Index agI=0; agI < nrAgents; agI++)
+        nrO[agI] = _m_pu->GetNrObservations(agI);
+    const vector<size_t>& nrTypes = GetNrTypes();
+    const vector<size_t>& nrPrevTypes = prevBG.GetNrTypes();
+
+    //the past policy specifies the actions taken at stage ts-1, i.e., for
+    //the observation histories that are the types of prevBG
+    boost::shared_ptr<const JointPolicyDiscretePure> jpolPrevTs = 
+        GetPastJointPolicy();
+    vector<Index> firstOHprevTsI;
+    Fill_FirstOHtsI(ts - 1, firstOHprevTsI);
+
+    //when observations depend on the previous state we use the regular
+    //belief update, otherwise the prediction P(s'|b,a) is computed once and
+    //shared by all joint observations.
+    bool eventObservability = madp->GetEventObservability();
+    TGet* T = madp->GetTGet();
+
+    vector<double> probs(nrJT, 0.0);
+    vector<double> utils(nrJT * nrJA, 0.0);
+    _m_jaohIs = vector<Index>(nrJT, 0);
+    bool parallel = ConstructConcurrently(nrPrevJT);
+    EParallel error;
+
+    //Each joint type of prevBG (a joint observation history of stage ts-1)
+    //has nrJO successor joint types: the individual type of each agent is 
+    //extended with its observation. Because observation histories are
+    //numbered breadth-first, the successor of type tI of agent agI for
+    //observation oI is type tI * nrO[agI] + oI.
+#pragma omp parallel for schedule(dynamic,16) if(parallel)
+    for(Index prevJtI = 0; prevJtI < nrPrevJT; prevJtI++)
+    {
+      try {
+        double prevP = prevBG.GetProbability(prevJtI);
+        if(prevP <= 0)
+            continue; //all successors have probability 0
+        const JointBeliefInterface* prevJB = prevBG._m_JBs.at(prevJtI);
+        if(!prevJB)
+            throw(E("BayesianGameForDecPOMDPStage::InitializeFromPreviousBG previous joint belief has not been computed"));
+
+        const vector<Index> prevIndTypes = 
+            IndexTools::JointToIndividualIndices(prevJtI, nrPrevTypes);
+        vector<Index> aIs(nrAgents);
+        for(Index agI=0; agI < nrAgents; agI++)
+            aIs[agI] = jpolPrevTs->GetActionIndex(agI, 
+                    prevIndTypes[agI] + firstOHprevTsI[agI]);
+        Index jaI = _m_pu->IndividualToJointActionIndices(aIs);
+        Index prevJaohI = prevBG._m_jaohIs[prevJtI];
+
+        vector<double> Ps_ba;
+        if(!eventObservability)
+        {
+            Ps_ba = vector<double>(nrS, 0.0);
+            BeliefIteratorGeneric it = prevJB->GetIterator();
+            do
+            {
+                Index sI = it.GetStateIndex();
+                double p = it.GetProbability();
+                for(Index sucSI=0; sucSI < nrS; sucSI++)
+                    Ps_ba[sucSI] += p * (T ? T->Get(sI, jaI, sucSI) :
+                        madp->GetTransitionProbability(sI, jaI, sucSI));
+            } while(it.Next());
+        }
+
+        vector<double> newJB(nrS);
+        vector<Index> indTypes(nrAgents);
+        for(Index joI=0; joI < nrJO; joI++)
+        {
+            JointBeliefInterface* jb = 0;
+            double condP = 0.0;
+            if(eventObservability)
+            {
+                jb = prevJB->Clone();
+                condP = jb->Update(*madp, jaI, joI);
+            }
+            else
+            {
+                for(Index sucSI=0; sucSI < nrS; sucSI++)
+                {
+                    newJB[sucSI] = (Ps_ba[sucSI] > 0) ? Ps_ba[sucSI] *
+                        madp->GetObservationProbability(jaI, sucSI, joI) : 0.0;
+                    condP += newJB[sucSI];
+                }
+                if(condP > 0)
+                {
+                    for(Index sucSI=0; sucSI < nrS; sucSI++)
+                        newJB[sucSI] /= condP;
+                    jb = prevJB->Clone();
+                    jb->Set(newJB);
+                }
+            }
+            if(condP <= 0)
+            {
+                delete jb;
+                continue;
+            }
+            if(!jb->SanityCheck())
+            {
+                delete jb;
+                throw(E("BayesianGameForDecPOMDPStage::InitializeFromPreviousBG() joint belief not valid"));
+            }
+
+            const vector<Index> oIs = 
+                _m_pu->JointToIndividualObservationIndices(joI);
+            for(Index agI=0; agI < nrAgents; agI++)
+                indTypes[agI] = prevIndTypes[agI] * nrO[agI] + oIs[agI];
+            Index jtI = IndexTools::IndividualToJointIndices(indTypes, 
+                                                             nrTypes);
+            Index jaohI = CastLIndexToIndex(
+                _m_pu->GetSuccessorJAOHI(prevJaohI, jaI, joI));
+
+            _m_JBs.at(jtI) = jb;
+            _m_jaohIs[jtI] = jaohI;
+            probs[jtI] = prevP * condP;
+            double* utilsThisJT = &utils[jtI * nrJA];
+            for(Index jaI2=0; jaI2 < nrJA; jaI2++)
+                utilsThisJT[jaI2] = _m_qHeuristic->GetQ(jaohI, jaI2);
+        }
+      } catch(...) {
+            error.Catch();
+      }
+    }
+    delete T;
+    error.Rethrow();
+
+    for(Index jtI = 0; jtI < nrJT; jtI++)
+    {
+        SetProbability(jtI, probs[jtI]);
+        for(Index jaI=0; jaI < nrJA; jaI++)
+            SetUtility(jtI, jaI, utils[jtI * nrJA + jaI]);
+    }
+}
+
+
+bool BayesianGameForDecPOMDPStage::ConstructConcurrently(size_t nrJT) const
+{
+#ifdef _OPENMP
+    if(nrJT < 2 || omp_get_max_threads() < 2 || omp_in_parallel())
+        return(false);
+    //the belief updates only read the model when the flat transition and
+    //observation models are available; probabilities that are computed on
+    //the fly (e.g., from a 2DBN) use scratch space that is not thread safe.
+    const MultiAgentDecisionProcessDiscreteInterface* madp = _m_pu->GetMADPDI();
+    TGet* T = madp->GetTGet();
+    OGet* O = madp->GetOGet();
+    bool flat = (T != 0 && O != 0);
+    delete T;
+    delete O;
+    return(flat);
+#else
+    return(false);
+#endif
+}
 
 void BayesianGameForDecPOMDPStage::
 ComputeAllImmediateRewards(const FactoredDecPOMDPDiscreteInterface *fd)
@@ -631,6 +861,20 @@ ComputeDiscountedImmediateRewardForJPol(const boost::shared_ptr<JointPolicyDiscr
 
 
 
+size_t BayesianGameForDecPOMDPStage::GetNrBytes() const
+{
+    size_t bytes=BayesianGameIdenticalPayoff::GetNrBytes() +
+        sizeof(*this) - sizeof(BayesianGameIdenticalPayoff);
+    for(Index jt=0; jt < _m_JBs.size(); jt++)
+        if(_m_JBs[jt])
+            bytes+=sizeof(JointBeliefInterface*) + 4*sizeof(void*) +
+                _m_JBs[jt]->Size()*sizeof(double);
+    for(Index jt=0; jt < _m_immR.size(); jt++)
+        bytes+=sizeof(vector<double>) + _m_immR[jt].capacity()*sizeof(double);
+    bytes+=_m_jaohIs.capacity()*sizeof(Index);
+    return(bytes);
+}
+
 string BayesianGameForDecPOMDPStage::SoftPrint() const
 {
     stringstream ss;
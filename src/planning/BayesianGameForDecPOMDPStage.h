@@ -52,6 +52,11 @@ class BayesianGameForDecPOMDPStage :
         bool _m_areCachedImmediateRewards;
         /// the cache for the immediate rewards: immR[jt][ja]
         std::vector< std::vector<double> > _m_immR;
+        /// The joint action-observation history index of each joint type.
+        /**Only maintained by Initialize() and InitializeFromPreviousBG(),
+         * which allows a BG for the next stage to be constructed from this
+         * one.*/
+        std::vector< Index > _m_jaohIs;
 
         ///Initialized the BG - called from constructor.
         /**\brief Given the past policy and q function, the
@@ -59,6 +64,29 @@ class BayesianGameForDecPOMDPStage :
          */
         void Initialize();
 
+        /**\brief Whether Initialize() may process the nrJT joint types
+         * concurrently.
+         *
+         * This is the case when compiled with OpenMP (configure
+         * --enable-openmp), more than one thread is available and the
+         * problem's flat transition and observation models are available
+         * (so the belief updates only read the model). The Q-heuristic's
+         * GetQ(jaohI, jaI) is called concurrently, so it should not modify
+         * the heuristic.
+         */
+        bool ConstructConcurrently(size_t nrJT) const;
+
+        ///Initializes the BG by extending the BG of the previous stage.
+        /**\brief Computes the probabilities, joint beliefs and utilities
+         * of the joint types by extending those of prevBG (the BG for stage
+         * ts-1 that was solved to obtain the past policy) by one joint
+         * action and joint observation, rather than recomputing them from
+         * stage 0 as Initialize() does. The cost therefore only depends on
+         * the size of this stage. The actions for stage ts-1 are taken from
+         * the past joint policy.
+         */
+        void InitializeFromPreviousBG(const BayesianGameForDecPOMDPStage& prevBG);
+
         /**\brief Extends a previous policy jpolPrevTs to the next stage.
          *
          * This function extends a previous policy jpolPrevTs for ts-1 with the 
@@ -144,6 +172,19 @@ class BayesianGameForDecPOMDPStage :
                 const boost::shared_ptr<const PartialJointPolicyDiscretePure> &pastJPol
         );
 
+        /// Constructor that creates and initializes a BG incrementally.
+        /**This constructor creates the BG for the next stage given the
+         * past policy, by extending the BG of the previous stage prevBG
+         * (see InitializeFromPreviousBG()). The result is the same as that
+         * of the from-scratch constructor, but only the last stage has to
+         * be computed. prevBG is not modified, so it can be shared by all
+         * extensions of its solutions.
+         */
+        BayesianGameForDecPOMDPStage(
+                const boost::shared_ptr<const BayesianGameForDecPOMDPStage> &prevBG,
+                const boost::shared_ptr<const PartialJointPolicyDiscretePure> &pastJPol
+        );
+
         // Constructor, destructor and copy assignment.
         /// Constructor that creates an empty BG.
         BayesianGameForDecPOMDPStage(
@@ -193,6 +234,10 @@ class BayesianGameForDecPOMDPStage :
         {return _m_pu;}
         const QFunctionJAOHInterface* GetQHeur() const
         {return _m_qHeuristic;}
+
+        /**Returns an estimate of the memory used by the BG in bytes,
+         * including the joint beliefs and cached immediate rewards.*/
+        size_t GetNrBytes() const;
        
         /** Prints a description of this  entire BayesianGameIdenticalPayoff 
          * to a string.*/
@@ -15,15 +15,21 @@
 
 #include "BayesianGameIdenticalPayoff.h"
 #include <fstream>
+#include <algorithm>
 #include "JointPolicyDiscretePure.h"
-#include "RewardModelMapping.h"
 #include "RewardModelMappingSparseMapped.h"
 
 using namespace std;
 
+/**The alignment (in bytes) of the dense utility table: a cache line.*/
+#define BGIP_UTILITY_ALIGNMENT 64
+
 //Default constructor
 BayesianGameIdenticalPayoff::BayesianGameIdenticalPayoff():
-    _m_utilFunction(0)
+    _m_utilFunction(0),
+    _m_utils(0),
+    _m_utilRowStride(0),
+    _m_utilRowsInUse(0)
 {
     _m_initialized=false;
 }
@@ -33,28 +39,30 @@ BayesianGameIdenticalPayoff::BayesianGameIdenticalPayoff(size_t nrAgents,
                                                          const vector<size_t>& nrTypes,
                                                          bool useSparseRewardModel) :
     BayesianGameIdenticalPayoffInterface(nrAgents, nrActions, nrTypes),
-    _m_utilFunction(0)
+    _m_utilFunction(0),
+    _m_utils(0),
+    _m_utilRowStride(0),
+    _m_utilRowsInUse(0)
 {
     _m_initialized=false;
 
     if(useSparseRewardModel)
         _m_utilFunction=new RewardModelMappingSparseMapped(_m_nrJTypes, _m_nrJA, "type", "ja");
     else
-        _m_utilFunction=new RewardModelMapping(_m_nrJTypes, _m_nrJA, "type", "ja");
+        AllocateDenseUtilities(_m_nrJTypes);
 }
 
-BayesianGameIdenticalPayoff::BayesianGameIdenticalPayoff(const BayesianGameIdenticalPayoff& o)
+BayesianGameIdenticalPayoff::BayesianGameIdenticalPayoff(const BayesianGameIdenticalPayoff& o) :
+    _m_utilFunction(0),
+    _m_utils(0),
+    _m_utilRowStride(0),
+    _m_utilRowsInUse(0)
 { *this=o; /* use assignment operator */}
 
 BayesianGameIdenticalPayoff::~BayesianGameIdenticalPayoff()
 {
-    if (_m_utilFunction != 0)
-    {
-        delete _m_utilFunction;
-        _m_utilFunction = 0;
-    }
-    else
-        cerr << "BayesianGameIdenticalPayoff::~BayesianGameIdenticalPayoff() trying to delete this BG twice!" << endl;
+    delete _m_utilFunction;
+    _m_utilFunction = 0;
 }
 
 BayesianGameIdenticalPayoff& BayesianGameIdenticalPayoff::operator= (const BayesianGameIdenticalPayoff& o)
@@ -63,10 +71,84 @@ BayesianGameIdenticalPayoff& BayesianGameIdenticalPayoff::operator= (const Bayes
 
     BayesianGameIdenticalPayoffInterface::operator=(o);
     _m_initialized=o._m_initialized;
-    _m_utilFunction=o._m_utilFunction->Clone();
+    delete _m_utilFunction;
+    _m_utilFunction=0;
+    if(o._m_utilFunction)
+    {
+        _m_utilFunction=o._m_utilFunction->Clone();
+        AllocateDenseUtilities(0);
+        _m_jtypeToRow.clear();
+    }
+    else
+    {
+        // the table has to be copied row by row, as its alignment within
+        // _m_utilStorage can differ
+        AllocateDenseUtilities(o._m_utilRowsInUse);
+        _m_jtypeToRow=o._m_jtypeToRow;
+        for(Index row=0; row < _m_utilRowsInUse; row++)
+            copy(o._m_utils + row * o._m_utilRowStride,
+                 o._m_utils + row * o._m_utilRowStride + _m_nrJA,
+                 _m_utils + row * _m_utilRowStride);
+    }
     return *this;
 }
 
+void BayesianGameIdenticalPayoff::AllocateDenseUtilities(size_t nrRows)
+{
+    const size_t doublesPerLine=BGIP_UTILITY_ALIGNMENT / sizeof(double);
+    // rows are padded to whole cache lines only when the padding is small
+    // (e.g., not 9 -> 16), otherwise it would cost more memory bandwidth
+    // than the alignment gains
+    size_t padded=((_m_nrJA + doublesPerLine - 1) / doublesPerLine) *
+        doublesPerLine;
+    _m_utilRowStride=(padded - _m_nrJA) * 8 <= _m_nrJA ? padded : _m_nrJA;
+    _m_utilRowsInUse=nrRows;
+
+    vector<double> storage(nrRows * _m_utilRowStride + doublesPerLine, 0.0);
+    _m_utilStorage.swap(storage);
+    size_t misalignment=reinterpret_cast<size_t>(&_m_utilStorage[0]) %
+        BGIP_UTILITY_ALIGNMENT;
+    _m_utils=&_m_utilStorage[0];
+    if(misalignment > 0)
+        _m_utils+=(BGIP_UTILITY_ALIGNMENT - misalignment) / sizeof(double);
+}
+
+void BayesianGameIdenticalPayoff::RemapUtilitiesToPositiveProbabilityTypes()
+{
+    if(!HasDenseUtilities())
+        throw(E("BayesianGameIdenticalPayoff::RemapUtilitiesToPositiveProbabilityTypes requires a dense utility table"));
+
+    // the joint types with zero probability get the last row, of zeros
+    vector<Index> jtypeToRow(_m_nrJTypes, INDEX_MAX);
+    size_t nrRows=0;
+    for(Index jtI=0; jtI < _m_nrJTypes; jtI++)
+        if(GetProbability(jtI) > 0)
+            jtypeToRow[jtI]=nrRows++;
+    for(Index jtI=0; jtI < _m_nrJTypes; jtI++)
+        if(jtypeToRow[jtI]==INDEX_MAX)
+            jtypeToRow[jtI]=nrRows;
+
+    // keep the old table alive while copying (swapping keeps _m_utils valid)
+    vector<double> oldStorage;
+    oldStorage.swap(_m_utilStorage);
+    const double *oldUtils=_m_utils;
+    size_t oldStride=_m_utilRowStride;
+    vector<Index> oldJtypeToRow;
+    oldJtypeToRow.swap(_m_jtypeToRow);
+
+    AllocateDenseUtilities(nrRows+1);
+    for(Index jtI=0; jtI < _m_nrJTypes; jtI++)
+    {
+        if(jtypeToRow[jtI]==nrRows)
+            continue;
+        Index oldRowI=oldJtypeToRow.empty() ? jtI : oldJtypeToRow[jtI];
+        const double *oldRow=oldUtils + oldRowI * oldStride;
+        copy(oldRow, oldRow + _m_nrJA,
+             _m_utils + jtypeToRow[jtI] * _m_utilRowStride);
+    }
+    _m_jtypeToRow.swap(jtypeToRow);
+}
+
 bool BayesianGameIdenticalPayoff::SetInitialized(bool b)
 {
     _m_initialized = b;
@@ -86,6 +168,19 @@ double BayesianGameIdenticalPayoff::ComputeValueJPol(const JointPolicyDiscretePu
     return(v);
 
 }
+
+size_t BayesianGameIdenticalPayoff::GetNrBytes() const
+{
+    //the probabilities, the individual type indices of the joint types
+    //and the dense utility table
+    size_t bytes=sizeof(*this) +
+        GetNrJointTypes()*(sizeof(double) + sizeof(vector<Index>) +
+                           GetNrAgents()*sizeof(Index));
+    bytes+=_m_utilStorage.capacity()*sizeof(double) +
+        _m_jtypeToRow.capacity()*sizeof(Index);
+    return(bytes);
+}
+
 string BayesianGameIdenticalPayoff::SoftPrintUtilForJointType(Index jtype) const
 {
     stringstream ss;
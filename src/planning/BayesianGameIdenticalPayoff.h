@@ -57,9 +57,38 @@ class BayesianGameIdenticalPayoff :
         bool _m_initialized;
 
         /**Util function - in identical payoff case we need only 1 util function
-         * We use RewardModelMapping substituting joint type indices for state
-         * indices. */
+         * We use RewardModelMappingSparseMapped substituting joint type
+         * indices for state indices. Only used for BGs with a sparse utility
+         * function, otherwise 0 and the dense table below is used. */
         RewardModelDiscreteInterface *_m_utilFunction;
+
+        /**The dense utility table: a contiguous jtype-major array, the row
+         * of a joint type holds the utilities of all joint actions. Rows
+         * start at _m_utils + row * _m_utilRowStride, where the stride is
+         * padded to a multiple of a cache line when that adds at most
+         * 1/8th to a row, and _m_utils is aligned to a cache line within
+         * _m_utilStorage.*/
+        std::vector<double> _m_utilStorage;
+        double *_m_utils;
+        size_t _m_utilRowStride;
+        /**The row in the dense table of each joint type. Empty if there is
+         * a row for every joint type (and the row index is the jtype
+         * index). Otherwise the joint types with zero probability share
+         * the last row, which holds zeros. See
+         * RemapUtilitiesToPositiveProbabilityTypes().*/
+        std::vector<Index> _m_jtypeToRow;
+        /// The number of rows of the dense table.
+        size_t _m_utilRowsInUse;
+
+        /**Allocates a zero-initialized dense utility table for nrRows joint
+         * types.*/
+        void AllocateDenseUtilities(size_t nrRows);
+        /**Returns the row of jtype in the dense table for writing. The
+         * shared row of zeros (see _m_jtypeToRow) should not be written.*/
+        double* GetWritableUtilityRow(const Index jtype)
+        {
+            return(const_cast<double*>(GetUtilityRow(jtype)));
+        }
             
     protected:
     
@@ -91,7 +120,12 @@ class BayesianGameIdenticalPayoff :
             if(!std::isfinite(u))
                 throw(E("BayesianGameIdenticalPayoff trying to set nan or inf utility"));
 #endif
-            _m_utilFunction->Set(jtype,ja,u);
+            if(_m_utilFunction)
+                _m_utilFunction->Set(jtype,ja,u);
+            else if(_m_jtypeToRow.empty())
+                GetWritableUtilityRow(jtype)[ja]=u;
+            else if(_m_jtypeToRow[jtype]+1 < _m_utilRowsInUse)
+                GetWritableUtilityRow(jtype)[ja]=u;
         }
         /**Sets the utility for (for all agents) joint type corresponding to 
          * the individual type indices (indTypeIndices) and joint action
@@ -103,28 +137,77 @@ class BayesianGameIdenticalPayoff :
             if(!std::isfinite(u))
                 throw(E("BayesianGameIdenticalPayoff trying to set nan or inf utility"));
 #endif
-            _m_utilFunction->Set(
-                IndividualToJointTypeIndices(indTypeIndices),
-                IndividualToJointActionIndices(indActionIndices),
-                u);
+            SetUtility(IndividualToJointTypeIndices(indTypeIndices),
+                       IndividualToJointActionIndices(indActionIndices),
+                       u);
         }
+
+        /**\brief Only keeps the utilities of the joint types with a
+         * positive probability.
+         *
+         * Shrinks the dense utility table to the joint types that currently
+         * have a positive probability, which are remapped to consecutive
+         * rows. Afterwards, the utility of the other joint types is 0 and
+         * setting it has no effect. This should therefore only be called
+         * once the probabilities are final.*/
+        void RemapUtilitiesToPositiveProbabilityTypes();
         
         //get (data) functions:
         /**Gets the utility for (for all agents) jtype, ja.*/
         double GetUtility(const Index jtype, const Index ja) const
-            {return(_m_utilFunction->Get(jtype,ja));}
+        {
+            if(_m_utilFunction)
+                return(_m_utilFunction->Get(jtype,ja));
+            return(GetUtilityDense(jtype,ja));
+        }
         /**Gets the utility for (for all agents) joint type corresponding to 
          * the individual type indices (indTypeIndices) and joint action
          * corresponding to individual action indices (indActionIndices).*/
         double GetUtility(const std::vector<Index>& indTypeIndices, 
                 const std::vector<Index>& indActionIndices ) const
-        {return(_m_utilFunction->Get(
+        {return(GetUtility(
                 IndividualToJointTypeIndices(indTypeIndices),
                 IndividualToJointActionIndices(indActionIndices) ));}
+
+        /**Returns whether the utilities are stored in the dense table, in
+         * which case GetUtilityDense() and GetUtilityRow() can be used.*/
+        bool HasDenseUtilities() const
+            {return(_m_utilFunction==0);}
+        /**Returns the utilities of jtype (indexed by joint action) in the
+         * dense table. Requires HasDenseUtilities(). After
+         * RemapUtilitiesToPositiveProbabilityTypes(), the joint types with
+         * zero probability share a row of zeros.*/
+        const double* GetUtilityRow(const Index jtype) const
+        {
+            Index row=_m_jtypeToRow.empty() ? jtype : _m_jtypeToRow[jtype];
+            return(_m_utils + row * _m_utilRowStride);
+        }
+        /**Gets the utility for jtype, ja from the dense table. Unlike
+         * GetUtility() this is not virtual, so solvers can use it in their
+         * inner loops (see GetDenseBG()). Requires HasDenseUtilities().*/
+        double GetUtilityDense(const Index jtype, const Index ja) const
+            {return(GetUtilityRow(jtype)[ja]);}
+        /**Returns the number of rows of the dense table.*/
+        size_t GetNrUtilityRows() const
+            {return(_m_utilRowsInUse);}
+
+        /**Returns bgip as a BayesianGameIdenticalPayoff if it stores its
+         * utilities in the dense table, or 0 otherwise.*/
+        static const BayesianGameIdenticalPayoff* 
+        GetDenseBG(const BayesianGameIdenticalPayoffInterface *bgip)
+        {
+            const BayesianGameIdenticalPayoff *bg=
+                dynamic_cast<const BayesianGameIdenticalPayoff*>(bgip);
+            return((bg && bg->HasDenseUtilities()) ? bg : 0);
+        }
         
         /**\brief evaluates the value of a joint policy.*/
         virtual double ComputeValueJPol(const JointPolicyDiscretePure & jpolBG) const;
 
+        /**Returns an estimate of the memory used by the BG in bytes. A
+         * sparse utility function is not counted.*/
+        size_t GetNrBytes() const;
+
         /** Prints a description of this  entire BayesianGameIdenticalPayoff 
          * to a string.*/
         std::string SoftPrint() const; 
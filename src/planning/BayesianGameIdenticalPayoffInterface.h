@@ -70,6 +70,10 @@ class BayesianGameIdenticalPayoffInterface
                 v += GetProbability(jtI) * GetUtility(jtI, jpolBG.GetJointActionIndex(jtI));
             return v;
         }
+        /**Returns an estimate of the memory used by the BG in bytes, or 0
+         * if it is not known.*/
+        virtual size_t GetNrBytes() const { return(0); }
+
         /** Prints a description of this  entire BayesianGameIdenticalPayoff 
          * to a string.*/
         virtual std::string SoftPrint() const = 0; 
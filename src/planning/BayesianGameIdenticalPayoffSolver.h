@@ -81,6 +81,12 @@ public:
     /// To limit the amount of time the solver uses.
     virtual void SetDeadline(double deadlineInSeconds) { _m_deadlineInSeconds=deadlineInSeconds; }
 
+    /**Returns an estimate of the memory (in bytes) used by the solver,
+     * not counting the BG it solves (see GetBGIPI()). Solvers that keep
+     * a search state between calls (incremental solvers) count it.*/
+    virtual size_t GetNrBytes() const
+        { return(sizeof(BayesianGameIdenticalPayoffSolver)); }
+
     const boost::shared_ptr<JointPolicy> GetJointPolicy() const 
         { return(_m_solution.GetJointPolicy()); }
     const JointPolicyPureVector& GetJointPolicyPureVector() const 
@@ -14,6 +14,7 @@
  */
 
 #include <list>
+#include <map>
 
 #include "BayesianGameWithClusterInfo.h"
 #include "BeliefIteratorGeneric.h"
@@ -31,12 +32,18 @@
 #include "Type_PointerTuple.h"
 #include "QHybrid.h"
 #include "boost/enable_shared_from_this.hpp"
+#include "boost/functional/hash.hpp"
 
 using namespace std;
 
 #define BGCLUSTER_OUTPUT_CLUSTERSTATS 0
 #define BGCLUSTER_OUTPUT_TESTEQUIVALENCE 0
 #define BGCLUSTER_REMOVE_ZEROPROB_TYPES 1
+/// The grid size used for the type signatures of lossless clustering.
+/**It is coarser than PROB_PRECISION, such that probabilities that are
+ * considered equal almost never end up on different sides of a grid
+ * boundary. */
+#define BGCLUSTER_SIGNATURE_PRECISION 1e-9
 
 //Default constructor
 BayesianGameWithClusterInfo::BayesianGameWithClusterInfo(                
@@ -552,6 +559,7 @@ bool BayesianGameWithClusterInfo::TestExactEquivalence(Index agI, Index t1, Inde
     double p1, p2;
     p1 = p2 = 0.0;    
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     bool finished = false;
     bool equalProb=true;
 
@@ -567,13 +575,14 @@ bool BayesianGameWithClusterInfo::TestExactEquivalence(Index agI, Index t1, Inde
             p1 += GetProbability(jtI1);
             p2 += GetProbability(jtI2);
         }        
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
 
 
 
     //now we compare P(type{-i} | t1) =? P(type{-i} | t2)
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     finished = false;
     while( !finished && equalProb )
     {
@@ -604,7 +613,7 @@ bool BayesianGameWithClusterInfo::TestExactEquivalence(Index agI, Index t1, Inde
                 equalProb=false;
             }
         }        
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
 
 #if !BGCLUSTER_OUTPUT_TESTEQUIVALENCE
@@ -617,6 +626,7 @@ bool BayesianGameWithClusterInfo::TestExactEquivalence(Index agI, Index t1, Inde
     //now we compare P(s, type{-i} | t1) =? P(s, type{-i} | t2)
     //or, actually we check that P(s |  type{-i}, t1) =? P(s | type{-i} , t2) 
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     finished = false;
     bool equalJB=true;
     while( !finished && equalJB )
@@ -663,7 +673,7 @@ bool BayesianGameWithClusterInfo::TestExactEquivalence(Index agI, Index t1, Inde
                 while(equalJB && bit1.Next() && bit2.Next());
             }
         }        
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
 
 #if BGCLUSTER_OUTPUT_TESTEQUIVALENCE
@@ -699,6 +709,7 @@ bool BayesianGameWithClusterInfo::TestApproximateEquivalence(Index agI, Index t1
     double p1, p2;
     p1 = p2 = 0.0;    
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     bool finished = false;
 
     while( !finished )
@@ -713,7 +724,7 @@ bool BayesianGameWithClusterInfo::TestApproximateEquivalence(Index agI, Index t1
             p1 += GetProbability(jtI1);
             p2 += GetProbability(jtI2);
         }        
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
 
     ///TODO: check if both p1, p2 > 0
@@ -721,6 +732,7 @@ bool BayesianGameWithClusterInfo::TestApproximateEquivalence(Index agI, Index t1
 
     //now we compare P(type{-i} | t1) =? P(type{-i} | t2)
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     finished = false;
     bool equalProb=true;
     while( !finished && equalProb )
@@ -741,7 +753,7 @@ bool BayesianGameWithClusterInfo::TestApproximateEquivalence(Index agI, Index t1
                 equalProb=false;
             }
         }        
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
 
 #if !BGCLUSTER_OUTPUT_TESTEQUIVALENCE
@@ -754,6 +766,7 @@ bool BayesianGameWithClusterInfo::TestApproximateEquivalence(Index agI, Index t1
     //now we compare P(s, type{-i} | t1) =? P(s, type{-i} | t2)
     //or, actually we check that P(s |  type{-i}, t1) =? P(s | type{-i} , t2) 
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     finished = false;
     bool equalJB=true;
     while( !finished && equalJB )
@@ -787,7 +800,7 @@ bool BayesianGameWithClusterInfo::TestApproximateEquivalence(Index agI, Index t1
                 while(equalJB && bit1.Next() && bit2.Next());
             }
         }
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
 
 #if BGCLUSTER_OUTPUT_TESTEQUIVALENCE
@@ -813,29 +826,53 @@ size_t BayesianGameWithClusterInfo::ConstructClusteredIndividualTypes(
         )
 {
     size_t nrNewTypes = 0;
-    //initialize the set of individual types of this agent
-    //(with all types in it), we will incrementally remove
-    //clusterable types
-    list<Index> tIs;
-    for(Index tI=0; tI < GetNrTypes(agI); tI++)
-        tIs.push_back(tI);
-    
-
-    list<Index>::iterator it1, it2;
-    it1 = tIs.begin();
-    //Index loopIndex = 0;
-    while(it1 != tIs.end())
+    size_t nrTypes = GetNrTypes(agI);
+
+    //only types with the same signature can be losslessly equivalent,
+    //so for lossless clustering we bucket the types by signature and
+    //only compare types within a bucket. Approximately equivalent types
+    //can end up in neighbouring cells of any grid, so the approximate
+    //algorithms put all types in one bucket and compare all pairs.
+    vector<size_t> signatures;
+    vector<double> margProbs;
+    switch(_m_clusterAlgorithm)
     {
-        // *it1 will become a type(cluster) in the clustered BG.
+    case Lossless:
+        ComputeTypeSignatures(agI, BGCLUSTER_SIGNATURE_PRECISION,
+                              BGCLUSTER_SIGNATURE_PRECISION,
+                              signatures, margProbs);
+        break;
+    case ApproxJB:
+    case ApproxPjaoh:
+    case ApproxPjaohJB:
+        signatures = vector<size_t>(nrTypes, 0);
+        for(Index tI=0; tI < nrTypes; tI++)
+            margProbs.push_back(ComputeMarginalTypeProbability(agI, tI));
+        break;
+    default:
+        throw(E("BayesianGameWithClusterInfo::ConstructClusteredIndividualTypes clustering algorithm not handled"));
+    }
+
+    //each bucket lists its unclustered types in increasing order
+    map<size_t, list<Index> > buckets;
+    for(Index tI=0; tI < nrTypes; tI++)
+        buckets[signatures[tI]].push_back(tI);
+    vector<bool> clustered(nrTypes, false);
 
-        Index t1 = *it1;
+    list<Index>::iterator it2;
+    for(Index t1=0; t1 < nrTypes; t1++)
+    {
+        if(clustered[t1])
+            continue;
+        // t1 will become a type(cluster) in the clustered BG, it is the
+        // first remaining type in its bucket
+        list<Index>& candidates = buckets[signatures[t1]];
+        candidates.pop_front();
         
         ///check if this type has (marginal) prob. > 0
-        double margProb = ComputeMarginalTypeProbability(agI,t1);
 #if BGCLUSTER_REMOVE_ZEROPROB_TYPES
-        if( Globals::EqualProbability(margProb, 0.0) )
+        if( Globals::EqualProbability(margProbs[t1], 0.0) )
         {
-            it1++;
 #if BGCLUSTER_OUTPUT_TESTEQUIVALENCE
             cout << "TESTEQUIVALENCE " << GetStage() << " zeroProb" << endl;
 #endif
@@ -848,17 +885,14 @@ size_t BayesianGameWithClusterInfo::ConstructClusteredIndividualTypes(
 
         newTypeList->push_back(tc1);
         nrNewTypes++;
-        it2 = it1;
-        it2++;
-        while(it2 != tIs.end())             
+        it2 = candidates.begin();
+        while(it2 != candidates.end())             
         {
-            //compare the types pointed to by it1 and it2
+            //compare the types t1 and t2
             Index t2 = *it2;
             ///check if this type has (marginal) prob. > 0
-            double margProb2 = ComputeMarginalTypeProbability(agI,t2);
 #if BGCLUSTER_REMOVE_ZEROPROB_TYPES
-
-            if( Globals::EqualProbability(margProb2, 0.0) )
+            if( Globals::EqualProbability(margProbs[t2], 0.0) )
             {
                 it2++;
 #if BGCLUSTER_OUTPUT_TESTEQUIVALENCE
@@ -892,28 +926,96 @@ size_t BayesianGameWithClusterInfo::ConstructClusteredIndividualTypes(
             if( equivalent )
             {
                 //cluster stuff
-                //cout << "About to cluster types " <<t1 <<"," <<t2<<
-                    //" of agent "<<agI<<"!"<< endl;
                 TypeCluster* tc2 = this->_m_typeLists.at(agI)->at(t2);
                 tc1->Merge(tc2);
                 tc2->clear();
                 ShiftProbabilityAndUtility(agI, t1, t2);
-                //remove Index from type list
-                it2 = tIs.erase(it2);
+                //remove Index from its bucket
+                clustered[t2] = true;
+                it2 = candidates.erase(it2);
             }
             else
             {
-                //if we performed it2 = tIs.erase(it2);, then it2 is already
-                //advanced.
+                //if we performed it2 = candidates.erase(it2);, then it2
+                //is already advanced.
                 it2++;
             }
         }
-        it1++;
-        //loopIndex++;
     }
     return nrNewTypes;
 } // now we should have constructed all the individual sets of types
 
+void BayesianGameWithClusterInfo::ComputeTypeSignatures(
+    Index agI, double gridPjaoh, double gridJB,
+    vector<size_t>& signatures, vector<double>& margProbs) const
+{
+    size_t nrTypes = GetNrTypes(agI);
+    signatures = vector<size_t>(nrTypes, 0);
+    margProbs = vector<double>(nrTypes, 0.0);
+
+    vector<Index> typeIndices(GetNrAgents(), 0 );
+    bool finished = false;
+    while( !finished )
+    {
+        Index jtI = IndividualToJointTypeIndices(typeIndices);
+        margProbs[typeIndices[agI]] += GetProbability(jtI);
+        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+    }
+
+    //the joint types with type t for agI are visited in the same order
+    //of type{-i} for every t, so the signatures are comparable
+    typeIndices = vector<Index>(GetNrAgents(), 0 );
+    finished = false;
+    while( !finished )
+    {
+        Index t = typeIndices[agI];
+        Index jtI = IndividualToJointTypeIndices(typeIndices);
+        if(margProbs[t] > 0)
+        {
+            size_t& seed = signatures[t];
+            double pjt = GetProbability(jtI);
+            long qP = static_cast<long>(floor(pjt / margProbs[t] /
+                                              gridPjaoh + 0.5));
+            boost::hash_combine(seed, qP);
+            JointBeliefInterface* jb = _m_JBs.at(jtI);
+            // the joint belief is only compared when the joint type can
+            // actually occur
+            if(qP != 0 && jb != 0)
+            {
+                BeliefIteratorGeneric bit = jb->GetIterator();
+                do
+                {
+                    long qB = static_cast<long>(
+                        floor(bit.GetProbability() / gridJB + 0.5));
+                    if(qB != 0)
+                    {
+                        boost::hash_combine(seed, bit.GetStateIndex());
+                        boost::hash_combine(seed, qB);
+                    }
+                }
+                while(bit.Next());
+            }
+        }
+        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+    }
+}
+
+bool BayesianGameWithClusterInfo::IncrementOtherTypes(
+    Index agI, vector<Index>& typeIndices) const
+{
+    //same order as IndexTools::Increment: the last agent changes fastest
+    for(Index i = GetNrAgents(); i-- > 0; )
+    {
+        if(i == agI)
+            continue;
+        typeIndices[i]++;
+        if(typeIndices[i] < _m_nrTypes[i])
+            return(false);
+        typeIndices[i] = 0;
+    }
+    return(true);
+}
+
 void BayesianGameWithClusterInfo::ShiftProbabilityAndUtility(Index agI, Index t1, Index t2)
 {
     
@@ -926,6 +1028,7 @@ void BayesianGameWithClusterInfo::ShiftProbabilityAndUtility(Index agI, Index t1
     double p1, p2 = 0.0;
     double u1, u2 = 0;
     typeIndices = vector<Index>(GetNrAgents(), 0 );
+    typeIndices.at(agI) = t1;
     bool finished = false;
     while( !finished )
     {
@@ -959,7 +1062,7 @@ void BayesianGameWithClusterInfo::ShiftProbabilityAndUtility(Index agI, Index t1
             }
         }        
         finished = 
-            IndexTools::Increment(typeIndices, _m_nrTypes);
+            IncrementOtherTypes(agI, typeIndices);
     }
 }
 
@@ -1083,16 +1186,13 @@ ComputeMarginalTypeProbability(Index agI, Index typeI) const
     double p1;
     p1 =  0.0;    
     vector<Index> typeIndices (GetNrAgents(), 0 );
+    typeIndices.at(agI) = typeI;
     bool finished = false;
     while( !finished )
     {
-        //only if agent agI's component is t1 we do stuff
-        if(typeIndices.at(agI) == typeI)
-        {
-            Index jtI1 = IndividualToJointTypeIndices( typeIndices);
-            p1 += GetProbability(jtI1);
-        }        
-        finished = IndexTools::Increment(typeIndices, _m_nrTypes);
+        Index jtI1 = IndividualToJointTypeIndices( typeIndices);
+        p1 += GetProbability(jtI1);
+        finished = IncrementOtherTypes(agI, typeIndices);
     }
     return p1;
 }
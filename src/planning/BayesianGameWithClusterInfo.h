@@ -113,6 +113,28 @@ public:
          */
         size_t ConstructClusteredIndividualTypes(Index agI, 
             TypeClusterList* newTypeList);
+        /**\brief Computes a signature hash for each type of agI.
+         *
+         * The signature of type t is the conditional distribution over the
+         * types of the other agents P(type{-i} | t) together with the
+         * joint beliefs P(s | type{-i}, t), quantised to a grid of size
+         * gridPjaoh resp. gridJB. Types that are equal up to
+         * floating point round-off have the same hash (unless a value
+         * lies within round-off of a cell boundary), so for lossless
+         * clustering only types with the same hash need to be compared
+         * with TestExactEquivalence(). Approximately equivalent types
+         * can have different hashes, so the approximate algorithms do not
+         * use them. Also returns the marginal probability of each
+         * type. Takes one pass over the joint types.
+         */
+        void ComputeTypeSignatures(Index agI, double gridPjaoh, double gridJB,
+                                   std::vector<size_t>& signatures,
+                                   std::vector<double>& margProbs) const;
+        /**\brief Increments the types of all agents but agI in
+         * typeIndices, returns true if all combinations have been
+         * visited.*/
+        bool IncrementOtherTypes(Index agI, 
+                                 std::vector<Index>& typeIndices) const;
         
     public:
         // Constructor, destructor and copy assignment.
@@ -0,0 +1,90 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Philipp Robbel 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+
+#include <algorithm>
+#include "ExperienceReplayBuffer.h"
+
+using namespace std;
+
+ExperienceReplayBuffer::ExperienceReplayBuffer(size_t capacity,
+                                               bool prioritized) :
+    _m_capacity(capacity),
+    _m_prioritized(prioritized),
+    _m_size(0),
+    _m_next(0),
+    _m_sI(capacity),
+    _m_jaI(capacity),
+    _m_r(capacity),
+    _m_sucI(capacity),
+    _m_firstLeaf(1),
+    _m_maxPriority(1.0)
+{
+    if(_m_prioritized)
+    {
+        while(_m_firstLeaf < capacity)
+            _m_firstLeaf*=2;
+        _m_sumTree.assign(2*_m_firstLeaf,0.0);
+    }
+}
+
+void ExperienceReplayBuffer::Add(Index sI, Index jaI, double r, Index sucI)
+{
+    if(_m_capacity==0)
+        throw(E("ExperienceReplayBuffer::Add: capacity is 0"));
+
+    _m_sI[_m_next]=sI;
+    _m_jaI[_m_next]=jaI;
+    _m_r[_m_next]=r;
+    _m_sucI[_m_next]=sucI;
+    if(_m_prioritized)
+        SetPriority(_m_next,_m_maxPriority);
+
+    _m_next=(_m_next+1)%_m_capacity;
+    _m_size=min(_m_size+1,_m_capacity);
+}
+
+Index ExperienceReplayBuffer::Sample(double u) const
+{
+    if(!_m_prioritized)
+        return(min(static_cast<size_t>(u*_m_size),_m_size-1));
+
+    // descend the sum tree towards the leaf that covers u*total
+    double x=u*_m_sumTree[1];
+    size_t node=1;
+    while(node < _m_firstLeaf)
+    {
+        size_t left=2*node;
+        if(x < _m_sumTree[left] || _m_sumTree[left+1]<=0)
+            node=left;
+        else
+        {
+            x-=_m_sumTree[left];
+            node=left+1;
+        }
+    }
+    return(min(node-_m_firstLeaf,_m_size-1));
+}
+
+void ExperienceReplayBuffer::SetPriority(Index k, double priority)
+{
+    if(!_m_prioritized)
+        return;
+
+    _m_maxPriority=max(_m_maxPriority,priority);
+    size_t node=_m_firstLeaf+k;
+    double delta=priority-_m_sumTree[node];
+    for(;node>=1;node/=2)
+        _m_sumTree[node]+=delta;
+}
@@ -0,0 +1,94 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Philipp Robbel 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+
+/* Only include this header file once. */
+#ifndef _EXPERIENCEREPLAYBUFFER_H_
+#define _EXPERIENCEREPLAYBUFFER_H_ 1
+
+/* the include directives */
+#include <vector>
+#include "Globals.h"
+
+/**\brief ExperienceReplayBuffer stores the last transitions (s,ja,r,s')
+ * of a learner, from which it samples minibatches.
+ *
+ * The buffer has a fixed capacity: once full, each new transition
+ * overwrites the oldest (a ring buffer). The transitions are stored as
+ * one array per field.
+ *
+ * Transitions are sampled uniformly, or, when prioritized, proportional
+ * to their priority, using a sum tree over the priorities so that both
+ * sampling and updating a priority take O(log capacity) time. New
+ * transitions get the largest priority seen so far, so each is likely to
+ * be replayed at least once.
+ */
+class ExperienceReplayBuffer
+{
+private:
+
+    size_t _m_capacity;
+    bool _m_prioritized;
+
+    /// the number of stored transitions
+    size_t _m_size;
+    /// where the next transition is stored
+    Index _m_next;
+
+    std::vector<Index> _m_sI;
+    std::vector<Index> _m_jaI;
+    std::vector<double> _m_r;
+    std::vector<Index> _m_sucI;
+
+    /// the first leaf of the sum tree (a power of 2)
+    size_t _m_firstLeaf;
+    /// _m_sumTree[i] is the sum of the priorities below node i, and the
+    /// leaf _m_firstLeaf+k holds the priority of transition k
+    std::vector<double> _m_sumTree;
+    double _m_maxPriority;
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /// (default) Constructor
+    ExperienceReplayBuffer(size_t capacity=0, bool prioritized=false);
+
+    size_t GetCapacity() const { return(_m_capacity); }
+    size_t GetSize() const { return(_m_size); }
+    bool IsPrioritized() const { return(_m_prioritized); }
+
+    /// Adds a transition, overwriting the oldest if the buffer is full.
+    void Add(Index sI, Index jaI, double r, Index sucI);
+
+    /// Returns the index of a stored transition, sampled given u
+    /// uniformly drawn from [0,1).
+    Index Sample(double u) const;
+
+    /// Sets the priority of transition k (only used when prioritized).
+    void SetPriority(Index k, double priority);
+
+    Index GetState(Index k) const { return(_m_sI[k]); }
+    Index GetJointAction(Index k) const { return(_m_jaI[k]); }
+    double GetReward(Index k) const { return(_m_r[k]); }
+    Index GetSuccessorState(Index k) const { return(_m_sucI[k]); }
+
+};
+
+
+#endif /* !_EXPERIENCEREPLAYBUFFER_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
@@ -0,0 +1,549 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "FactoredMMDPDecoupledValueIteration.h"
+#include <float.h>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include "FactoredDecPOMDPDiscreteInterface.h"
+#include "TwoStageDynamicBayesianNetwork.h"
+#include "IndexTools.h"
+#include "FG_SolverMaxPlus.h"
+#include "FG_SolverNDP.h"
+#include "factorgraph.h"
+#include "EParallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+#define DEBUG_FactoredMMDPDecoupledValueIteration 0
+
+FactoredMMDPDecoupledValueIteration::FactoredMMDPDecoupledValueIteration(
+    const FactoredDecPOMDPDiscreteInterface* fmmdp) :
+    _m_fmmdp(fmmdp),
+    _m_tolerance(1e-4),
+    _m_FGSt(FG_Solver::FGSt_MaxPlus),
+    _m_nrSamples(1000),
+    _m_maxNrIterations(1000),
+    _m_nrIterations(0),
+    _m_planned(false)
+{
+    AddLocalQs(_m_fmmdp->GetImmediateRewardScopes());
+}
+
+FactoredMMDPDecoupledValueIteration::FactoredMMDPDecoupledValueIteration(
+    const FactoredDecPOMDPDiscreteInterface* fmmdp,
+    const FactoredQFunctionScopeForStage &scopes) :
+    _m_fmmdp(fmmdp),
+    _m_tolerance(1e-4),
+    _m_FGSt(FG_Solver::FGSt_MaxPlus),
+    _m_nrSamples(1000),
+    _m_maxNrIterations(1000),
+    _m_nrIterations(0),
+    _m_planned(false)
+{
+    AddLocalQs(scopes);
+}
+
+FactoredMMDPDecoupledValueIteration::~FactoredMMDPDecoupledValueIteration()
+{
+}
+
+void FactoredMMDPDecoupledValueIteration::AddLocalQs(
+    const FactoredQFunctionScopeForStage &scopes)
+{
+    _m_localQs.resize(scopes.GetNrLQFs());
+    for(Index k = 0; k < _m_localQs.size(); k++)
+    {
+        LocalQ &lq=_m_localQs[k];
+        lq.sfScope=scopes.GetStateFactorScope(k);
+        lq.sfScope.Sort();
+        lq.agScope=scopes.GetAgentScope(k);
+        lq.agScope.Sort();
+
+        lq.nrX=1;
+        for(Index i = 0; i < lq.sfScope.size(); i++)
+        {
+            size_t nrVals=_m_fmmdp->GetNrValuesForFactor(lq.sfScope[i]);
+            lq.nrSFVals.push_back(nrVals);
+            lq.nrX*=nrVals;
+        }
+        lq.nrA=1;
+        for(Index i = 0; i < lq.agScope.size(); i++)
+        {
+            size_t nrVals=_m_fmmdp->GetNrActions(lq.agScope[i]);
+            lq.nrActionVals.push_back(nrVals);
+            lq.nrA*=nrVals;
+        }
+    }
+    AssignLRFs();
+}
+
+void FactoredMMDPDecoupledValueIteration::AssignLRFs()
+{
+    for(Index e = 0; e < _m_fmmdp->GetNrLRFs(); e++)
+    {
+        const Scope &sfSC=_m_fmmdp->GetStateFactorScopeForLRF(e);
+        const Scope &agSC=_m_fmmdp->GetAgentScopeForLRF(e);
+        bool assigned=false;
+        for(Index k = 0; k < _m_localQs.size() && !assigned; k++)
+            if(sfSC.IsSubSetOf(_m_localQs[k].sfScope) &&
+               agSC.IsSubSetOf(_m_localQs[k].agScope))
+            {
+                _m_localQs[k].LRFs.push_back(e);
+                assigned=true;
+            }
+        if(!assigned)
+        {
+            stringstream ss;
+            ss << "FactoredMMDPDecoupledValueIteration: the scopes of LRF " << e
+               << " (" << sfSC << ", " << agSC
+               << ") are not contained in any local Q-function";
+            throw(E(ss));
+        }
+    }
+}
+
+void FactoredMMDPDecoupledValueIteration::ComputeLocalModel(LocalQ &lq) const
+{
+    const TwoStageDynamicBayesianNetwork *dbn=_m_fmmdp->Get2DBN();
+    const Scope &X=lq.sfScope;
+    const Scope &A=lq.agScope;
+
+    // Z are the next-stage factors that X depends on within the stage
+    Scope Y=X;
+    for(Index i = 0; i < Y.size(); i++)
+    {
+        const Scope &YSoI=dbn->GetYSoI_Y(Y[i]);
+        for(Index j = 0; j < YSoI.size(); j++)
+            if(!Y.Contains(YSoI[j]))
+                Y.Insert(YSoI[j]);
+    }
+    Scope Z=Y;
+    Z.Remove(X);
+
+    // U and W are the parents of Y outside of the scopes of lq
+    Scope U=_m_fmmdp->StateScopeBackup(X,Scope());
+    U.Remove(X);
+    Scope W=_m_fmmdp->AgentScopeBackup(X,Scope());
+    W.Remove(A);
+
+    vector<size_t> nrUVals, nrWVals, nrZVals;
+    size_t nrU=1, nrW=1, nrZ=1;
+    for(Index i = 0; i < U.size(); i++)
+    {
+        nrUVals.push_back(_m_fmmdp->GetNrValuesForFactor(U[i]));
+        nrU*=nrUVals.back();
+    }
+    for(Index i = 0; i < W.size(); i++)
+    {
+        nrWVals.push_back(_m_fmmdp->GetNrActions(W[i]));
+        nrW*=nrWVals.back();
+    }
+    for(Index i = 0; i < Z.size(); i++)
+    {
+        nrZVals.push_back(_m_fmmdp->GetNrValuesForFactor(Z[i]));
+        nrZ*=nrZVals.back();
+    }
+
+    // the probabilities are computed for the scopes X+U, A+W and X+Z
+    Scope XU=X, AW=A, XZ=X;
+    XU.Insert(U);
+    AW.Insert(W);
+    XZ.Insert(Z);
+    vector<Index> XUs(XU.size()), AWs(AW.size()), XZs(XZ.size());
+    vector<Index> xs, us, as, ws, ys, zs;
+    Scope emptySc;
+    vector<Index> emptyVals;
+    double weight=1.0/(nrU*nrW);
+
+    lq.R.assign(lq.nrX*lq.nrA,0.0);
+    lq.T.assign(lq.nrX*lq.nrA*lq.nrX,0.0);
+    lq.Q.assign(lq.nrX*lq.nrA,0.0);
+
+    for(Index x = 0; x < lq.nrX; x++)
+    {
+        IndexTools::JointToIndividualIndices(x,lq.nrSFVals,xs);
+        copy(xs.begin(),xs.end(),XUs.begin());
+        for(Index a = 0; a < lq.nrA; a++)
+        {
+            IndexTools::JointToIndividualIndices(a,lq.nrActionVals,as);
+            copy(as.begin(),as.end(),AWs.begin());
+            Index xa=x*lq.nrA+a;
+
+            for(Index i = 0; i < lq.LRFs.size(); i++)
+            {
+                Index e=lq.LRFs[i];
+                const Scope &sfSC=_m_fmmdp->GetStateFactorScopeForLRF(e);
+                const Scope &agSC=_m_fmmdp->GetAgentScopeForLRF(e);
+                vector<Index> xs_e(sfSC.size()), as_e(agSC.size());
+                IndexTools::RestrictIndividualIndicesToNarrowerScope(
+                    xs,X,sfSC,xs_e);
+                IndexTools::RestrictIndividualIndicesToNarrowerScope(
+                    as,A,agSC,as_e);
+                lq.R[xa]+=_m_fmmdp->GetLRFReward(
+                    e,
+                    _m_fmmdp->RestrictedStateVectorToJointIndex(e,xs_e),
+                    _m_fmmdp->RestrictedActionVectorToJointIndex(e,as_e));
+            }
+
+            double *T_xa=&lq.T[xa*lq.nrX];
+            for(Index u = 0; u < nrU; u++)
+            {
+                IndexTools::JointToIndividualIndices(u,nrUVals,us);
+                copy(us.begin(),us.end(),XUs.begin()+X.size());
+                for(Index w = 0; w < nrW; w++)
+                {
+                    IndexTools::JointToIndividualIndices(w,nrWVals,ws);
+                    copy(ws.begin(),ws.end(),AWs.begin()+A.size());
+                    for(Index y = 0; y < lq.nrX; y++)
+                    {
+                        IndexTools::JointToIndividualIndices(y,lq.nrSFVals,
+                                                             ys);
+                        copy(ys.begin(),ys.end(),XZs.begin());
+                        double p=0;
+                        for(Index z = 0; z < nrZ; z++)
+                        {
+                            IndexTools::JointToIndividualIndices(z,nrZVals,
+                                                                 zs);
+                            copy(zs.begin(),zs.end(),XZs.begin()+X.size());
+                            p+=dbn->GetYOProbability(XU,XUs,AW,AWs,XZ,XZs,
+                                                     emptySc,emptyVals);
+                        }
+                        T_xa[y]+=weight*p;
+                    }
+                }
+            }
+        }
+    }
+}
+
+double FactoredMMDPDecoupledValueIteration::BackupLocalQ(LocalQ &lq,
+                                                          double gamma) const
+{
+    double maxDelta=0;
+    for(Index xa = 0; xa < lq.nrX*lq.nrA; xa++)
+    {
+        const double *T_xa=&lq.T[xa*lq.nrX];
+        double R_f=0;
+        for(Index y = 0; y < lq.nrX; y++)
+            R_f+=T_xa[y]*lq.V[y];
+        double q=lq.R[xa]+gamma*R_f;
+        maxDelta=std::max(maxDelta,std::abs(lq.Q[xa]-q));
+        lq.Q[xa]=q;
+    }
+    return(maxDelta);
+}
+
+size_t FactoredMMDPDecoupledValueIteration::IterateLocalQ(LocalQ &lq,
+                                                          double gamma) const
+{
+    lq.V.resize(lq.nrX);
+    size_t nrIterations=0;
+    double maxDelta=DBL_MAX;
+    while(maxDelta>_m_tolerance)
+    {
+        for(Index y = 0; y < lq.nrX; y++)
+            lq.V[y]=*max_element(lq.Q.begin()+y*lq.nrA,
+                                 lq.Q.begin()+(y+1)*lq.nrA);
+        maxDelta=BackupLocalQ(lq,gamma);
+        nrIterations++;
+    }
+    return(nrIterations);
+}
+
+void FactoredMMDPDecoupledValueIteration::SampleStates()
+{
+    size_t nrSFs=_m_fmmdp->GetNrStateFactors();
+    vector<size_t> nrSFVals(nrSFs);
+    // as a double, as the number of states can overflow an Index
+    double nrStates=1;
+    for(Index i = 0; i < nrSFs; i++)
+    {
+        nrSFVals[i]=_m_fmmdp->GetNrValuesForFactor(i);
+        nrStates*=nrSFVals[i];
+    }
+
+    _m_samples.clear();
+    vector<Index> sfacValues(nrSFs,0);
+    if(nrStates <= _m_nrSamples)
+    {
+        bool finished=false;
+        while(!finished)
+        {
+            _m_samples.push_back(sfacValues);
+            finished=IndexTools::Increment(sfacValues,nrSFVals);
+        }
+    }
+    else
+    {
+        unsigned int seed=0;
+        for(Index n = 0; n < _m_nrSamples; n++)
+        {
+            for(Index i = 0; i < nrSFs; i++)
+                sfacValues[i]=rand_r(&seed) % nrSFVals[i];
+            _m_samples.push_back(sfacValues);
+        }
+    }
+}
+
+void FactoredMMDPDecoupledValueIteration::ComputeJointMaxValues(
+    double stepSize)
+{
+    long nrSamples=static_cast<long>(_m_samples.size());
+    vector<vector<Index> > maxActions(nrSamples);
+#ifdef _OPENMP
+    bool parallel=(nrSamples>1 && omp_get_max_threads() > 1 &&
+                   !omp_in_parallel());
+#endif
+    EParallel error;
+#pragma omp parallel for schedule(dynamic) if(parallel)
+    for(long n = 0; n < nrSamples; n++)
+    {
+        try {
+            maxActions[n]=MaximizeFactorGraph(_m_samples[n]);
+        }
+        catch(...)
+        {
+            error.Catch();
+        }
+    }
+    error.Rethrow();
+
+    // the value of a local Q-function for y_k moves to the average of its
+    // terms over the sampled states with that y_k
+    vector<Index> xs, as;
+    for(Index k = 0; k < _m_localQs.size(); k++)
+    {
+        LocalQ &lq=_m_localQs[k];
+        vector<double> sum(lq.nrX,0.0);
+        vector<size_t> count(lq.nrX,0);
+        xs.resize(lq.sfScope.size());
+        as.resize(lq.agScope.size());
+        for(long n = 0; n < nrSamples; n++)
+        {
+            IndexTools::RestrictIndividualIndicesToScope(_m_samples[n],
+                                                         lq.sfScope,xs);
+            IndexTools::RestrictIndividualIndicesToScope(maxActions[n],
+                                                         lq.agScope,as);
+            Index x=IndexTools::IndividualToJointIndices(xs,lq.nrSFVals);
+            Index a=IndexTools::IndividualToJointIndices(as,lq.nrActionVals);
+            sum[x]+=lq.Q[x*lq.nrA+a];
+            count[x]++;
+        }
+        for(Index y = 0; y < lq.nrX; y++)
+            if(count[y]>0)
+                lq.V[y]+=stepSize*(sum[y]/count[y]-lq.V[y]);
+            else
+                lq.V[y]=*max_element(lq.Q.begin()+y*lq.nrA,
+                                     lq.Q.begin()+(y+1)*lq.nrA);
+    }
+}
+
+void FactoredMMDPDecoupledValueIteration::Plan()
+{
+    double gamma=_m_fmmdp->GetDiscount();
+    if(gamma>=1.0)
+        throw(E("FactoredMMDPDecoupledValueIteration::Plan() requires a discount < 1"));
+
+    StartTimer("Plan");
+
+    long nrLQs=static_cast<long>(_m_localQs.size());
+#ifdef _OPENMP
+    bool parallel=(nrLQs>1 && omp_get_max_threads() > 1 &&
+                   !omp_in_parallel());
+#endif
+    // the local MDPs are first solved independently of each other
+    EParallel error;
+#pragma omp parallel for schedule(dynamic) if(parallel)
+    for(long k = 0; k < nrLQs; k++)
+    {
+        try {
+            ComputeLocalModel(_m_localQs[k]);
+            size_t nrIt=IterateLocalQ(_m_localQs[k],gamma);
+#if DEBUG_FactoredMMDPDecoupledValueIteration
+#pragma omp critical
+            cout << "FactoredMMDPDecoupledValueIteration: local Q " << k
+                 << " converged after " << nrIt << " iterations" << endl;
+#else
+            (void)nrIt;
+#endif
+        }
+        catch(...)
+        {
+            error.Catch();
+        }
+    }
+    error.Rethrow();
+
+    // then the backups maximize jointly over the local Q-functions
+    SampleStates();
+    _m_nrIterations=0;
+    double maxDelta=DBL_MAX, stepSize=1;
+    while(maxDelta>_m_tolerance && _m_nrIterations<_m_maxNrIterations)
+    {
+        ComputeJointMaxValues(stepSize);
+        double prevMaxDelta=maxDelta;
+        maxDelta=0;
+        for(long k = 0; k < nrLQs; k++)
+            maxDelta=std::max(maxDelta,BackupLocalQ(_m_localQs[k],gamma));
+        // the residual of a contraction decreases, when it does not the
+        // maximizing actions alternate, and a smaller step damps that
+        if(maxDelta>=prevMaxDelta)
+            stepSize/=2;
+        _m_nrIterations++;
+    }
+#if DEBUG_FactoredMMDPDecoupledValueIteration
+    cout << "FactoredMMDPDecoupledValueIteration: " << _m_nrIterations
+         << " joint backups, Bellman residual " << maxDelta << endl;
+#endif
+    _m_planned=true;
+
+    StopTimer("Plan");
+}
+
+double FactoredMMDPDecoupledValueIteration::GetLocalQ(
+    const LocalQ &lq,
+    const vector<Index> &sfacValues,
+    const vector<Index> &actions) const
+{
+    vector<Index> xs(lq.sfScope.size()), as(lq.agScope.size());
+    IndexTools::RestrictIndividualIndicesToScope(sfacValues,lq.sfScope,xs);
+    IndexTools::RestrictIndividualIndicesToScope(actions,lq.agScope,as);
+    Index x=IndexTools::IndividualToJointIndices(xs,lq.nrSFVals);
+    Index a=IndexTools::IndividualToJointIndices(as,lq.nrActionVals);
+    return(lq.Q[x*lq.nrA+a]);
+}
+
+double FactoredMMDPDecoupledValueIteration::GetQ(
+    const vector<Index> &sfacValues,
+    const vector<Index> &actions) const
+{
+    double q=0;
+    for(Index k = 0; k < _m_localQs.size(); k++)
+        q+=GetLocalQ(_m_localQs[k],sfacValues,actions);
+    return(q);
+}
+
+double FactoredMMDPDecoupledValueIteration::GetQ(Index sI, Index jaI) const
+{
+    return(GetQ(_m_fmmdp->StateIndexToFactorValueIndices(sI),
+                _m_fmmdp->JointToIndividualActionIndices(jaI)));
+}
+
+vector<Index> FactoredMMDPDecoupledValueIteration::GetMaximizingActions(
+    const vector<Index> &sfacValues) const
+{
+    if(!_m_planned)
+        throw(E("FactoredMMDPDecoupledValueIteration::GetMaximizingActions() called before Plan()"));
+    return(MaximizeFactorGraph(sfacValues));
+}
+
+vector<Index> FactoredMMDPDecoupledValueIteration::MaximizeFactorGraph(
+    const vector<Index> &sfacValues) const
+{
+    size_t nrAgents=_m_fmmdp->GetNrAgents();
+    // every agent gets a zero factor, such that all agents are variables
+    // of the factor graph even if they are in no agent scope
+    vector<libDAI::Var> vars;
+    vector<libDAI::Factor> facs;
+    for(Index agI = 0; agI < nrAgents; agI++)
+    {
+        vars.push_back(libDAI::Var(agI,_m_fmmdp->GetNrActions(agI)));
+        facs.push_back(libDAI::Factor(libDAI::VarSet(vars.back()),0.0));
+    }
+
+    // local Q-functions with the same agent scope are summed into one
+    // factor, which avoids many (short) cycles in the factor graph
+    vector<Scope> factorScopes;
+    vector<Index> xs, as;
+    for(Index k = 0; k < _m_localQs.size(); k++)
+    {
+        const LocalQ &lq=_m_localQs[k];
+        // local Q-functions without agents do not influence the maximization
+        if(lq.agScope.empty())
+            continue;
+
+        xs.resize(lq.sfScope.size());
+        IndexTools::RestrictIndividualIndicesToScope(sfacValues,lq.sfScope,xs);
+        Index x=IndexTools::IndividualToJointIndices(xs,lq.nrSFVals);
+
+        libDAI::VarSet vs;
+        for(Index i = 0; i < lq.agScope.size(); i++)
+            vs = vs | vars[lq.agScope[i]];
+        Index fI=0;
+        while(fI < factorScopes.size() && !factorScopes[fI].Equals(lq.agScope))
+            fI++;
+        if(fI == factorScopes.size())
+        {
+            factorScopes.push_back(lq.agScope);
+            facs.push_back(libDAI::Factor(vs,0.0));
+        }
+        libDAI::Factor &f=facs[nrAgents+fI];
+        for(Index a = 0; a < lq.nrA; a++)
+        {
+            IndexTools::JointToIndividualIndices(a,lq.nrActionVals,as);
+            vector<size_t> asST(as.begin(),as.end());
+            f[libDAI::Factor::IndividualToJointFactorIndex(vs,asST)]+=
+                lq.Q[x*lq.nrA+a];
+        }
+    }
+
+    // as in BG_FactorGraphCreator, the values are perturbed slightly such
+    // that max-plus does not get stuck between tied configurations
+    unsigned int seed=0;
+    for(Index fI = nrAgents; fI < facs.size(); fI++)
+        for(Index i = 0; i < facs[fI].stateSpace(); i++)
+            facs[fI][i]+=(1e-6*rand_r(&seed))/RAND_MAX;
+
+    libDAI::FactorGraph fg(facs);
+    FG_Solver* fgs=0;
+    switch(_m_FGSt)
+    {
+    case FG_Solver::FGSt_NDP:
+        fgs = new FG_SolverNDP(fg,0);
+        break;
+    case FG_Solver::FGSt_MaxPlus:
+        fgs = new FG_SolverMaxPlus(fg,1000,"PARALL",0,0.05);
+        break;
+    default:
+        throw(E("FactoredMMDPDecoupledValueIteration::MaximizeFactorGraph() unhandled solver type"));
+    }
+    fgs->Solve();
+    list< libDAI::MADP_util::valConf >& bestConfs=fgs->GetBestConfigurations();
+    if(bestConfs.empty())
+    {
+        delete fgs;
+        throw(E("FactoredMMDPDecoupledValueIteration::MaximizeFactorGraph() the factor graph solver found no configuration"));
+    }
+    const vector<size_t> &config=bestConfs.front().second;
+    vector<Index> actions(nrAgents);
+    for(Index agI = 0; agI < nrAgents; agI++)
+        actions[agI]=config[agI];
+    delete fgs;
+
+    return(actions);
+}
+
+Index FactoredMMDPDecoupledValueIteration::GetMaximizingAction(Index sI) const
+{
+    return(_m_fmmdp->IndividualToJointActionIndices(
+               GetMaximizingActions(
+                   _m_fmmdp->StateIndexToFactorValueIndices(sI))));
+}
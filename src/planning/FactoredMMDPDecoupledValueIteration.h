@@ -0,0 +1,211 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _FACTOREDMMDPDECOUPLEDVALUEITERATION_H_
+#define _FACTOREDMMDPDECOUPLEDVALUEITERATION_H_ 1
+
+/* the include directives */
+#include <iostream>
+#include <vector>
+#include "Globals.h"
+
+#include "Scope.h"
+#include "FactoredQFunctionScopeForStage.h"
+#include "TimedAlgorithm.h"
+#include "FG_Solver.h"
+
+class FactoredDecPOMDPDiscreteInterface;
+
+/**\brief FactoredMMDPDecoupledValueIteration computes an approximate
+ * Q-function for factored MMDPs by value iteration on decoupled local
+ * models, without enumerating the joint state space.
+ *
+ * The Q-function is represented as a sum of local Q-functions
+ * \f[ Q(x,a) = \sum_k Q_k(x[X_k],a[A_k]) \f]
+ * with the scopes (X_k,A_k) of a FactoredQFunctionScopeForStage. By
+ * default these are the scopes of the local reward functions (LRFs); each
+ * LRF is added to the first local Q-function whose scopes contain it.
+ *
+ * Every local Q-function has its own local model: the reward R_k of its
+ * LRFs and the transition model P(y_k|x_k,a_k), obtained from the CPTs
+ * of the 2DBN. The parents of X_k that lie outside (X_k,A_k) are
+ * projected out by averaging over their values uniformly, and
+ * next-stage factors that X_k depends on within the stage are
+ * marginalized. The local models are computed once.
+ *
+ * The backups maximize jointly over the local Q-functions: for each state
+ * y of a set of sampled states the maximizing joint action
+ * \f$ a^*(y) = \arg\max_a \sum_k Q_k(y_k,a_k) \f$ is found with the
+ * factor graph solver, and the value of y is split into the terms
+ * Q_k(y_k,a^*_k(y)). These are projected onto the scope of each local
+ * Q-function by averaging them over the sampled states with the same
+ * y_k, which gives V_k(y_k), and then
+ * \f[ Q_k(x_k,a_k) = R_k(x_k,a_k) + \gamma \sum_{y_k} P(y_k|x_k,a_k)
+ *      V_k(y_k). \f]
+ * A value y_k that no sampled state has gets the value
+ * \f$ \max_{a_k} Q_k(y_k,a_k) \f$. All states are used when there are at
+ * most GetNrSamples() of them, otherwise that many states are sampled
+ * uniformly (with a fixed seed). The local Q-functions are initialized
+ * by solving each local MDP on its own, and the joint backups are
+ * repeated until the Bellman residual drops to the tolerance, or for at
+ * most GetMaxNrIterations() iterations. The maximizing actions of some
+ * states can alternate between backups, which keeps the residual from
+ * decreasing; each time that happens the V_k only move half as far
+ * towards the new projected values as before, which damps it. When compiled with OpenMP the local MDPs and
+ * the maximizations for the sampled states are computed concurrently.
+ * Memory and runtime depend on the scope sizes and the number of sampled
+ * states only.
+ *
+ * The result is exact when a single local Q-function spans all state
+ * factors and agents (then it is flat value iteration). Otherwise it is
+ * an approximation, as the local transition models are projections and
+ * the value is projected onto the scopes, and not a bound on the optimal
+ * Q-function.
+ *
+ * The maximizing joint action for a state is found by building a factor
+ * graph of the local Q-functions, conditioned on that state, and
+ * maximizing it with FG_SolverMaxPlus (default) or FG_SolverNDP.
+ *
+ * Observations are ignored, so this is only meaningful for fully
+ * observable models such as FactoredMMDPDiscrete. Only discounted
+ * infinite-horizon problems are supported.
+ */
+class FactoredMMDPDecoupledValueIteration : public TimedAlgorithm
+{
+private:
+
+    /// A local Q-function with its local model.
+    struct LocalQ
+    {
+        /// The (sorted) state factor and agent scopes.
+        Scope sfScope;
+        Scope agScope;
+        std::vector<size_t> nrSFVals;
+        std::vector<size_t> nrActionVals;
+        size_t nrX;
+        size_t nrA;
+        /// The LRFs that are added to this component.
+        std::vector<Index> LRFs;
+        /// R[x*nrA+a]
+        std::vector<double> R;
+        /// T[(x*nrA+a)*nrX+y], the projected P(y|x,a).
+        std::vector<double> T;
+        /// Q[x*nrA+a]
+        std::vector<double> Q;
+        /// V[y], the value projected onto the state factor scope.
+        std::vector<double> V;
+    };
+
+    const FactoredDecPOMDPDiscreteInterface* _m_fmmdp;
+
+    std::vector<LocalQ> _m_localQs;
+
+    /// The Bellman residual at which VI stops.
+    double _m_tolerance;
+
+    /// The factor graph solver used by GetMaximizingActions().
+    FG_Solver::FG_Solver_t _m_FGSt;
+
+    /// The maximum number of states the joint backups use.
+    size_t _m_nrSamples;
+
+    /// The maximum number of joint backups.
+    size_t _m_maxNrIterations;
+
+    /// The number of joint backups performed by Plan().
+    size_t _m_nrIterations;
+
+    /// The states the joint backups use.
+    std::vector<std::vector<Index> > _m_samples;
+
+    bool _m_planned;
+
+    void AddLocalQs(const FactoredQFunctionScopeForStage &scopes);
+    void AssignLRFs();
+    void ComputeLocalModel(LocalQ &lq) const;
+    /// Backs up Q of one local MDP with lq.V, returns the Bellman residual.
+    double BackupLocalQ(LocalQ &lq, double gamma) const;
+    /// Runs VI on one local MDP, returns the nr. of iterations.
+    size_t IterateLocalQ(LocalQ &lq, double gamma) const;
+    /// Fills _m_samples with all states, or with sampled ones.
+    void SampleStates();
+    /// Moves V of all local Q-functions by stepSize towards the values
+    /// of the joint maximization.
+    void ComputeJointMaxValues(double stepSize);
+    /// Maximizes the factor graph of the local Q-functions.
+    std::vector<Index> MaximizeFactorGraph(
+        const std::vector<Index> &sfacValues) const;
+
+    double GetLocalQ(const LocalQ &lq,
+                     const std::vector<Index> &sfacValues,
+                     const std::vector<Index> &actions) const;
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /// Constructor that uses the immediate reward scopes.
+    FactoredMMDPDecoupledValueIteration(
+        const FactoredDecPOMDPDiscreteInterface* fmmdp);
+    /// Constructor with the scopes of the local Q-functions.
+    FactoredMMDPDecoupledValueIteration(
+        const FactoredDecPOMDPDiscreteInterface* fmmdp,
+        const FactoredQFunctionScopeForStage &scopes);
+    /// Destructor.
+    ~FactoredMMDPDecoupledValueIteration();
+
+    void Plan();
+
+    /// Returns Q(x,a) for a vector of state factor values and actions.
+    double GetQ(const std::vector<Index> &sfacValues,
+                const std::vector<Index> &actions) const;
+
+    /// Returns Q(s,ja) for flat state and joint action indices.
+    double GetQ(Index sI, Index jaI) const;
+
+    /// Returns the actions that maximize Q for the given state.
+    std::vector<Index> GetMaximizingActions(
+        const std::vector<Index> &sfacValues) const;
+
+    /// Returns the maximizing joint action for a flat state index.
+    Index GetMaximizingAction(Index sI) const;
+
+    size_t GetNrLocalQs() const { return(_m_localQs.size()); }
+    const Scope& GetStateFactorScope(Index k) const
+        { return(_m_localQs.at(k).sfScope); }
+    const Scope& GetAgentScope(Index k) const
+        { return(_m_localQs.at(k).agScope); }
+
+    double GetTolerance() const { return(_m_tolerance); }
+    void SetTolerance(double tolerance) { _m_tolerance=tolerance; }
+    FG_Solver::FG_Solver_t GetFGSolverType() const { return(_m_FGSt); }
+    void SetFGSolverType(FG_Solver::FG_Solver_t FGSt) { _m_FGSt=FGSt; }
+    size_t GetNrSamples() const { return(_m_nrSamples); }
+    void SetNrSamples(size_t nrSamples) { _m_nrSamples=nrSamples; }
+    size_t GetMaxNrIterations() const { return(_m_maxNrIterations); }
+    void SetMaxNrIterations(size_t maxNrIterations)
+        { _m_maxNrIterations=maxNrIterations; }
+    /// Returns the number of joint backups the last Plan() performed.
+    size_t GetNrIterations() const { return(_m_nrIterations); }
+
+};
+
+
+#endif /* !_FACTOREDMMDPDECOUPLEDVALUEITERATION_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
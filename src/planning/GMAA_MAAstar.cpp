@@ -89,23 +89,42 @@ bool GMAA_MAAstar::ConstructAndValuateNextPolicies(
         if(_m_verboseness >= 8) 
             cout << "GMAA_MAAstar: I have not expanded this ppi before..." << endl;
 
-        // Construct the bayesian game for this timestep - 
-        bg_ts= boost::shared_ptr<BayesianGameForDecPOMDPStage> (
-            new BayesianGameForDecPOMDPStage(
-                this,
-                _m_qHeuristic,
-                jpolPrevTs
-                ));
+        // Construct the bayesian game for this timestep - by extending
+        // the BG that jpolPrevTs was a solution of, if we have it
+        boost::shared_ptr<const BayesianGameForDecPOMDPStage> prevBG = 
+            ppi->GetPreviousBG();
+        boost::shared_ptr<BayesianGameForDecPOMDPStage> newBG;
+        if(prevBG)
+        {
+            newBG= boost::shared_ptr<BayesianGameForDecPOMDPStage> (
+                new BayesianGameForDecPOMDPStage(prevBG, jpolPrevTs));
+            // the BG for the previous stage is no longer needed by this ppi
+            ppi->SetPreviousBG(
+                boost::shared_ptr<const BayesianGameForDecPOMDPStage>());
+        }
+        else
+            newBG= boost::shared_ptr<BayesianGameForDecPOMDPStage> (
+                new BayesianGameForDecPOMDPStage(
+                    this,
+                    _m_qHeuristic,
+                    jpolPrevTs
+                    ));
+        if(_m_compactBGs && newBG->HasDenseUtilities())
+            newBG->RemapUtilitiesToPositiveProbabilityTypes();
+        bg_ts=newBG;
         // not sure this pays off in terms of time vs space...
 //        bg_ts->ComputeAllImmediateRewards();
 
         // save the BG to disk in case the user requested it
-        _m_bgCounter++;
-        if(_m_bgBaseFilename!="")
+#pragma omp critical(GeneralizedMAAStarPlanner_bgCounter)
         {
-            stringstream ss;
-            ss << _m_bgBaseFilename << _m_bgCounter;
-            BayesianGameIdenticalPayoff::Save(*bg_ts,ss.str());
+            _m_bgCounter++;
+            if(_m_bgBaseFilename!="")
+            {
+                stringstream ss;
+                ss << _m_bgBaseFilename << _m_bgCounter;
+                BayesianGameIdenticalPayoff::Save(*bg_ts,ss.str());
+            }
         }
 
         // keep track of every bg_ts we instantiate, so we can clean
@@ -204,8 +223,13 @@ bool GMAA_MAAstar::ConstructAndValuateNextPolicies(
         else
             newValue = prevPastReward + discounted_F;
 
-        //push this policy and value on the priority queue
-        poolOfNextPolicies->Insert( NewPPI(jpolTs,newValue) );
+        //push this policy and value on the priority queue, together with
+        //bg_ts such that the BG for the next stage can be built from it
+        PartialPolicyPoolItemInterface_sharedPtr newPPI = 
+            NewPPI(jpolTs,newValue);
+        if(!is_last_ts)
+            newPPI->SetPreviousBG(bg_ts);
+        poolOfNextPolicies->Insert(newPPI);
 
 #if DEBUG_GMAA4
         cout <<"v = pastReward_prevTs + g^t * f = "
@@ -101,6 +101,12 @@ class GMAA_MAAstar : public GeneralizedMAAStarPlannerForDecPOMDPDiscrete
         
         void ResetPlanner();
 
+        /**\brief ConstructAndValuateNextPolicies() only modifies the
+         * expanded ppi, so several items can be expanded at once when
+         * the BGs can be constructed concurrently. */
+        bool CanExpandConcurrently() const
+        { return(CanConstructBGsConcurrently()); }
+
     public:
         
         // Constructor, destructor and copy assignment.
@@ -22,6 +22,7 @@
 #include "BayesianGameIdenticalPayoffSolver_T.h"
 #include "BGIP_SolverCreatorInterface_T.h"
 #include "PartialJointPolicyPureVector.h"
+#include "BGIP_SolutionCache.h"
 
 using namespace std;
 
@@ -56,21 +57,32 @@ bool GMAA_kGMAA::ConstructAndValuateNextPolicies(
     vector<Index> firstOHtsI(GetNrAgents());
     for(Index agI=0; agI < GetNrAgents(); agI++)
         firstOHtsI.at(agI) = CastLIndexToIndex(GetFirstObservationHistoryIndex(agI, ts));
-    // Construct the bayesian game for this timestep - 
-    boost::shared_ptr<BayesianGameForDecPOMDPStage> bg_ts=
-        boost::shared_ptr<BayesianGameForDecPOMDPStage>(
-        new BayesianGameForDecPOMDPStage(
-            this,
-            _m_qHeuristic,
-            jpolPrevTs
-            ));
-
-    _m_bgCounter++;
-    if(_m_bgBaseFilename!="")
+    // Construct the bayesian game for this timestep - by extending the BG
+    // that jpolPrevTs was a solution of, if we have it
+    boost::shared_ptr<BayesianGameForDecPOMDPStage> bg_ts;
+    if(ppi->GetPreviousBG())
+        bg_ts=boost::shared_ptr<BayesianGameForDecPOMDPStage>(
+            new BayesianGameForDecPOMDPStage(ppi->GetPreviousBG(),
+                                             jpolPrevTs));
+    else
+        bg_ts=boost::shared_ptr<BayesianGameForDecPOMDPStage>(
+            new BayesianGameForDecPOMDPStage(
+                this,
+                _m_qHeuristic,
+                jpolPrevTs
+                ));
+    if(_m_compactBGs && bg_ts->HasDenseUtilities())
+        bg_ts->RemapUtilitiesToPositiveProbabilityTypes();
+
+#pragma omp critical(GeneralizedMAAStarPlanner_bgCounter)
     {
-        stringstream ss;
-        ss << _m_bgBaseFilename << _m_bgCounter;
-        BayesianGameIdenticalPayoff::Save(*bg_ts,ss.str());
+        _m_bgCounter++;
+        if(_m_bgBaseFilename!="")
+        {
+            stringstream ss;
+            ss << _m_bgBaseFilename << _m_bgCounter;
+            BayesianGameIdenticalPayoff::Save(*bg_ts,ss.str());
+        }
     }
 
     double prevPastReward = jpolPrevTs->GetPastReward();
@@ -99,22 +111,39 @@ bool GMAA_kGMAA::ConstructAndValuateNextPolicies(
                 );
 
     SetCBGbounds(ppi,bgips);
-    bgips->Solve();
+
+    //the solutions of the BG, best first: from the cache if the BG has
+    //been solved before, otherwise from the solver
+    vector<boost::shared_ptr<JPPVValuePair> > solutions;
+    double CBGlowerbound, CBGupperbound;
+    GetCBGbounds(ppi,CBGlowerbound,CBGupperbound);
+    if(!_m_bgSolutionCache ||
+       !_m_bgSolutionCache->Lookup(bg_ts,_m_nrPoliciesToProcess,
+                                   CBGlowerbound,CBGupperbound,solutions))
+    {
+        bgips->Solve();
+        while(solutions.size() < _m_nrPoliciesToProcess && !bgips->IsEmptyJPPV())
+        {
+            solutions.push_back(bgips->GetNextSolutionJPPV());
+            bgips->PopNextSolutionJPPV();
+        }
+        if(_m_bgSolutionCache)
+            _m_bgSolutionCache->Store(bg_ts,CBGlowerbound,CBGupperbound,
+                                      solutions,bgips->IsEmptyJPPV());
+    }
 
     //for each solution in BGIPSolution  
     bg_ts->ComputeAllImmediateRewards();
     for(Index solI=0; solI < _m_nrPoliciesToProcess; solI++)
     {
-        if(bgips->IsEmptyJPPV())
+        if(solI==solutions.size())
         {
             cerr << "Warning, BGIP_Solver only returned "<<solI<<
                 " usable joint policies"<<endl;
             break;
         }
-        const boost::shared_ptr<JPPVValuePair> jpvp = bgips->GetNextSolutionJPPV();
+        const boost::shared_ptr<JPPVValuePair> jpvp = solutions[solI];
         JPPV_sharedPtr bgpol = jpvp->GetJPPV();
-
-        bgips->PopNextSolutionJPPV();
         PJPDP_sharedPtr jpolTs = 
             ConstructExtendedJointPolicy(*jpolPrevTs,
                                     *bgpol, nrOHts, firstOHtsI);
@@ -136,8 +165,13 @@ bool GMAA_kGMAA::ConstructAndValuateNextPolicies(
         else
             newValue = prevPastReward + discounted_F;
 
-        //push this policy and value on the priority queue
-        poolOfNextPolicies->Insert( NewPPI(jpolTs,newValue) );
+        //push this policy and value on the priority queue, together with
+        //bg_ts such that the BG for the next stage can be built from it
+        PartialPolicyPoolItemInterface_sharedPtr newPPI = 
+            NewPPI(jpolTs,newValue);
+        if(!is_last_ts)
+            newPPI->SetPreviousBG(bg_ts);
+        poolOfNextPolicies->Insert(newPPI);
 
         /*//push this policy and value on the priority queue
         ////if last stage, if so, we want to return the 
@@ -95,6 +95,12 @@ class GMAA_kGMAA : public GeneralizedMAAStarPlannerForDecPOMDPDiscrete
         
         void ResetPlanner();
 
+        /**\brief ConstructAndValuateNextPolicies() only modifies the
+         * expanded ppi, so several items can be expanded at once when
+         * the BGs can be constructed concurrently. */
+        bool CanExpandConcurrently() const
+        { return(CanConstructBGsConcurrently()); }
+
     public:
         
         // Constructor, destructor and copy assignment.
@@ -18,10 +18,16 @@
 #include "QFunctionJAOHInterface.h"
 #include "PartialPolicyPoolInterface.h"
 #include "PolicyPoolJPolValPair.h"
+#include "PolicyPoolPartialJPolValPairSpilling.h"
 #include "EDeadline.h"
+#include "EParallel.h"
 
 #include "PartialJointPolicyPureVector.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #define DEBUG_GMAA_POLS 0
 
 using namespace std;
@@ -43,6 +49,9 @@ GeneralizedMAAStarPlanner::GeneralizedMAAStarPlanner(
     _m_nrPoliciesToProcess=UINT_MAX;
     _m_bgCounter=0;
     _m_bgBaseFilename="";
+    _m_nrConcurrentExpansions=1;
+    _m_policyPoolMemoryBudget=0;
+    _m_compactBGs=false;
 }
 
 //Destructor
@@ -117,9 +126,6 @@ void GeneralizedMAAStarPlanner::Plan()
     tms ts_start;   //the time struct
     clock_t tck_start;  //ticks
     tck_start = times(&ts_start);
-    //the intermediate timing stream
-    ofstream & its = *_m_intermediateResultFile;
-
     tms ts_before, ts_after;
     times(&ts_before);
 
@@ -131,8 +137,14 @@ void GeneralizedMAAStarPlanner::Plan()
     bestJPol->Print();
 #endif
 
-    // Setup the Policy Pool
-    PartialPolicyPoolInterface_sharedPtr pp_p = NewPP(); 
+    // Setup the Policy Pool, only this pool spills to disk, the
+    // temporary pools used during expansion are kept in memory
+    PartialPolicyPoolInterface_sharedPtr pp_p;
+    if(_m_policyPoolMemoryBudget>0)
+        pp_p=PartialPolicyPoolInterface_sharedPtr(
+            new PolicyPoolPartialJPolValPairSpilling(_m_policyPoolMemoryBudget));
+    else
+        pp_p=NewPP();
     pp_p->Init( GetThisFromMostDerivedPU() ); //initialize with empty joint policy
 
     do
@@ -165,109 +177,13 @@ void GeneralizedMAAStarPlanner::Plan()
                 pp_p->Size()<<"<<--"<<endl;
         }
 
-        PartialPolicyPoolItemInterface_sharedPtr ppi = pp_p->Select();
-        boost::shared_ptr<PartialJointPolicyDiscretePure> jpol_sel =  ppi->GetJPol();
-        double v_sel = ppi->GetValue();
-        size_t depth_sel = jpol_sel->GetDepth();
-        if(_m_verboseness >= 3) {
-            cout << "GMAA Selected a partial jpol of depth="<< depth_sel << " and heur. val="<<v_sel<<
-                " to expand" << endl;
-            if(_m_verboseness >= 4) 
-                ppi->GetJPol()->Print();
-        }
-        //cout << "SELECTed partial pol with heur. val="<<v_sel<<endl;
-        
-        if( (v_sel + _m_slack) < _m_maxLowerBound) //the highest upperbound < the best lower
-        {
-            //  1)if JPolValPool is no priority queue, this should be changed.
-            if(_m_verboseness >= 0)
-                cout<<"!!!GMAA::Plan highest upper < best found lower bound, stopping\n";
-            break;
-        }
-
-        //poolOfNextPolicies     = {<pol,vals>} 
-        //isLowerBound  = bool   - whether the vals are lower bounds to the 
-        //                optimal value (i.e. value for the optimal policy)
-        //<poolOfNextPolicies,isLowerBound>=ConstructAndValuateNextPolicies(ppi)
-
-        PartialPolicyPoolInterface_sharedPtr poolOfNextPolicies = NewPP();
-        bool cleanUpPPI=true;
-        bool are_LBs =
-            ConstructAndValuateNextPolicies(ppi,
-                                            poolOfNextPolicies,
-                                            cleanUpPPI);
-
-        //this keeps track of the actually expanded *nodes*
-        //however, due to our clever stuff we never exand all the nodes anymore
-        //so we will need to extract the information of 'non-incremental expansion'
-        //from within the CBG solver...
-        if(_m_expanded_childs.size()<=depth_sel)
-            _m_expanded_childs.resize(depth_sel+1,0);
-        _m_expanded_childs.at(depth_sel) += poolOfNextPolicies->Size();
-
-        //Clean up ppi - that is we remove the top element of the policy pool because that was just expanded (right?)
-        if(cleanUpPPI)
-            pp_p->Pop(ppi);
+        bool continuePlanning;
+        if(UseConcurrentExpansion())
+            continuePlanning=ExpandConcurrently(pp_p, bestJPol, tck_start);
         else
-        {
-            pp_p->Pop(ppi);
-            pp_p->Insert(ppi);
-            
-        }
-
-#if DEBUG_GMAA4        
-        if(DEBUG_GMAA4){
-            cout << "--------------------------------------------------\n"<<
-                    ">>>The next policies found, poolOfNextPolicies:"<<endl;
-            PartialPolicyPoolInterface_sharedPtr pp_copy = NewPP();
-            *pp_copy = *poolOfNextPolicies;
-            while(! pp_copy->Empty())
-            {
-                PartialPolicyPoolItemInterface_sharedPtr it = pp_copy->Select();
-                it->Print();
-                cout << endl;
-                pp_copy->Pop();
-            }
-            cout << "<<<\n---------------------------------------------"<<endl;
-        }
-#endif        
-
-        //if(isLowerBound)
-        //    Prune( JPolValPool, max(lowerBound) )
-        if(are_LBs && poolOfNextPolicies->Size() > 0)
-        {
-            PartialPolicyPoolItemInterface_sharedPtr bestRanked_ppi = poolOfNextPolicies->
-                GetBestRanked();
-            poolOfNextPolicies->PopBestRanked();
-            double bestNextVal = bestRanked_ppi->GetValue();
-            if(bestNextVal > _m_maxLowerBound) //new best lowerbound (and policy) found
-            {
-                _m_maxLowerBound = bestNextVal;
-                *bestJPol = *(bestRanked_ppi->GetJPol());
-                if(_m_verboseness >= 2) {
-                    cout << "new bestJPol (and max. lowerbound) found! - ";
-                    cout << "value v="
-                         << bestNextVal <<" - "
-                         << bestRanked_ppi->GetJPol()->SoftPrintBrief() << endl;
-                }
-                if(_m_verboseness >= 4) 
-                    cout << "new bestJPol->SoftPrint():"<<bestJPol->SoftPrint();
-
-                //if we maintain the internal timings...
-                if(_m_intermediateResultFile != 0)
-                {
-                    tms ts_cur;
-                    clock_t tck_cur;
-                    tck_cur = times(&ts_cur);
-                    clock_t diff = tck_cur - tck_start;
-                    its << diff << "\t" <<  _m_maxLowerBound << endl;
-                }
-                // prune JPolValPool
-                pp_p->Prune(_m_maxLowerBound - _m_slack );
-            }
-        }
-        SelectPoliciesToProcessFurther(poolOfNextPolicies, are_LBs, _m_maxLowerBound - _m_slack);
-        pp_p->Union(poolOfNextPolicies);
+            continuePlanning=Expand(pp_p, bestJPol, tck_start);
+        if(!continuePlanning)
+            break;
 
         if( _m_maxJPolPoolSize < pp_p->Size())
             _m_maxJPolPoolSize = pp_p->Size();
@@ -322,6 +238,211 @@ void GeneralizedMAAStarPlanner::Plan()
     }
 }
 
+bool GeneralizedMAAStarPlanner::Expand(
+    const boost::shared_ptr<PartialPolicyPoolInterface> &pp_p,
+    const boost::shared_ptr<PartialJointPolicyDiscretePure> &bestJPol,
+    clock_t tck_start)
+{
+    PartialPolicyPoolItemInterface_sharedPtr ppi = pp_p->Select();
+    boost::shared_ptr<PartialJointPolicyDiscretePure> jpol_sel =  ppi->GetJPol();
+    double v_sel = ppi->GetValue();
+    size_t depth_sel = jpol_sel->GetDepth();
+    if(_m_verboseness >= 3) {
+        cout << "GMAA Selected a partial jpol of depth="<< depth_sel << " and heur. val="<<v_sel<<
+            " to expand" << endl;
+        if(_m_verboseness >= 4) 
+            ppi->GetJPol()->Print();
+    }
+    //cout << "SELECTed partial pol with heur. val="<<v_sel<<endl;
+    
+    if( (v_sel + _m_slack) < _m_maxLowerBound) //the highest upperbound < the best lower
+    {
+        //  1)if JPolValPool is no priority queue, this should be changed.
+        if(_m_verboseness >= 0)
+            cout<<"!!!GMAA::Plan highest upper < best found lower bound, stopping\n";
+        return(false);
+    }
+
+    //poolOfNextPolicies     = {<pol,vals>} 
+    //isLowerBound  = bool   - whether the vals are lower bounds to the 
+    //                optimal value (i.e. value for the optimal policy)
+    //<poolOfNextPolicies,isLowerBound>=ConstructAndValuateNextPolicies(ppi)
+
+    PartialPolicyPoolInterface_sharedPtr poolOfNextPolicies = NewPP();
+    bool cleanUpPPI=true;
+    bool are_LBs =
+        ConstructAndValuateNextPolicies(ppi,
+                                        poolOfNextPolicies,
+                                        cleanUpPPI);
+
+    //this keeps track of the actually expanded *nodes*
+    //however, due to our clever stuff we never exand all the nodes anymore
+    //so we will need to extract the information of 'non-incremental expansion'
+    //from within the CBG solver...
+    if(_m_expanded_childs.size()<=depth_sel)
+        _m_expanded_childs.resize(depth_sel+1,0);
+    _m_expanded_childs.at(depth_sel) += poolOfNextPolicies->Size();
+
+    //Clean up ppi - that is we remove the top element of the policy pool because that was just expanded (right?)
+    if(cleanUpPPI)
+        pp_p->Pop(ppi);
+    else
+    {
+        pp_p->Pop(ppi);
+        pp_p->Insert(ppi);
+        
+    }
+
+    MergeNextPolicies(pp_p, poolOfNextPolicies, are_LBs, bestJPol, tck_start);
+    return(true);
+}
+
+bool GeneralizedMAAStarPlanner::ExpandConcurrently(
+    const boost::shared_ptr<PartialPolicyPoolInterface> &pp_p,
+    const boost::shared_ptr<PartialJointPolicyDiscretePure> &bestJPol,
+    clock_t tck_start)
+{
+    //take the best-ranked items off the pool, as long as they can still
+    //improve on the best lower bound
+    vector<PartialPolicyPoolItemInterface_sharedPtr> selected;
+    while(selected.size() < _m_nrConcurrentExpansions && !pp_p->Empty())
+    {
+        PartialPolicyPoolItemInterface_sharedPtr ppi = pp_p->Select();
+        if( (ppi->GetValue() + _m_slack) < _m_maxLowerBound)
+            break;
+        pp_p->Pop(ppi);
+        selected.push_back(ppi);
+    }
+    if(selected.empty())
+    {
+        if(_m_verboseness >= 0)
+            cout<<"!!!GMAA::Plan highest upper < best found lower bound, stopping\n";
+        return(false);
+    }
+    if(_m_verboseness >= 3)
+        cout << "GMAA Selected " << selected.size()
+             << " partial jpols to expand concurrently" << endl;
+
+    size_t nrSelected = selected.size();
+    vector<PartialPolicyPoolInterface_sharedPtr> poolsOfNextPolicies(nrSelected);
+    vector<size_t> depths(nrSelected);
+    for(Index i=0; i < nrSelected; i++)
+    {
+        poolsOfNextPolicies[i] = NewPP();
+        depths[i] = selected[i]->GetJPol()->GetDepth();
+    }
+    vector<char> cleanUpPPIs(nrSelected,1);
+    vector<char> are_LBs(nrSelected,0);
+
+    //the items are expanded on the worker threads, each in its own BG and
+    //BG solver; exceptions are passed on after the loop
+    EParallel error;
+#pragma omp parallel for schedule(dynamic,1)
+    for(int i=0; i < static_cast<int>(nrSelected); i++)
+    {
+        try {
+            bool cleanUpPPI=true;
+            are_LBs[i]=ConstructAndValuateNextPolicies(selected[i],
+                                                       poolsOfNextPolicies[i],
+                                                       cleanUpPPI);
+            cleanUpPPIs[i]=cleanUpPPI;
+        }
+        catch(...) { error.Catch(); }
+    }
+    error.Rethrow();
+
+    //merge the results in the order in which the items were selected
+    for(Index i=0; i < nrSelected; i++)
+    {
+        if(_m_expanded_childs.size()<=depths[i])
+            _m_expanded_childs.resize(depths[i]+1,0);
+        _m_expanded_childs.at(depths[i]) += poolsOfNextPolicies[i]->Size();
+
+        //items that can be expanded again (see GMAA_MAAstar) go back
+        //into the pool
+        if(!cleanUpPPIs[i])
+            pp_p->Insert(selected[i]);
+
+        MergeNextPolicies(pp_p, poolsOfNextPolicies[i], are_LBs[i],
+                          bestJPol, tck_start);
+    }
+    return(true);
+}
+
+void GeneralizedMAAStarPlanner::MergeNextPolicies(
+    const boost::shared_ptr<PartialPolicyPoolInterface> &pp_p,
+    const boost::shared_ptr<PartialPolicyPoolInterface> &poolOfNextPolicies,
+    bool are_LBs,
+    const boost::shared_ptr<PartialJointPolicyDiscretePure> &bestJPol,
+    clock_t tck_start)
+{
+#if DEBUG_GMAA4        
+    if(DEBUG_GMAA4){
+        cout << "--------------------------------------------------\n"<<
+                ">>>The next policies found, poolOfNextPolicies:"<<endl;
+        PartialPolicyPoolInterface_sharedPtr pp_copy = NewPP();
+        *pp_copy = *poolOfNextPolicies;
+        while(! pp_copy->Empty())
+        {
+            PartialPolicyPoolItemInterface_sharedPtr it = pp_copy->Select();
+            it->Print();
+            cout << endl;
+            pp_copy->Pop();
+        }
+        cout << "<<<\n---------------------------------------------"<<endl;
+    }
+#endif        
+
+    //if(isLowerBound)
+    //    Prune( JPolValPool, max(lowerBound) )
+    if(are_LBs && poolOfNextPolicies->Size() > 0)
+    {
+        PartialPolicyPoolItemInterface_sharedPtr bestRanked_ppi = poolOfNextPolicies->
+            GetBestRanked();
+        poolOfNextPolicies->PopBestRanked();
+        double bestNextVal = bestRanked_ppi->GetValue();
+        if(bestNextVal > _m_maxLowerBound) //new best lowerbound (and policy) found
+        {
+            _m_maxLowerBound = bestNextVal;
+            *bestJPol = *(bestRanked_ppi->GetJPol());
+            if(_m_verboseness >= 2) {
+                cout << "new bestJPol (and max. lowerbound) found! - ";
+                cout << "value v="
+                     << bestNextVal <<" - "
+                     << bestRanked_ppi->GetJPol()->SoftPrintBrief() << endl;
+            }
+            if(_m_verboseness >= 4) 
+                cout << "new bestJPol->SoftPrint():"<<bestJPol->SoftPrint();
+
+            //if we maintain the internal timings...
+            if(_m_intermediateResultFile != 0)
+            {
+                tms ts_cur;
+                clock_t tck_cur;
+                tck_cur = times(&ts_cur);
+                clock_t diff = tck_cur - tck_start;
+                *_m_intermediateResultFile << diff << "\t" <<  _m_maxLowerBound << endl;
+            }
+            // prune JPolValPool
+            pp_p->Prune(_m_maxLowerBound - _m_slack );
+        }
+    }
+    SelectPoliciesToProcessFurther(poolOfNextPolicies, are_LBs, _m_maxLowerBound - _m_slack);
+    pp_p->Union(poolOfNextPolicies);
+}
+
+bool GeneralizedMAAStarPlanner::UseConcurrentExpansion() const
+{
+#ifdef _OPENMP
+    return(_m_nrConcurrentExpansions > 1 &&
+           omp_get_max_threads() > 1 &&
+           !omp_in_parallel() &&
+           CanExpandConcurrently());
+#else
+    return(false);
+#endif
+}
+
 void 
 GeneralizedMAAStarPlanner::SelectKBestPoliciesToProcessFurther(
     const boost::shared_ptr<PartialPolicyPoolInterface> &poolOfNextPolicies, bool are_LBs,
@@ -406,6 +527,13 @@ boost::shared_ptr<JointPolicyDiscrete> GeneralizedMAAStarPlanner::GetJointPolicy
 JPDP_sharedPtr GeneralizedMAAStarPlanner::GetJointPolicyDiscretePure()
 { return(_m_foundPolicy); }
 
+void GeneralizedMAAStarPlanner::SetNrConcurrentExpansions(size_t n)
+{
+    if(n==0)
+        throw(E("GeneralizedMAAStarPlanner::SetNrConcurrentExpansions should expand at least 1 item"));
+    _m_nrConcurrentExpansions=n;
+}
+
 void GeneralizedMAAStarPlanner::SetDeadline(size_t deadlineInS)
 {
     _m_deadline=deadlineInS;
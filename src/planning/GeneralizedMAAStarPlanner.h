@@ -48,6 +48,7 @@ class JointPolicyPureVector;
 class PartialJointPolicyDiscretePure;
 class PartialJointPolicyPureVector;
 class BayesianGameForDecPOMDPStage;
+class BGIP_SolutionCache;
 //template<class JP> class BayesianGameIdenticalPayoffSolver_T;
 
 class Interface_ProblemToPolicyDiscretePure;
@@ -99,9 +100,49 @@ class GeneralizedMAAStarPlanner :
          * the planning process.*/
         LIndex _m_maxJPolPoolSize;
 
+        /// The maximum number of pool items that are expanded at once.
+        size_t _m_nrConcurrentExpansions;
+
         /// Initialize the planner.
         void Initialize();
 
+        /**\brief Performs one GMAA iteration: selects the best-ranked item
+         * of pp_p and expands it.
+         *
+         * Returns false when the search can stop, i.e., when the selected
+         * item cannot improve on the best lower bound found so far.
+         */
+        bool Expand(const boost::shared_ptr<PartialPolicyPoolInterface> &pp_p,
+                    const boost::shared_ptr<PartialJointPolicyDiscretePure> &bestJPol,
+                    clock_t tck_start);
+        /**\brief Performs one GMAA iteration that expands up to
+         * _m_nrConcurrentExpansions of the best-ranked items of pp_p at
+         * once.
+         *
+         * The items are expanded by ConstructAndValuateNextPolicies() on
+         * separate threads, after which their children are merged into
+         * pp_p in the order in which the items were selected. The best
+         * lower bound is therefore shared between iterations: all items
+         * are expanded with the bound that was available when they were
+         * selected.
+         */
+        bool ExpandConcurrently(
+            const boost::shared_ptr<PartialPolicyPoolInterface> &pp_p,
+            const boost::shared_ptr<PartialJointPolicyDiscretePure> &bestJPol,
+            clock_t tck_start);
+        /**\brief Merges the result of ConstructAndValuateNextPolicies()
+         * into pp_p, updating the best lower bound (and bestJPol) and
+         * pruning pp_p when a better lower bound has been found.
+         */
+        void MergeNextPolicies(
+            const boost::shared_ptr<PartialPolicyPoolInterface> &pp_p,
+            const boost::shared_ptr<PartialPolicyPoolInterface> &poolOfNextPolicies,
+            bool are_LBs,
+            const boost::shared_ptr<PartialJointPolicyDiscretePure> &bestJPol,
+            clock_t tck_start);
+        /// Whether Plan() should use ExpandConcurrently().
+        bool UseConcurrentExpansion() const;
+
     protected:
 
         ///the level of verboseness, default=0, >0 verbose, <0 silent
@@ -124,6 +165,17 @@ class GeneralizedMAAStarPlanner :
     
         size_t _m_nrPoliciesToProcess;
 
+        /**The memory budget (in bytes) of the policy pool, 0 means
+         * unlimited. See SetPolicyPoolMemoryBudget(). */
+        size_t _m_policyPoolMemoryBudget;
+
+        /**Whether the BGs only store the utilities of joint types with a
+         * positive probability. See SetCompactBGs(). */
+        bool _m_compactBGs;
+
+        /**The cache of BG solutions, if any. See SetBGSolutionCache(). */
+        boost::shared_ptr<BGIP_SolutionCache> _m_bgSolutionCache;
+
         /**when the heuristic is not admissible, or the past reward is an approximation,
          * we may add some slack such that good policies are not pruned
          */
@@ -271,8 +323,42 @@ class GeneralizedMAAStarPlanner :
         /// This should reset the planner, so it can be started from the beginning.
         virtual void ResetPlanner() = 0;
 
+        /**\brief Whether ConstructAndValuateNextPolicies() may be called
+         * concurrently for different pool items.
+         *
+         * Derived planners that support this should only modify the
+         * given ppi and poolOfNextPolicies (and the statistics kept by
+         * SetCBGbounds()) from ConstructAndValuateNextPolicies(). The
+         * default is false, in which case SetNrConcurrentExpansions() has
+         * no effect.
+         */
+        virtual bool CanExpandConcurrently() const
+        { return(false); }
+
         void Prune(PartialPolicyPoolInterface& JPVs, size_t k);
 
+        /**\brief Computes the bounds on the value of the CBG that is
+         * constructed for ppi.
+         *
+         * These are the bounds that SetCBGbounds() passes to the BG
+         * solver (-DBL_MAX and DBL_MAX when GMAA_SET_CBG_BOUNDS is 0).
+         */
+        void GetCBGbounds(const boost::shared_ptr<PartialPolicyPoolItemInterface> &ppi,
+                          bool is_last_ts,
+                          double discount,
+                          double &CBGlowerbound,
+                          double &CBGupperbound) const
+        {
+            CBGlowerbound=-DBL_MAX;
+            CBGupperbound=DBL_MAX;
+#if GMAA_SET_CBG_BOUNDS
+            double pastReward_prevTs = ppi->GetJPol()->GetPastReward();
+            CBGlowerbound=GetMaxLowerBound() - pastReward_prevTs;
+            if(is_last_ts && discount==1.0)
+                CBGupperbound= ppi->GetValue() - pastReward_prevTs;
+#endif
+        }
+
         //template<class JP>
         void SetCBGbounds(const boost::shared_ptr<PartialPolicyPoolItemInterface> &ppi,
                           const boost::shared_ptr<BayesianGameIdenticalPayoffSolver> &bgips,
@@ -282,10 +368,8 @@ class GeneralizedMAAStarPlanner :
             size_t ts = ppi->GetJPol()->GetDepth();
             double pastReward_prevTs = ppi->GetJPol()->GetPastReward();
 #if GMAA_SET_CBG_BOUNDS
-            double CBGlowerbound=GetMaxLowerBound() - pastReward_prevTs;
-            double CBGupperbound=DBL_MAX;
-            if(is_last_ts && discount==1.0)
-                CBGupperbound= ppi->GetValue() - pastReward_prevTs;
+            double CBGlowerbound, CBGupperbound;
+            GetCBGbounds(ppi,is_last_ts,discount,CBGlowerbound,CBGupperbound);
             bgips->SetCBGlowerBound(CBGlowerbound);
             bgips->SetCBGupperBound(CBGupperbound);
             
@@ -297,6 +381,8 @@ class GeneralizedMAAStarPlanner :
                           << " pastR " << pastReward_prevTs << std::endl;
 #endif
             //in the worst case this is the number of children that will be expanded:
+#pragma omp critical(GeneralizedMAAStarPlanner_SetCBGbounds)
+            {
             if(_m_max_expanded_childs.size()<=ts)
                 _m_max_expanded_childs.resize(ts+1,0);
 
@@ -307,6 +393,7 @@ class GeneralizedMAAStarPlanner :
                 std::cout << "GeneralizedMAAStarPlanner: Warning, joint policy indices are overflowing, max expanded children will be set to 0" << std::endl;
                 _m_max_expanded_childs.at(ts) = 0;
             }
+            }
 
         }
         
@@ -334,6 +421,50 @@ class GeneralizedMAAStarPlanner :
         void SetSaveAllBGs(const std::string &filename)
             { _m_bgBaseFilename=filename; }
         void SetVerbose(int verbose);
+        /**\brief Sets the number of policy pool items that Plan() expands
+         * at once.
+         *
+         * When n>1, the planner supports it (see CanExpandConcurrently())
+         * and more than one thread is available (configure
+         * --enable-openmp), each iteration of Plan() expands the n
+         * best-ranked items concurrently. The default is 1.
+         */
+        void SetNrConcurrentExpansions(size_t n);
+        size_t GetNrConcurrentExpansions() const
+            { return(_m_nrConcurrentExpansions); }
+        /**\brief Sets the memory budget (in bytes) of the policy pool.
+         *
+         * When non-zero, the main policy pool of Plan() is a
+         * PolicyPoolPartialJPolValPairSpilling, which moves the
+         * lowest-ranked partial joint policies to disk once the budget is
+         * exceeded. The temporary pools of an expansion are always kept in
+         * memory. The default is 0, i.e., the pool is kept in memory.
+         */
+        void SetPolicyPoolMemoryBudget(size_t bytes)
+            { _m_policyPoolMemoryBudget=bytes; }
+        /**\brief Sets whether the BGs only store the utilities of the
+         * joint types with a positive probability.
+         *
+         * When true, planners that construct a BayesianGameForDecPOMDPStage
+         * (GMAA_MAAstar, GMAA_kGMAA) remap its dense utility table to the
+         * joint types with positive probability (see
+         * BayesianGameIdenticalPayoff::RemapUtilitiesToPositiveProbabilityTypes()),
+         * which saves memory when many joint types are unreachable under
+         * the past policy. The default is false.
+         */
+        void SetCompactBGs(bool compact)
+            { _m_compactBGs=compact; }
+        /**\brief Sets a cache of BG solutions.
+         *
+         * Planners that solve each CBG completely (GMAA_kGMAA) look up
+         * the CBG in the cache before solving it, and store its solutions
+         * afterwards. The cache can be shared with other planners (or a
+         * QBG heuristic). By default no cache is used.
+         */
+        void SetBGSolutionCache(const boost::shared_ptr<BGIP_SolutionCache> &cache)
+            { _m_bgSolutionCache=cache; }
+        boost::shared_ptr<BGIP_SolutionCache> GetBGSolutionCache() const
+            { return(_m_bgSolutionCache); }
 
         void Plan();
         
@@ -22,6 +22,8 @@
 #include "PartialJointPolicyPureVector.h"
 #include "PartialJPDPValuePair.h"
 #include "PolicyPoolPartialJPolValPair.h"
+#include "TGet.h"
+#include "OGet.h"
 
 //#include "JointObservationHistoryTree.h"
 //#include "JointBeliefInterface.h"
@@ -123,3 +125,15 @@ NewPP() const
 {
     return PartialPolicyPoolInterface_sharedPtr(new PolicyPoolPartialJPolValPair);
 }
+
+bool GeneralizedMAAStarPlannerForDecPOMDPDiscrete::
+CanConstructBGsConcurrently() const
+{
+    const MultiAgentDecisionProcessDiscreteInterface* madp = GetMADPDI();
+    TGet* T = madp->GetTGet();
+    OGet* O = madp->GetOGet();
+    bool flat = (T != 0 && O != 0);
+    delete T;
+    delete O;
+    return(flat);
+}
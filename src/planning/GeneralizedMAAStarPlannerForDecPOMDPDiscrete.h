@@ -111,6 +111,16 @@ class GeneralizedMAAStarPlannerForDecPOMDPDiscrete :
 
         double GetHeuristicQ(Index joahI, Index jaI) const;
 
+        /**\brief Whether BGs for different past joint policies can be
+         * constructed concurrently.
+         *
+         * This requires the flat transition and observation models of the
+         * problem (computing them on the fly, e.g., from a 2DBN, is not
+         * thread safe). Derived planners can use this to implement
+         * CanExpandConcurrently().
+         */
+        bool CanConstructBGsConcurrently() const;
+
         //using GeneralizedMAAStarPlanner::SetCBGbounds;
         /** Function to set the bounds of the CBG.
          *
@@ -126,6 +136,16 @@ class GeneralizedMAAStarPlannerForDecPOMDPDiscrete :
             bool is_last_ts = (ts ==  GetHorizon() - 1);
             this->GeneralizedMAAStarPlanner::SetCBGbounds(ppi,bgips,is_last_ts,GetDiscount());
         }
+        /// Computes the bounds that SetCBGbounds() would set for ppi.
+        void GetCBGbounds(const boost::shared_ptr<PartialPolicyPoolItemInterface> &ppi,
+                          double &CBGlowerbound,
+                          double &CBGupperbound) const
+        {
+            size_t ts = ppi->GetJPol()->GetDepth();
+            bool is_last_ts = (ts ==  GetHorizon() - 1);
+            this->GeneralizedMAAStarPlanner::GetCBGbounds(ppi,is_last_ts,GetDiscount(),
+                                                          CBGlowerbound,CBGupperbound);
+        }
 
     public:
         // Constructor, destructor and copy assignment.
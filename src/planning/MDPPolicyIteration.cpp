@@ -16,20 +16,27 @@
 
 
 #include <fstream>
-#include <time.h>
 #include "directories.h"
 #include "PlanningUnitDecPOMDPDiscrete.h"
-#include "TransitionModelMapping.h"
-#include "TransitionModelMappingSparse.h"
 #include "MDPPolicyIteration.h"
-//#include "SystemOfLinearEquationsSolver.h"
+#include "MDPValueIteration.h"
+#include "MDPTransitionRows.h"
+#include "QFunctionCache.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 #define DEBUG_MDPPolicyIteration 0
 
 
 MDPPolicyIteration::MDPPolicyIteration(const PlanningUnitDecPOMDPDiscrete& pu) :
-    MDPSolver(pu)
+    MDPSolver(pu),
+    _m_evaluationType(PI_MODIFIED),
+    _m_nrEvaluationSweeps(20),
+    _m_tolerance(1e-4),
+    _m_nrThreads(1)
 {
     _m_initialized = false;
 }
@@ -94,197 +101,304 @@ void MDPPolicyIteration::SetQTable(const QTable &Q, Index time_step)
     _m_QValues[time_step]=Q;
 }
 
-void MDPPolicyIteration::Plan()
+void MDPPolicyIteration::PlanWithCache(bool computeIfNotCached)
 {
-    PlanSlow();
-}
-
-void MDPPolicyIteration::PlanWithCache(bool computeIfNotCached){}
+    if(!_m_initialized)
+        Initialize();
 
-void MDPPolicyIteration::PlanWithCache(const string &filenameCache,
-        bool computeIfNotCached){}
+    stringstream ss;
+    ss << directories::MADPGetResultsDir("GMAA",GetPU()) << "/MDPPIQtable";
+    if(_m_finiteHorizon)
+        ss << "_h" << GetPU()->GetHorizon();
+    string filenameCache=ss.str();
 
+    PlanWithCache(filenameCache,computeIfNotCached);
+}
 
+void MDPPolicyIteration::PlanWithCache(const string &filenameCache,
+                                       bool computeIfNotCached)
+{
+    if(!_m_initialized)
+        Initialize();
 
+    // the cache is only used if it was computed for this model
+    stringstream ssDescr;
+    ssDescr << "MDPPolicyIteration tolerance " << _m_tolerance;
+    QFunctionCache cache(GetPU(),ssDescr.str());
+    size_t nrTables=_m_finiteHorizon ? GetPU()->GetHorizon() : 1;
+    bool cached=cache.Load(filenameCache,
+                           GetPU()->GetNrStates(),
+                           GetPU()->GetNrJointActions(),
+                           nrTables,
+                           _m_QValues);
+
+    if(!cached && !computeIfNotCached)
+    {
+        stringstream ss;
+        ss << "MDPPolicyIteration::PlanWithCache: "
+           << filenameCache << " not cached, bailing out";
+        throw(E(ss.str()));
+    }
 
+    // Couldn't load cache file, so compute
+    if(!cached)
+    {
+        Plan();
+        cache.Save(_m_QValues,filenameCache);
+    }
+}
 
-void MDPPolicyIteration::PlanSlow()
+void MDPPolicyIteration::Plan()
 {
-	printf("Initialize the problem\n");
     if(!_m_initialized)
         Initialize();
 
     StartTimer("Plan");
 
-    size_t horizon = GetPU()->GetHorizon();
+    if(_m_finiteHorizon)
+    {
+        // policy iteration over the stages amounts to backward induction
+        MDPValueIteration vi(*GetPU());
+        vi.Plan();
+        _m_QValues=vi.GetQTables();
+    }
+    else
+        PlanInfiniteHorizon();
+
+    StopTimer("Plan");
+
+#if DEBUG_MDPPolicyIteration
+    PrintTimersSummary();
+#endif
+}
+
+bool MDPPolicyIteration::ComputeConcurrently() const
+{
+#ifdef _OPENMP
+    return(_m_nrThreads > 1 && !omp_in_parallel());
+#else
+    return(false);
+#endif
+}
+
+void MDPPolicyIteration::PlanInfiniteHorizon()
+{
     size_t nrS = GetPU()->GetNrStates();
     size_t nrJA =  GetPU()->GetNrJointActions();
+    double gamma=GetPU()->GetDiscount();
+    bool parallel=ComputeConcurrently();
+    int nrThreads=static_cast<int>(_m_nrThreads);
 
-    double R_i,R_f,maxQsuc;
+    StartTimer("CacheTransitionModel");
+    MDPTransitionRows T(*GetPU());
+    StopTimer("CacheTransitionModel");
 
     // cache immediate reward for speed
     QTable immReward(nrS,nrJA);
-    printf("Get immediate reward...");
-    for(Index sI = 0; sI < nrS; sI++){
-        for(Index jaI = 0; jaI < nrJA; jaI++){
+    for(Index sI = 0; sI < nrS; sI++)
+        for(Index jaI = 0; jaI < nrJA; jaI++)
             immReward(sI,jaI)=GetPU()->GetReward(sI, jaI);
+
+    // start from the policy and values of the current Q-values, which
+    // are 0 unless set by SetQTable()
+    QTable &Q=_m_QValues[0];
+    vector<Index> policy(nrS);
+    vector<double> V(nrS), r(nrS);
+    for(Index sI = 0; sI < nrS; sI++)
+    {
+        policy[sI]=0;
+        for(Index jaI = 1; jaI < nrJA; jaI++)
+            if(Q(sI,jaI) > Q(sI,policy[sI]))
+                policy[sI]=jaI;
+        V[sI]=Q(sI,policy[sI]);
+    }
+
+    size_t nrIterations=0;
+    bool stable=false;
+    double residual=DBL_MAX;
+    while(true)
+    {
+        StartTimer("Iteration");
+        nrIterations++;
+
+        StartTimer("Evaluation");
+        for(Index sI = 0; sI < nrS; sI++)
+            r[sI]=immReward(sI,policy[sI]);
+        switch(_m_evaluationType)
+        {
+        case PI_MODIFIED:
+            EvaluateBySweeps(T,policy,r,V);
+            break;
+        case PI_BICGSTAB:
+            EvaluateByBiCGSTAB(T,policy,r,V);
+            break;
         }
+        StopTimer("Evaluation");
+
+        // improvement: make the policy greedy with respect to V, keeping
+        // the current action on ties
+        StartTimer("Improvement");
+        stable=true;
+        residual=0;
+        long nrStates=static_cast<long>(nrS);
+#pragma omp parallel for schedule(static) num_threads(nrThreads) \
+    reduction(max:residual) reduction(&&:stable) if(parallel)
+        for(long s = 0; s < nrStates; s++)
+        {
+            Index sI=s;
+            for(Index jaI = 0; jaI < nrJA; jaI++)
+                Q(sI,jaI) = immReward(sI,jaI) +
+                    gamma*T.Expectation(sI,jaI,V);
+            Index best=policy[sI];
+            for(Index jaI = 0; jaI < nrJA; jaI++)
+                if(Q(sI,jaI) > Q(sI,best))
+                    best=jaI;
+            if(best!=policy[sI])
+                stable=false;
+            residual=std::max(residual,std::abs(Q(sI,best)-V[sI]));
+            policy[sI]=best;
+        }
+        StopTimer("Improvement");
+        StopTimer("Iteration");
+
+#if DEBUG_MDPPolicyIteration
+        cout << "MDPPolicyIteration iteration " << nrIterations
+             << " residual " << residual
+             << (stable ? " stable" : "") << endl;
+#endif
+
+        if(residual <= _m_tolerance ||
+           (stable && _m_evaluationType==PI_BICGSTAB))
+            break;
     }
-    printf("Done.\n");
+}
 
+void MDPPolicyIteration::MultiplyPolicyMatrix(const MDPTransitionRows &T,
+                                              const vector<Index> &policy,
+                                              const vector<double> &x,
+                                              vector<double> &y) const
+{
+    double gamma=GetPU()->GetDiscount();
+    bool parallel=ComputeConcurrently();
+    int nrThreads=static_cast<int>(_m_nrThreads);
+    long nrStates=static_cast<long>(x.size());
+#pragma omp parallel for schedule(static) num_threads(nrThreads) if(parallel)
+    for(long s = 0; s < nrStates; s++)
+        y[s]=x[s]-gamma*T.Expectation(s,policy[s],x);
+}
 
+void MDPPolicyIteration::EvaluateBySweeps(const MDPTransitionRows &T,
+                                          const vector<Index> &policy,
+                                          const vector<double> &r,
+                                          vector<double> &v) const
+{
+    double gamma=GetPU()->GetDiscount();
+    bool parallel=ComputeConcurrently();
+    int nrThreads=static_cast<int>(_m_nrThreads);
+    long nrStates=static_cast<long>(v.size());
+    vector<double> vNew(v.size());
+    for(size_t k = 0; k < _m_nrEvaluationSweeps; k++)
+    {
+#pragma omp parallel for schedule(static) num_threads(nrThreads) if(parallel)
+        for(long s = 0; s < nrStates; s++)
+            vNew[s]=r[s]+gamma*T.Expectation(s,policy[s],v);
+        v.swap(vNew);
+    }
+}
 
-    if(_m_finiteHorizon)
+static double Dot(const vector<double> &x, const vector<double> &y)
+{
+    double sum=0;
+    for(size_t i = 0; i < x.size(); i++)
+        sum+=x[i]*y[i];
+    return(sum);
+}
+
+static double MaxNorm(const vector<double> &x)
+{
+    double norm=0;
+    for(size_t i = 0; i < x.size(); i++)
+        norm=std::max(norm,std::abs(x[i]));
+    return(norm);
+}
+
+size_t MDPPolicyIteration::EvaluateByBiCGSTAB(const MDPTransitionRows &T,
+                                              const vector<Index> &policy,
+                                              const vector<double> &b,
+                                              vector<double> &x) const
+{
+    size_t nrS=x.size();
+    double gamma=GetPU()->GetDiscount();
+
+    // Jacobi preconditioner: the diagonal of I-gamma*T_pi
+    vector<double> invDiag(nrS);
+    for(Index sI = 0; sI < nrS; sI++)
     {
-        throw(E("Sorry this function does not support finite horizon now"));
+        double d=1.0;
+        for(size_t e=T.RowBegin(sI,policy[sI]);e!=T.RowEnd(sI,policy[sI]);++e)
+            if(T.GetSuccessor(e)==sI)
+                d-=gamma*T.GetProbability(e);
+        invDiag[sI]=1.0/d;
     }
-    else // infinite horizon problem
+
+    // the error of x is at most the residual divided by 1-gamma, so this
+    // keeps it well below the tolerance of the Bellman residual
+    double tol=0.01*_m_tolerance*(1-gamma);
+
+    vector<double> r(nrS), rHat, p(nrS,0.0), v(nrS,0.0), y(nrS), s(nrS),
+        z(nrS), t(nrS);
+    MultiplyPolicyMatrix(T,policy,x,r);
+    for(Index i = 0; i < nrS; i++)
+        r[i]=b[i]-r[i];
+    rHat=r;
+    double rho=1, alpha=1, omega=1;
+
+    size_t maxIterations=std::max(nrS,static_cast<size_t>(1000));
+    size_t it;
+    for(it = 0; it < maxIterations && MaxNorm(r) > tol; it++)
     {
-        double maxDelta=DBL_MAX;
-        double gamma=GetPU()->GetDiscount();
-
-
-        // in infinite-horizon case, it is typically worth to cache
-        // the transition model
-        typedef boost::numeric::ublas::compressed_matrix<double> CMatrix;
-        vector<CMatrix*> T;
-        CMatrix *Ta;
-        double p;
-        printf("Get transition model...");
-        for(unsigned int a=0;a!=nrJA;++a)
+        double rhoNew=Dot(rHat,r);
+        if(rhoNew==0) // breakdown, restart from the current x
         {
-        	//printf("a%d:\n",a);
-#if DEBUG_MDPPolicyIteration
-            PrintTimersSummary();
-#endif
-            StartTimer("CacheTransitionModel");
-            Ta=new CMatrix(nrS,nrS);
-
-            for(unsigned int s=0;s!=nrS;++s)
-            {
-                for(unsigned int s1=0;s1!=nrS;++s1)
-                {
-                    p=GetPU()->GetTransitionProbability(s,a,s1);
-
-                    (*Ta)(s,s1)=p;
-                    double sss = (*Ta)(s,s1);
-                }
-            }
-
-            T.push_back(Ta);
-            StopTimer("CacheTransitionModel");
+            rHat=r;
+            rhoNew=Dot(rHat,r);
+            std::fill(p.begin(),p.end(),0.0);
+            std::fill(v.begin(),v.end(),0.0);
+            rho=alpha=omega=1;
         }
-        printf("Done.\n");
-
-        //Initialize state values
-        double *SV = (double *)malloc(sizeof(double)*nrS);
-        for(int i = 0; i < nrS; i++)
-        	SV[i] = 0;
-
-        //Initialize a random policy
-        vector<int> policy;
-        srand(time(NULL));
-        for(int sI = 0; sI != nrS; ++sI)
+        double beta=(rhoNew/rho)*(alpha/omega);
+        for(Index i = 0; i < nrS; i++)
         {
-        	int aI;
-        	aI = (rand() % nrJA);
-        	policy.push_back(aI);
+            p[i]=r[i]+beta*(p[i]-omega*v[i]);
+            y[i]=invDiag[i]*p[i];
         }
-
-        //Initialize policy-statable flag
-        bool psf = 0;
-        const double THETA = 0.0001;
-        double delta;
-        //Set a small positive number as number flag to prevent from 0.8273 > 0.8273 due to a 0.0000001 error. If a - b > NUM_FLAG, we think that a > b.
-        const double NUM_FLAG = 0.001;
-
-        //Set timer.
-        int num_iter = 0;
-        time_t eva_start, eva_end, imp_end;
-        double time_eva, time_imp, time_iter,time_total;
-        double total_eva = 0;
-        double total_imp = 0;
-
-        //Policy iteration
-        while(psf == 0){
-        	//policy evaluation
-        	num_iter += 1;
-        	eva_start = clock();
-        	do
-        	{
-        		delta = 0;
-        		for(int s1I = 0; s1I != nrS; ++s1I)
-        		{
-        			double v = SV[s1I];
-        			int actionIndex = policy[s1I];
-        			double new_v = 0;
-        			double r = immReward(s1I, actionIndex);
-        			for(int s2I = 0; s2I !=nrS; ++s2I)
-        			{
-        				double tp = (*T[actionIndex])(s1I,s2I);
-        				if(tp != 0)
-        					new_v += tp * (r + gamma * SV[s2I]);
-        			}
-        			SV[s1I] = new_v;
-        			delta = std::max(delta, std::abs(v - SV[s1I]));
-        		}
-
-        	}while(delta > THETA);
-
-
-        	eva_end = clock();
-        	//Policy improvement
-        	psf = 1;
-        	for(int s1I = 0; s1I != nrS; ++s1I)
-        	{
-        		double ba = SV[s1I];
-        		for(int aI = 0; aI != nrJA; ++aI)
-        		{
-        			double qa = 0;
-        			double r = immReward(s1I, aI);
-        			for(int s2I = 0; s2I != nrS; ++s2I)
-        			{
-        				double tp = (*T[aI])(s1I,s2I);
-        				if(tp != 0)
-        					qa += tp * (r + gamma * SV[s2I]);
-        			}
-        			if(qa - ba > NUM_FLAG)
-        			{
-        				psf = 0;
-        				ba = qa;
-        				policy[s1I] = aI;
-        			}
-
-        		}
-
-        	}
-
-        	imp_end = clock();
-        	time_eva = (double)(eva_end - eva_start)/CLOCKS_PER_SEC;
-        	time_imp = (double)(imp_end - eva_end)/CLOCKS_PER_SEC;
-        	time_iter = time_eva + time_imp;
-        	total_eva += time_eva;
-        	total_imp += time_imp;
-        	printf("Iter:%d %f %f %f\n",num_iter, time_eva, time_imp, time_iter);
-
+        MultiplyPolicyMatrix(T,policy,y,v);
+        alpha=rhoNew/Dot(rHat,v);
+        for(Index i = 0; i < nrS; i++)
+            s[i]=r[i]-alpha*v[i];
+        if(MaxNorm(s) <= tol)
+        {
+            for(Index i = 0; i < nrS; i++)
+                x[i]+=alpha*y[i];
+            r.swap(s);
+            it++;
+            break;
         }
-        time_total = total_eva + total_imp;
-        printf("Normal policy iteration completed...\n");
-        for(int i=0; i<nrS; i++)
+        for(Index i = 0; i < nrS; i++)
+            z[i]=invDiag[i]*s[i];
+        MultiplyPolicyMatrix(T,policy,z,t);
+        omega=Dot(t,s)/Dot(t,t);
+        for(Index i = 0; i < nrS; i++)
         {
-        	printf("State %d: %f, %d  ", i, SV[i], policy[i]);
+            x[i]+=alpha*y[i]+omega*z[i];
+            r[i]=s[i]-omega*t[i];
         }
-        printf("\n");
-        printf("States: %d  Actions: %d\n",nrS, nrJA);
-        printf("Total policy iteration time: %f\nTotal policy evaluation time: %f\nTotal policy improvement time: %f\nNumber of iterations: %d\n", time_total, total_eva, total_imp,num_iter);
-
-        for(unsigned int a=0;a!=nrJA;++a)
-            delete T[a];
+        rho=rhoNew;
     }
 
-    StopTimer("Plan");
-
 #if DEBUG_MDPPolicyIteration
-    PrintTimersSummary();
+    cout << "MDPPolicyIteration::EvaluateByBiCGSTAB " << it
+         << " iterations, residual " << MaxNorm(r) << endl;
 #endif
+    return(it);
 }
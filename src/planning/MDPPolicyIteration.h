@@ -24,9 +24,33 @@
 
 #include "MDPSolver.h"
 #include "TimedAlgorithm.h"
+#include "MDPPolicyIterationEvaluationType.h"
 
-/**\brief MDPPolicyIteration implements policy iteration for MDPs via GPU.
-  */
+class MDPTransitionRows;
+
+/**\brief MDPPolicyIteration implements (modified) policy iteration for
+ * MDPs.
+ *
+ * Starting from the policy that is greedy with respect to the current
+ * Q-values, it alternates evaluating the policy and making it greedy with
+ * respect to the resulting values. The evaluation type selects how the
+ * policy is evaluated:
+ * - PI_MODIFIED (default): a fixed number of sweeps v=r_pi+gamma*T_pi*v
+ *   (modified policy iteration), after which the policy is improved,
+ * - PI_BICGSTAB: solves (I-gamma*T_pi)v=r_pi with BiCGSTAB, using the
+ *   diagonal of I-gamma*T_pi as preconditioner.
+ * Both work on the compressed transition rows of MDPTransitionRows and
+ * start from the values of the previous policy. Planning stops when the
+ * Bellman residual of the values drops to the tolerance (1e-4 by
+ * default), or when the policy no longer changes after an exact
+ * evaluation.
+ *
+ * When compiled with OpenMP, nrThreads > 1 computes the matrix-vector
+ * products with that many threads.
+ *
+ * Finite-horizon problems are solved by backward induction, for which
+ * MDPValueIteration is used.
+ */
 class MDPPolicyIteration : public MDPSolver,
     public TimedAlgorithm
 {
@@ -37,35 +61,66 @@ private:
      * t (time-to-go = horizon - t). */
     QTables _m_QValues;
 
-    /**Is the MDPValueIteration object initialized?.*/
+    /**Is the MDPPolicyIteration object initialized?.*/
     bool _m_initialized;
 
     /// Are we solving a finite-horizon problem?
     bool _m_finiteHorizon;
 
-    void Initialize();
+    /// How the policies are evaluated.
+    MDPPolicyIterationEvaluationType _m_evaluationType;
+
+    /// The number of sweeps per evaluation of PI_MODIFIED.
+    size_t _m_nrEvaluationSweeps;
 
-    /**Vector<const M*> T is the vector of matrices specifying the transition
-       model (one matrix for each joint action). */
-    template <class M>
-    void Plan(std::vector<const M*> T);
+    /// The Bellman residual at which planning stops.
+    double _m_tolerance;
 
+    /// The number of threads that compute the matrix-vector products.
+    size_t _m_nrThreads;
+
+    void Initialize();
+
+    /// Computes _m_QValues[0] of an infinite-horizon problem.
+    void PlanInfiniteHorizon();
+
+    /// Applies sweeps v=r_pi+gamma*T_pi*v.
+    void EvaluateBySweeps(const MDPTransitionRows &T,
+                          const std::vector<Index> &policy,
+                          const std::vector<double> &r,
+                          std::vector<double> &v) const;
+    /// Solves (I-gamma*T_pi)v=r with preconditioned BiCGSTAB, starting
+    /// from v. Returns the number of iterations.
+    size_t EvaluateByBiCGSTAB(const MDPTransitionRows &T,
+                              const std::vector<Index> &policy,
+                              const std::vector<double> &r,
+                              std::vector<double> &v) const;
+    /// Sets y=(I-gamma*T_pi)x.
+    void MultiplyPolicyMatrix(const MDPTransitionRows &T,
+                              const std::vector<Index> &policy,
+                              const std::vector<double> &x,
+                              std::vector<double> &y) const;
+
+    /// Whether the matrix-vector products use several threads.
+    bool ComputeConcurrently() const;
 
 protected:
 
 public:
     // Constructor, destructor and copy assignment.
     /// (default) Constructor
-    MDPPolicyIteration(){};
+    MDPPolicyIteration() :
+        _m_initialized(false),
+        _m_evaluationType(PI_MODIFIED),
+        _m_nrEvaluationSweeps(20),
+        _m_tolerance(1e-4),
+        _m_nrThreads(1)
+        {};
 
     MDPPolicyIteration(const PlanningUnitDecPOMDPDiscrete& pu);
     /// Destructor.
     ~MDPPolicyIteration();
 
-    /// Uses the GetTransitionProbability() interface, which is slow.
-    void PlanSlow();
-
-
     void Plan();
 
     void PlanWithCache(bool computeIfNotCached=true);
@@ -87,10 +142,22 @@ public:
     void SetQTables(const QTables &Qs);
     void SetQTable(const QTable &Q, Index time_step);
 
+    MDPPolicyIterationEvaluationType GetEvaluationType() const
+        { return(_m_evaluationType); }
+    void SetEvaluationType(MDPPolicyIterationEvaluationType evaluationType)
+        { _m_evaluationType=evaluationType; }
+    size_t GetNrEvaluationSweeps() const { return(_m_nrEvaluationSweeps); }
+    void SetNrEvaluationSweeps(size_t nrSweeps)
+        { _m_nrEvaluationSweeps=nrSweeps; }
+    double GetTolerance() const { return(_m_tolerance); }
+    void SetTolerance(double tolerance) { _m_tolerance=tolerance; }
+    size_t GetNrThreads() const { return(_m_nrThreads); }
+    void SetNrThreads(size_t nrThreads) { _m_nrThreads=nrThreads; }
+
 };
 
 
-#endif /* !_MDPVALUEITERATION_H_ */
+#endif /* !_MDPPOLICYITERATION_H_ */
 
 // Local Variables: ***
 // mode:c++ ***
@@ -0,0 +1,24 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek 
+ * Matthijs Spaan 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#ifndef _MDPPOLICYITERATIONEVALUATIONTYPE_H_
+#define _MDPPOLICYITERATIONEVALUATIONTYPE_H_ 1
+
+/// How MDPPolicyIteration evaluates the current policy.
+enum MDPPolicyIterationEvaluationType { PI_MODIFIED,
+                                        PI_BICGSTAB
+};
+
+#endif /* !_MDPPOLICYITERATIONEVALUATIONTYPE_H_ */
@@ -0,0 +1,180 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "MDPTransitionRows.h"
+#include "PlanningUnitDecPOMDPDiscrete.h"
+#include "TransitionModelMapping.h"
+#include "TransitionModelMappingSparse.h"
+#include "TransitionModelTOI.h"
+#include "MultiAgentDecisionProcessDiscreteFactoredStates.h"
+#include "FactoredFlatModelEvaluator.h"
+
+using namespace std;
+
+MDPTransitionRows::MDPTransitionRows(const PlanningUnitDecPOMDPDiscrete &pu) :
+    _m_nrStates(pu.GetNrStates()),
+    _m_nrActions(pu.GetNrJointActions())
+{
+    _m_rowStart.reserve(_m_nrStates*_m_nrActions+1);
+    _m_rowStart.push_back(0);
+
+    const TransitionModelMappingSparse *tms=0;
+    const TransitionModelMapping *tm=0;
+    const TransitionModelTOI *ttoi=0;
+    const TransitionModelDiscrete *tmd=pu.GetTransitionModelDiscretePtr();
+    const MultiAgentDecisionProcessDiscreteFactoredStates *fmadp=
+        dynamic_cast<const MultiAgentDecisionProcessDiscreteFactoredStates *>(
+            pu.GetDPOMDPD());
+
+    if(tmd==0 && fmadp && fmadp->GetFlatModelEvaluator())
+        AddSuccessorRows(*fmadp->GetFlatModelEvaluator());
+    else if(tmd==0)
+        AddRowsSlow(pu); // just use GetTransitionProbability()
+    else if((tms=dynamic_cast<const TransitionModelMappingSparse *>(tmd)))
+    {
+        vector<const TransitionModelMappingSparse::SparseMatrix *> T;
+        for(Index a=0;a!=_m_nrActions;++a)
+            T.push_back(tms->GetMatrixPtr(a));
+        AddRows(T);
+    }
+    else if((tm=dynamic_cast<const TransitionModelMapping *>(tmd)))
+    {
+        vector<const TransitionModelMapping::Matrix *> T;
+        for(Index a=0;a!=_m_nrActions;++a)
+            T.push_back(tm->GetMatrixPtr(a));
+        AddRows(T);
+    }
+    else if((ttoi=dynamic_cast<const TransitionModelTOI *>(tmd)))
+        AddSuccessorRows(*ttoi);
+    else
+        throw(E("MDPTransitionRows: TransitionModelDiscretePtr not handled"));
+}
+
+template <class M>
+void MDPTransitionRows::AddRows(const vector<const M*> &T)
+{
+    for(Index a=0;a!=_m_nrActions;++a)
+    {
+        // the iterators skip rows without entries (for sparse matrices),
+        // so rows are filled in as they are encountered
+        Index sNext=0;
+        for(typename M::const_iterator1 ri=T[a]->begin1();
+            ri!=T[a]->end1(); ++ri)
+        {
+            for(;sNext < ri.index1();++sNext)
+                _m_rowStart.push_back(_m_successor.size());
+            for(typename M::const_iterator2 ci=ri.begin(); ci!=ri.end(); ++ci)
+                if(*ci>0)
+                {
+                    _m_successor.push_back(ci.index2());
+                    _m_probability.push_back(*ci);
+                }
+            _m_rowStart.push_back(_m_successor.size());
+            sNext=ri.index1()+1;
+        }
+        for(;sNext < _m_nrStates;++sNext)
+            _m_rowStart.push_back(_m_successor.size());
+    }
+}
+
+template <class M>
+void MDPTransitionRows::AddSuccessorRows(const M &T)
+{
+    vector<Index> sucSIs;
+    vector<double> probs;
+    for(Index a=0;a!=_m_nrActions;++a)
+        for(Index s=0;s!=_m_nrStates;++s)
+        {
+            T.GetSuccessors(s,a,sucSIs,probs);
+            for(Index k=0;k!=sucSIs.size();++k)
+            {
+                _m_successor.push_back(sucSIs[k]);
+                _m_probability.push_back(probs[k]);
+            }
+            _m_rowStart.push_back(_m_successor.size());
+        }
+}
+
+void MDPTransitionRows::AddRowsSlow(const PlanningUnitDecPOMDPDiscrete &pu)
+{
+    double p;
+    for(Index a=0;a!=_m_nrActions;++a)
+        for(Index s=0;s!=_m_nrStates;++s)
+        {
+            for(Index s1=0;s1!=_m_nrStates;++s1)
+            {
+                p=pu.GetTransitionProbability(s,a,s1);
+                if(p>0)
+                {
+                    _m_successor.push_back(s1);
+                    _m_probability.push_back(p);
+                }
+            }
+            _m_rowStart.push_back(_m_successor.size());
+        }
+}
+
+void MDPTransitionRows::BuildAliasTables()
+{
+    size_t nrEntries=_m_successor.size();
+    _m_aliasThreshold.assign(nrEntries,1.0);
+    _m_alias.resize(nrEntries);
+    for(size_t e=0;e!=nrEntries;++e)
+        _m_alias[e]=e;
+
+    vector<double> q;
+    vector<size_t> small, large;
+    size_t nrRows=_m_nrStates*_m_nrActions;
+    for(size_t row=0;row!=nrRows;++row)
+    {
+        size_t begin=_m_rowStart[row], end=_m_rowStart[row+1];
+        size_t n=end-begin;
+        if(n<2)
+            continue;
+
+        // scale the probabilities to average 1, normalizing rows that
+        // do not quite sum to 1
+        double sum=0;
+        for(size_t e=begin;e!=end;++e)
+            sum+=_m_probability[e];
+        q.resize(n);
+        small.clear();
+        large.clear();
+        for(size_t k=0;k!=n;++k)
+        {
+            q[k]=_m_probability[begin+k]*n/sum;
+            if(q[k]<1.0)
+                small.push_back(k);
+            else
+                large.push_back(k);
+        }
+        // pair each entry below 1 with one above, which donates the rest
+        while(!small.empty() && !large.empty())
+        {
+            size_t l=small.back(), g=large.back();
+            small.pop_back();
+            _m_aliasThreshold[begin+l]=q[l];
+            _m_alias[begin+l]=begin+g;
+            q[g]+=q[l]-1.0;
+            if(q[g]<1.0)
+            {
+                large.pop_back();
+                small.push_back(g);
+            }
+        }
+        // what remains is 1 up to rounding errors, and keeps its
+        // default threshold of 1
+    }
+}
@@ -0,0 +1,130 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _MDPTRANSITIONROWS_H_
+#define _MDPTRANSITIONROWS_H_ 1
+
+/* the include directives */
+#include <vector>
+#include <algorithm>
+#include "Globals.h"
+
+class PlanningUnitDecPOMDPDiscrete;
+class TransitionModelTOI;
+class FactoredFlatModelEvaluator;
+
+/**\brief MDPTransitionRows stores the transition model of an MDP as
+ * compressed rows: one row T(sI,jaI,.) per (joint action, state) pair,
+ * holding only the successor states with non-zero probability.
+ *
+ * The rows are stored jaI-major in three flat arrays (compressed sparse
+ * row format), regardless of whether the model stores its transitions in
+ * dense or sparse matrices, implicitly (TransitionModelTOI), as a 2DBN
+ * (FactoredFlatModelEvaluator, which enumerates only reachable
+ * successors), or only offers GetTransitionProbability().
+ * This gives the MDP solvers a single representation that can be
+ * traversed in any order (and by several threads), with the successors
+ * of each row in increasing order.
+ *
+ * After BuildAliasTables(), SampleSuccessor() draws a successor of a row
+ * in constant time with Walker's alias method.
+ */
+class MDPTransitionRows
+{
+private:
+
+    size_t _m_nrStates;
+    size_t _m_nrActions;
+    /// _m_rowStart[jaI*nrS+sI] is the first entry of row (sI,jaI)
+    std::vector<size_t> _m_rowStart;
+    /// the successor state of each entry
+    std::vector<Index> _m_successor;
+    /// the transition probability of each entry
+    std::vector<double> _m_probability;
+    /// the alias tables: entry e is sampled with probability
+    /// _m_aliasThreshold[e], otherwise entry _m_alias[e] is
+    std::vector<double> _m_aliasThreshold;
+    std::vector<size_t> _m_alias;
+
+    template <class M>
+    void AddRows(const std::vector<const M*> &T);
+    /// Adds the rows of a model that implements GetSuccessors().
+    template <class M>
+    void AddSuccessorRows(const M &T);
+    void AddRowsSlow(const PlanningUnitDecPOMDPDiscrete &pu);
+
+protected:
+
+public:
+    /// Constructor, which reads the transition model of pu.
+    MDPTransitionRows(const PlanningUnitDecPOMDPDiscrete &pu);
+
+    size_t GetNrStates() const { return(_m_nrStates); }
+    size_t GetNrActions() const { return(_m_nrActions); }
+    /// The number of non-zero entries.
+    size_t GetNrEntries() const { return(_m_successor.size()); }
+
+    /// The index of the first entry of row (sI,jaI).
+    size_t RowBegin(Index sI, Index jaI) const
+        { return(_m_rowStart[jaI*_m_nrStates+sI]); }
+    /// One past the index of the last entry of row (sI,jaI).
+    size_t RowEnd(Index sI, Index jaI) const
+        { return(_m_rowStart[jaI*_m_nrStates+sI+1]); }
+    Index GetSuccessor(size_t e) const { return(_m_successor[e]); }
+    double GetProbability(size_t e) const { return(_m_probability[e]); }
+
+    /// Returns sum_s' T(sI,jaI,s') v[s'].
+    double Expectation(Index sI, Index jaI,
+                       const std::vector<double> &v) const
+        {
+            double sum=0.0;
+            size_t end=RowEnd(sI,jaI);
+            for(size_t e=RowBegin(sI,jaI);e!=end;++e)
+                sum+=_m_probability[e]*v[_m_successor[e]];
+            return(sum);
+        }
+
+    /// Builds the alias tables used by SampleSuccessor().
+    void BuildAliasTables();
+    bool HasAliasTables() const { return(!_m_alias.empty() ||
+                                         _m_successor.empty()); }
+
+    /**Samples a successor of (sI,jaI), given u uniformly drawn from
+     * [0,1). Requires BuildAliasTables(). A row without successors
+     * returns sI. */
+    Index SampleSuccessor(Index sI, Index jaI, double u) const
+        {
+            size_t begin=RowBegin(sI,jaI);
+            size_t n=RowEnd(sI,jaI)-begin;
+            if(n==0)
+                return(sI);
+            double x=u*n;
+            size_t k=std::min(static_cast<size_t>(x),n-1);
+            size_t e=begin+k;
+            if(x-k < _m_aliasThreshold[e])
+                return(_m_successor[e]);
+            else
+                return(_m_successor[_m_alias[e]]);
+        }
+
+};
+
+
+#endif /* !_MDPTRANSITIONROWS_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
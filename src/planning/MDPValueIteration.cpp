@@ -17,8 +17,14 @@
 #include <fstream>
 #include "directories.h"
 #include "PlanningUnitDecPOMDPDiscrete.h"
-#include "TransitionModelMapping.h"
-#include "TransitionModelMappingSparse.h"
+#include <queue>
+#include <algorithm>
+#include "QFunctionCache.h"
+#include "MDPTransitionRows.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -26,7 +32,9 @@ using namespace std;
 
 //Default constructor
 MDPValueIteration::MDPValueIteration(const PlanningUnitDecPOMDPDiscrete& pu) :
-    MDPSolver(pu)
+    MDPSolver(pu),
+    _m_updateType(VI_JACOBI),
+    _m_tolerance(1e-4)
 {
     _m_initialized = false;
 }
@@ -86,15 +94,14 @@ void MDPValueIteration::PlanWithCache(const string &filenameCache,
     if(!_m_initialized)
         Initialize();
 
-    bool cached;
-
-    {
-        ifstream fp(filenameCache.c_str());
-        if(!fp)
-            cached=false;
-        else
-            cached=true;
-    }
+    // the cache is only used if it was computed for this model
+    QFunctionCache cache(GetPU(),GetCacheDescription());
+    size_t nrTables=_m_finiteHorizon ? GetPU()->GetHorizon() : 1;
+    bool cached=cache.Load(filenameCache,
+                           GetPU()->GetNrStates(),
+                           GetPU()->GetNrJointActions(),
+                           nrTables,
+                           _m_QValues);
 
     if(!cached && !computeIfNotCached)
     {
@@ -105,33 +112,22 @@ void MDPValueIteration::PlanWithCache(const string &filenameCache,
         return;
     }
 
-    // Couldn't open cache file, so compute
+    // Couldn't load cache file, so compute
     if(!cached)
     {
         Plan();
-        if(_m_finiteHorizon)
-            QTable::Save(_m_QValues,filenameCache);
-        else
-            QTable::Save(_m_QValues[0],filenameCache);
+        cache.Save(_m_QValues,filenameCache);
 
 #if DEBUG_MDPValueIteration
         cout << "MDPValueIteration::PlanWithCache saved Q values to "
              << filenameCache << endl;
 #endif
     }
-    else // load Q values from file
-    {
-        if(_m_finiteHorizon)
-            LoadQTables(filenameCache,GetPU()->GetHorizon(),_m_QValues);
-        else
-            LoadQTable(filenameCache,_m_QValues[0]);
-
 #if DEBUG_MDPValueIteration
+    else
         cout << "MDPValueIteration::PlanWithCache loaded Q values from "
              << filenameCache << endl;
 #endif
-
-    }
 }
 
 QTables MDPValueIteration::GetQTables() const
@@ -154,19 +150,19 @@ void MDPValueIteration::SetQTable(const QTable &Q, Index time_step)
     _m_QValues[time_step]=Q;
 }
 
-/** Duplication of code from the templatized version, but well... */
-void MDPValueIteration::PlanSlow()
+void MDPValueIteration::Plan()
 {
     if(!_m_initialized)
         Initialize();
 
     StartTimer("Plan");
 
-    size_t horizon = GetPU()->GetHorizon();
     size_t nrS = GetPU()->GetNrStates();
     size_t nrJA =  GetPU()->GetNrJointActions();
 
-    double R_i,R_f,maxQsuc;
+    StartTimer("CacheTransitionModel");
+    MDPTransitionRows T(*GetPU());
+    StopTimer("CacheTransitionModel");
 
     // cache immediate reward for speed
     QTable immReward(nrS,nrJA);
@@ -174,274 +170,254 @@ void MDPValueIteration::PlanSlow()
         for(Index jaI = 0; jaI < nrJA; jaI++)
             immReward(sI,jaI)=GetPU()->GetReward(sI, jaI);
 
-   
     if(_m_finiteHorizon)
+        PlanFiniteHorizon(T,immReward);
+    else
     {
-        for(size_t t = horizon - 1; true; t--)
+        switch(_m_updateType)
         {
-            for(Index sI = 0; sI < nrS; sI++)
-            {
-                for(Index jaI = 0; jaI < nrJA; jaI++)
-                {
-                    //calc. expected immediate reward
-                    R_i = immReward(sI,jaI);
-                    R_f = 0.0;
-                    if(t < horizon - 1)
-                    {
-                        //calc. expected future reward
-                        for(Index ssucI = 0; ssucI < nrS; ssucI++)
-                        {
-                            //find the best action at ssucI
-                            maxQsuc = -DBL_MAX;
-                            for(Index jasucI = 0; jasucI < nrJA; jasucI++)
-                                maxQsuc = max( _m_QValues[t+1](ssucI,jasucI),
-                                               maxQsuc);
-                            
-                            R_f += GetPU()->GetTransitionProbability(sI, jaI,
-                                                                     ssucI)
-                                * maxQsuc;
-                        }//done calc. expected future reward
-                    }
-                    _m_QValues[t](sI,jaI) = R_i + R_f;
-                }//end for jaI
-            }//end for sI
-            if(t == 0) //escape from (loop t is unsigned!)
-                break;
+        case VI_JACOBI:
+            PlanJacobi(T,immReward);
+            break;
+        case VI_GAUSS_SEIDEL:
+            PlanGaussSeidel(T,immReward);
+            break;
+        case VI_PRIORITIZED_SWEEPING:
+            PlanPrioritizedSweeping(T,immReward);
+            break;
         }
     }
-    else // infinite horizon problem
-    {
-        double maxDelta=DBL_MAX;
-        double gamma=GetPU()->GetDiscount();
-        QTable oldQtable;
-
-        // in infinite-horizon case, it is typically worth to cache
-        // the transition model
-        typedef boost::numeric::ublas::compressed_matrix<double> CMatrix;
-        vector<CMatrix*> T;
-        CMatrix *Ta;
-        double p;
-        for(unsigned int a=0;a!=nrJA;++a)
-        {
-#if DEBUG_MDPValueIteration
-            PrintTimersSummary();
-#endif
-            StartTimer("CacheTransitionModel");
-            Ta=new CMatrix(nrS,nrS);
-
-            for(unsigned int s=0;s!=nrS;++s)
-                for(unsigned int s1=0;s1!=nrS;++s1)
-                {
-                    p=GetPU()->GetTransitionProbability(s,a,s1);
-                    if(p>0)
-                        (*Ta)(s,s1)=p;
-                }
-
-            T.push_back(Ta);
-            StopTimer("CacheTransitionModel");
-        }
 
-        Index sI,ssucI;
-        while(maxDelta>1e-4)
-        {
-            StartTimer("Iteration");
-            maxDelta=0;
-            oldQtable=_m_QValues[0];
-            for(Index jaI = 0; jaI < nrJA; jaI++)
-            {
-                for(CMatrix::const_iterator1 ri=T[jaI]->begin1();
-                    ri!=T[jaI]->end1(); ++ri)
-                {
-                    sI=ri.index1();
-
-                    //calc. expected immediate reward
-                    R_i = immReward(sI,jaI);
-                    R_f = 0.0;
-                    //calc. expected future reward
-                    
-                    for (CMatrix::const_iterator2 ci = ri.begin();
-                         ci != ri.end(); ++ci)
-                    {
-                        ssucI=ci.index2();
-
-                        //find the best action at ssucI
-                        maxQsuc = -DBL_MAX;
-                        for(Index jasucI = 0; jasucI < nrJA; jasucI++)
-                            maxQsuc = max( oldQtable(ssucI,jasucI),
-                                           maxQsuc);
-                            
-                        R_f += *ci * maxQsuc;
-                    }//done calc. expected future reward
-
-                    _m_QValues[0](sI,jaI) = R_i + gamma*R_f;
-                    maxDelta=max(maxDelta,abs(oldQtable(sI,jaI)-
-                                              _m_QValues[0](sI,jaI)));
-                }//end for jaI
-            }//end for sI
-
-            StopTimer("Iteration");
+    StopTimer("Plan");
 
 #if DEBUG_MDPValueIteration
-            cout << "delta " << maxDelta << endl;
-            PrintTimersSummary();
+    PrintTimersSummary();
 #endif
-        }
+}
 
-        for(unsigned int a=0;a!=nrJA;++a)
-            delete T[a];
-    }
+bool MDPValueIteration::ComputeConcurrently() const
+{
+#ifdef _OPENMP
+    return(omp_get_max_threads() > 1 && !omp_in_parallel());
+#else
+    return(false);
+#endif
+}
 
-    StopTimer("Plan");
+string MDPValueIteration::GetCacheDescription() const
+{
+    // the Q-values of finite-horizon problems and of the default
+    // settings do not depend on the update type
+    if(_m_finiteHorizon || (_m_updateType==VI_JACOBI && _m_tolerance==1e-4))
+        return("MDPValueIteration");
 
-#if DEBUG_MDPValueIteration
-    PrintTimersSummary();
-#endif
+    stringstream ss;
+    ss << "MDPValueIteration update " << _m_updateType
+       << " tolerance " << _m_tolerance;
+    return(ss.str());
 }
 
-void MDPValueIteration::Plan()
+/// Sets V[s]=max_a Q(s,a) for all s.
+static void ComputeStateValues(const QTable &Q, vector<double> &V)
 {
-    if(!_m_initialized)
-        Initialize();
+    size_t nrS=Q.GetNrStates();
+    size_t nrJA=Q.GetNrActions();
+    for(Index sI = 0; sI < nrS; sI++)
+    {
+        double maxQ = -DBL_MAX;
+        for(Index jaI = 0; jaI < nrJA; jaI++)
+            maxQ = std::max( Q(sI,jaI), maxQ);
+        V[sI]=maxQ;
+    }
+}
 
-    StartTimer("Plan");
-    
+void MDPValueIteration::PlanFiniteHorizon(const MDPTransitionRows &T,
+                                          const QTable &immReward)
+{
+    size_t horizon = GetPU()->GetHorizon();
+    size_t nrS = GetPU()->GetNrStates();
     size_t nrJA =  GetPU()->GetNrJointActions();
-    const TransitionModelMappingSparse *tms=0;
-    const TransitionModelMapping *tm=0;
-    const TransitionModelDiscrete *tmd=
-        GetPU()->GetTransitionModelDiscretePtr();
-
-    if(tmd==0)
-        PlanSlow(); // just use GetTransitionProbability()
-    else if((tms=dynamic_cast<const TransitionModelMappingSparse *>(tmd)))
+    double gamma=GetPU()->GetDiscount();
+    bool parallel=ComputeConcurrently();
+
+    // V stores the value of the states at stage t+1
+    vector<double> V(nrS,0.0);
+    for(size_t t = horizon - 1; true; t--)
     {
-        std::vector<const TransitionModelMappingSparse::SparseMatrix *> T;
-        for(unsigned int a=0;a!=nrJA;++a)
-            T.push_back(tms->GetMatrixPtr(a));
-        Plan(T);
+        StartTimer("Iteration");
+        QTable &Q=_m_QValues[t];
+        if(t < horizon - 1)
+            ComputeStateValues(_m_QValues[t+1],V);
+        bool last = (t == horizon - 1);
+
+        // every (sI,jaI) is written by one thread only
+        long nrRows=static_cast<long>(nrS*nrJA);
+#pragma omp parallel for schedule(static) if(parallel)
+        for(long r = 0; r < nrRows; r++)
+        {
+            Index jaI = r / nrS;
+            Index sI = r % nrS;
+            double R_f = last ? 0.0 : T.Expectation(sI,jaI,V);
+            Q(sI,jaI) = immReward(sI,jaI) + gamma*R_f;
+        }
+        StopTimer("Iteration");
+        if(t == 0) //escape from (loop t is unsigned!)
+            break;
     }
-    else if((tm=dynamic_cast<const TransitionModelMapping *>(tmd)))
+}
+
+void MDPValueIteration::PlanJacobi(const MDPTransitionRows &T,
+                                   const QTable &immReward)
+{
+    size_t nrS = GetPU()->GetNrStates();
+    size_t nrJA =  GetPU()->GetNrJointActions();
+    double gamma=GetPU()->GetDiscount();
+    bool parallel=ComputeConcurrently();
+
+    QTable &Q=_m_QValues[0];
+    vector<double> V(nrS);
+    long nrRows=static_cast<long>(nrS*nrJA);
+    double maxDelta=DBL_MAX;
+    while(maxDelta>_m_tolerance)
     {
-        std::vector<const TransitionModelMapping::Matrix *> T;
-        for(unsigned int a=0;a!=nrJA;++a)
-            T.push_back(tm->GetMatrixPtr(a));
-            Plan(T);
+        StartTimer("Iteration");
+        // V is the value of the previous sweep, so Q can be updated in place
+        ComputeStateValues(Q,V);
+        maxDelta=0;
+#pragma omp parallel for schedule(static) reduction(max:maxDelta) if(parallel)
+        for(long r = 0; r < nrRows; r++)
+        {
+            Index jaI = r / nrS;
+            Index sI = r % nrS;
+            double q = immReward(sI,jaI) + gamma*T.Expectation(sI,jaI,V);
+            maxDelta=std::max(maxDelta,std::abs(Q(sI,jaI)-q));
+            Q(sI,jaI) = q;
+        }
+        StopTimer("Iteration");
+
+#if DEBUG_MDPValueIteration
+        cout << "delta " << maxDelta << endl;
+        PrintTimersSummary();
+#endif
     }
-    else 
-        throw(E("MDPValueIteration::Plan() TransitionModelDiscretePtr not handled"));
-    
-    StopTimer("Plan");
 }
 
-template <class M>
-void MDPValueIteration::Plan(std::vector<const M*> T)
+void MDPValueIteration::PlanGaussSeidel(const MDPTransitionRows &T,
+                                        const QTable &immReward)
 {
-    size_t horizon = GetPU()->GetHorizon();
     size_t nrS = GetPU()->GetNrStates();
     size_t nrJA =  GetPU()->GetNrJointActions();
-    
-    Index sI,ssucI;
     double gamma=GetPU()->GetDiscount();
-    double R_i,R_f,maxQsuc;
-    
-    // cache immediate reward for speed
-    QTable immReward(nrS,nrJA);
-    for(Index sI = 0; sI < nrS; sI++)
-        for(Index jaI = 0; jaI < nrJA; jaI++)
-            immReward(sI,jaI)=GetPU()->GetReward(sI, jaI);
-    
-    if(_m_finiteHorizon)
+
+    QTable &Q=_m_QValues[0];
+    vector<double> V(nrS);
+    ComputeStateValues(Q,V);
+    double maxDelta=DBL_MAX;
+    while(maxDelta>_m_tolerance)
     {
-        for(size_t t = horizon - 1; true; t--)
+        StartTimer("Iteration");
+        maxDelta=0;
+        for(Index sI = 0; sI < nrS; sI++)
         {
-            StartTimer("Iteration");
+            double maxQ = -DBL_MAX;
             for(Index jaI = 0; jaI < nrJA; jaI++)
             {
-                for(typename M::const_iterator1 ri=T[jaI]->begin1();
-                    ri!=T[jaI]->end1(); ++ri)
-                {
-                    sI=ri.index1();
-                    
-                    //calc. expected immediate reward
-                    R_i = immReward(sI,jaI);
-                    R_f = 0.0;
-                    if(t < horizon - 1)
-                    {
-                        //calc. expected future reward
-                        for (typename M::const_iterator2 ci = ri.begin();
-                             ci != ri.end(); ++ci)
-                        {
-                            ssucI=ci.index2();
-                            //find the best action at ssucI
-                            maxQsuc = -DBL_MAX;
-                            for(Index jasucI = 0; jasucI < nrJA; jasucI++)
-                                maxQsuc = std::max( _m_QValues[t+1](ssucI,jasucI),
-                                                    maxQsuc);
-                            
-                            R_f += *ci * maxQsuc;
-                        }//done calc. expected future reward
-                    }
-                    _m_QValues[t](sI,jaI) = R_i + gamma*R_f;
-                }//end for jaI
-            }//end for sI
-            StopTimer("Iteration");
-            if(t == 0) //escape from (loop t is unsigned!)
-                break;
+                double q = immReward(sI,jaI) + 
+                    gamma*T.Expectation(sI,jaI,V);
+                maxDelta=std::max(maxDelta,std::abs(Q(sI,jaI)-q));
+                Q(sI,jaI) = q;
+                maxQ = std::max(q, maxQ);
+            }
+            // the states after sI use its new value in this sweep
+            V[sI]=maxQ;
         }
+        StopTimer("Iteration");
+
+#if DEBUG_MDPValueIteration
+        cout << "delta " << maxDelta << endl;
+        PrintTimersSummary();
+#endif
+    }
+}
+
+void MDPValueIteration::PlanPrioritizedSweeping(const MDPTransitionRows &T,
+                                                const QTable &immReward)
+{
+    StartTimer("PrioritizedSweeping");
+
+    size_t nrS = GetPU()->GetNrStates();
+    size_t nrJA =  GetPU()->GetNrJointActions();
+    double gamma=GetPU()->GetDiscount();
+
+    // for each state sI, its predecessors sp with max_a T(sp,a,sI): the
+    // change of V[sI] changes the residual of sp by at most
+    // gamma*max_a T(sp,a,sI) times as much
+    vector< vector< pair<Index,double> > > pred(nrS);
+    for(Index jaI = 0; jaI < nrJA; jaI++)
+        for(Index sp = 0; sp < nrS; sp++)
+            for(size_t e=T.RowBegin(sp,jaI);e!=T.RowEnd(sp,jaI);++e)
+                pred[T.GetSuccessor(e)].push_back(
+                    make_pair(sp,T.GetProbability(e)));
+    // merge the entries of each sp (one per joint action)
+    for(Index sI = 0; sI < nrS; sI++)
+    {
+        vector< pair<Index,double> > &p=pred[sI];
+        sort(p.begin(),p.end());
+        size_t n=0;
+        for(size_t i=0; i < p.size(); i++)
+            if(n > 0 && p[n-1].first==p[i].first)
+                p[n-1].second=std::max(p[n-1].second,p[i].second);
+            else
+                p[n++]=p[i];
+        p.resize(n);
     }
-    else // infinite horizon problem
+
+    QTable &Q=_m_QValues[0];
+    vector<double> V(nrS);
+    ComputeStateValues(Q,V);
+
+    // priority[sI] bounds the Bellman residual of sI, initially unknown
+    vector<double> priority(nrS,DBL_MAX);
+    priority_queue< pair<double,Index> > queue;
+    for(Index sI = 0; sI < nrS; sI++)
+        queue.push(make_pair(priority[sI],sI));
+
+    size_t nrBackups=0;
+    while(!queue.empty())
     {
-        double maxDelta=DBL_MAX;
-        QTable oldQtable;
-        
-        while(maxDelta>1e-4)
+        double prio=queue.top().first;
+        Index sI=queue.top().second;
+        queue.pop();
+        if(prio!=priority[sI]) // outdated entry
+            continue;
+        if(prio<=_m_tolerance) // so are all other priorities
+            break;
+
+        priority[sI]=0;
+        double maxQ = -DBL_MAX;
+        for(Index jaI = 0; jaI < nrJA; jaI++)
         {
-            StartTimer("Iteration");
-            maxDelta=0;
-            oldQtable=_m_QValues[0];
-            for(Index jaI = 0; jaI < nrJA; jaI++)
+            double q = immReward(sI,jaI) + gamma*T.Expectation(sI,jaI,V);
+            Q(sI,jaI) = q;
+            maxQ = std::max(q, maxQ);
+        }
+        double delta=std::abs(maxQ-V[sI]);
+        V[sI]=maxQ;
+        nrBackups++;
+
+        if(delta>0)
+            for(vector< pair<Index,double> >::const_iterator
+                    it=pred[sI].begin(); it!=pred[sI].end(); ++it)
             {
-                for(typename M::const_iterator1 ri=T[jaI]->begin1();
-                    ri!=T[jaI]->end1(); ++ri)
-                {
-                    sI=ri.index1();
-                    
-                    //calc. expected immediate reward
-                    R_i = immReward(sI,jaI);
-                    R_f = 0.0;
-                    //calc. expected future reward
-                    
-                    for (typename M::const_iterator2 ci = ri.begin();
-                         ci != ri.end(); ++ci)
-                    {
-                        ssucI=ci.index2();
-                        
-                        //find the best action at ssucI
-                        maxQsuc = -DBL_MAX;
-                        for(Index jasucI = 0; jasucI < nrJA; jasucI++)
-                            maxQsuc = std::max( oldQtable(ssucI,jasucI),
-                                                maxQsuc);
-                            
-                        R_f += *ci * maxQsuc;
-                    }//done calc. expected future reward
-                    
-                    _m_QValues[0](sI,jaI) = R_i + gamma*R_f;
-                    maxDelta=std::max(maxDelta,
-                                      std::abs(oldQtable(sI,jaI)-
-                                               _m_QValues[0](sI,jaI)));
-                }//end for jaI
-            }//end for sI
-            
-            StopTimer("Iteration");
+                priority[it->first]+=gamma*it->second*delta;
+                queue.push(make_pair(priority[it->first],it->first));
+            }
+    }
 
 #if DEBUG_MDPValueIteration
-            std::cout << "delta " << maxDelta << std::endl;
-            PrintTimersSummary();
+    cout << "MDPValueIteration::PlanPrioritizedSweeping " << nrBackups
+         << " backups" << endl;
 #endif
-        }
-    }
+
+    StopTimer("PrioritizedSweeping");
 }
-template
-void MDPValueIteration::Plan(std::vector<const TransitionModelMappingSparse::SparseMatrix*> T);
-template
-void MDPValueIteration::Plan(std::vector<const TransitionModelMapping::Matrix*> T);
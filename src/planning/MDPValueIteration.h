@@ -24,8 +24,29 @@
 
 #include "MDPSolver.h"
 #include "TimedAlgorithm.h"
+#include "MDPValueIterationUpdateType.h"
+
+class MDPTransitionRows;
 
 /**\brief MDPValueIteration implements value iteration for MDPs.
+ *
+ * The transition model is read once into an MDPTransitionRows, and in
+ * each sweep V(s')=max_a Q(s',a) is computed once per state, rather than
+ * for every (s,a,s') triple.
+ *
+ * Finite-horizon problems are solved by backing up the stages in turn.
+ * For infinite-horizon problems, the update type selects how the states
+ * are backed up until the largest change of a Q-value (the Bellman
+ * residual) drops to the tolerance (1e-4 by default):
+ * - VI_JACOBI (default): synchronous sweeps using the V of the previous
+ *   sweep,
+ * - VI_GAUSS_SEIDEL: sweeps in which each state uses the values already
+ *   updated in the same sweep,
+ * - VI_PRIORITIZED_SWEEPING: backs up the state with the largest bound
+ *   on its residual first, until all bounds are below the tolerance.
+ *
+ * When compiled with OpenMP, the (s,a) rows of finite-horizon stages and
+ * Jacobi sweeps are computed by several threads.
   */
 class MDPValueIteration : public MDPSolver,
     public TimedAlgorithm
@@ -43,22 +64,40 @@ private:
     /// Are we solving a finite-horizon problem?
     bool _m_finiteHorizon;
 
+    /// How the states of infinite-horizon problems are backed up.
+    MDPValueIterationUpdateType _m_updateType;
+
+    /// The Bellman residual at which infinite-horizon VI stops.
+    double _m_tolerance;
+
     void Initialize();
 
-    /**Vector<const M*> T is the vector of matrices specifying the transition
-       model (one matrix for each joint action). */
-    template <class M>
-    void Plan(std::vector<const M*> T);
+    /// Computes _m_QValues for all stages of a finite-horizon problem.
+    void PlanFiniteHorizon(const MDPTransitionRows &T,
+                           const QTable &immReward);
+    void PlanJacobi(const MDPTransitionRows &T, const QTable &immReward);
+    void PlanGaussSeidel(const MDPTransitionRows &T,
+                         const QTable &immReward);
+    void PlanPrioritizedSweeping(const MDPTransitionRows &T,
+                                 const QTable &immReward);
 
-    /// Uses the GetTransitionProbability() interface, which is slow.
-    void PlanSlow();
+    /// Whether the rows of a sweep are computed by several threads.
+    bool ComputeConcurrently() const;
+
+    /// Describes the Q-values for the cache, which depend on the update
+    /// type and the tolerance.
+    std::string GetCacheDescription() const;
 
 protected:
     
 public:
     // Constructor, destructor and copy assignment.
     /// (default) Constructor
-    MDPValueIteration(){};
+    MDPValueIteration() :
+        _m_initialized(false),
+        _m_updateType(VI_JACOBI),
+        _m_tolerance(1e-4)
+        {};
 
     MDPValueIteration(const PlanningUnitDecPOMDPDiscrete& pu);
     /// Destructor.
@@ -84,6 +123,13 @@ public:
     void SetQTables(const QTables &Qs);
     void SetQTable(const QTable &Q, Index time_step);
 
+    MDPValueIterationUpdateType GetUpdateType() const
+        { return(_m_updateType); }
+    void SetUpdateType(MDPValueIterationUpdateType updateType)
+        { _m_updateType=updateType; }
+    double GetTolerance() const { return(_m_tolerance); }
+    void SetTolerance(double tolerance) { _m_tolerance=tolerance; }
+
 };
 
 
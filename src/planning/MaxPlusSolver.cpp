@@ -24,14 +24,16 @@ MaxPlusSolver::MaxPlusSolver(
         int verbosity,
         double damping,
         size_t nrSolutions,
-        size_t nrRestarts)
+        size_t nrRestarts,
+        size_t nrThreads)
     :
     _m_maxiter(maxiter),
     _m_updateType(updateType),
     _m_verbosity(verbosity),
     _m_damping(damping),
     _m_nrSolutions(nrSolutions),
-    _m_nrRestarts(nrRestarts)
+    _m_nrRestarts(nrRestarts),
+    _m_nrThreads(nrThreads)
 {
 }
 
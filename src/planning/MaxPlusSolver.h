@@ -39,6 +39,8 @@ class MaxPlusSolver
     size_t _m_nrSolutions;
     ///stores the number of restarts (for non-deterministic Max-Plus variants)
     size_t _m_nrRestarts;  
+    ///stores the number of threads that compute the PARALL message updates
+    size_t _m_nrThreads;
     
     
     public:
@@ -50,7 +52,8 @@ class MaxPlusSolver
             int verbosity = 2,
             double damping = 0.0,
             size_t nrSolutions = 1,
-            size_t nrRestarts = 1);
+            size_t nrRestarts = 1,
+            size_t nrThreads = 1);
 
 /*
         /// Copy constructor.
@@ -32,9 +32,11 @@ MaxPlusSolverForBGs::MaxPlusSolverForBGs(
         int verbosity,
         double damping,
         size_t nrSolutions,
-        size_t nrRestarts)
+        size_t nrRestarts,
+        size_t nrThreads)
     :
-    MaxPlusSolver(maxiter, updateType, verbosity, damping, nrSolutions, nrRestarts)
+    MaxPlusSolver(maxiter, updateType, verbosity, damping, nrSolutions, nrRestarts,
+                  nrThreads)
 {
 }
 
@@ -47,7 +47,8 @@ class MaxPlusSolverForBGs :
             int verbosity = 2,
             double damping = 0.0,
             size_t nrSolutions = 1,
-            size_t nrRestarts = 1);
+            size_t nrRestarts = 1,
+            size_t nrThreads = 1);
 /*        /// Copy constructor.
         MaxPlusSolverForBGs(const MaxPlusSolverForBGs& a);
         /// Destructor.
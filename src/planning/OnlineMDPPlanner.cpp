@@ -0,0 +1,32 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Philipp Robbel 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "OnlineMDPPlanner.h"
+
+using namespace std;
+
+OnlineMDPPlanner::OnlineMDPPlanner(const PlanningUnitDecPOMDPDiscrete* pu) :
+    _m_pu(pu),
+    _m_lastActionChosen(INDEX_MAX)
+{
+}
+
+OnlineMDPPlanner::~OnlineMDPPlanner()
+{
+}
+
+void OnlineMDPPlanner::Reset()
+{
+    _m_lastActionChosen=INDEX_MAX;
+}
@@ -29,6 +29,10 @@ private:
 
     Index _m_lastActionChosen;
 
+protected:
+
+    void SetLastActionChosen(Index jaI) { _m_lastActionChosen=jaI; }
+
 public:
 
     // Constructor, destructor and copy assignment.
@@ -0,0 +1,392 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek 
+ * Matthijs Spaan 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <float.h>
+#include <stdlib.h>
+#include "OnlineMDPPlannerMCTS.h"
+#include "PlanningUnitDecPOMDPDiscrete.h"
+#include "TimeTools.h"
+#include "EParallel.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+#define DEBUG_OnlineMDPPlannerMCTS 0
+
+OnlineMDPPlannerMCTS::OnlineMDPPlannerMCTS(
+    const PlanningUnitDecPOMDPDiscrete* pu,
+    size_t nrThreads,
+    size_t maxNodes,
+    unsigned int seed) :
+    OnlineMDPPlanner(pu),
+    _m_trees(nrThreads),
+    _m_spareTrees(nrThreads),
+    _m_T(*pu),
+    _m_nrStates(pu->GetNrStates()),
+    _m_nrThreads(nrThreads),
+    _m_maxNodes(maxNodes),
+    _m_iterationBudget(1000),
+    _m_timeBudget(0),
+    _m_t(0)
+{
+    if(nrThreads==0 || maxNodes==0)
+        throw(E("OnlineMDPPlannerMCTS: nrThreads and maxNodes should be positive"));
+
+    _m_T.BuildAliasTables();
+
+    size_t nrS=pu->GetNrStates();
+    size_t nrJA=pu->GetNrJointActions();
+    _m_reward.resize(nrS*nrJA);
+    double minR=DBL_MAX, maxR=-DBL_MAX;
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+        for(Index sI=0;sI!=nrS;++sI)
+        {
+            double r=pu->GetReward(sI,jaI);
+            _m_reward[jaI*nrS+sI]=r;
+            minR=min(minR,r);
+            maxR=max(maxR,r);
+        }
+
+    // simulate until the discount drops below 0.01, or up to the horizon
+    double gamma=pu->GetDiscount();
+    if(gamma < 1)
+        _m_maxDepth=static_cast<size_t>(ceil(log(0.01)/log(gamma)));
+    else if(pu->GetHorizon()!=MAXHORIZON)
+        _m_maxDepth=pu->GetHorizon();
+    else
+        _m_maxDepth=100;
+
+    // explore on the scale of the returns
+    double effectiveHorizon=_m_maxDepth;
+    if(gamma < 1)
+        effectiveHorizon=min(effectiveHorizon,1/(1-gamma));
+    _m_explorationConstant=(maxR-minR)*effectiveHorizon;
+    if(_m_explorationConstant<=0)
+        _m_explorationConstant=1;
+
+    for(Index i=0;i!=nrThreads;++i)
+        _m_trees[i].seed=seed+i;
+}
+
+OnlineMDPPlannerMCTS::~OnlineMDPPlannerMCTS()
+{
+}
+
+void OnlineMDPPlannerMCTS::Reset()
+{
+    OnlineMDPPlanner::Reset();
+    _m_t=0;
+    for(Index i=0;i!=_m_nrThreads;++i)
+    {
+        _m_trees[i].stateNodes.clear();
+        _m_trees[i].actionNodes.clear();
+    }
+}
+
+Index OnlineMDPPlannerMCTS::SearchForAction(Index sI, Index joI)
+{
+    if(_m_iterationBudget==0 && _m_timeBudget<=0)
+        throw(E("OnlineMDPPlannerMCTS::SearchForAction: no iteration or time budget"));
+
+    size_t maxDepth=_m_maxDepth;
+    size_t horizon=GetPU()->GetHorizon();
+    if(horizon!=MAXHORIZON)
+        maxDepth=min(maxDepth, horizon > _m_t ? horizon-_m_t : 1);
+
+    for(Index i=0;i!=_m_nrThreads;++i)
+        if(_m_t > 0 && GetLastActionChosen()!=INDEX_MAX)
+            ReuseSubtree(i,GetLastActionChosen(),sI);
+        else
+        {
+            _m_trees[i].stateNodes.clear();
+            _m_trees[i].actionNodes.clear();
+        }
+
+    // the iteration budget is shared by the trees
+    size_t nrIterations=0;
+    if(_m_iterationBudget > 0)
+        nrIterations=(_m_iterationBudget+_m_nrThreads-1)/_m_nrThreads;
+
+#ifdef _OPENMP
+    bool parallel=_m_nrThreads > 1 && !omp_in_parallel();
+#endif
+    long nrTrees=static_cast<long>(_m_nrThreads);
+    EParallel error;
+#pragma omp parallel for schedule(static,1) num_threads(_m_nrThreads) if(parallel)
+    for(long i=0; i < nrTrees; i++)
+    {
+        try {
+            Search(_m_trees[i],sI,nrIterations,maxDepth);
+        }
+        catch(...)
+        {
+            error.Catch();
+        }
+    }
+    error.Rethrow();
+
+    // choose the action visited most often over all trees, breaking ties
+    // by the mean return
+    size_t nrJA=GetPU()->GetNrJointActions();
+    Index bestJaI=0;
+    size_t bestN=0;
+    double bestQ=-DBL_MAX;
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+    {
+        size_t N=0;
+        double sumQ=0;
+        for(Index i=0;i!=_m_nrThreads;++i)
+        {
+            const ActionNode &a=_m_trees[i].actionNodes[jaI];
+            N+=a.N;
+            sumQ+=a.N*a.Q;
+        }
+        double Q=N>0 ? sumQ/N : -DBL_MAX;
+        if(N > bestN || (N == bestN && Q > bestQ))
+        {
+            bestJaI=jaI;
+            bestN=N;
+            bestQ=Q;
+        }
+    }
+
+#if DEBUG_OnlineMDPPlannerMCTS
+    cout << "OnlineMDPPlannerMCTS::SearchForAction s " << sI << " ja "
+         << bestJaI << " N " << bestN << " Q " << bestQ << " nodes "
+         << _m_trees[0].stateNodes.size() << endl;
+#endif
+
+    SetLastActionChosen(bestJaI);
+    _m_t++;
+    return(bestJaI);
+}
+
+size_t OnlineMDPPlannerMCTS::GetNrVisits() const
+{
+    size_t N=0;
+    for(Index i=0;i!=_m_nrThreads;++i)
+        if(!_m_trees[i].stateNodes.empty())
+            N+=_m_trees[i].stateNodes[0].N;
+    return(N);
+}
+
+size_t OnlineMDPPlannerMCTS::GetNrVisits(Index jaI, Index sucSI) const
+{
+    size_t N=0;
+    for(Index i=0;i!=_m_nrThreads;++i)
+    {
+        const Tree &tree=_m_trees[i];
+        if(tree.stateNodes.empty())
+            continue;
+        Index childI=
+            tree.actionNodes[tree.stateNodes[0].firstAction+jaI].firstChild;
+        while(childI!=INDEX_MAX && tree.stateNodes[childI].sI!=sucSI)
+            childI=tree.stateNodes[childI].nextSibling;
+        if(childI!=INDEX_MAX)
+            N+=tree.stateNodes[childI].N;
+    }
+    return(N);
+}
+
+void OnlineMDPPlannerMCTS::Search(Tree &tree, Index sI, size_t nrIterations,
+                                  size_t maxDepth) const
+{
+    if(tree.stateNodes.empty())
+        AddStateNode(tree,sI);
+
+    struct timeval start_time, cur_time;
+    if(gettimeofday(&start_time, NULL) != 0)
+        throw(E("OnlineMDPPlannerMCTS::Search: error with gettimeofday"));
+    for(size_t i=0; nrIterations==0 || i < nrIterations; i++)
+    {
+        // checking the clock every iteration would cost more than the
+        // iterations of small problems
+        if(_m_timeBudget > 0 && i%16==0)
+        {
+            gettimeofday(&cur_time, NULL);
+            if(TimeTools::GetDeltaTimeDouble(start_time, cur_time) >=
+               _m_timeBudget*1e6)
+                break;
+        }
+        Simulate(tree,0,0,maxDepth);
+    }
+}
+
+Index OnlineMDPPlannerMCTS::AddStateNode(Tree &tree, Index sI) const
+{
+    if(tree.stateNodes.size() >= _m_maxNodes)
+        return(INDEX_MAX);
+
+    StateNode node;
+    node.sI=sI;
+    node.N=0;
+    node.firstAction=tree.actionNodes.size();
+    node.nextSibling=INDEX_MAX;
+    tree.stateNodes.push_back(node);
+
+    ActionNode a;
+    a.N=0;
+    a.Q=0;
+    a.firstChild=INDEX_MAX;
+    tree.actionNodes.resize(tree.actionNodes.size()+
+                            GetPU()->GetNrJointActions(),a);
+    return(tree.stateNodes.size()-1);
+}
+
+Index OnlineMDPPlannerMCTS::SelectAction(Tree &tree, Index nodeI) const
+{
+    const StateNode &node=tree.stateNodes[nodeI];
+    size_t nrJA=GetPU()->GetNrJointActions();
+
+    // try the untried actions first, starting at a random one
+    Index offset=rand_r(&tree.seed)%nrJA;
+    for(Index k=0;k!=nrJA;++k)
+    {
+        Index jaI=(offset+k)%nrJA;
+        if(tree.actionNodes[node.firstAction+jaI].N==0)
+            return(jaI);
+    }
+
+    double logN=log(static_cast<double>(node.N));
+    Index bestJaI=0;
+    double bestU=-DBL_MAX;
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+    {
+        const ActionNode &a=tree.actionNodes[node.firstAction+jaI];
+        double u=a.Q+_m_explorationConstant*sqrt(logN/a.N);
+        if(u > bestU)
+        {
+            bestU=u;
+            bestJaI=jaI;
+        }
+    }
+    return(bestJaI);
+}
+
+double OnlineMDPPlannerMCTS::Simulate(Tree &tree, Index nodeI, size_t depth,
+                                      size_t maxDepth) const
+{
+    if(depth >= maxDepth)
+        return(0);
+
+    Index sI=tree.stateNodes[nodeI].sI;
+    Index jaI=SelectAction(tree,nodeI);
+    Index aI=tree.stateNodes[nodeI].firstAction+jaI;
+    Index sucI=_m_T.SampleSuccessor(sI,jaI,
+                                    rand_r(&tree.seed)/(RAND_MAX+1.0));
+
+    Index childI=tree.actionNodes[aI].firstChild;
+    while(childI!=INDEX_MAX && tree.stateNodes[childI].sI!=sucI)
+        childI=tree.stateNodes[childI].nextSibling;
+
+    double future;
+    if(childI!=INDEX_MAX)
+        future=Simulate(tree,childI,depth+1,maxDepth);
+    else
+    {
+        // expand a new leaf (unless the tree is full), and evaluate it
+        // by a rollout
+        childI=AddStateNode(tree,sucI);
+        if(childI!=INDEX_MAX)
+        {
+            tree.stateNodes[childI].nextSibling=tree.actionNodes[aI].firstChild;
+            tree.actionNodes[aI].firstChild=childI;
+        }
+        future=Rollout(tree,sucI,depth+1,maxDepth);
+    }
+
+    double ret=GetReward(sI,jaI)+GetPU()->GetDiscount()*future;
+
+    // AddStateNode() may have moved the nodes, so index them again
+    tree.stateNodes[nodeI].N++;
+    ActionNode &a=tree.actionNodes[aI];
+    a.N++;
+    a.Q+=(ret-a.Q)/a.N;
+    return(ret);
+}
+
+double OnlineMDPPlannerMCTS::Rollout(Tree &tree, Index sI, size_t depth,
+                                     size_t maxDepth) const
+{
+    size_t nrJA=GetPU()->GetNrJointActions();
+    double gamma=GetPU()->GetDiscount();
+    double ret=0, discount=1;
+    for(size_t d=depth;d < maxDepth;++d)
+    {
+        Index jaI=rand_r(&tree.seed)%nrJA;
+        ret+=discount*GetReward(sI,jaI);
+        discount*=gamma;
+        sI=_m_T.SampleSuccessor(sI,jaI,rand_r(&tree.seed)/(RAND_MAX+1.0));
+    }
+    return(ret);
+}
+
+void OnlineMDPPlannerMCTS::ReuseSubtree(Index treeI, Index jaI, Index sI)
+{
+    Tree &tree=_m_trees[treeI];
+    Tree &spare=_m_spareTrees[treeI];
+
+    Index childI=INDEX_MAX;
+    if(!tree.stateNodes.empty())
+    {
+        childI=tree.actionNodes[tree.stateNodes[0].firstAction+jaI].firstChild;
+        while(childI!=INDEX_MAX && tree.stateNodes[childI].sI!=sI)
+            childI=tree.stateNodes[childI].nextSibling;
+    }
+
+    spare.stateNodes.clear();
+    spare.actionNodes.clear();
+    if(childI!=INDEX_MAX)
+        CopySubtree(tree,childI,spare);
+
+    // swapping keeps the capacity of both arrays for later use
+    tree.stateNodes.swap(spare.stateNodes);
+    tree.actionNodes.swap(spare.actionNodes);
+}
+
+Index OnlineMDPPlannerMCTS::CopySubtree(const Tree &from, Index nodeI,
+                                        Tree &to) const
+{
+    size_t nrJA=GetPU()->GetNrJointActions();
+    const StateNode &node=from.stateNodes[nodeI];
+
+    Index newI=to.stateNodes.size();
+    StateNode copy=node;
+    copy.firstAction=to.actionNodes.size();
+    copy.nextSibling=INDEX_MAX;
+    to.stateNodes.push_back(copy);
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+    {
+        ActionNode a=from.actionNodes[node.firstAction+jaI];
+        a.firstChild=INDEX_MAX;
+        to.actionNodes.push_back(a);
+    }
+
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+        for(Index childI=from.actionNodes[node.firstAction+jaI].firstChild;
+            childI!=INDEX_MAX;
+            childI=from.stateNodes[childI].nextSibling)
+        {
+            Index newChildI=CopySubtree(from,childI,to);
+            ActionNode &a=to.actionNodes[copy.firstAction+jaI];
+            to.stateNodes[newChildI].nextSibling=a.firstChild;
+            a.firstChild=newChildI;
+        }
+    return(newI);
+}
@@ -0,0 +1,173 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek 
+ * Matthijs Spaan 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _ONLINEMDPPLANNERMCTS_H_
+#define _ONLINEMDPPLANNERMCTS_H_ 1
+
+/* the include directives */
+#include <vector>
+#include "Globals.h"
+#include "OnlineMDPPlanner.h"
+#include "MDPTransitionRows.h"
+
+/**\brief OnlineMDPPlannerMCTS is an online MDP planner that selects each
+ * action by Monte-Carlo tree search with UCT.
+ *
+ * Each call to SearchForAction() grows a search tree from the current
+ * state, until the iteration budget or the wall-clock budget (whichever
+ * is reached first) is used up. New leaves are evaluated by a rollout
+ * with uniformly random actions, up to the search depth. Successor
+ * states are drawn from the alias tables of MDPTransitionRows, so a
+ * simulation step takes constant time.
+ *
+ * The subtree below the chosen action and the observed state is kept
+ * for the next decision; Reset() discards the tree. The nodes live in
+ * arrays that are cleared rather than freed, so no memory is allocated
+ * once these have grown to their working size, and at most maxNodes
+ * state nodes are stored per tree.
+ *
+ * With nrThreads > 1 (when compiled with OpenMP) every thread searches
+ * its own tree (root parallelisation), and the action with the most
+ * visits summed over the trees is chosen.
+ */
+class OnlineMDPPlannerMCTS : public OnlineMDPPlanner
+{
+private:
+
+    struct ActionNode
+    {
+        /// the number of times the action was tried
+        size_t N;
+        /// the mean return after the action
+        double Q;
+        /// the first child state node, or INDEX_MAX
+        Index firstChild;
+    };
+
+    struct StateNode
+    {
+        Index sI;
+        /// the number of times the node was visited
+        size_t N;
+        /// the index of the first of its nrJA ActionNodes
+        Index firstAction;
+        /// the next child of the same ActionNode, or INDEX_MAX
+        Index nextSibling;
+    };
+
+    /// One search tree, the unit of root parallelisation.
+    struct Tree
+    {
+        /// the state nodes, of which stateNodes[0] is the root
+        std::vector<StateNode> stateNodes;
+        std::vector<ActionNode> actionNodes;
+        /// the seed for rand_r()
+        unsigned int seed;
+    };
+
+    std::vector<Tree> _m_trees;
+    /// scratch space to which the reused subtree is copied
+    std::vector<Tree> _m_spareTrees;
+
+    MDPTransitionRows _m_T;
+    /// _m_reward[jaI*_m_nrStates+sI] caches R(sI,jaI)
+    std::vector<double> _m_reward;
+    size_t _m_nrStates;
+
+    size_t _m_nrThreads;
+    size_t _m_maxNodes;
+    size_t _m_iterationBudget;
+    double _m_timeBudget;
+    size_t _m_maxDepth;
+    double _m_explorationConstant;
+
+    /// the number of decisions since the last Reset()
+    size_t _m_t;
+
+    double GetReward(Index sI, Index jaI) const
+        { return(_m_reward[jaI*_m_nrStates+sI]); }
+
+    /// Adds a state node for sI to tree, if there is room.
+    Index AddStateNode(Tree &tree, Index sI) const;
+
+    /// Samples one trajectory from stateNodes[nodeI] and returns its return.
+    double Simulate(Tree &tree, Index nodeI, size_t depth,
+                    size_t maxDepth) const;
+    /// Returns the return of a random trajectory from sI.
+    double Rollout(Tree &tree, Index sI, size_t depth,
+                   size_t maxDepth) const;
+    /// Selects the action at stateNodes[nodeI] by UCB1, trying each
+    /// action once first.
+    Index SelectAction(Tree &tree, Index nodeI) const;
+
+    /// Makes the child of the root for (jaI,sI) the new root, or clears
+    /// the tree if there is none.
+    void ReuseSubtree(Index treeI, Index jaI, Index sI);
+    /// Copies the subtree at from.stateNodes[nodeI] into to.
+    Index CopySubtree(const Tree &from, Index nodeI, Tree &to) const;
+
+    /// Runs the searches of one tree from sI.
+    void Search(Tree &tree, Index sI, size_t nrIterations,
+                size_t maxDepth) const;
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /**Constructor. The searches use nrThreads trees of at most maxNodes
+     * state nodes each, and the random numbers are drawn with seeds
+     * derived from seed. */
+    OnlineMDPPlannerMCTS(const PlanningUnitDecPOMDPDiscrete* pu,
+                         size_t nrThreads=1,
+                         size_t maxNodes=100000,
+                         unsigned int seed=42);
+    /// Destructor.
+    ~OnlineMDPPlannerMCTS();
+
+    void Reset();
+
+    Index SearchForAction(Index sI, Index joI);
+
+    /// The number of search iterations per decision, 0 for no limit.
+    size_t GetIterationBudget() const { return(_m_iterationBudget); }
+    void SetIterationBudget(size_t nrIterations)
+        { _m_iterationBudget=nrIterations; }
+    /// The wall-clock time per decision in seconds, 0 for no limit.
+    double GetTimeBudget() const { return(_m_timeBudget); }
+    void SetTimeBudget(double seconds) { _m_timeBudget=seconds; }
+    /// The number of steps simulated ahead; finite-horizon problems are
+    /// never simulated beyond their horizon.
+    size_t GetMaxDepth() const { return(_m_maxDepth); }
+    void SetMaxDepth(size_t maxDepth) { _m_maxDepth=maxDepth; }
+    /// The weight of the UCB1 exploration term.
+    double GetExplorationConstant() const
+        { return(_m_explorationConstant); }
+    void SetExplorationConstant(double c) { _m_explorationConstant=c; }
+
+    /// The number of visits of the root, summed over the trees.
+    size_t GetNrVisits() const;
+    /// The number of visits of the child of the root for joint action
+    /// jaI and successor state sucSI, summed over the trees.
+    size_t GetNrVisits(Index jaI, Index sucSI) const;
+
+};
+
+
+#endif /* !_ONLINEMDPPLANNERMCTS_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
@@ -0,0 +1,222 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Philipp Robbel 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+
+#include <cmath>
+#include <cfloat>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "ParallelQLearner.h"
+#include "PlanningUnitDecPOMDPDiscrete.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+#define EPSILON 0.000000001 // as in AgentQLearner
+
+/// The number of doubles in a cache line of 64 bytes.
+static const size_t CACHE_LINE_DOUBLES=8;
+
+ParallelQLearner::ParallelQLearner(const PlanningUnitDecPOMDPDiscrete *pu,
+                                   double initValue, double epsilon,
+                                   double alpha, double gamma,
+                                   ExplorationT exploration, double temp) :
+    _m_pu(pu),
+    _m_nrStates(pu->GetNrStates()),
+    _m_nrActions(pu->GetNrJointActions()),
+    _m_T(*pu),
+    _m_alpha(alpha),
+    _m_gamma(gamma),
+    _m_exploration(exploration),
+    _m_epsilon(epsilon),
+    _m_temp(temp)
+{
+    // pad the rows to whole cache lines, and allocate one extra line to
+    // be able to align the first row
+    _m_stride=(_m_nrActions+CACHE_LINE_DOUBLES-1)/
+        CACHE_LINE_DOUBLES*CACHE_LINE_DOUBLES;
+    _m_storage.assign(_m_nrStates*_m_stride+CACHE_LINE_DOUBLES,initValue);
+    size_t misalignment=reinterpret_cast<size_t>(&_m_storage[0])%
+        (CACHE_LINE_DOUBLES*sizeof(double));
+    _m_Q=&_m_storage[0];
+    if(misalignment!=0)
+        _m_Q+=(CACHE_LINE_DOUBLES*sizeof(double)-misalignment)/sizeof(double);
+
+    _m_T.BuildAliasTables();
+
+    _m_reward.resize(_m_nrStates*_m_nrActions);
+    for(Index sI=0;sI!=_m_nrStates;++sI)
+        for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+            _m_reward[sI*_m_nrActions+jaI]=pu->GetReward(sI,jaI);
+
+    _m_isdCumulative.resize(_m_nrStates);
+    double sum=0;
+    for(Index sI=0;sI!=_m_nrStates;++sI)
+    {
+        sum+=pu->GetInitialStateProbability(sI);
+        _m_isdCumulative[sI]=sum;
+    }
+}
+
+ParallelQLearner::~ParallelQLearner()
+{
+}
+
+double ParallelQLearner::GetQ(Index sI, Index jaI) const
+{
+    double q;
+    const double *p=_m_Q+sI*_m_stride+jaI;
+#pragma omp atomic read
+    q=*p;
+    return(q);
+}
+
+void ParallelQLearner::SetQ(Index sI, Index jaI, double q)
+{
+    double *p=_m_Q+sI*_m_stride+jaI;
+#pragma omp atomic write
+    *p=q;
+}
+
+double ParallelQLearner::GetMaxQ(Index sI) const
+{
+    double maxQ=-DBL_MAX;
+    for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+        maxQ=max(maxQ,GetQ(sI,jaI));
+    return(maxQ);
+}
+
+Index ParallelQLearner::SelectAction(Index sI, unsigned int *seed,
+                                     vector<double> &q) const
+{
+    for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+        q[jaI]=GetQ(sI,jaI);
+
+    if( _m_exploration == EXPL_EGREEDY )
+    {
+        if( (rand_r(seed)/(RAND_MAX+1.0)) <= _m_epsilon )
+            return(static_cast<Index>(rand_r(seed)/(RAND_MAX+1.0)*
+                                      _m_nrActions));
+
+        // greedy, choosing uniformly among equal Q-values
+        double dMax=-DBL_MAX;
+        Index best=0;
+        size_t nrBest=0;
+        for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+            if(std::abs(q[jaI]-dMax) < EPSILON)
+            {
+                nrBest++;
+                if(rand_r(seed)%nrBest==0)
+                    best=jaI;
+            }
+            else if(q[jaI] > dMax)
+            {
+                dMax=q[jaI];
+                best=jaI;
+                nrBest=1;
+            }
+        return(best);
+    }
+    else if( _m_exploration == EXPL_BOLTZMANN )
+    {
+        // subtracting the maximum does not change the distribution, but
+        // avoids overflow of exp()
+        double maxQ=*max_element(q.begin(),q.end());
+        double sum=0.0;
+        for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+        {
+            q[jaI]=exp((q[jaI]-maxQ)/_m_temp);
+            sum+=q[jaI];
+        }
+        double d=rand_r(seed)/(RAND_MAX+1.0)*sum;
+        for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+        {
+            d-=q[jaI];
+            if(d < 0)
+                return(jaI);
+        }
+        return(_m_nrActions-1);
+    }
+    else
+        throw(E("ParallelQLearner::SelectAction error, sampling scheme not supported"));
+}
+
+double ParallelQLearner::RunEpisode(size_t horizon, unsigned int *seed)
+{
+    // scratch space for SelectAction()
+    vector<double> q(_m_nrActions);
+
+    double u=rand_r(seed)/(RAND_MAX+1.0)*_m_isdCumulative.back();
+    Index sI=min(static_cast<size_t>(upper_bound(_m_isdCumulative.begin(),
+                                                 _m_isdCumulative.end(),u)-
+                                     _m_isdCumulative.begin()),
+                 _m_nrStates-1);
+
+    double sumR=0, discount=1;
+    for(size_t h=0;h<horizon;h++)
+    {
+        Index jaI=SelectAction(sI,seed,q);
+        double r=_m_reward[sI*_m_nrActions+jaI];
+        Index sucI=_m_T.SampleSuccessor(sI,jaI,rand_r(seed)/(RAND_MAX+1.0));
+
+        // other actors may change Q(sI,jaI) in between, in which case
+        // one of the updates is lost
+        double target=r+_m_gamma*GetMaxQ(sucI);
+        SetQ(sI,jaI,(1.0-_m_alpha)*GetQ(sI,jaI)+_m_alpha*target);
+
+        sumR+=discount*r;
+        discount*=_m_pu->GetDiscount();
+        sI=sucI;
+    }
+    return(sumR);
+}
+
+vector<double> ParallelQLearner::Learn(size_t nrEpisodes, size_t horizon,
+                                       size_t nrActors, unsigned int seed)
+{
+    if(nrActors==0)
+        throw(E("ParallelQLearner::Learn: nrActors should be positive"));
+
+    vector<double> returns(nrEpisodes);
+
+#ifdef _OPENMP
+    bool parallel=nrActors > 1 && !omp_in_parallel();
+#endif
+    long nrEps=static_cast<long>(nrEpisodes);
+#pragma omp parallel num_threads(nrActors) if(parallel)
+    {
+        // without OpenMP, the single actor runs all episodes
+        unsigned int actorSeed=seed;
+#ifdef _OPENMP
+        actorSeed+=omp_get_thread_num();
+#endif
+#pragma omp for schedule(dynamic,1)
+        for(long e=0;e<nrEps;e++)
+            returns[e]=RunEpisode(horizon,&actorSeed);
+    }
+    return(returns);
+}
+
+QTable ParallelQLearner::GetQTable() const
+{
+    QTable Q(_m_nrStates,_m_nrActions);
+    for(Index sI=0;sI!=_m_nrStates;++sI)
+        for(Index jaI=0;jaI!=_m_nrActions;++jaI)
+            Q(sI,jaI)=GetQ(sI,jaI);
+    return(Q);
+}
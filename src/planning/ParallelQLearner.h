@@ -0,0 +1,119 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Philipp Robbel 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+
+/* Only include this header file once. */
+#ifndef _PARALLELQLEARNER_H_
+#define _PARALLELQLEARNER_H_ 1
+
+/* the include directives */
+#include <vector>
+#include "Globals.h"
+#include "QTable.h"
+#include "AgentQLearner.h"
+#include "MDPTransitionRows.h"
+
+class PlanningUnitDecPOMDPDiscrete;
+
+/**\brief ParallelQLearner learns the joint Q-function of an MMDP with
+ * several concurrent actors.
+ *
+ * Like AgentQLearner, it applies Q-learning in the joint state and
+ * action space, but rather than acting within a Simulation, it
+ * simulates the MMDP itself. Each actor thread runs its own episodes,
+ * drawing its random numbers from its own seed and the successor states
+ * from the alias tables of MDPTransitionRows, and all actors update one
+ * shared Q-table.
+ *
+ * The updates are Hogwild-style: the Q-values are read and written with
+ * relaxed atomic operations, without locking, so concurrent updates of
+ * the same (s,a) can overwrite each other. Each row of the table is
+ * padded to whole cache lines, so actors in different states do not
+ * share cache lines.
+ */
+class ParallelQLearner
+{
+private:
+
+    const PlanningUnitDecPOMDPDiscrete *_m_pu;
+
+    size_t _m_nrStates;
+    size_t _m_nrActions;
+
+    /// The number of doubles between consecutive rows of the Q-table.
+    size_t _m_stride;
+    /// The storage of the Q-table, of which _m_Q is the aligned start.
+    std::vector<double> _m_storage;
+    double *_m_Q;
+
+    MDPTransitionRows _m_T;
+    /// _m_reward[sI*_m_nrActions+jaI] caches R(sI,jaI)
+    std::vector<double> _m_reward;
+    /// the cumulative initial state distribution
+    std::vector<double> _m_isdCumulative;
+
+    double _m_alpha;       //!< learning rate
+    double _m_gamma;       //!< discount rate
+
+    ExplorationT _m_exploration; //!< exploration strategy
+    double _m_epsilon;     //!< greedy probability
+    double _m_temp;        //!< boltzmann temperature
+
+    /// Q-values are shared by the actors, so only accessed through these.
+    double GetQ(Index sI, Index jaI) const;
+    void SetQ(Index sI, Index jaI, double q);
+    double GetMaxQ(Index sI) const;
+
+    /// Selects an action in sI, using q as scratch space.
+    Index SelectAction(Index sI, unsigned int *seed,
+                       std::vector<double> &q) const;
+
+    /// Runs one episode of horizon steps and returns its discounted
+    /// return.
+    double RunEpisode(size_t horizon, unsigned int *seed);
+
+    /// Not copyable, since _m_Q points into _m_storage.
+    ParallelQLearner(const ParallelQLearner&);
+    ParallelQLearner& operator=(const ParallelQLearner&);
+
+protected:
+
+public:
+    // Constructor, destructor and copy assignment.
+    /// Constructor, with the parameters of AgentQLearner.
+    ParallelQLearner(const PlanningUnitDecPOMDPDiscrete *pu,
+                     double initValue, double epsilon, double alpha,
+                     double gamma, ExplorationT expl=EXPL_EGREEDY,
+                     double temp=0.4);
+    /// Destructor.
+    ~ParallelQLearner();
+
+    /**Learns from nrEpisodes episodes of horizon steps, which are divided
+     * over nrActors threads (when compiled with OpenMP). The actors draw
+     * their random numbers from seeds derived from seed. Returns the
+     * discounted return of each episode. */
+    std::vector<double> Learn(size_t nrEpisodes, size_t horizon,
+                              size_t nrActors, unsigned int seed);
+
+    /// Returns the learned (infinite horizon) Q-Table.
+    QTable GetQTable() const;
+
+};
+
+
+#endif /* !_PARALLELQLEARNER_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
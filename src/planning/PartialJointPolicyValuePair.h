@@ -36,6 +36,8 @@ class PartialJointPolicyValuePair : public PartialPolicyPoolItemInterface
 {   
     private:
         double _m_val;
+        /// The BG of which the last stage of the policy is a solution.
+        boost::shared_ptr<const BayesianGameForDecPOMDPStage> _m_prevBG;
 
     protected:
     public:
@@ -59,6 +61,14 @@ class PartialJointPolicyValuePair : public PartialPolicyPoolItemInterface
 
         void SetValue(double value)
             { _m_val=value; }
+
+        boost::shared_ptr<const BayesianGameForDecPOMDPStage>
+        GetPreviousBG() const
+            { return(_m_prevBG); }
+
+        void SetPreviousBG(
+            const boost::shared_ptr<const BayesianGameForDecPOMDPStage> &bg)
+            { _m_prevBG=bg; }
 };
 
 namespace std{
@@ -29,6 +29,7 @@ typedef boost::shared_ptr<PartialPolicyPoolItemInterface> PartialPolicyPoolItemI
 class BayesianGameIdenticalPayoffSolver;
 class PartialJointPolicyDiscretePure;
 class BGCG_Solver;
+class BayesianGameForDecPOMDPStage;
 
 /**\brief PartialPolicyPoolItemInterface is a class that gives the
  * interface for a PolicyPoolItem. A PolicyPoolItem is a wrapper for a
@@ -90,6 +91,19 @@ class PartialPolicyPoolItemInterface
         SetBGCGSolverPointer(
             const boost::shared_ptr<BGCG_Solver> &bgcgs) = 0;
 
+        /**\brief Returns the BG that was solved to obtain the last stage
+         * of GetJPol(), or 0 if it is not known.
+         *
+         * This BG can be extended to construct the BG for the next stage
+         * incrementally.*/
+        virtual boost::shared_ptr<const BayesianGameForDecPOMDPStage>
+        GetPreviousBG() const = 0;
+        /** \brief Sets the BG that was solved to obtain the last stage of
+         * GetJPol(). */
+        virtual void 
+        SetPreviousBG(
+            const boost::shared_ptr<const BayesianGameForDecPOMDPStage> &bg) = 0;
+
 //------------------------------------
 //avoid use of the following functions
 //(consider them deprecated)        
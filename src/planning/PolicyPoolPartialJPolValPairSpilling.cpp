@@ -0,0 +1,503 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <float.h>
+#include "PolicyPoolPartialJPolValPairSpilling.h"
+#include "PartialJointPolicyPureVector.h"
+#include "PolicyPureVector.h"
+#include "BayesianGameForDecPOMDPStage.h"
+#include "BayesianGameIdenticalPayoffSolver.h"
+
+using namespace std;
+
+//Default constructor
+PolicyPoolPartialJPolValPairSpilling::PolicyPoolPartialJPolValPairSpilling(
+    size_t memoryBudget) :
+    _m_memoryBudget(memoryBudget),
+    _m_memoryUsed(0),
+    _m_spillFile(0),
+    _m_spillFileEnd(0),
+    _m_pu(0)
+{
+}
+
+//Destructor
+PolicyPoolPartialJPolValPairSpilling::~PolicyPoolPartialJPolValPairSpilling()
+{
+    if(_m_spillFile)
+        fclose(_m_spillFile);
+}
+
+//Copy assignment operator
+PolicyPoolPartialJPolValPairSpilling& PolicyPoolPartialJPolValPairSpilling::operator=
+    (const PolicyPoolPartialJPolValPairSpilling& o)
+{
+    if (this == &o) return *this;   // Gracefully handle self assignment
+
+    Clear();
+    _m_memoryBudget=o._m_memoryBudget;
+    _m_pu=o._m_pu;
+    for(ItemMap::const_iterator it=o._m_items.begin(); it!=o._m_items.end(); ++it)
+        InsertItem(it->second.ppi);
+    //the spilled items of o are read back, and spilled again to our own
+    //file if necessary
+    for(SpillMap::const_iterator it=o._m_spilled.begin(); it!=o._m_spilled.end(); ++it)
+        InsertItem(o.Read(it->second, it->first));
+    Spill();
+
+    return *this;
+}
+
+PartialPolicyPoolInterface& PolicyPoolPartialJPolValPairSpilling::operator=
+    (const PartialPolicyPoolInterface& o)
+{
+    if (this == &o) return *this;   // Gracefully handle self assignment
+    const PolicyPoolPartialJPolValPairSpilling& casted_o =
+        dynamic_cast<const PolicyPoolPartialJPolValPairSpilling&>(o);
+
+    return(operator=(casted_o));
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Init(const Interface_ProblemToPolicyDiscretePure* pu)
+{
+    //start with a horizon 0 joint policy - i.e. specifying 0 actions
+    _m_pu=pu;
+    boost::shared_ptr<PartialJointPolicyPureVector> jpol_empty =
+        boost::shared_ptr<PartialJointPolicyPureVector>(
+            new PartialJointPolicyPureVector(pu, OHIST_INDEX, 0.0, 0));
+    PartialJPDPValuePair_sharedPtr jpv_empty =
+        PartialJPDPValuePair_sharedPtr(new PartialJPDPValuePair(jpol_empty, DBL_MAX) );
+    InsertItem(jpv_empty);
+}
+
+PartialPolicyPoolItemInterface_sharedPtr PolicyPoolPartialJPolValPairSpilling::Select() const
+{
+    //Restore() makes sure the best-ranked item is in memory
+    if(_m_items.empty())
+        throw E("Pool empty!");
+    return((--_m_items.end())->second.ppi);
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Pop(PartialPolicyPoolItemInterface_sharedPtr ppiToBeRemoved)
+{
+    if(_m_items.empty())
+        throw E("Pool empty!");
+    ItemMap::iterator top=--_m_items.end();
+    if(ppiToBeRemoved!=0 &&
+       top->second.ppi!=ppiToBeRemoved)
+        throw(E("PolicyPoolPartialJPolValPairSpilling::Pop not the correct ppi to be popped"));
+    EraseItem(top);
+    Restore();
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Insert(PartialPolicyPoolItemInterface_sharedPtr ppi)
+{
+    PartialJPDPValuePair_sharedPtr jp = boost::dynamic_pointer_cast<PartialJPDPValuePair>(ppi);
+
+    if(jp==0)
+         throw(E("PolicyPoolPartialJPolValPairSpilling::Insert could not cast input to PartialJPDPValuePair"));
+
+    InsertItem(jp);
+    Spill();
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Union(PartialPolicyPoolInterface_sharedPtr  o)
+{
+    if(o.get()==this)
+        return;
+    while(!o->Empty())
+    {
+        Insert(o->Select());
+        o->Pop();
+    }
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Prune(double v)
+{
+    //the items with a value <= v are at the front of both indices
+    ItemMap::iterator lastItem=_m_items.upper_bound(v);
+    while(_m_items.begin()!=lastItem)
+        EraseItem(_m_items.begin());
+
+    SpillMap::iterator lastSpilled=_m_spilled.upper_bound(v);
+    for(SpillMap::iterator it=_m_spilled.begin(); it!=lastSpilled; ++it)
+        FreeExtent(it->second);
+    _m_spilled.erase(_m_spilled.begin(), lastSpilled);
+    if(_m_spilled.empty())
+        ClearSpillFile();
+}
+
+void PolicyPoolPartialJPolValPairSpilling::SetMemoryBudget(size_t memoryBudget)
+{
+    _m_memoryBudget=memoryBudget;
+    Spill();
+}
+
+string PolicyPoolPartialJPolValPairSpilling::SoftPrint() const
+{
+    stringstream ss;
+    //merge the items in memory and on disk, highest value first
+    ItemMap::const_reverse_iterator it=_m_items.rbegin();
+    SpillMap::const_reverse_iterator its=_m_spilled.rbegin();
+    while(it!=_m_items.rend() || its!=_m_spilled.rend())
+    {
+        if(its==_m_spilled.rend() ||
+           (it!=_m_items.rend() && it->first >= its->first))
+        {
+            ss << it->second.ppi->SoftPrint() << endl;
+            ++it;
+        }
+        else
+        {
+            ss << Read(its->second, its->first)->SoftPrint() << endl;
+            ++its;
+        }
+    }
+    return(ss.str());
+}
+
+void PolicyPoolPartialJPolValPairSpilling::InsertItem(
+    const PartialJPDPValuePair_sharedPtr &ppi)
+{
+    if(_m_pu==0)
+        _m_pu=ppi->GetJPol()->GetInterfacePTPDiscretePure();
+    Item item;
+    item.ppi=ppi;
+    item.bytes=EstimateSize(ppi);
+    AddSharedObjects(item);
+    _m_items.insert(make_pair(ppi->GetValue(), item));
+    _m_memoryUsed+=item.bytes;
+}
+
+void PolicyPoolPartialJPolValPairSpilling::EraseItem(ItemMap::iterator it)
+{
+    _m_memoryUsed-=it->second.bytes;
+    ReleaseSharedObjects(it->second);
+    _m_items.erase(it);
+}
+
+void PolicyPoolPartialJPolValPairSpilling::AddSharedObjects(Item &item)
+{
+    const PartialJPDPValuePair &ppi=*item.ppi;
+    boost::shared_ptr<const BayesianGameIdenticalPayoffSolver> solver=
+        ppi.GetBGIPSolverPointer();
+    if(solver==0)
+        solver=ppi.GetBGIPSolver_T_PointerJPPV();
+    if(solver==0)
+        solver=ppi.GetBGIPSolver_T_PointerCluster();
+    boost::shared_ptr<const BayesianGameForDecPOMDPStage> previousBG=
+        ppi.GetPreviousBG();
+
+    //the most derived objects, a BG can be referred to through
+    //different base classes
+    const void* objects[NR_SHARED_OBJECTS]={
+        dynamic_cast<const void*>(previousBG.get()),
+        dynamic_cast<const void*>(solver.get()),
+        solver ? dynamic_cast<const void*>(solver->GetBGIPI().get()) : 0 };
+    for(Index i=0; i < NR_SHARED_OBJECTS; i++)
+    {
+        item.shared[i]=objects[i];
+        if(objects[i]==0)
+            continue;
+        SharedObjectMap::iterator it=_m_sharedObjects.find(objects[i]);
+        if(it!=_m_sharedObjects.end())
+        {
+            it->second.nrItems++;
+            continue;
+        }
+        SharedObject o;
+        o.nrItems=1;
+        if(i==0)
+            o.bytes=previousBG->GetNrBytes();
+        else if(i==1)
+            o.bytes=solver->GetNrBytes();
+        else
+            o.bytes=solver->GetBGIPI()->GetNrBytes();
+        _m_sharedObjects.insert(make_pair(objects[i], o));
+        _m_memoryUsed+=o.bytes;
+    }
+}
+
+void PolicyPoolPartialJPolValPairSpilling::ReleaseSharedObjects(const Item &item)
+{
+    for(Index i=0; i < NR_SHARED_OBJECTS; i++)
+    {
+        if(item.shared[i]==0)
+            continue;
+        SharedObjectMap::iterator it=_m_sharedObjects.find(item.shared[i]);
+        if(it==_m_sharedObjects.end())
+            throw(E("PolicyPoolPartialJPolValPairSpilling::ReleaseSharedObjects object not found"));
+        if(--it->second.nrItems==0)
+        {
+            _m_memoryUsed-=it->second.bytes;
+            _m_sharedObjects.erase(it);
+        }
+    }
+}
+
+void PolicyPoolPartialJPolValPairSpilling::FreeExtent(const SpillRecord &record)
+{
+    long offset=record.offset;
+    size_t bytes=record.bytes;
+    ExtentOffsetMap::iterator next=_m_freeExtentOffsets.lower_bound(offset);
+    if(next!=_m_freeExtentOffsets.begin())
+    {
+        ExtentOffsetMap::iterator prev=next;
+        --prev;
+        if(prev->first + static_cast<long>(prev->second) == offset)
+        {
+            offset=prev->first;
+            bytes+=prev->second;
+            RemoveFreeExtent(prev->first, prev->second);
+        }
+    }
+    if(next!=_m_freeExtentOffsets.end() &&
+       offset + static_cast<long>(bytes) == next->first)
+    {
+        bytes+=next->second;
+        RemoveFreeExtent(next->first, next->second);
+    }
+
+    if(offset + static_cast<long>(bytes) == _m_spillFileEnd)
+        _m_spillFileEnd=offset;
+    else
+        AddFreeExtent(offset, bytes);
+}
+
+void PolicyPoolPartialJPolValPairSpilling::AddFreeExtent(long offset,
+                                                         size_t bytes)
+{
+    _m_freeExtents.insert(make_pair(bytes, offset));
+    _m_freeExtentOffsets.insert(make_pair(offset, bytes));
+}
+
+void PolicyPoolPartialJPolValPairSpilling::RemoveFreeExtent(long offset,
+                                                            size_t bytes)
+{
+    pair<ExtentMap::iterator,ExtentMap::iterator> range=
+        _m_freeExtents.equal_range(bytes);
+    for(ExtentMap::iterator it=range.first; it!=range.second; ++it)
+        if(it->second==offset)
+        {
+            _m_freeExtents.erase(it);
+            break;
+        }
+    _m_freeExtentOffsets.erase(offset);
+}
+
+void PolicyPoolPartialJPolValPairSpilling::ClearSpillFile()
+{
+    _m_spillFileEnd=0;
+    _m_freeExtents.clear();
+    _m_freeExtentOffsets.clear();
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Clear()
+{
+    _m_items.clear();
+    _m_spilled.clear();
+    _m_sharedObjects.clear();
+    _m_memoryUsed=0;
+    ClearSpillFile();
+}
+
+size_t PolicyPoolPartialJPolValPairSpilling::EstimateSize(
+    const PartialJPDPValuePair_sharedPtr &ppi) const
+{
+    //the index entry, the item and the joint policy object
+    size_t bytes=sizeof(ItemMap::value_type) + 4*sizeof(void*) +
+        sizeof(PartialJPDPValuePair) + sizeof(PartialJointPolicyPureVector);
+    const PartialJointPolicyDiscretePure& jpol=*ppi->GetJPol();
+    const Interface_ProblemToPolicyDiscretePure* pu=
+        jpol.GetInterfacePTPDiscretePure();
+    if(pu!=0)
+    {
+        //the individual policies (counting the stages they share with
+        //other policies as well, so this is an overestimate)
+        for(Index agI=0; agI < pu->GetNrAgents(); agI++)
+        {
+            const PolicyPureVector* pol=dynamic_cast<const PolicyPureVector*>(
+                jpol.GetIndividualPolicyDiscrete(agI));
+            if(pol)
+                bytes+=sizeof(PolicyPureVector) + pol->GetNrBytes();
+        }
+    }
+    return(bytes);
+}
+
+bool PolicyPoolPartialJPolValPairSpilling::CanSpill(
+    const PartialJPDPValuePair_sharedPtr &ppi) const
+{
+    //items that are expanded incrementally keep their BG solver
+    if(ppi->GetBGIPSolverPointer()!=0 ||
+       ppi->GetBGCGSolverPointer()!=0 ||
+       ppi->GetBGIPSolver_T_PointerJPPV()!=0 ||
+       ppi->GetBGIPSolver_T_PointerCluster()!=0)
+        return(false);
+    const PartialJointPolicyDiscretePure* jpol=ppi->GetJPol().get();
+    if(dynamic_cast<const PartialJointPolicyPureVector*>(jpol)==0 ||
+       jpol->GetPolicyDomainCategory()!=PolicyGlobals::OHIST_INDEX ||
+       jpol->GetInterfacePTPDiscretePure()!=_m_pu)
+        return(false);
+    return(true);
+}
+
+size_t PolicyPoolPartialJPolValPairSpilling::GetNrBitsPerAction(Index agentI) const
+{
+    size_t nrActions=_m_pu->GetNrActions(agentI);
+    size_t nrBits=0;
+    while((static_cast<size_t>(1) << nrBits) < nrActions)
+        nrBits++;
+    return(nrBits);
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Spill()
+{
+    if(_m_memoryBudget==0 || _m_memoryUsed <= _m_memoryBudget)
+        return;
+
+    //spill until we are a quarter below the budget, so that we do not
+    //have to spill again on the next insertion
+    size_t target=_m_memoryBudget - _m_memoryBudget/4;
+    ItemMap::iterator it=_m_items.begin();
+    //the best-ranked item always stays in memory
+    ItemMap::iterator top=--_m_items.end();
+    while(_m_memoryUsed > target && it!=top)
+    {
+        if(CanSpill(it->second.ppi))
+        {
+            _m_spilled.insert(make_pair(it->first, Write(it->second.ppi)));
+            EraseItem(it++);
+        }
+        else
+            ++it;
+    }
+}
+
+void PolicyPoolPartialJPolValPairSpilling::Restore()
+{
+    while(!_m_spilled.empty() &&
+          (_m_items.empty() ||
+           (--_m_spilled.end())->first > (--_m_items.end())->first))
+    {
+        SpillMap::iterator it=--_m_spilled.end();
+        InsertItem(Read(it->second, it->first));
+        FreeExtent(it->second);
+        _m_spilled.erase(it);
+    }
+    //the whole file can be reused once all items have been read back
+    if(_m_spilled.empty())
+        ClearSpillFile();
+}
+
+PolicyPoolPartialJPolValPairSpilling::SpillRecord
+PolicyPoolPartialJPolValPairSpilling::Write(const PartialJPDPValuePair_sharedPtr &ppi)
+{
+    if(_m_spillFile==0)
+    {
+        _m_spillFile=tmpfile();
+        if(_m_spillFile==0)
+            throw(E("PolicyPoolPartialJPolValPairSpilling::Write could not create the spill file"));
+    }
+
+    const PartialJointPolicyDiscretePure& jpol=*ppi->GetJPol();
+    SpillRecord record;
+    record.depth=jpol.GetDepth();
+
+    //pack the actions of all agents in a bit string
+    vector<unsigned char> buffer;
+    size_t bitI=0;
+    for(Index agI=0; agI < _m_pu->GetNrAgents(); agI++)
+    {
+        size_t nrBits=GetNrBitsPerAction(agI);
+        size_t nrOH=_m_pu->GetNrPolicyDomainElements(
+            agI, PolicyGlobals::OHIST_INDEX, record.depth);
+        buffer.resize((bitI + nrBits*nrOH + 7)/8, 0);
+        for(Index ohI=0; ohI < nrOH; ohI++)
+        {
+            Index aI=jpol.GetActionIndex(agI, ohI);
+            for(size_t b=0; b < nrBits; b++, bitI++)
+                if(aI & (1u << b))
+                    buffer[bitI/8] |= static_cast<unsigned char>(1u << (bitI%8));
+        }
+    }
+
+    //reuse the smallest free extent that is large enough, or append
+    record.bytes=sizeof(double) + buffer.size();
+    ExtentMap::iterator extent=_m_freeExtents.lower_bound(record.bytes);
+    if(extent!=_m_freeExtents.end())
+    {
+        record.offset=extent->second;
+        size_t extentBytes=extent->first;
+        RemoveFreeExtent(record.offset, extentBytes);
+        if(extentBytes > record.bytes)
+            AddFreeExtent(record.offset + static_cast<long>(record.bytes),
+                          extentBytes - record.bytes);
+    }
+    else
+    {
+        record.offset=_m_spillFileEnd;
+        _m_spillFileEnd+=record.bytes;
+    }
+
+    double pastReward=jpol.GetPastReward();
+    if(fseek(_m_spillFile, record.offset, SEEK_SET)!=0 ||
+       fwrite(&pastReward, sizeof(double), 1, _m_spillFile)!=1 ||
+       (!buffer.empty() &&
+        fwrite(&buffer[0], 1, buffer.size(), _m_spillFile)!=buffer.size()))
+        throw(E("PolicyPoolPartialJPolValPairSpilling::Write could not write to the spill file"));
+
+    return(record);
+}
+
+PartialJPDPValuePair_sharedPtr
+PolicyPoolPartialJPolValPairSpilling::Read(const SpillRecord& record,
+                                           double value) const
+{
+    size_t nrAgents=_m_pu->GetNrAgents();
+    vector<size_t> nrBits(nrAgents), nrOH(nrAgents);
+    size_t totalBits=0;
+    for(Index agI=0; agI < nrAgents; agI++)
+    {
+        nrBits[agI]=GetNrBitsPerAction(agI);
+        nrOH[agI]=_m_pu->GetNrPolicyDomainElements(
+            agI, PolicyGlobals::OHIST_INDEX, record.depth);
+        totalBits+=nrBits[agI]*nrOH[agI];
+    }
+
+    double pastReward;
+    vector<unsigned char> buffer((totalBits+7)/8);
+    if(fseek(_m_spillFile, record.offset, SEEK_SET)!=0 ||
+       fread(&pastReward, sizeof(double), 1, _m_spillFile)!=1 ||
+       (!buffer.empty() &&
+        fread(&buffer[0], 1, buffer.size(), _m_spillFile)!=buffer.size()))
+        throw(E("PolicyPoolPartialJPolValPairSpilling::Read could not read from the spill file"));
+
+    boost::shared_ptr<PartialJointPolicyPureVector> jpol(
+        new PartialJointPolicyPureVector(_m_pu, OHIST_INDEX, pastReward,
+                                         record.depth));
+    size_t bitI=0;
+    for(Index agI=0; agI < nrAgents; agI++)
+        for(Index ohI=0; ohI < nrOH[agI]; ohI++)
+        {
+            Index aI=0;
+            for(size_t b=0; b < nrBits[agI]; b++, bitI++)
+                if(buffer[bitI/8] & (1u << (bitI%8)))
+                    aI |= (1u << b);
+            jpol->SetAction(agI, ohI, aI);
+        }
+
+    return(PartialJPDPValuePair_sharedPtr(new PartialJPDPValuePair(jpol, value)));
+}
@@ -0,0 +1,274 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _POLICYPOOLPARTIALJPOLVALPAIRSPILLING_H_
+#define _POLICYPOOLPARTIALJPOLVALPAIRSPILLING_H_ 1
+
+/* the include directives */
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "Globals.h"
+#include "PartialJPDPValuePair.h"
+#include "PartialPolicyPoolInterface.h"
+#include "boost/shared_ptr.hpp"
+
+class PolicyPoolPartialJPolValPairSpilling;
+typedef boost::shared_ptr<PolicyPoolPartialJPolValPairSpilling> PolicyPoolPartialJPolValPairSpilling_sharedPtr;
+
+
+/**\brief PolicyPoolPartialJPolValPairSpilling is a policy pool with
+ * partial joint policy - value pairs that keeps its memory usage below a
+ * given budget by moving low-valued items to disk.
+ *
+ * The items are indexed by their value (a std::multimap), which allows
+ * both the best-ranked item to be selected and the worst-ranked items to be
+ * found in logarithmic time. Prune(v) therefore only touches the items it
+ * removes, rather than rebuilding the whole pool as
+ * PolicyPoolPartialJPolValPair does.
+ *
+ * When the estimated memory used by the items exceeds the budget, the
+ * lowest-valued items are written to a temporary file. Their partial joint
+ * policy is stored compactly: only the actions for the observation
+ * histories up to its depth are written, using as few bits per action as
+ * the agent's number of actions allows. In memory only the value and the
+ * file offset are kept. A spilled item is read back as soon as it would be
+ * the best-ranked item, so the order in which items are selected is not
+ * affected.
+ *
+ * Only items that consist of a PartialJointPolicyPureVector and value are
+ * spilled. Items that carry a BG solver (see
+ * PartialPolicyPoolItemInterface::GetBGIPSolverPointer(), used for
+ * incremental expansion) always stay in memory, and the BG of the previous
+ * stage (GetPreviousBG()) is dropped when an item is spilled, in which case
+ * the next BG is constructed from scratch.
+ *
+ * The memory used counts the BGs and solvers the items refer to: the
+ * previous BG, which the children of an expanded item share, and the
+ * solver of an incrementally expanded item together with its BG. Each of
+ * these is counted once, as long as an item in memory refers to it.
+ *
+ * The space of items that are read back or pruned is reused for items
+ * that are spilled later.
+ */
+class PolicyPoolPartialJPolValPairSpilling : public PartialPolicyPoolInterface
+{
+    private:
+
+        /// The number of shared objects an item can refer to.
+        static const size_t NR_SHARED_OBJECTS=3;
+
+        /// An item in memory, with its estimated size in bytes.
+        struct Item
+        {
+            PartialJPDPValuePair_sharedPtr ppi;
+            size_t bytes;
+            /// The BGs and solver the item refers to (0 if unused), see
+            /// AddSharedObjects().
+            const void* shared[NR_SHARED_OBJECTS];
+        };
+        typedef std::multimap<double, Item> ItemMap;
+
+        /// A BG or solver referred to by items in memory.
+        struct SharedObject
+        {
+            size_t nrItems;
+            size_t bytes;
+        };
+        typedef std::map<const void*, SharedObject> SharedObjectMap;
+
+        /// An item that has been written to the spill file.
+        struct SpillRecord
+        {
+            long offset;
+            size_t bytes;
+            size_t depth;
+        };
+        typedef std::multimap<double, SpillRecord> SpillMap;
+        /// Unused extents of the spill file, indexed by their size.
+        typedef std::multimap<size_t, long> ExtentMap;
+        /// Unused extents of the spill file, size indexed by offset.
+        typedef std::map<long, size_t> ExtentOffsetMap;
+
+        /// The items in memory, indexed by their value when inserted.
+        ItemMap _m_items;
+        /// The items on disk, indexed by their value.
+        SpillMap _m_spilled;
+        /// The BGs and solvers the items in memory refer to.
+        SharedObjectMap _m_sharedObjects;
+
+        /// The memory budget in bytes (0 means unlimited).
+        size_t _m_memoryBudget;
+        /// The estimated memory used by the items in _m_items.
+        size_t _m_memoryUsed;
+
+        /// The spill file (created when it is first needed).
+        FILE* _m_spillFile;
+        /// The end of the used part of the spill file.
+        long _m_spillFileEnd;
+        /// The extents before _m_spillFileEnd that can be reused.
+        /** Adjacent free extents are merged, and a free extent never
+         * ends at _m_spillFileEnd. */
+        ExtentMap _m_freeExtents;
+        /// The same extents as _m_freeExtents, to find adjacent ones.
+        ExtentOffsetMap _m_freeExtentOffsets;
+
+        /// The problem the spilled policies refer to.
+        const Interface_ProblemToPolicyDiscretePure* _m_pu;
+
+        /// Estimates the memory used by ppi.
+        size_t EstimateSize(const PartialJPDPValuePair_sharedPtr &ppi) const;
+        /// Returns whether ppi can be written to the spill file.
+        bool CanSpill(const PartialJPDPValuePair_sharedPtr &ppi) const;
+        /// Returns the number of bits used to store an action of agentI.
+        size_t GetNrBitsPerAction(Index agentI) const;
+
+        /// Writes the items with the lowest values to disk, until the
+        /// memory used is well below the budget.
+        void Spill();
+        /// Reads back spilled items that rank above the items in memory.
+        void Restore();
+        /// Writes ppi to the spill file.
+        SpillRecord Write(const PartialJPDPValuePair_sharedPtr &ppi);
+        /// Reads the item stored at record from the spill file.
+        PartialJPDPValuePair_sharedPtr Read(const SpillRecord& record,
+                                            double value) const;
+
+        /// Adds ppi to the items in memory.
+        void InsertItem(const PartialJPDPValuePair_sharedPtr &ppi);
+        /// Removes the item at it from memory.
+        void EraseItem(ItemMap::iterator it);
+        /// Counts the BGs and solver of item.ppi, if not counted yet.
+        void AddSharedObjects(Item &item);
+        /// Releases what AddSharedObjects() counted for item.
+        void ReleaseSharedObjects(const Item &item);
+        /// Makes the extent of record available for reuse.
+        /** It is merged with the free extents before and after it, and
+         * the file end moves back if it is the last extent. */
+        void FreeExtent(const SpillRecord &record);
+        /// Adds a free extent to both indices.
+        void AddFreeExtent(long offset, size_t bytes);
+        /// Removes a free extent from both indices.
+        void RemoveFreeExtent(long offset, size_t bytes);
+        /// Marks the whole spill file as unused.
+        void ClearSpillFile();
+        /// Removes the items, in memory and on disk.
+        void Clear();
+
+        /// Copy constructor (not implemented, the spill file is not shared).
+        PolicyPoolPartialJPolValPairSpilling(const PolicyPoolPartialJPolValPairSpilling& a);
+
+    protected:
+
+    public:
+        // Constructor, destructor and copy assignment.
+        /// (default) Constructor
+        /** memoryBudget is the budget in bytes for the items kept in
+         * memory, 0 means that items are never spilled. */
+        PolicyPoolPartialJPolValPairSpilling(size_t memoryBudget=0);
+        /// Destructor.
+        ~PolicyPoolPartialJPolValPairSpilling();
+        /// Copy assignment operator
+        PolicyPoolPartialJPolValPairSpilling& operator= (const PolicyPoolPartialJPolValPairSpilling& o);
+        PartialPolicyPoolInterface& operator= (const PartialPolicyPoolInterface& o);
+
+        //operators:
+
+        //data manipulation (set) functions:
+        /**\brief  initializes the policy pool with the empty joint policy
+         * and a heuristic value set to infinuty (i.e., DBL_MAX)
+         *
+         * A pointer to a Interface_ProblemToPolicyDiscretePure is needed to create the
+         * joint policy.
+         */
+        void Init(const Interface_ProblemToPolicyDiscretePure* pu);
+
+        /**\brief The 'Select' operator from #refGMAA.
+         *
+         * This returns the item with the highest value. The returned
+         * PolicyPoolItem is not removed from the PolicyPool.
+         */
+        PartialPolicyPoolItemInterface_sharedPtr Select() const;
+        /**\brief Removes the item returned by 'Select'.
+         *
+         * If ppiToBeRemoved is specified, it actually checks that the
+         * desired PPI is removed.
+         */
+        void Pop(PartialPolicyPoolItemInterface_sharedPtr ppiToBeRemoved =
+                 PartialPolicyPoolItemInterface_sharedPtr());
+        /**\brief returns the contained item with the highest value.
+         *
+         * Because this class always 'select's the best ranked policy, this
+         * function does the same as 'Select()'.
+         */
+        PartialPolicyPoolItemInterface_sharedPtr GetBestRanked() const
+        {return(Select());};
+        /**\brief remove the GetBestRanked() item
+         *
+         * Because this class always 'select's the best ranked policy, this
+         * function does the same as 'Pop()'.
+         */
+        void PopBestRanked()
+        {Pop();};
+        /**\brief Add a PolicyPoolItem to the Pool.
+         *
+         * The item should be a PartialJPDPValuePair.
+         */
+        void Insert(PartialPolicyPoolItemInterface_sharedPtr  ppi);
+
+        /**\brief add all elements of pp to 'this'.
+         *
+         * Note, that the pool pp is emptied in this process.
+         */
+        void Union(PartialPolicyPoolInterface_sharedPtr  pp);
+        /**\brief Removes all items with a value <= v. */
+        void Prune(double v);
+
+        /// Sets the memory budget in bytes (0 means unlimited).
+        void SetMemoryBudget(size_t memoryBudget);
+
+        //get (data) functions:
+
+        /**\brief return the number of items in the policy pool
+         *
+         * This includes the items that have been spilled to disk.
+         */
+        size_t Size() const
+        { return(_m_items.size() + _m_spilled.size()); }
+        /// Returns the number of items that are currently on disk.
+        size_t GetNrSpilledItems() const
+        { return(_m_spilled.size()); }
+        /// Returns the size of the used part of the spill file in bytes.
+        /** This includes the free extents that lie before the last item
+         * on disk. */
+        size_t GetSpillFileSize() const
+        { return(static_cast<size_t>(_m_spillFileEnd)); }
+        /**Returns the estimated memory used by the items in memory,
+         * including the BGs and solvers they refer to.*/
+        size_t GetMemoryUsed() const
+        { return(_m_memoryUsed); }
+
+        std::string SoftPrint() const;
+
+};
+
+
+#endif /* !_POLICYPOOLPARTIALJPOLVALPAIRSPILLING_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
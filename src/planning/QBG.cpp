@@ -13,6 +13,7 @@
  * For contact information please see the included AUTHORS file.
  */
 
+#include <float.h>
 #include "QBG.h"
 #include "JointBelief.h"
 #include "PlanningUnitDecPOMDPDiscrete.h"
@@ -23,6 +24,8 @@
 #include "BeliefIteratorGeneric.h"
 #include "BayesianGameIdenticalPayoff.h"
 #include "BGIP_SolverBruteForceSearch.h"
+#include "BGIP_SolutionCache.h"
+#include "JPPVValuePair.h"
 
 using namespace std;
 
@@ -209,8 +212,7 @@ double QBG::ComputeRecursively(size_t time_step, JointActionObservationHistoryTr
     }//end for newJOI
 
     //solve this bayesian game
-    BGIP_SolverBruteForceSearch<JointPolicyPureVector> bgs(bg_time_step,0,1);
-    double v = bgs.Solve();
+    double v = SolveBG(bg_time_step);
     if(DEBUG_QBG_COMPREC){
         cout << "QBG::ComputeRecursively:"<< endl << "time_step t="<<
             time_step << ", prev. jaoh index jaoh^(t-1)="<<jaohI
@@ -223,6 +225,49 @@ double QBG::ComputeRecursively(size_t time_step, JointActionObservationHistoryTr
     return( v );
 }
 
+double QBG::ComputeFutureReward(const double* probs,
+                                const vector<const double*>& nextQ) const
+{
+    //the BG for the next time step has the joint observations as joint
+    //types, and the Qvalues of the resulting joint beliefs as payoffs
+    BGIP_sharedPtr bg_time_step=BGIP_sharedPtr(
+        new BayesianGameIdenticalPayoff(GetPU()->GetNrAgents(), 
+                                        GetPU()->GetNrActions(),
+                                        GetPU()->GetNrObservations()));
+    size_t nrJA = GetPU()->GetNrJointActions();
+    for(Index newJOI=0; newJOI < nextQ.size(); newJOI++)
+    {
+        if(nextQ[newJOI] == 0)
+            continue;
+        bg_time_step->SetProbability(newJOI, probs[newJOI]);
+        for(Index newJAI=0; newJAI < nrJA; newJAI++)
+            bg_time_step->SetUtility(newJOI, newJAI, nextQ[newJOI][newJAI]);
+    }
+    return( SolveBG(bg_time_step) );
+}
+
+double QBG::SolveBG(const BGIP_sharedPtr &bg) const
+{
+    //solve this bayesian game, unless it has been solved before
+    double v;
+    vector<boost::shared_ptr<JPPVValuePair> > solutions;
+    if(_m_bgSolutionCache &&
+       _m_bgSolutionCache->Lookup(bg,1,-DBL_MAX,DBL_MAX,solutions) &&
+       !solutions.empty())
+        v = solutions[0]->GetValue();
+    else
+    {
+        BGIP_SolverBruteForceSearch<JointPolicyPureVector> bgs(bg,0,1);
+        v = bgs.Solve();
+        if(_m_bgSolutionCache)
+        {
+            solutions.assign(1,bgs.GetNextSolutionJPPV());
+            _m_bgSolutionCache->Store(bg,-DBL_MAX,DBL_MAX,solutions,false);
+        }
+    }
+    return( v );
+}
+
 
 void QBG::ComputeNoCache()
 {
@@ -21,8 +21,11 @@
 #include <iostream>
 #include "Globals.h"
 #include "QFunctionJAOHTree.h"
+#include "BayesianGameIdenticalPayoff.h"
+#include "boost/shared_ptr.hpp"
 
 class JointBelief;
+class BGIP_SolutionCache;
 
 /**\brief QBG is a class that represents the QBG heuristic.
  *
@@ -44,6 +47,16 @@ private:
                               Index lastJAI);
 #endif
 
+    /**Computes the expected future reward for ComputeQStagewise(). */
+    double ComputeFutureReward(const double* probs,
+                               const std::vector<const double*>& nextQ) const;
+
+    /// Solves bg, or looks up its solution in the cache.
+    double SolveBG(const BGIP_sharedPtr &bg) const;
+
+    /// The cache of BG solutions, if any.
+    boost::shared_ptr<BGIP_SolutionCache> _m_bgSolutionCache;
+
 protected:
     
     public:
@@ -58,6 +71,16 @@ protected:
     //operators:
     
     //data manipulation (set) functions:
+
+    /**\brief Sets a cache of BG solutions.
+     *
+     * Each BG that is constructed is then looked up in the cache
+     * before it is solved. This pays off when many joint
+     * action-observation histories lead to the same BG, e.g., when
+     * they have the same joint belief. By default no cache is used.
+     */
+    void SetBGSolutionCache(const boost::shared_ptr<BGIP_SolutionCache> &cache)
+    { _m_bgSolutionCache=cache; }
     
     /**Compute the heuristic. (after associated with an initialized 
      * PlanningUnitDecPOMDPDiscrete) */
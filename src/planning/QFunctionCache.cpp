@@ -0,0 +1,329 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include "QFunctionCache.h"
+#include "PlanningUnitDecPOMDPDiscrete.h"
+#include "MDPTransitionRows.h"
+#include "ObservationModelMapping.h"
+#include "ObservationModelMappingSparse.h"
+#include <fstream>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define DEBUG_QFunctionCache 0
+
+namespace {
+
+/// The first bytes of a cache file (the last one is the format version).
+const char cacheFileMagic[8] = { 'M', 'A', 'D', 'P', 'Q', 'C', 0, 2 };
+
+/// Adds the bytes of x to the FNV-1a hash h.
+template <class T>
+void HashAdd(unsigned long long &h, const T &x)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&x);
+    for(size_t i = 0; i < sizeof(T); i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+/// Adds the non-zero entries of the observation matrices O, one per joint
+/// action, to the hash h.
+template <class M>
+void HashObservationRows(unsigned long long &h, const vector<const M*> &O)
+{
+    for(Index jaI = 0; jaI < O.size(); jaI++)
+        for(typename M::const_iterator1 ri = O[jaI]->begin1();
+            ri != O[jaI]->end1(); ++ri)
+            for(typename M::const_iterator2 ci = ri.begin(); ci != ri.end();
+                ++ci)
+                if(*ci > 0)
+                {
+                    HashAdd(h, jaI);
+                    HashAdd(h, static_cast<Index>(ci.index1()));
+                    HashAdd(h, static_cast<Index>(ci.index2()));
+                    HashAdd(h, static_cast<double>(*ci));
+                }
+}
+
+}
+
+QFunctionCache::QFunctionCache(const PlanningUnitDecPOMDPDiscrete* pu,
+                               const string &description) :
+    _m_pu(pu),
+    _m_description(description),
+    _m_fingerprint(0),
+    _m_fingerprintComputed(false)
+{
+}
+
+unsigned long long QFunctionCache::ComputeFingerprint(
+    const PlanningUnitDecPOMDPDiscrete* pu)
+{
+    unsigned long long h = 14695981039346656037ULL;
+    size_t nrAgents = pu->GetNrAgents();
+    HashAdd(h, nrAgents);
+    for(Index agI = 0; agI < nrAgents; agI++)
+    {
+        HashAdd(h, pu->GetNrActions(agI));
+        HashAdd(h, pu->GetNrObservations(agI));
+    }
+    size_t nrS = pu->GetNrStates();
+    size_t nrJA = pu->GetNrJointActions();
+    size_t nrJO = pu->GetNrJointObservations();
+    HashAdd(h, nrS);
+    for(Index sI = 0; sI < nrS; sI++)
+        HashAdd(h, pu->GetInitialStateProbability(sI));
+    for(Index sI = 0; sI < nrS; sI++)
+        for(Index jaI = 0; jaI < nrJA; jaI++)
+            HashAdd(h, pu->GetReward(sI, jaI));
+
+    // only the non-zero probabilities are hashed, such that the cost is
+    // linear in the size of a sparse model, and the fingerprint does not
+    // depend on how the model is stored
+    MDPTransitionRows T(*pu);
+    for(Index jaI = 0; jaI < nrJA; jaI++)
+        for(Index sI = 0; sI < nrS; sI++)
+            for(size_t e = T.RowBegin(sI, jaI); e != T.RowEnd(sI, jaI); e++)
+            {
+                HashAdd(h, jaI);
+                HashAdd(h, sI);
+                HashAdd(h, T.GetSuccessor(e));
+                HashAdd(h, T.GetProbability(e));
+            }
+
+    const ObservationModelDiscrete* om = pu->GetObservationModelDiscretePtr();
+    const ObservationModelMappingSparse* oms =
+        dynamic_cast<const ObservationModelMappingSparse*>(om);
+    const ObservationModelMapping* omm =
+        dynamic_cast<const ObservationModelMapping*>(om);
+    if(oms)
+    {
+        vector<const ObservationModelMappingSparse::SparseMatrix*> O;
+        for(Index jaI = 0; jaI < nrJA; jaI++)
+            O.push_back(oms->GetMatrixPtr(jaI));
+        HashObservationRows(h, O);
+    }
+    else if(omm)
+    {
+        vector<const ObservationModelMapping::Matrix*> O;
+        for(Index jaI = 0; jaI < nrJA; jaI++)
+            O.push_back(omm->GetMatrixPtr(jaI));
+        HashObservationRows(h, O);
+    }
+    else
+        for(Index jaI = 0; jaI < nrJA; jaI++)
+            for(Index sucSI = 0; sucSI < nrS; sucSI++)
+                for(Index joI = 0; joI < nrJO; joI++)
+                {
+                    double p = pu->GetObservationProbability(jaI, sucSI, joI);
+                    if(p > 0)
+                    {
+                        HashAdd(h, jaI);
+                        HashAdd(h, sucSI);
+                        HashAdd(h, joI);
+                        HashAdd(h, p);
+                    }
+                }
+    return(h);
+}
+
+unsigned long long QFunctionCache::GetFingerprint() const
+{
+    if(!_m_fingerprintComputed)
+    {
+        _m_fingerprint = ComputeFingerprint(_m_pu);
+        _m_fingerprintComputed = true;
+    }
+    return(_m_fingerprint);
+}
+
+size_t QFunctionCache::GetDataOffset() const
+{
+    // the description is padded such that the values are 8-byte aligned
+    return(sizeof(Header) + (_m_description.size() + 7) / 8 * 8);
+}
+
+void QFunctionCache::Save(const string &filename,
+                          const vector<const double*> &tables,
+                          size_t nrRows, size_t nrColumns) const
+{
+    ofstream fp(filename.c_str(), ios::out | ios::binary);
+    if(!fp)
+    {
+        stringstream ss;
+        ss << "QFunctionCache::Save: failed to open file " << filename;
+        throw E(ss.str());
+    }
+
+    Header header;
+    memcpy(header.magic, cacheFileMagic, sizeof(header.magic));
+    header.fingerprint = GetFingerprint();
+    header.horizon = _m_pu->GetHorizon();
+    header.discount = _m_pu->GetDiscount();
+    header.nrTables = tables.size();
+    header.nrRows = nrRows;
+    header.nrColumns = nrColumns;
+    header.descriptionLength = _m_description.size();
+    fp.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fp.write(_m_description.c_str(), _m_description.size());
+    for(size_t i = sizeof(header) + _m_description.size();
+        i < GetDataOffset(); i++)
+        fp.put(0);
+    for(Index k = 0; k < tables.size(); k++)
+        fp.write(reinterpret_cast<const char*>(tables[k]),
+                 nrRows * nrColumns * sizeof(double));
+    if(!fp)
+    {
+        stringstream ss;
+        ss << "QFunctionCache::Save: failed to write file " << filename;
+        throw E(ss.str());
+    }
+
+#if DEBUG_QFunctionCache
+    cout << "QFunctionCache::Save saved " << _m_description << " to "
+         << filename << endl;
+#endif
+}
+
+bool QFunctionCache::Load(const string &filename,
+                          const vector<double*> &tables,
+                          size_t nrRows, size_t nrColumns) const
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return(false);
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return(false);
+    }
+    size_t size = st.st_size;
+    size_t tableSize = nrRows * nrColumns * sizeof(double);
+    size_t expectedSize = GetDataOffset() + tables.size() * tableSize;
+
+    // a file of the wrong size cannot be a cache of these values, which
+    // also rules out old text files that are smaller than the header
+    string mismatch;
+    void* p = MAP_FAILED;
+    if(size != expectedSize)
+        mismatch = "its size differs";
+    else
+    {
+        p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED)
+        {
+            close(fd);
+            stringstream ss;
+            ss << "QFunctionCache::Load: failed to map file " << filename;
+            throw E(ss.str());
+        }
+    }
+    close(fd);
+
+    if(mismatch.empty())
+    {
+        const char* data = static_cast<const char*>(p);
+        const Header* header = reinterpret_cast<const Header*>(data);
+        if(memcmp(header->magic, cacheFileMagic, sizeof(header->magic)))
+            mismatch = "it is not a cache file of this version";
+        else if(header->descriptionLength != _m_description.size() ||
+                _m_description.compare(0, string::npos, data + sizeof(Header),
+                                       header->descriptionLength))
+            mismatch = "it was computed by a different heuristic";
+        else if(header->horizon != _m_pu->GetHorizon())
+            mismatch = "it was computed for a different horizon";
+        else if(header->discount != _m_pu->GetDiscount())
+            mismatch = "it was computed for a different discount";
+        else if(header->nrTables != tables.size() ||
+                header->nrRows != nrRows ||
+                header->nrColumns != nrColumns)
+            mismatch = "its size differs";
+        else if(header->fingerprint != GetFingerprint())
+            mismatch = "it was computed for a different model";
+        else
+        {
+            madvise(p, size, MADV_SEQUENTIAL);
+            for(Index k = 0; k < tables.size(); k++)
+                memcpy(tables[k], data + GetDataOffset() + k * tableSize,
+                       tableSize);
+        }
+        munmap(p, size);
+    }
+
+    if(!mismatch.empty())
+    {
+        cerr << "QFunctionCache: not using " << filename << " because "
+             << mismatch << endl;
+        return(false);
+    }
+
+#if DEBUG_QFunctionCache
+    cout << "QFunctionCache::Load loaded " << _m_description << " from "
+         << filename << endl;
+#endif
+    return(true);
+}
+
+bool QFunctionCache::Load(const string &filename,
+                          size_t nrRows,
+                          size_t nrColumns,
+                          QTable &Q) const
+{
+    // the values are read directly into Q, to avoid needing twice the memory
+    Q.resize(nrRows, nrColumns, false);
+    vector<double*> tables(1, &Q.data()[0]);
+    return(Load(filename, tables, nrRows, nrColumns));
+}
+
+bool QFunctionCache::Load(const string &filename,
+                          size_t nrRows,
+                          size_t nrColumns,
+                          size_t nrTables,
+                          QTables &Qs) const
+{
+    Qs.resize(nrTables);
+    vector<double*> tables;
+    for(Index k = 0; k < nrTables; k++)
+    {
+        Qs[k].resize(nrRows, nrColumns, false);
+        tables.push_back(&Qs[k].data()[0]);
+    }
+    return(Load(filename, tables, nrRows, nrColumns));
+}
+
+void QFunctionCache::Save(const QTable &Q, const string &filename) const
+{
+    vector<const double*> tables(1, &Q.data()[0]);
+    Save(filename, tables, Q.size1(), Q.size2());
+}
+
+void QFunctionCache::Save(const QTables &Qs, const string &filename) const
+{
+    vector<const double*> tables;
+    for(Index k = 0; k < Qs.size(); k++)
+        tables.push_back(&Qs[k].data()[0]);
+    Save(filename, tables, Qs.empty() ? 0 : Qs[0].size1(),
+         Qs.empty() ? 0 : Qs[0].size2());
+}
@@ -0,0 +1,137 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+/* Only include this header file once. */
+#ifndef _QFUNCTIONCACHE_H_
+#define _QFUNCTIONCACHE_H_ 1
+
+/* the include directives */
+#include <iostream>
+#include <string>
+#include "Globals.h"
+#include "QTable.h"
+
+class PlanningUnitDecPOMDPDiscrete;
+
+/**\brief QFunctionCache reads and writes the files in which Q-value
+ * functions are cached (see QFunctionInterface::ComputeWithCachedQValues()).
+ *
+ * A cache file is a binary file that starts with a header identifying the
+ * values: a fingerprint of the model (a hash of its initial state
+ * distribution, transition, observation and reward model), the horizon,
+ * the discount and a description of the heuristic and its parameters
+ * (typically its SoftPrintBrief()). It is followed by the Q-tables in
+ * row-major order.
+ *
+ * Load() maps the file into memory, such that the values are copied
+ * directly into the QTable without being parsed. A file whose header does
+ * not match the problem and heuristic is not loaded, so a cache that was
+ * computed for a different model is never used.
+ */
+class QFunctionCache
+{
+    private:
+
+        /// The header of a cache file.
+        /** All fields have 8 bytes, so the struct has no padding. */
+        struct Header
+        {
+            char magic[8];
+            unsigned long long fingerprint;
+            unsigned long long horizon;
+            double discount;
+            unsigned long long nrTables;
+            unsigned long long nrRows;
+            unsigned long long nrColumns;
+            /// The length of the description that follows the header.
+            unsigned long long descriptionLength;
+        };
+
+        /// The problem of which Q-values are cached.
+        const PlanningUnitDecPOMDPDiscrete* _m_pu;
+        /// Describes the heuristic and its parameters.
+        std::string _m_description;
+
+        /// The fingerprint of the model of _m_pu (computed when needed).
+        mutable unsigned long long _m_fingerprint;
+        mutable bool _m_fingerprintComputed;
+
+        unsigned long long GetFingerprint() const;
+        /// Returns the size of the header and description in the file.
+        size_t GetDataOffset() const;
+
+        /// Writes nrTables tables of nrRows x nrColumns to filename.
+        void Save(const std::string &filename,
+                  const std::vector<const double*> &tables,
+                  size_t nrRows, size_t nrColumns) const;
+        /// Reads nrTables tables of nrRows x nrColumns from filename.
+        bool Load(const std::string &filename,
+                  const std::vector<double*> &tables,
+                  size_t nrRows, size_t nrColumns) const;
+
+    protected:
+
+    public:
+        // Constructor, destructor and copy assignment.
+        /// Constructor
+        /** description identifies the heuristic and its parameters. */
+        QFunctionCache(const PlanningUnitDecPOMDPDiscrete* pu,
+                       const std::string &description);
+
+        /**\brief Loads a QTable of nrRows x nrColumns from filename.
+         *
+         * Returns false if the file does not exist, or if it was written
+         * for a different model, horizon, discount, heuristic or table
+         * size (which is reported on cerr). Q is resized in any case.
+         */
+        bool Load(const std::string &filename,
+                  size_t nrRows,
+                  size_t nrColumns,
+                  QTable &Q) const;
+
+        /// Loads nrTables QTables of nrRows x nrColumns from filename.
+        /** Returns false if the file does not exist or does not match. */
+        bool Load(const std::string &filename,
+                  size_t nrRows,
+                  size_t nrColumns,
+                  size_t nrTables,
+                  QTables &Qs) const;
+
+        /// Saves Q to filename.
+        void Save(const QTable &Q, const std::string &filename) const;
+
+        /// Saves Qs to filename.
+        void Save(const QTables &Qs, const std::string &filename) const;
+
+        /**\brief Computes the fingerprint of the model of pu.
+         *
+         * This is a hash of the number of agents, actions, observations
+         * and states, the initial state distribution and the transition,
+         * observation and reward model. Only the non-zero transition and
+         * observation probabilities are hashed, so for sparse models the
+         * cost is linear in their number of entries rather than in
+         * |S|^2|A|.
+         */
+        static unsigned long long ComputeFingerprint(
+            const PlanningUnitDecPOMDPDiscrete* pu);
+
+};
+
+
+#endif /* !_QFUNCTIONCACHE_H_ */
+
+// Local Variables: ***
+// mode:c++ ***
+// End: ***
@@ -43,7 +43,8 @@ public:
      * re-use. This behavior can be changed by settings
      * computeIfNotCached to false, in which case an Exception will be
      * thrown if the Q function has not been previously stored on
-     * disk.
+     * disk. Stored Qvalues are only used if they were computed for the
+     * same model, horizon and heuristic (see QFunctionCache).
      */
     virtual void ComputeWithCachedQValues(bool computeIfNotCached=true) = 0;
 
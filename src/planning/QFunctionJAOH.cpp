@@ -15,6 +15,7 @@
 
 #include "QFunctionJAOH.h"
 #include "PlanningUnitDecPOMDPDiscrete.h"
+#include "QFunctionCache.h"
 #include <fstream>
 
 #define DEBUG_QHEUR_COMP 0
@@ -37,15 +38,13 @@ QFunctionJAOH::QFunctionJAOH(
 void QFunctionJAOH::ComputeWithCachedQValues(const string &filenameCache,
                                              bool computeIfNotCached)
 {
-    bool cached;
-
-    {
-        ifstream fp(filenameCache.c_str());
-        if(!fp)
-            cached=false;
-        else
-            cached=true;
-    }
+    // the cache is only used if it was computed for this model, horizon
+    // and heuristic
+    QFunctionCache cache(GetPU(),SoftPrintBrief());
+    bool cached=cache.Load(filenameCache,
+                           GetPU()->GetNrJointActionObservationHistories(),
+                           GetPU()->GetNrJointActions(),
+                           _m_QValues);
 
     if(!cached && !computeIfNotCached)
     {
@@ -56,35 +55,20 @@ void QFunctionJAOH::ComputeWithCachedQValues(const string &filenameCache,
         return;
     }
 
-    // Couldn't open cache file, so compute
+    // Couldn't load cache file, so compute
     if(!cached)
     {
         Compute();
-        QTable::Save(_m_QValues,filenameCache);
+        cache.Save(_m_QValues,filenameCache);
 
 #if DEBUG_QHEUR_COMP
         cout << "QFunctionJAOH::ComputeWithCachedQValues saved Q values to "
              << filenameCache << endl;
 #endif
     }
-    else // load Q values from file
-    {
-#if 0 // don't use this, it makes a copy (so you need twice the memory)
-        _m_QValues=
-            MDPSolver::LoadQTable(filenameCache,
-                                  GetPU()->
-                                  GetNrJointActionObservationHistories(),
-                                  GetPU()->GetNrJointActions());
-#else
-        QTable::Load(filenameCache,
-                     GetPU()->GetNrJointActionObservationHistories(),
-                     GetPU()->GetNrJointActions(),
-                     _m_QValues);
-#endif
-
 #if DEBUG_QHEUR_COMP
+    else
         cout << "QFunctionJAOH::ComputeWithCachedQValues loaded Q values from "
              << filenameCache << endl;
 #endif
-    }
 }
@@ -18,6 +18,14 @@
 #include "BayesianGameIdenticalPayoff.h"
 #include "JointBeliefInterface.h"
 #include "BGIP_SolverBruteForceSearch.h"
+#include "TGet.h"
+#include "OGet.h"
+#include "EParallel.h"
+#include <map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -30,6 +38,7 @@ QFunctionJAOHTree(const PlanningUnitDecPOMDPDiscrete *pu) :
     QFunctionJAOH(pu)
 {
     _m_initialized = false;
+    _m_stagewise = true;
 }
 
 QFunctionJAOHTree::
@@ -38,6 +47,7 @@ QFunctionJAOHTree(const boost::shared_ptr<const PlanningUnitDecPOMDPDiscrete> &p
     QFunctionJAOH(pu)
 {
     _m_initialized = false;
+    _m_stagewise = true;
 }
 
 //Destructor
@@ -77,6 +87,12 @@ void QFunctionJAOHTree::Compute()
     if(!_m_initialized)
         Initialize();
 
+#if QFunctionJAOH_useIndices
+    //ComputeQStagewise() gives up when the distinct beliefs need more
+    //memory than the Qvalues themselves
+    if(_m_stagewise && ComputeQStagewise())
+        return;
+#endif
     ComputeQ();
 }
 
@@ -177,3 +193,227 @@ void QFunctionJAOHTree::ComputeQ()
     delete b0p;
     return;
 }
+
+bool QFunctionJAOHTree::ComputeConcurrently() const
+{
+#ifdef _OPENMP
+    if(omp_get_max_threads() < 2 || omp_in_parallel())
+        return(false);
+    //the belief updates only read the model when the flat transition and
+    //observation models are available
+    const MultiAgentDecisionProcessDiscreteInterface* madp =
+        GetPU()->GetMADPDI();
+    TGet* T = madp->GetTGet();
+    OGet* O = madp->GetOGet();
+    bool flat = (T != 0 && O != 0);
+    delete T;
+    delete O;
+    return(flat);
+#else
+    return(false);
+#endif
+}
+
+#if QFunctionJAOH_useIndices
+bool QFunctionJAOHTree::ComputeQStagewise()
+{
+    const PlanningUnitDecPOMDPDiscrete* pu = GetPU();
+    if(pu == 0)
+        throw E("QFunctionJAOHTree::ComputeQStagewise - GetPU() returns 0; no PlanningUnit available!");
+
+    size_t h = pu->GetHorizon();
+    size_t nrS = pu->GetNrStates();
+    size_t nrJA = pu->GetNrJointActions();
+    size_t nrJO = pu->GetNrJointObservations();
+    size_t nrJAJO = nrJA * nrJO;
+    double discount = pu->GetDiscount();
+    const Index unreachable = INT_MAX;
+    bool parallel = ComputeConcurrently();
+    EParallel error;
+
+    //the number of doubles the beliefs and the per-stage tables may take:
+    //as much as the Qvalues of all histories, but at least 2^22
+    size_t maxStored = max<size_t>(_m_QValues.size1() * _m_QValues.size2(),
+                                   1 << 22);
+    //the doubles in the per-stage tables (an Index counting as half)
+    size_t stored = 0;
+
+    //for each stage, the Qvalues of the distinct joint beliefs (nrJA per
+    //belief). Initially they only contain the expected immediate reward.
+    vector<vector<double> > Q(h);
+    //for each stage, the probability P(jo|b,ja) and the index of the
+    //resulting belief for each distinct belief b, ja and jo
+    vector<vector<double> > probs(h);
+    vector<vector<Index> > succ(h);
+
+    //the distinct joint beliefs of the current stage
+    vector<vector<double> > beliefs;
+    JointBeliefInterface* b0 = pu->GetNewJointBeliefFromISD();
+    beliefs.push_back(b0->Get());
+    delete b0;
+
+    for(Index t = 0; t < h; t++)
+    {
+        bool last_t = (t + 1 == h);
+        size_t nrB = beliefs.size();
+        Q[t].resize(nrB * nrJA);
+        if(!last_t)
+        {
+            probs[t].resize(nrB * nrJAJO);
+            succ[t].resize(nrB * nrJAJO);
+            stored += nrB * nrJAJO + nrB * nrJAJO / 2;
+        }
+        stored += nrB * nrJA;
+        if(DEBUG_QHEUR_COMP_TREE)
+            cout << "QFunctionJAOHTree::ComputeQStagewise() stage " << t
+                 << " has " << nrB << " distinct joint beliefs" << endl;
+
+        //the successor beliefs are computed for blocks of beliefs
+        //concurrently, and then numbered in order (such that the result
+        //does not depend on the number of threads). A block is limited to
+        //about 2^22 doubles.
+        size_t blockSize = last_t ? nrB :
+            max<size_t>(1, (1 << 22) / (nrJAJO * nrS));
+        vector<vector<double> > newBeliefs;
+        map<vector<double>, Index> nextBeliefs;
+        for(Index firstBI = 0; firstBI < nrB; firstBI += blockSize)
+        {
+            Index endBI = min(firstBI + blockSize, nrB);
+            if(!last_t)
+                newBeliefs.assign((endBI - firstBI) * nrJAJO,
+                                  vector<double>());
+#pragma omp parallel for schedule(dynamic,1) if(parallel)
+            for(Index bI = firstBI; bI < endBI; bI++)
+            {
+              try {
+                const vector<double>& b = beliefs[bI];
+                for(Index jaI = 0; jaI < nrJA; jaI++)
+                {
+                    double exp_imm_R = 0.0;
+                    for(Index sI = 0; sI < nrS; sI++)
+                        if(b[sI] > 0)
+                            exp_imm_R += b[sI] * pu->GetReward(sI, jaI);
+                    Q[t][bI * nrJA + jaI] = exp_imm_R;
+                }
+                if(!last_t)
+                {
+                    JointBeliefInterface* jb =
+                        pu->GetNewJointBeliefInterface();
+                    for(Index k = 0; k < nrJAJO; k++)
+                    {
+                        jb->Set(b);
+                        double Po_ba = jb->Update(*pu->GetMADPDI(),
+                                                  k / nrJO, k % nrJO);
+                        probs[t][bI * nrJAJO + k] = Po_ba;
+                        if(Po_ba >= PROB_PRECISION)
+                            newBeliefs[(bI - firstBI) * nrJAJO + k] =
+                                jb->Get();
+                    }
+                    delete jb;
+                }
+              } catch(...) {
+                    //exceptions cannot leave a parallel region, so they
+                    //are re-thrown after the loop
+                    error.Catch();
+              }
+            }
+            error.Rethrow();
+
+            //number the distinct successor beliefs
+            if(!last_t)
+                for(Index bI = firstBI; bI < endBI; bI++)
+                    for(Index k = 0; k < nrJAJO; k++)
+                    {
+                        Index i = bI * nrJAJO + k;
+                        if(probs[t][i] < PROB_PRECISION)
+                        {
+                            succ[t][i] = unreachable;
+                            continue;
+                        }
+                        Index newBI = nextBeliefs.size();
+                        succ[t][i] = nextBeliefs.insert(
+                            make_pair(newBeliefs[i - firstBI * nrJAJO],
+                                      newBI)).first->second;
+                    }
+            if(stored + (nrB + nextBeliefs.size()) * nrS > maxStored)
+            {
+                if(DEBUG_QHEUR_COMP_TREE)
+                    cout << "QFunctionJAOHTree::ComputeQStagewise() stage "
+                         << t << " has too many distinct joint beliefs, "
+                         << "computing the Qvalues recursively" << endl;
+                return(false);
+            }
+        }
+        beliefs.assign(nextBeliefs.size(), vector<double>());
+        for(map<vector<double>, Index>::const_iterator it =
+                nextBeliefs.begin(); it != nextBeliefs.end(); ++it)
+            beliefs[it->second] = it->first;
+    }
+
+    //compute the Qvalues backwards in time:
+    //  Q(b,ja) = R(b,ja) + discount * future reward of b,ja
+    for(Index t = h - 1; t-- > 0; )
+    {
+        size_t nrB = Q[t].size() / nrJA;
+#pragma omp parallel for schedule(dynamic,1) if(parallel)
+        for(Index bI = 0; bI < nrB; bI++)
+        {
+          try {
+            vector<const double*> nextQ(nrJO);
+            for(Index jaI = 0; jaI < nrJA; jaI++)
+            {
+                Index first = (bI * nrJA + jaI) * nrJO;
+                for(Index joI = 0; joI < nrJO; joI++)
+                {
+                    Index newBI = succ[t][first + joI];
+                    nextQ[joI] = (newBI == unreachable) ? 0 :
+                        &Q[t+1][newBI * nrJA];
+                }
+                double exp_fut_R = ComputeFutureReward(&probs[t][first],
+                                                       nextQ);
+                Q[t][bI * nrJA + jaI] += discount * exp_fut_R;
+            }
+          } catch(...) {
+                error.Catch();
+          }
+        }
+        error.Rethrow();
+    }
+
+    //copy the Qvalues to the joint action-observation histories; those
+    //that cannot occur get Qvalue 0
+    vector<Index> jaohBIs(1, 0); //the belief of each jaoh of stage t
+    for(Index t = 0; t < h; t++)
+    {
+        LIndex firstJAOHI = pu->GetFirstJointActionObservationHistoryIndex(t);
+        vector<Index> nextJaohBIs;
+        if(t + 1 < h)
+            nextJaohBIs.resize(jaohBIs.size() * nrJAJO);
+        LIndex firstNextJAOHI = (t + 1 < h) ?
+            pu->GetFirstJointActionObservationHistoryIndex(t+1) : 0;
+        for(Index i = 0; i < jaohBIs.size(); i++)
+        {
+            Index jaohI = CastLIndexToIndex(firstJAOHI + i);
+            Index bI = jaohBIs[i];
+            for(Index jaI = 0; jaI < nrJA; jaI++)
+                _m_QValues(jaohI, jaI) = (bI == unreachable) ? 0.0 :
+                    Q[t][bI * nrJA + jaI];
+            if(t + 1 < h)
+                for(Index k = 0; k < nrJAJO; k++)
+                {
+                    LIndex newJAOHI = pu->GetSuccessorJAOHI(jaohI, k / nrJO,
+                                                            k % nrJO);
+                    nextJaohBIs.at(CastLIndexToIndex(newJAOHI -
+                                                     firstNextJAOHI)) =
+                        (bI == unreachable) ? unreachable :
+                        succ[t][bI * nrJAJO + k];
+                }
+        }
+        jaohBIs.swap(nextJaohBIs);
+        //these are no longer needed
+        vector<double>().swap(probs[t]);
+        vector<Index>().swap(succ[t]);
+    }
+    return(true);
+}
+#endif
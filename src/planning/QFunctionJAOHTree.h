@@ -18,16 +18,29 @@
 #define _QFUNCTIONJOINTHISTORYTREE_H_ 1
 
 /* the include directives */
+#include <vector>
 #include "Globals.h"
 #include "QFunctionJAOH.h"
 
 /** \brief QFunctionJAOHTree is represents
- * QFunctionJAOH which store Qvalues in a tree.  */
+ * QFunctionJAOH which store Qvalues in a tree.
+ *
+ * The Qvalues are computed either by recursively traversing the tree of
+ * joint action-observation histories (ComputeQ()), or stage by stage
+ * starting from the last stage (ComputeQStagewise(), the default). In
+ * the latter case histories that lead to the same joint belief share
+ * their Qvalues, which are only computed once. Storing the distinct
+ * beliefs takes nrS doubles each, so when they would take more memory
+ * than the Qvalues of all histories (and more than 2^22 doubles)
+ * Compute() falls back to ComputeQ().
+ */
 class QFunctionJAOHTree : public QFunctionJAOH
 {
 private:    
 
     bool _m_initialized; 
+    /// Whether Compute() uses ComputeQStagewise() or ComputeQ().
+    bool _m_stagewise;
     
     void Initialize();
     void DeInitialize();
@@ -55,6 +68,44 @@ private:
      * ComputeRecursively.
      * */
     void ComputeQ();
+
+    /**\brief Computes the Qvalues stage by stage, from the last stage
+     * to the first.
+     *
+     * First the distinct joint beliefs of each stage are determined, by
+     * updating those of the previous stage for all joint actions and
+     * joint observations. The Qvalues of each distinct belief are then
+     * computed backwards in time, and stored in a dense array per
+     * stage. Finally they are copied to the joint action-observation
+     * histories that lead to the belief.
+     *
+     * The beliefs of a stage are processed concurrently when compiled
+     * with OpenMP.
+     *
+     * Classes that use this function have to define (reimplement)
+     * ComputeFutureReward.
+     *
+     * Returns false, without computing the Qvalues, as soon as the
+     * beliefs and the per-stage tables exceed the memory bound described
+     * above.
+     */
+    bool ComputeQStagewise();
+
+    /**\brief Computes the expected future reward of a joint action.
+     *
+     * Function that should be reimplemented by derived classes that
+     * use ComputeQStagewise(). probs contains, for each joint
+     * observation, its probability given the joint belief and joint
+     * action; nextQ points to the Qvalues (for each joint action) of the
+     * resulting joint belief, or is 0 if the probability is below
+     * PROB_PRECISION. This function is called concurrently.
+     */
+    virtual double ComputeFutureReward(const double* probs,
+                                       const std::vector<const double*>&
+                                       nextQ) const = 0;
+
+    /// Returns whether ComputeQStagewise() can use multiple threads.
+    bool ComputeConcurrently() const;
     
 
 protected:
@@ -78,6 +129,11 @@ public:
      * PlanningUnitDecPOMDPDiscrete)*/
     void Compute();
 
+    /**Sets whether Compute() computes the Qvalues stage by stage (the
+     * default), or recursively. */
+    void SetComputeStagewise(bool stagewise)
+        { _m_stagewise=stagewise; }
+
     void SetPU(const PlanningUnitDecPOMDPDiscrete* pu);
     void SetPU(const boost::shared_ptr<const PlanningUnitDecPOMDPDiscrete> &pu);
 
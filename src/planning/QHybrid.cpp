@@ -22,6 +22,7 @@
 #include "BayesianGameIdenticalPayoff.h"
 #include "BGIP_SolverBruteForceSearch.h"
 #include "BGIP_SolverBranchAndBound.h"
+#include "QFunctionCache.h"
 
 using namespace std;
 using namespace qheur;
@@ -349,6 +350,25 @@ void QHybrid::ComputeWithCachedQValues(bool computeIfNotCached)
             cached=false;
     }
 
+    // the stored values are only used if they were computed for this
+    // model and heuristic
+    if(cached)
+    {
+        size_t horizonLastTimeSteps=_m_horizonLastTimeSteps;
+        bool optimizedHorLast=_m_optimizedHorLast;
+        try {
+            Load(filenameCache);
+        }
+        catch(E& e)
+        {
+            if(!computeIfNotCached)
+                throw;
+            cached=false;
+            _m_horizonLastTimeSteps=horizonLastTimeSteps;
+            SetOptimizedHorLast(optimizedHorLast);
+        }
+    }
+
     if(!cached && !computeIfNotCached)
     {
         stringstream ss;
@@ -358,14 +378,12 @@ void QHybrid::ComputeWithCachedQValues(bool computeIfNotCached)
         return;
     }
 
-    // Couldn't open cache file, so compute
+    // Couldn't load cache file, so compute
     if(!cached)
     {
         Compute();
         Save(filenameCache);
     }
-    else // load Q values from file
-        Load(filenameCache);
 }
     
 void QHybrid::Load(const std::string& filename)
@@ -398,10 +416,17 @@ void QHybrid::Load(const std::string& filename)
     {
         stringstream ss;
         ss << filename << "_firstTS";
-        QTable::Load(ss.str(),
-                     _m_nrJAOHinFirstTS,
-                     GetPU()->GetNrJointActions(),
-                     _m_QValuesFirstTimeSteps);
+        QFunctionCache cache(GetPU(),SoftPrintBrief());
+        if(!cache.Load(ss.str(),
+                       _m_nrJAOHinFirstTS,
+                       GetPU()->GetNrJointActions(),
+                       _m_QValuesFirstTimeSteps))
+        {
+            stringstream ss1;
+            ss1 << "QHybrid::Load: " << ss.str()
+                << " does not contain Q values for this problem";
+            throw(E(ss1.str()));
+        }
     }
     {
         stringstream ss;
@@ -429,7 +454,8 @@ void QHybrid::Save(const std::string& filename) const
     {
         stringstream ss;
         ss << filename << "_firstTS";
-        QTable::Save(_m_QValuesFirstTimeSteps,ss.str());
+        QFunctionCache cache(GetPU(),SoftPrintBrief());
+        cache.Save(_m_QValuesFirstTimeSteps,ss.str());
     }
     {
         stringstream ss;
@@ -196,6 +196,25 @@ double QPOMDP::ComputeRecursively(size_t time_step,
     return( v );
 }
 
+double QPOMDP::ComputeFutureReward(const double* probs,
+                                   const vector<const double*>& nextQ) const
+{
+    // v = sum_jo P(jo|b,a) * max_a Q(b'_jo,a)
+    double v = 0.0;
+    size_t nrJA = GetPU()->GetNrJointActions();
+    for(Index newJOI=0; newJOI < nextQ.size(); newJOI++)
+    {
+        if(nextQ[newJOI] == 0)
+            continue;
+        double maxQ = -DBL_MAX;
+        for(Index newJAI=0; newJAI < nrJA; newJAI++)
+            if(nextQ[newJOI][newJAI] > maxQ)
+                maxQ = nextQ[newJOI][newJAI];
+        v += probs[newJOI] * maxQ;
+    }
+    return( v );
+}
+
 /*
 void QPOMDP::ComputeNoCache()
 //size_t time_step = 0,
@@ -42,6 +42,10 @@ private:
                               JointActionObservationHistoryTree* jaoht, 
                               Index lastJAI);
 #endif
+
+    /**Computes the expected future reward for ComputeQStagewise(). */
+    double ComputeFutureReward(const double* probs,
+                               const std::vector<const double*>& nextQ) const;
     
 protected:
     
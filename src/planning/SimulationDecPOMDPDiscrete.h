@@ -176,6 +176,9 @@ public:
         return(result);
     }
 
+    /// The number of stages of each simulated episode.
+    size_t GetHorizon() const { return(_m_horizon); }
+
     /// Indicate that intermediate should be stored to file named filename.
     void SaveIntermediateResults(std::string filename);
 
@@ -519,6 +519,11 @@ static const int AM_RESTARTS=1;
 static const int SLACK=2;
 static const int OPT_GMAADEADLINE=3;
 static const int OPT_REQUIREQCACHE=4;
+static const int OPT_GMAACONCURRENT=5;
+static const int OPT_GMAAPOOLMEMORY=6;
+static const int OPT_BGCACHE=7;
+static const int OPT_BGCACHEFILE=8;
+static const int OPT_GMAACOMPACTBGS=9;
 static struct argp_option gmaa_options[] = {
 {"GMAA",    'G', "GMAA", 0, "Select which GMAA variation to use" },
 {"k",   'k', "K", 0, "Set k in k-GMAA" },
@@ -530,6 +535,11 @@ static struct argp_option gmaa_options[] = {
 {"ApproxInference", 'a', 0, 0, "Use approximate inference for BG construction (by default exact BGs are constructed"},
 {"slack",   SLACK, "FLOAT", 0, "Sets slack to avoid pruning in case of inadmissible heuristics or approximate past rewards. (default=0.0)"},
 {"GMAAdeadline", OPT_GMAADEADLINE, "TIME", 0, "Deadline for completing GMAA, in s"},
+{"GMAAconcurrent", OPT_GMAACONCURRENT, "N", 0, "Expand the N best policy pool items concurrently (MAAstar and kGMAA, requires OpenMP, default=1)"},
+{"GMAApoolMemory", OPT_GMAAPOOLMEMORY, "MB", 0, "Memory budget of the policy pool, lower ranked policies are moved to disk when it is exceeded (default=0, unlimited)"},
+{"GMAAcompactBGs", OPT_GMAACOMPACTBGS, 0, 0, "Only store the BG utilities of joint types with a positive probability (MAAstar and kGMAA)"},
+{"BGcache", OPT_BGCACHE, "MB", 0, "Memory budget of a cache of BG solutions, the least recently used BGs are removed when it is exceeded (kGMAA and QBG, default=0, no cache)"},
+{"BGcacheFile", OPT_BGCACHEFILE, "FILE", 0, "Load the BG solution cache from FILE (if it exists) and save it there afterwards"},
 { 0 }
 };
 error_t
@@ -581,6 +591,23 @@ gmaa_parse_argument (int key, char *arg, struct argp_state *state)
     case OPT_GMAADEADLINE:
         theArgumentsStruc->GMAAdeadline = atoi(arg);
         break;
+    case OPT_GMAACONCURRENT:
+        theArgumentsStruc->GMAAconcurrent = atoi(arg);
+        if(theArgumentsStruc->GMAAconcurrent < 1)
+            theArgumentsStruc->GMAAconcurrent = 1;
+        break;
+    case OPT_GMAAPOOLMEMORY:
+        theArgumentsStruc->GMAApoolMemory = atoi(arg);
+        break;
+    case OPT_GMAACOMPACTBGS:
+        theArgumentsStruc->GMAAcompactBGs = 1;
+        break;
+    case OPT_BGCACHE:
+        theArgumentsStruc->BGcache = atoi(arg);
+        break;
+    case OPT_BGCACHEFILE:
+        theArgumentsStruc->BGcacheFile = arg;
+        break;
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -1008,9 +1035,19 @@ This parser should be included as a child argp parser in the \
 main argp parser of your application. (and this message will\
 not be shown)"; 
 //\v";
+static const int OPT_ACTORS=1;
+static const int OPT_REPLAY=2;
+static const int OPT_REPLAY_BATCH=3;
+static const int OPT_REPLAY_NRBATCHES=4;
+static const int OPT_REPLAY_PRIORITIZED=5;
 static struct argp_option simulation_options[] = {
 {"runs",  'r', "RUNS", 0, "Set the number of episodes to simulate" },
 {"seed",  'S', "SEED", 0, "Set the random seed" },
+{"actors",  OPT_ACTORS, "ACTORS", 0, "MMDP_QLearner: learn with ACTORS concurrent actors sharing one Q-table (default 0: learn within the simulation)" },
+{"replay",  OPT_REPLAY, "CAPACITY", 0, "MMDP_QLearner: learn by experience replay from the last CAPACITY transitions (default 0: no replay)" },
+{"replayBatch",  OPT_REPLAY_BATCH, "SIZE", 0, "MMDP_QLearner: the number of transitions per replay minibatch (32)" },
+{"replayBatches",  OPT_REPLAY_NRBATCHES, "N", 0, "MMDP_QLearner: the number of replay minibatches per step (1)" },
+{"prioritized",  OPT_REPLAY_PRIORITIZED, 0, 0, "MMDP_QLearner: replay transitions proportional to their TD error, rather than uniformly" },
 { 0 }
 };
 error_t
@@ -1028,6 +1065,21 @@ simulation_parse_argument (int key, char *arg, struct argp_state *state)
     case 'S':
         theArgumentsStruc->randomSeed=atoi(arg);
         break;
+    case OPT_ACTORS:
+        theArgumentsStruc->nrActors=atoi(arg);
+        break;
+    case OPT_REPLAY:
+        theArgumentsStruc->replayCapacity=atoi(arg);
+        break;
+    case OPT_REPLAY_BATCH:
+        theArgumentsStruc->replayBatchSize=atoi(arg);
+        break;
+    case OPT_REPLAY_NRBATCHES:
+        theArgumentsStruc->replayNrBatches=atoi(arg);
+        break;
+    case OPT_REPLAY_PRIORITIZED:
+        theArgumentsStruc->replayPrioritized=true;
+        break;
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -1121,6 +1173,7 @@ Options for using MaxPlus for optimization include:\n\
 -the number of restarts (only useful for randomized Maxplus versions),\n\
 -the number maximum number of of iterations of mesage passing in each run,\n\
 -the update scheme,\n\
+-the number of threads computing the PARALL updates,\n\
 -the damping factor (may speed up convergence, at extra computational cost per \
 iteration)\n\
 -the verboseness (a positive number), for debugging.";
@@ -1130,12 +1183,14 @@ static const int MAXPLUS_UPDATE = 2;
 static const int MAXPLUS_ITER = 3;
 static const int MAXPLUS_VERB = 4;
 static const int MAXPLUS_DAMP = 5;
+static const int MAXPLUS_THREADS = 6;
 static struct argp_option MaxPlus_options[] = {
 {"MP-restarts", MAXPLUS_RESTARTS, "MaxPlusRESTARTS", 0, "Set the number of MaxPlus restarts (runs)"},
 {"MP-update", MAXPLUS_UPDATE, "STRING", 0, "The update scheme: \"PARALL\"(default), \"SEQRND\", or \"SEQMAX\""},
 {"MP-iters", MAXPLUS_ITER, "NUMBER", 0, "The maximum number of iterations performed by Max-Plus"},
 {"MP-verbose", MAXPLUS_VERB, "0...9", 0, "Set verboseness level of Max-Plus (o by default"},
 {"MP-damp", MAXPLUS_DAMP, "REAL", 0, "Set the damping factor (default 0.5)"},
+{"MP-threads", MAXPLUS_THREADS, "NUMBER", 0, "The number of threads that compute the PARALL updates (default 1, requires OpenMP)"},
 { 0 }
 };
 error_t
@@ -1162,6 +1217,9 @@ MaxPlus_parse_argument (int key, char *arg, struct argp_state *state)
     case MAXPLUS_DAMP:
         theArgumentsStruc->maxplus_damping =  atof(arg);
         break;
+    case MAXPLUS_THREADS:
+        theArgumentsStruc->maxplus_nrThreads =  atoi(arg);
+        break;
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -1438,8 +1496,18 @@ PolicyIteration : \
 PolicyIterationGPU :\
 \v";
 
+static const int OPT_VI_UPDATE=1;
+static const int OPT_VI_TOLERANCE=2;
+static const int OPT_PI_EVALUATION=3;
+static const int OPT_PI_SWEEPS=4;
+static const int OPT_PI_THREADS=5;
 static struct argp_option mmdp_method_options[] = {
 {"mmdp_method",'t', "MMDP_METHOD",  0, "available: 'ValueIteration' (default), 'PolicyIteration', 'PolicyIterationGPU'"},
+{"vi_update", OPT_VI_UPDATE, "UPDATE",  0, "ValueIteration: how infinite-horizon states are backed up, available: 'Jacobi' (default), 'GaussSeidel', 'PrioritizedSweeping'"},
+{"vi_tolerance", OPT_VI_TOLERANCE, "TOL",  0, "ValueIteration, PolicyIteration: the Bellman residual at which infinite-horizon planning stops (1e-4)"},
+{"pi_evaluation", OPT_PI_EVALUATION, "EVAL",  0, "PolicyIteration: how policies are evaluated, available: 'Modified' (default), 'BiCGSTAB'"},
+{"pi_sweeps", OPT_PI_SWEEPS, "SWEEPS",  0, "PolicyIteration: the number of sweeps per Modified evaluation (20)"},
+{"pi_threads", OPT_PI_THREADS, "THREADS",  0, "PolicyIteration: the number of threads that compute the matrix-vector products (1)"},
 { 0 }
 };
 error_t
@@ -1464,6 +1532,39 @@ mmdp_method_parse_argument (int key, char *arg, struct argp_state *state)
                 abort();
             }
             break;
+        case OPT_VI_UPDATE:
+            if (argString=="Jacobi")
+                theArgumentsStruc->vi_update=VI_JACOBI;
+            else if (argString=="GaussSeidel")
+                theArgumentsStruc->vi_update=VI_GAUSS_SEIDEL;
+            else if (argString=="PrioritizedSweeping")
+                theArgumentsStruc->vi_update=VI_PRIORITIZED_SWEEPING;
+            else
+            {
+                std::cerr<<"unkown vi_update '"<<argString<<"'"<<std::endl;
+                abort();
+            }
+            break;
+        case OPT_VI_TOLERANCE:
+            theArgumentsStruc->vi_tolerance=strtod(arg,0);
+            break;
+        case OPT_PI_EVALUATION:
+            if (argString=="Modified")
+                theArgumentsStruc->pi_evaluation=PI_MODIFIED;
+            else if (argString=="BiCGSTAB")
+                theArgumentsStruc->pi_evaluation=PI_BICGSTAB;
+            else
+            {
+                std::cerr<<"unkown pi_evaluation '"<<argString<<"'"<<std::endl;
+                abort();
+            }
+            break;
+        case OPT_PI_SWEEPS:
+            theArgumentsStruc->pi_nrSweeps=atoi(arg);
+            break;
+        case OPT_PI_THREADS:
+            theArgumentsStruc->pi_nrThreads=atoi(arg);
+            break;
         default:
             return ARGP_ERR_UNKNOWN;
             break;
@@ -25,6 +25,8 @@
 #include "gmaatype.h"
 #include "JESPtype.h"
 #include "PerseusBackupType.h"
+#include "MDPValueIterationUpdateType.h"
+#include "MDPPolicyIterationEvaluationType.h"
 #include "BGBackupType.h"
 #include "BGIP_SolverType.h"
 #include "ProblemType.h" //problem enum.
@@ -101,6 +103,11 @@ struct Arguments
     bool exactBGs; // construct BGs exactly (or using approximate inference?) using in GMAAF
     double slack;  // slack parameter to stop search before finding optimal solution
     size_t GMAAdeadline;
+    int GMAAconcurrent;
+    size_t GMAApoolMemory;
+    int GMAAcompactBGs;
+    size_t BGcache;
+    const char * BGcacheFile;
 
     // GMAA Cluster options
     int useBGclustering;
@@ -150,6 +157,11 @@ struct Arguments
     // Simulation options
     int nrRuns;
     int randomSeed;
+    size_t nrActors;
+    size_t replayCapacity;
+    size_t replayBatchSize;
+    size_t replayNrBatches;
+    bool replayPrioritized;
     double successfulCommProb;
 
     // TOI options
@@ -182,6 +194,7 @@ struct Arguments
     double maxplus_damping;
     size_t maxplus_nrRestarts;
     std::string maxplus_updateT;
+    size_t maxplus_nrThreads;
 
     // BGIP Branch-and-Bound Options
     BnB_JointTypeOrdering BnBJointTypeOrdering;
@@ -201,6 +214,11 @@ struct Arguments
     int falseNegativeObs;
 
     MMDP_method mmdp_method;
+    MDPValueIterationUpdateType vi_update;
+    double vi_tolerance;
+    MDPPolicyIterationEvaluationType pi_evaluation;
+    size_t pi_nrSweeps;
+    size_t pi_nrThreads;
 
     //default values by constructor:
     Arguments()
@@ -255,6 +273,11 @@ struct Arguments
         exactBGs = true;
         slack = 0.0;
         GMAAdeadline = 0;
+        GMAAconcurrent = 1;
+        GMAApoolMemory = 0;
+        GMAAcompactBGs = 0;
+        BGcache = 0;
+        BGcacheFile = 0;
 
         // GMAA Cluster
         useBGclustering = 0;
@@ -301,6 +324,11 @@ struct Arguments
         // Simulation options
         nrRuns = 1000;
         randomSeed = 42;
+        nrActors = 0;
+        replayCapacity = 0;
+        replayBatchSize = 32;
+        replayNrBatches = 1;
+        replayPrioritized = false;
         successfulCommProb = -1;
 
         // TOI options
@@ -332,6 +360,7 @@ struct Arguments
         maxplus_damping = 0.5;
         maxplus_nrRestarts = 1;
         maxplus_updateT = std::string("PARALL");
+        maxplus_nrThreads = 1;
 
         BnBJointTypeOrdering = IdentityMapping;
         BnB_keepAll = false;
@@ -350,6 +379,11 @@ struct Arguments
         falseNegativeObs = -1;
 
         mmdp_method = ValueIteration;
+        vi_update = VI_JACOBI;
+        vi_tolerance = 1e-4;
+        pi_evaluation = PI_MODIFIED;
+        pi_nrSweeps = 20;
+        pi_nrThreads = 1;
     }
         
 };
@@ -50,6 +50,7 @@
 #include "BGIP_SolverCreator_BnB.h" 
 #include "BGIP_SolverCreator_Random.h" 
 #include "BGIP_SolverCreator_BFSNonInc.h" 
+#include "BGIP_SolutionCache.h"
 
 #include "argumentHandlers.h"
 #include "argumentUtils.h"
@@ -241,6 +242,27 @@ try
         cout << "GMAA Planner initialized" << endl;
 
     q=GetQheuristicFromArgs(gmaaFirstInstance,args);
+
+    // a cache of BG solutions, shared by the Q heuristic and the GMAA
+    // instances
+    BGIP_SolutionCache_sharedPtr bgCache;
+    if(args.BGcache)
+    {
+        bgCache=BGIP_SolutionCache_sharedPtr(
+            new BGIP_SolutionCache(args.BGcache*1024*1024));
+        if(args.BGcacheFile)
+        {
+            ifstream cacheFile(args.BGcacheFile);
+            if(cacheFile)
+            {
+                cacheFile.close();
+                bgCache->Load(args.BGcacheFile);
+            }
+        }
+        QBG *qbg=dynamic_cast<QBG*>(q);
+        if(qbg)
+            qbg->SetBGSolutionCache(bgCache);
+    }
     string filename="",timingsFilename="", jpolFilename="";
     ofstream of;
     ofstream of_jpol;
@@ -317,6 +339,8 @@ try
         }
 
         gmaa->SetQHeuristic(q);
+        if(bgCache)
+            gmaa->SetBGSolutionCache(bgCache);
 
 //timer starting - don't do file I/O (if possible)        
         Time.Start("Plan");
@@ -568,6 +592,14 @@ sysconf(_SC_CLK_TCK)<<"s)"<<
 #endif
     }
 
+    if(bgCache)
+    {
+        if(args.verbose >= 0)
+            bgCache->Print();
+        if(args.BGcacheFile)
+            bgCache->Save(args.BGcacheFile);
+    }
+
     delete q;
     delete gmaa;
     if(args.nrRestarts>1)
@@ -849,6 +881,12 @@ GeneralizedMAAStarPlannerForDecPOMDPDiscrete* GetGMAAInstance(
     gmaa->SetVerbose(args.verbose);
     if(args.GMAAdeadline)
         gmaa->SetDeadline(args.GMAAdeadline);
+    if(args.GMAAconcurrent > 1)
+        gmaa->SetNrConcurrentExpansions(args.GMAAconcurrent);
+    if(args.GMAApoolMemory)
+        gmaa->SetPolicyPoolMemoryBudget(args.GMAApoolMemory*1024*1024);
+    if(args.GMAAcompactBGs)
+        gmaa->SetCompactBGs(true);
 
     return(gmaa);
 }
@@ -915,14 +953,16 @@ void GetBGIPSolverCreatorInstances(
                     args.maxplus_maxiter, args.maxplus_updateT, 
                     args.maxplus_verbose, args.maxplus_damping, 
                     args.k,//<- nr solutions to return by BG solver
-                    args.maxplus_nrRestarts
+                    args.maxplus_nrRestarts,
+                    args.maxplus_nrThreads
                     );
             else
                 bgipsc_p = new BGIP_SolverCreator_MP<JointPolicyPureVector> (
                     args.maxplus_maxiter, args.maxplus_updateT, 
                     args.maxplus_verbose, args.maxplus_damping, 
                     args.k,//<- nr solutions to return by BG solver
-                    args.maxplus_nrRestarts
+                    args.maxplus_nrRestarts,
+                    args.maxplus_nrThreads
                     );
             break;
         case BnB:
@@ -23,6 +23,7 @@
 #include "directories.h"
 
 #include "AgentQLearner.h"
+#include "ParallelQLearner.h"
 
 #include "MDPValueIteration.h"
 #include "QTable.h"
@@ -39,6 +40,8 @@ const char *argp_program_version = "MMDP_QLearner";
 static char doc[] =
 "MMDP_QLearner - loads an MMDP problem, and learns a policy online with Q-learning. \
 This only works for infinite horizon, so you have the specify a discount < 1. \
+With --actors, several threads learn concurrently. With --replay, \
+the learner replays minibatches of stored transitions. \
 \vFor more information please consult the MADP documentation. \
 ";
 
@@ -57,10 +60,14 @@ const struct argp_child childVector[] = {
 
 double runSimulations(const PlanningUnitDecPOMDPDiscrete *pu,
                       const SimulationDecPOMDPDiscrete &sim,
-                      bool verbose)
+                      const ArgumentHandlers::Arguments &args)
 {
     // create 'template' agent from which others are created
     AgentQLearner agent(pu, 0, 0.0, 0.1, 0.9, pu->GetDiscount());
+    if(args.replayCapacity > 0)
+        agent.SetExperienceReplay(args.replayCapacity, args.replayBatchSize,
+                                  args.replayNrBatches,
+                                  args.replayPrioritized);
 
     AgentQLearner *newAgent;
     vector<AgentFullyObservable*> agents;
@@ -77,7 +84,7 @@ double runSimulations(const PlanningUnitDecPOMDPDiscrete *pu,
     }
     SimulationResult result = sim.RunSimulations(agents);
 
-    if(verbose)
+    if(args.verbose)
     {
         QTable q = static_cast<AgentQLearner*>(agents[0])->GetQTable();
         row_t row   = q.GetRow(0);
@@ -92,6 +99,34 @@ double runSimulations(const PlanningUnitDecPOMDPDiscrete *pu,
     return avgReward;
 }
 
+double runParallelLearners(const PlanningUnitDecPOMDPDiscrete *pu,
+                           const SimulationDecPOMDPDiscrete &sim,
+                           size_t nrActors, const string &filename,
+                           bool verbose)
+{
+    // the same parameters as the AgentQLearner in runSimulations()
+    ParallelQLearner learner(pu, 0.0, 0.1, 0.9, pu->GetDiscount());
+    vector<double> returns=learner.Learn(sim.GetNrRuns(), sim.GetHorizon(),
+                                         nrActors, sim.GetRandomSeed());
+
+    if(verbose)
+    {
+        QTable q = learner.GetQTable();
+        row_t row   = q.GetRow(0);
+        cout << setprecision(7)
+             << "Here's first row (state 0) from Q-learning result: \n" << row << endl;
+    }
+
+    SimulationResult result(sim.GetHorizon(),sim.GetRandomSeed(),
+                            sim.GetNrRuns());
+    for(Index i=0; i < returns.size(); i++)
+        result.AddReward(returns[i]);
+    if(!filename.empty())
+        result.Save(filename);
+
+    return result.GetAvgReward();
+}
+
 bool file_exists(const string& fileName)
 {
     ofstream file(fileName.c_str());
@@ -160,7 +195,15 @@ int main(int argc, char **argv)
         cout << "Running q learning with nrRuns: "
              << nrRuns << " and seed: " << seed <<endl;
         Time.Start("Learn");
-        r = runSimulations(np, sim, args.verbose);
+        if(args.nrActors > 0)
+        {
+            cout << "...with " << args.nrActors << " concurrent actors" << endl;
+            r = runParallelLearners(np, sim, args.nrActors,
+                                    args.dryrun ? "" : filename,
+                                    args.verbose);
+        }
+        else
+            r = runSimulations(np, sim, args);
         Time.Stop("Learn");
         cout << "Avg reward of "<< nrRuns << " simulations: " << r << endl << endl;
 
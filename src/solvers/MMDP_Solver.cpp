@@ -108,15 +108,27 @@ int main(int argc, char **argv)
         switch (args.mmdp_method)
         {
         case ArgumentHandlers::ValueIteration:
-            mdpSolver=new MDPValueIteration(*np);
+        {
+            MDPValueIteration *vi=new MDPValueIteration(*np);
+            vi->SetUpdateType(args.vi_update);
+            vi->SetTolerance(args.vi_tolerance);
+            mdpSolver=vi;
             methodName="MMDP_Solver_VI";
             cout << "Running value iteration..."<<endl;
             break;
+        }
         case ArgumentHandlers::PolicyIteration:
-            mdpSolver=new MDPPolicyIteration(*np);
+        {
+            MDPPolicyIteration *pi=new MDPPolicyIteration(*np);
+            pi->SetEvaluationType(args.pi_evaluation);
+            pi->SetNrEvaluationSweeps(args.pi_nrSweeps);
+            pi->SetTolerance(args.vi_tolerance);
+            pi->SetNrThreads(args.pi_nrThreads);
+            mdpSolver=pi;
             cout << "Running policy iteration..."<<endl;
             methodName="MMDP_Solver_PI";
             break;
+        }
         case ArgumentHandlers::PolicyIterationGPU:
 #if HAVE_CUDA_CUSOLVERDN_H
             mdpSolver=new MDPPolicyIterationGPU(*np);
@@ -151,7 +163,7 @@ int main(int argc, char **argv)
 
         //start planning
         Time.Start("Plan");
-        mdpSolver->Plan(); // calls PlanSlow() on MDPPolicyIteration and MDPPolicyIterationGPU objects
+        mdpSolver->Plan(); // calls PlanSlow() on MDPPolicyIterationGPU objects
 
         Time.Stop("Plan");
         cout << "...done."<<endl;
@@ -20,6 +20,8 @@
 #include <typeinfo>
 
 #include "TGet.h"
+#include "TransitionModelTOI.h"
+#include "ObservationModelTOI.h"
 
 using namespace std;
 
@@ -83,6 +85,15 @@ JointBelief::operator= (const JointBeliefInterface& o)
 double JointBelief::Update(const MultiAgentDecisionProcessDiscreteInterface &pu,
                            Index lastJAI, Index newJOI)
 {
+    const TransitionModelTOI *Ttoi=0;
+    const ObservationModelTOI *Otoi=0;
+    if(!pu.GetEventObservability() &&
+       (Ttoi=dynamic_cast<const TransitionModelTOI *>(
+           pu.GetTransitionModelDiscretePtr())) &&
+       (Otoi=dynamic_cast<const ObservationModelTOI *>(
+           pu.GetObservationModelDiscretePtr())))
+        return(UpdateTOI(*Ttoi,*Otoi,lastJAI,newJOI));
+
     double Po_ba = 0.0; // P(o|b,a) with o=newJO
     vector<double> newJB_unnorm;
     size_t nrS = pu.GetNrStates();
@@ -174,3 +185,34 @@ double JointBelief::Update(const MultiAgentDecisionProcessDiscreteInterface &pu,
 
     return(Po_ba);
 }
+
+double JointBelief::UpdateTOI(const TransitionModelTOI &T,
+                              const ObservationModelTOI &O,
+                              Index lastJAI, Index newJOI)
+{
+    //P(sI | b, a) for all sI at once
+    vector<double> newJB_unnorm, Po_as;
+    T.MultiplyTransposed(lastJAI, _m_b, newJB_unnorm);
+    //P(newJOI | lastJAI, sI) for all sI
+    O.GetProbabilities(lastJAI, newJOI, Po_as);
+
+    double Po_ba = 0.0; // P(o|b,a) with o=newJO
+    size_t nrS = _m_b.size();
+    for(Index sI=0; sI < nrS; sI++)
+    {
+        newJB_unnorm[sI]*=Po_as[sI]; //unormalized new belief
+        Po_ba += newJB_unnorm[sI];
+    }
+
+    //normalize:
+    if(Po_ba>0)
+        for(Index sI=0; sI < nrS; sI++)
+            _m_b[sI]=newJB_unnorm[sI]/Po_ba;
+
+#if JointBelief_doSanityCheckAfterEveryUpdate
+    if(!SanityCheck())
+        throw(E("JointBelief::UpdateTOI SanityCheck failed"));
+#endif
+
+    return(Po_ba);
+}
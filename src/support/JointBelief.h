@@ -25,6 +25,8 @@
 #include "JointBeliefInterface.h"
 
 class MultiAgentDecisionProcessDiscreteInterface; //forward declaration to avoid including each other
+class TransitionModelTOI;
+class ObservationModelTOI;
 
 /**
  * \brief JointBelief stores a joint belief, represented as a regular
@@ -34,6 +36,12 @@ class JointBelief : virtual public JointBeliefInterface,
                     virtual public Belief
 {
 private:    
+
+    /// Update() for the implicit models of a TOI problem, which
+    /// predicts the belief with one Kronecker-structured product.
+    double UpdateTOI(const TransitionModelTOI &T,
+                     const ObservationModelTOI &O,
+                     Index lastJAI, Index newJOI);
     
 protected:
     
@@ -16,6 +16,8 @@
 #include "JointBeliefSparse.h"
 #include "TransitionModelDiscrete.h"
 #include "ObservationModelDiscrete.h"
+#include "TransitionModelTOI.h"
+#include "ObservationModelTOI.h"
 #include "TGet.h"
 #include <float.h>
 
@@ -78,6 +80,14 @@ double JointBeliefSparse::Update(const MultiAgentDecisionProcessDiscreteInterfac
     //const TransitionModelDiscrete* T=pu.GetTransitionModelDiscretePtr();
     const ObservationModelDiscrete* O=pu.GetObservationModelDiscretePtr();
 
+    const TransitionModelTOI *Ttoi=0;
+    const ObservationModelTOI *Otoi=0;
+    if(!pu.GetEventObservability() &&
+       (Ttoi=dynamic_cast<const TransitionModelTOI *>(
+           pu.GetTransitionModelDiscretePtr())) &&
+       (Otoi=dynamic_cast<const ObservationModelTOI *>(O)))
+        return(UpdateTOI(*Ttoi,*Otoi,lastJAI,newJOI));
+
     //pointer to the transition probability Get funtion:
     TGet* T = pu.GetTGet();
     if(T==0)
@@ -143,6 +153,54 @@ double JointBeliefSparse::Update(const MultiAgentDecisionProcessDiscreteInterfac
     return(Po_ba);
 }
 
+double JointBeliefSparse::UpdateTOI(const TransitionModelTOI &T,
+                                    const ObservationModelTOI &O,
+                                    Index lastJAI, Index newJOI)
+{
+    size_t nrS = _m_b.size();
+    //P(sI | b, a), accumulated over the successors of the support of b
+    vector<double> Ps_ba(nrS,0.0);
+    vector<Index> sucSIs;
+    vector<double> probs;
+    for(BScit it=_m_b.begin(); it!=_m_b.end(); ++it)
+    {
+        T.GetSuccessors(it.index(), lastJAI, sucSIs, probs);
+        for(Index k=0; k!=sucSIs.size(); ++k)
+            Ps_ba[sucSIs[k]] += probs[k] * *it;
+    }
+
+    double Po_ba = 0.0; // P(o|b,a) with o=newJO
+    double Pso_ba;
+    BS newJB_unnorm(nrS);
+    for(Index sI=0; sI < nrS; sI++)
+    {
+        if(Ps_ba[sI]>0) // if it is zero, Pso_ba will be zero anyway
+        {
+            //the new (unormalized) belief P(s,o|b,a)
+            Pso_ba = O.Get(lastJAI, sI, newJOI) * Ps_ba[sI];
+            if(Pso_ba>PROB_PRECISION)
+            {
+                newJB_unnorm[sI]=Pso_ba; //unnormalized new belief
+                Po_ba += Pso_ba; //running sum of P(o|b,a)
+            }
+        }
+    }
+    
+    //normalize:    
+    if(Po_ba>0)
+        for(BSit it=newJB_unnorm.begin(); it!=newJB_unnorm.end(); ++it)
+            *it/=Po_ba;
+
+    _m_b=newJB_unnorm;
+
+#if JointBeliefSparse_doSanityCheckAfterEveryUpdate
+    if(!SanityCheck())
+        throw(E("JointBeliefSparse::UpdateTOI SanityCheck failed"));
+#endif
+
+    return(Po_ba);
+}
+
 /** Almost literal copy of Update(). */
 double JointBeliefSparse::UpdateSlow(const MultiAgentDecisionProcessDiscreteInterface &pu,
                                      Index lastJAI, Index newJOI)
@@ -24,6 +24,8 @@
 #include "BeliefSparse.h"
 
 class MultiAgentDecisionProcessDiscreteInterface; //forward declaration to avoid including each other
+class TransitionModelTOI;
+class ObservationModelTOI;
 
 /// JointBeliefSparse represents a sparse joint belief.
 class JointBeliefSparse : virtual public JointBeliefInterface,
@@ -35,6 +37,12 @@ private:
     double UpdateSlow(const MultiAgentDecisionProcessDiscreteInterface &pu,
                       Index lastJAI, Index newJOI);
 
+    /// Update() for the implicit models of a TOI problem, which only
+    /// visits the successors of the states in the belief's support.
+    double UpdateTOI(const TransitionModelTOI &T,
+                     const ObservationModelTOI &O,
+                     Index lastJAI, Index newJOI);
+
 protected:
     
 public:
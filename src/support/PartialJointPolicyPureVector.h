@@ -28,7 +28,13 @@ typedef boost::shared_ptr<PartialJointPolicyPureVector> PJPPV_sharedPtr;
 
 /** \brief PartialJointPolicyPureVector implements a
  * PartialJointPolicy using a mapping of history indices to
- * actions. */
+ * actions.
+ *
+ * The mapping is stored by PolicyPureVector objects, which pack the
+ * actions of each stage into a block that is shared between copies. A
+ * partial joint policy constructed by copying its parent and setting
+ * the actions for one more stage therefore shares the parent's earlier
+ * stages. */
 class PartialJointPolicyPureVector :
 //    public JointPolicyPureVector , //<- don't use mutliple inheritance for code reuse..
     public PartialJointPolicyDiscretePure,
@@ -39,7 +39,9 @@ PolicyPureVector::PolicyPureVector(
              << nrDE << ")" << endl;
 
     _m_agentI = agentI;
-    _m_domainToActionIndices = vector<Index>(nrDE, 0);
+    SetNrBitsPerAction(GetInterfacePTPDiscretePure()->GetNrActions(agentI));
+    _m_nrDomainElements = 0;
+    Layout(depth);
 }
 
 PolicyPureVector::PolicyPureVector(
@@ -58,7 +60,9 @@ PolicyPureVector::PolicyPureVector(
              << nrDE << ")" << endl;
 
     _m_agentI = agentI;
-    _m_domainToActionIndices = vector<Index>(nrDE, 0);
+    SetNrBitsPerAction(GetInterfacePTPDiscretePure()->GetNrActions(agentI));
+    _m_nrDomainElements = 0;
+    Layout(depth);
 }
 
 //Copy assignment constructor.    
@@ -67,13 +71,21 @@ PolicyPureVector::PolicyPureVector(const PolicyPureVector& o) :
 {
     if(DEBUG_PPV)    cout << " clone PolicyPureVector ";
     _m_agentI = o._m_agentI;
-    _m_domainToActionIndices =vector<Index>(o._m_domainToActionIndices);
+    _m_bitsLog = o._m_bitsLog;
+    _m_entriesPerWordLog = o._m_entriesPerWordLog;
+    _m_actionMask = o._m_actionMask;
+    _m_nrActions = o._m_nrActions;
+    //the blocks are shared until one of the copies changes them
+    _m_stages = o._m_stages;
+    _m_stageBegin = o._m_stageBegin;
+    _m_nrDomainElements = o._m_nrDomainElements;
+    _m_blockLog = o._m_blockLog;
+    _m_blockStage = o._m_blockStage;
 }
 
 //Destructor
 PolicyPureVector::~PolicyPureVector()
 {
-    _m_domainToActionIndices.clear();
 }
 
 PolicyPureVector& PolicyPureVector::operator= (const PolicyPureVector& o)
@@ -82,22 +94,111 @@ PolicyPureVector& PolicyPureVector::operator= (const PolicyPureVector& o)
     // Put the normal assignment duties here...
     PolicyDiscretePure::operator= ( o );
     _m_agentI = o._m_agentI;
-    _m_domainToActionIndices = o._m_domainToActionIndices;
+    _m_bitsLog = o._m_bitsLog;
+    _m_entriesPerWordLog = o._m_entriesPerWordLog;
+    _m_actionMask = o._m_actionMask;
+    _m_nrActions = o._m_nrActions;
+    _m_stages = o._m_stages;
+    _m_stageBegin = o._m_stageBegin;
+    _m_nrDomainElements = o._m_nrDomainElements;
+    _m_blockLog = o._m_blockLog;
+    _m_blockStage = o._m_blockStage;
 
     return *this;
 }
-void PolicyPureVector::ZeroInitialization()
+
+void PolicyPureVector::SetNrBitsPerAction(size_t nrA)
 {
-if(DEBUG_PPV)cout << ">>>PolicyPureVector::ZeroInitialization(): for agent " 
-                              << _m_agentI << endl;
-    vector<Index>::iterator it = _m_domainToActionIndices.begin();
-    vector<Index>::iterator last = _m_domainToActionIndices.end();
+    //use 1, 2, 4, 8, 16 or 32 bits, such that the action indices do not
+    //cross word boundaries
+    _m_nrActions = nrA;
+    _m_bitsLog = 0;
+    while((static_cast<PackedWord>(1) << (1 << _m_bitsLog)) < nrA)
+        _m_bitsLog++;
+    _m_entriesPerWordLog = 6 - _m_bitsLog;
+    _m_actionMask = (static_cast<PackedWord>(1) << (1 << _m_bitsLog)) - 1;
+}
+
+boost::shared_ptr<PolicyPureVector::Stage>
+PolicyPureVector::NewStage(Index n) const
+{
+    size_t nrWords = (n + (1 << _m_entriesPerWordLog) - 1)
+        >> _m_entriesPerWordLog;
+    return(boost::shared_ptr<Stage>(new Stage(nrWords, 0)));
+}
+
+void PolicyPureVector::Layout(size_t depth)
+{
+    PolicyGlobals::PolicyDomainCategory cat = GetPolicyDomainCategory();
+    Index nrDE = GetInterfacePTPDiscretePure()->
+        GetNrPolicyDomainElements(_m_agentI, cat, depth);
+
+    //histories are indexed stage by stage, so for a policy of finite
+    //depth each stage gets its own block, other policies use a single one
+    vector<Index> stageBegin;
+    if(depth != MAXHORIZON && (cat == PolicyGlobals::OHIST_INDEX ||
+                               cat == PolicyGlobals::AOHIST_INDEX))
+        for(size_t t = 0; t != depth; t++)
+            stageBegin.push_back(GetInterfacePTPDiscretePure()->
+                                 GetNrPolicyDomainElements(_m_agentI, cat, t));
+    else
+        stageBegin.push_back(0);
+
+    vector<boost::shared_ptr<Stage> > stages(stageBegin.size());
+    for(size_t s = 0; s != stages.size(); s++)
+    {
+        Index begin = stageBegin[s];
+        Index end = (s+1 < stageBegin.size()) ? stageBegin[s+1] : nrDE;
+        if(s < _m_stages.size() && _m_stageBegin[s] == begin &&
+           GetStageEnd(s) == end)
+            stages[s] = _m_stages[s];
+        else
+        {
+            stages[s] = NewStage(end - begin);
+            for(Index i = begin; i < end && i < _m_nrDomainElements; i++)
+                SetPacked(*stages[s], i - begin, GetActionIndex(i));
+        }
+    }
+
+    _m_stages.swap(stages);
+    _m_stageBegin.swap(stageBegin);
+    _m_nrDomainElements = nrDE;
+    ComputeBlockStages();
+}
 
-    while(it != last)
+void PolicyPureVector::ComputeBlockStages()
+{
+    //use at most 64 blocks, the table is small compared to the stages
+    _m_blockLog = 0;
+    while((_m_nrDomainElements >> _m_blockLog) >= 64)
+        _m_blockLog++;
+    size_t nrBlocks = (_m_nrDomainElements >> _m_blockLog) + 1;
+    vector<unsigned short>* blockStage = new vector<unsigned short>(nrBlocks);
+    size_t s = 0;
+    for(size_t b = 0; b != nrBlocks; b++)
     {
-        *it = 0;
-        it++;
+        Index first = b << _m_blockLog;
+        while(s+1 < _m_stageBegin.size() && first >= _m_stageBegin[s+1])
+            s++;
+        (*blockStage)[b] = s;
     }
+    _m_blockStage = boost::shared_ptr<const vector<unsigned short> >(blockStage);
+}
+
+size_t PolicyPureVector::GetNrBytes() const
+{
+    size_t bytes = 0;
+    for(size_t s = 0; s != _m_stages.size(); s++)
+        bytes += sizeof(Stage) + _m_stages[s]->size() * sizeof(PackedWord);
+    bytes += _m_blockStage->size() * sizeof(unsigned short);
+    return(bytes);
+}
+void PolicyPureVector::ZeroInitialization()
+{
+if(DEBUG_PPV)cout << ">>>PolicyPureVector::ZeroInitialization(): for agent " 
+                              << _m_agentI << endl;
+    for(size_t s = 0; s != _m_stages.size(); s++)
+        _m_stages[s] = NewStage(GetStageEnd(s) - _m_stageBegin[s]);
 }
 
 void PolicyPureVector::RandomInitialization()
@@ -107,16 +208,13 @@ void PolicyPureVector::RandomInitialization()
             << _m_agentI << endl;
 
     Index nrA = GetInterfacePTPDiscretePure()->GetNrActions(_m_agentI);   
-    vector<Index>::iterator it = _m_domainToActionIndices.begin();
-    vector<Index>::iterator last = _m_domainToActionIndices.end();
 
-    while(it != last)
+    for(Index i = 0; i != _m_nrDomainElements; i++)
     {
         int r = rand();
         if(DEBUG_PPV)
             cout << "rand() = " <<r<<endl;
-        *it =  r% nrA;
-        it++;
+        SetAction(i, r% nrA);
     }
 }
 
@@ -134,8 +232,9 @@ bool PolicyPureVector::Increment()
     Index i = nrOH - 1;
     while(carry_over)
     {
-        _m_domainToActionIndices.at(i) = (_m_domainToActionIndices.at(i) + 1) % nrA;
-        carry_over = (_m_domainToActionIndices.at(i) == 0);
+        Index aI = (GetActionIndex(i) + 1) % nrA;
+        SetAction(i, aI);
+        carry_over = (aI == 0);
         if(i > 0)
             i--;
         else
@@ -163,7 +262,7 @@ LIndex PolicyPureVector::GetIndex() const
     {
         nrElems[0]*=nrO;
         indexVec[0]=i;
-        indexVec[1]=_m_domainToActionIndices[o];
+        indexVec[1]=GetActionIndex(o);
         i=IndexTools::IndividualToJointIndices(indexVec,nrElems);
     }
     return(i);
@@ -194,33 +293,22 @@ void PolicyPureVector::SetIndex(LIndex i)
 void PolicyPureVector::SetDepth(size_t d)
 {
     Policy::SetDepth(d);
-    _m_domainToActionIndices.resize(
-        GetInterfacePTPDiscretePure()->GetNrPolicyDomainElements(
-            _m_agentI,
-            GetPolicyDomainCategory(),
-            d));
+    Layout(d);
 }
 
 string PolicyPureVector::SoftPrint() const
 {
-    vector<Index>::const_iterator it = _m_domainToActionIndices.begin();
-    vector<Index>::const_iterator last = _m_domainToActionIndices.end();
-   
     //const ObservationHistoryTree* oht;
-    Index dIndex = 0;
-
     stringstream ss;
 
-    while(it != last)
+    for(Index dIndex = 0; dIndex != _m_nrDomainElements; dIndex++)
     {
         ss << GetInterfacePTPDiscretePure()->SoftPrintPolicyDomainElement
             (_m_agentI, dIndex, GetPolicyDomainCategory() );
         ss << " --> ";
-        ss << GetInterfacePTPDiscretePure()->SoftPrintAction(_m_agentI, *it);
+        ss << GetInterfacePTPDiscretePure()->SoftPrintAction(_m_agentI,
+                                                             GetActionIndex(dIndex));
         ss << endl;
-                
-        it++;
-        dIndex++;
     }
     return(ss.str());
 }
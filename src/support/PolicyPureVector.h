@@ -20,9 +20,11 @@
 /* the include directives */
 #include <iostream>
 #include <cmath>
+#include <vector>
 #include "PolicyDiscretePure.h"
 #include "ObservationHistoryTree.h"
 #include "E.h"
+#include "boost/shared_ptr.hpp"
 
 
 /** \brief PolicyPureVector is a class that represents a pure
@@ -34,17 +36,107 @@
  * a #Referrer to an object that implements the functions defined by
  * the #Interface_ProblemToPolicyDiscretePure (for example a planning
  * unit or Bayesian game).
+ *
+ * The action indices are stored compactly: each takes the smallest
+ * power of two number of bits that can hold the agent's number of
+ * actions. For observation histories (and action-observation
+ * histories) of a policy with a finite depth, the actions of each
+ * stage are kept in a separate block. Copies of a policy share these
+ * blocks, and a block is only copied when it is changed
+ * (copy-on-write). As a result, a partial policy that is extended
+ * with a new stage (as in GMAA) only stores the actions of that new
+ * stage itself. Different copies can be used by different threads,
+ * but like other policies a single PolicyPureVector is not
+ * thread-safe.
  */
 class PolicyPureVector : public PolicyDiscretePure 
 {
     private:    
-    
-    protected:
-        ///The index of the agent to which this policy belongs.
-        Index _m_agentI;
-        /** \brief The vector that stores the action indices for each
-         * observation history.*/
-        std::vector<Index> _m_domainToActionIndices;
+        /// The type of word in which the action indices are packed.
+        typedef unsigned long long PackedWord;
+        /// A block of packed action indices.
+        typedef std::vector<PackedWord> Stage;
+
+        /// The log2 of the number of bits used per action index.
+        size_t _m_bitsLog;
+        /// The log2 of the number of action indices per PackedWord.
+        size_t _m_entriesPerWordLog;
+        /// Mask selecting an action index from a shifted PackedWord.
+        PackedWord _m_actionMask;
+        /// The number of actions of the agent.
+        size_t _m_nrActions;
+
+        /// The blocks of packed action indices, one per stage.
+        std::vector<boost::shared_ptr<Stage> > _m_stages;
+        /// The first domain index of each of the _m_stages.
+        std::vector<Index> _m_stageBegin;
+        /// The number of domain indices (i.e., of action indices stored).
+        Index _m_nrDomainElements;
+
+        /// Sets the number of bits used per action index for nrA actions.
+        void SetNrBitsPerAction(size_t nrA);
+        /// Lays out the action indices for a policy of the given depth.
+        /** Stages whose domain indices do not change keep their
+         * block, the action indices of the other stages are copied
+         * (or set to 0 for new domain indices). */
+        void Layout(size_t depth);
+        /// The log2 of the number of domain indices per entry of _m_blockStage.
+        size_t _m_blockLog;
+        /// For each block of 2^_m_blockLog domain indices, the stage
+        /// that stores the first index of the block.
+        /** It only changes with the layout, so copies share it. */
+        boost::shared_ptr<const std::vector<unsigned short> > _m_blockStage;
+
+        /// Fills _m_blockStage for the current _m_stageBegin.
+        void ComputeBlockStages();
+        /// Returns the stage that stores domain index i.
+        /** Only a block that contains the start of a stage needs to
+         * look beyond the stage of its first index, and these are few
+         * as the stages (the histories of one length) grow in size. */
+        size_t GetStage(Index i) const
+        {
+            size_t s=(*_m_blockStage)[i >> _m_blockLog];
+            while(s+1 < _m_stageBegin.size() && i >= _m_stageBegin[s+1])
+                s++;
+            return(s);
+        }
+        /// Returns the action index stored at position i of a stage.
+        Index GetPacked(const Stage& stage, Index i) const
+        {
+            return(static_cast<Index>(
+                       (stage[i >> _m_entriesPerWordLog] >>
+                        ((i & ((1 << _m_entriesPerWordLog) - 1))
+                         << _m_bitsLog)) & _m_actionMask));
+        }
+        /// Stores aI at position i of a stage.
+        void SetPacked(Stage& stage, Index i, Index aI)
+        {
+            size_t shift=(i & ((1 << _m_entriesPerWordLog) - 1)) << _m_bitsLog;
+            PackedWord& w=stage[i >> _m_entriesPerWordLog];
+            w=(w & ~(_m_actionMask << shift)) |
+                (static_cast<PackedWord>(aI) << shift);
+        }
+        /// Returns the end of the domain indices of stage s.
+        Index GetStageEnd(size_t s) const
+        {
+            return(s+1 < _m_stageBegin.size() ? _m_stageBegin[s+1] :
+                   _m_nrDomainElements);
+        }
+        /// Returns a new block for n action indices, which are all 0.
+        boost::shared_ptr<Stage> NewStage(Index n) const;
+        /// Returns stage s, after copying it if it is shared.
+        /** This relies on the reference count of the shared_ptr,
+         * which is updated atomically, so copies of a policy can be
+         * changed by different threads. A single PolicyPureVector
+         * should not be used by several threads at the same time
+         * (while one of them changes it), as for any other object
+         * that is not thread-safe. */
+        Stage& GetWritableStage(size_t s)
+        {
+            if(!_m_stages[s].unique())
+                _m_stages[s]=boost::shared_ptr<Stage>(new Stage(*_m_stages[s]));
+            return(*_m_stages[s]);
+        }
     
     public:
         // Constructor, destructor and copy assignment.
@@ -104,14 +196,29 @@ class PolicyPureVector : public PolicyDiscretePure
 
         ///Sets the policy to map ohI->aI.
         void SetAction(Index ohI, Index aI)
-            {_m_domainToActionIndices.at(ohI) =  aI;}
+        {
+            if(ohI >= _m_nrDomainElements || aI >= _m_nrActions)
+                throw(E("PolicyPureVector::SetAction index out of bounds"));
+            size_t s=GetStage(ohI);
+            SetPacked(GetWritableStage(s), ohI - _m_stageBegin[s], aI);
+        }
         
         //get (data) functions:
 
         /**Returns the action (index) this policy specifies for a
          * particular domain index. */
         Index GetActionIndex(Index oh) const
-            {return( _m_domainToActionIndices[oh] ); }
+        {
+            size_t s=GetStage(oh);
+            return(GetPacked(*_m_stages[s], oh - _m_stageBegin[s]));
+        }
+
+        /** \brief Returns the number of bytes used to store the
+         * action indices.
+         *
+         * This includes the blocks that are shared with copies of
+         * this policy. */
+        size_t GetNrBytes() const;
         
         /// Returns a pointer to a copy of this class.
         virtual PolicyPureVector* Clone() const
@@ -16,6 +16,10 @@
 #include "TimedAlgorithm.h"
 #include <fstream>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 
 //Default constructor
@@ -31,11 +35,19 @@ TimedAlgorithm::~TimedAlgorithm()
 
 void TimedAlgorithm::StartTimer(const string & id) const
 {
+#ifdef _OPENMP
+    if(omp_in_parallel())
+        return;
+#endif
     _m_timer->Start(id);
 }
 
 void TimedAlgorithm::StopTimer(const string & id) const
 {
+#ifdef _OPENMP
+    if(omp_in_parallel())
+        return;
+#endif
     _m_timer->Stop(id);
 }
 
@@ -44,6 +44,8 @@ public:
     virtual ~TimedAlgorithm();
 
     /// Start to time an event identified by \a id.
+    /** Events that occur inside an OpenMP parallel region are not timed
+     * (the timers are not thread safe). */
     void StartTimer(const std::string & id) const;
 
     /// Stop to time an event identified by \a id.
@@ -0,0 +1,217 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <list>
+#include "Globals.h"
+#include "DecPOMDPDiscrete.h"
+#include "MADPParser.h"
+#include "NullPlanner.h"
+#include "QMDP.h"
+#include "BayesianGameWithClusterInfo.h"
+#include "PartialJointPolicyPureVector.h"
+#include "JointPolicyPureVector.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Returns the path of a problem in the problems directory of the source tree.
+string GetProblemFilename(const string &unixName)
+{
+    // 'make check' sets srcdir, also when building outside the source tree
+    const char *srcdir=getenv("srcdir");
+    return(string(srcdir ? srcdir : ".") + "/../../problems/" +
+           unixName + ".dpomdp");
+}
+
+/// Clusters the types by comparing all pairs of types, as
+/// BayesianGameWithClusterInfo::Cluster() did before it bucketed the
+/// types by signature.
+class PairwiseClusteredBG : public BayesianGameWithClusterInfo
+{
+public:
+    PairwiseClusteredBG(const BayesianGameWithClusterInfo &bg) :
+        BayesianGameWithClusterInfo(bg)
+    {}
+
+    /// Returns for each agent the types that become a type cluster, the
+    /// probabilities of the other types are shifted to them.
+    vector<vector<Index> > Cluster()
+    {
+        vector<vector<Index> > representatives(GetNrAgents());
+        for(Index agI=0;agI!=GetNrAgents();++agI)
+        {
+            list<Index> tIs;
+            for(Index tI=0;tI!=GetNrTypes(agI);++tI)
+                tIs.push_back(tI);
+            for(list<Index>::iterator it1=tIs.begin();it1!=tIs.end();++it1)
+            {
+                Index t1=*it1;
+                if(Globals::EqualProbability(
+                       ComputeMarginalTypeProbability(agI,t1),0.0))
+                    continue;
+                representatives[agI].push_back(t1);
+                list<Index>::iterator it2=it1;
+                for(++it2;it2!=tIs.end();)
+                {
+                    Index t2=*it2;
+                    if(!Globals::EqualProbability(
+                           ComputeMarginalTypeProbability(agI,t2),0.0) &&
+                       Equivalent(agI,t1,t2))
+                    {
+                        ShiftProbabilityAndUtility(agI,t1,t2);
+                        it2=tIs.erase(it2);
+                    }
+                    else
+                        ++it2;
+                }
+            }
+        }
+        return(representatives);
+    }
+
+private:
+    bool Equivalent(Index agI, Index t1, Index t2) const
+    {
+        switch(GetClusterAlgorithm())
+        {
+        case Lossless:
+            return(TestExactEquivalence(agI,t1,t2));
+        case ApproxJB:
+            return(TestApproximateEquivalence(agI,t1,t2,GetThresholdJB(),
+                                              PROB_PRECISION));
+        case ApproxPjaoh:
+            return(TestApproximateEquivalence(agI,t1,t2,PROB_PRECISION,
+                                              GetThresholdPjaoh()));
+        case ApproxPjaohJB:
+            return(TestApproximateEquivalence(agI,t1,t2,GetThresholdJB(),
+                                              GetThresholdPjaoh()));
+        }
+        return(false);
+    }
+};
+
+/// Checks that clustering the BGs of a sequence of random BG policies
+/// gives the same types, probabilities and utilities as the pairwise
+/// comparison of all types.
+void testClustering(NullPlanner &np, const QFunctionJAOHInterface &q,
+                    BayesianGameWithClusterInfo::BGClusterAlgorithm alg,
+                    double threshold)
+{
+    size_t h=np.GetHorizon();
+    boost::shared_ptr<PartialJointPolicyPureVector> pastJPol(
+        new PartialJointPolicyPureVector(&np, OHIST_INDEX, 0.0));
+    pastJPol->SetDepth(0);
+    BGwCI_sharedPtr bg(new BayesianGameWithClusterInfo(&np, &q, pastJPol,
+                                                       alg));
+    bg->SetThresholdJB(threshold);
+    bg->SetThresholdPjaoh(threshold);
+
+    stringstream name;
+    name << np.GetDPOMDPD()->GetUnixName() << " h=" << h << " "
+         << BayesianGameWithClusterInfo::SoftPrint(alg);
+    srand(42);
+    size_t nrTypes=0, nrClusteredTypes=0;
+    for(Index t=0;t!=h;++t)
+    {
+        PairwiseClusteredBG pairwise(*bg);
+        vector<vector<Index> > representatives=pairwise.Cluster();
+        BGwCI_sharedPtr bgc=bg->Cluster();
+
+        for(Index agI=0;agI!=bg->GetNrAgents();++agI)
+        {
+            nrTypes+=bg->GetNrTypes(agI);
+            nrClusteredTypes+=bgc->GetNrTypes(agI);
+            if(bgc->GetNrTypes(agI)!=representatives[agI].size())
+            {
+                stringstream ss;
+                ss << name.str() << " stage " << t << ": agent " << agI
+                   << " has " << bgc->GetNrTypes(agI) << " types, "
+                   << representatives[agI].size()
+                   << " with pairwise clustering";
+                fail(ss.str());
+            }
+        }
+        // the type clusters are in the order of their first type, so
+        // the k-th type cluster is the k-th type kept by pairwise
+        // clustering
+        for(Index jtI=0;jtI!=bgc->GetNrJointTypes();++jtI)
+        {
+            const vector<Index> &indTypes=
+                bgc->JointToIndividualTypeIndices(jtI);
+            vector<Index> pairwiseTypes(indTypes.size());
+            for(Index agI=0;agI!=indTypes.size();++agI)
+                pairwiseTypes[agI]=representatives[agI][indTypes[agI]];
+            Index pairwiseJtI=
+                pairwise.IndividualToJointTypeIndices(pairwiseTypes);
+            bool same=std::abs(bgc->GetProbability(jtI)-
+                               pairwise.GetProbability(pairwiseJtI))<1e-12;
+            for(Index jaI=0;same && jaI!=bgc->GetNrJointActions();++jaI)
+                same=std::abs(bgc->GetUtility(jtI,jaI)-
+                              pairwise.GetUtility(pairwiseJtI,jaI))<1e-9;
+            if(!same)
+            {
+                stringstream ss;
+                ss << name.str() << " stage " << t << ": joint type " << jtI
+                   << " differs from pairwise clustering";
+                fail(ss.str());
+            }
+        }
+
+        if(t+1<h)
+        {
+            JointPolicyPureVector jpol(bgc.get());
+            jpol.RandomInitialization();
+            bg=BayesianGameWithClusterInfo::ConstructExtendedBGWCI(bgc, jpol,
+                                                                   &q);
+        }
+    }
+    cout << name.str() << ": same clustering as pairwise comparison ("
+         << nrTypes << " types, " << nrClusteredTypes << " clustered)"
+         << endl;
+}
+
+int main()
+{
+    try
+    {
+        const char *problems[] = {"dectiger", "broadcastChannel",
+                                  "recycling"};
+        for(Index p=0;p!=3;++p)
+        {
+            DecPOMDPDiscrete decpomdp("","",GetProblemFilename(problems[p]));
+            MADPParser parser(&decpomdp);
+            NullPlanner np(4, &decpomdp);
+            QMDP q(&np);
+            q.Compute();
+            testClustering(np, q, BayesianGameWithClusterInfo::Lossless, 0);
+            testClustering(np, q, BayesianGameWithClusterInfo::ApproxJB, 0.3);
+            testClustering(np, q, BayesianGameWithClusterInfo::ApproxPjaoh,
+                           0.3);
+            testClustering(np, q, BayesianGameWithClusterInfo::ApproxPjaohJB,
+                           0.3);
+        }
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "BGClustering tests passed" << endl;
+    return(0);
+}
@@ -0,0 +1,252 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Globals.h"
+#include "E.h"
+#include "BayesianGameIdenticalPayoff.h"
+#include "BGIP_SolverBruteForceSearch.h"
+#include "BGIP_SolutionCache.h"
+#include "JointPolicyPureVector.h"
+#include "JPPVValuePair.h"
+
+using namespace std;
+
+typedef vector<boost::shared_ptr<JPPVValuePair> > Solutions;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Returns the best nrSolutions solutions of bg, best first.
+Solutions Solve(const BGIP_constPtr &bg, size_t nrSolutions, bool &exhausted)
+{
+    BGIP_SolverBruteForceSearch<JointPolicyPureVector> bfs(bg);
+    bfs.Solve();
+    Solutions solutions;
+    while(solutions.size() < nrSolutions && !bfs.IsEmptyJPPV())
+    {
+        solutions.push_back(bfs.GetNextSolutionJPPV());
+        bfs.PopNextSolutionJPPV();
+    }
+    exhausted=bfs.IsEmptyJPPV();
+    return(solutions);
+}
+
+BGIP_sharedPtr RandomBG(size_t nrA, size_t nrT)
+{
+    vector<size_t> acs(2, nrA), types(2, nrT);
+    return(BGIP_sharedPtr(new BayesianGameIdenticalPayoff(
+                              BayesianGameIdenticalPayoff::GenerateRandomBG(
+                                  2, acs, types))));
+}
+
+/// Returns bg with the types of each agent agI renumbered, type t of
+/// the result is type perm[agI][t] of bg.
+BGIP_sharedPtr PermuteTypes(const BayesianGameIdenticalPayoff &bg,
+                            const vector<vector<Index> > &perm)
+{
+    BGIP_sharedPtr permuted(new BayesianGameIdenticalPayoff(bg));
+    for(Index jtI=0;jtI!=bg.GetNrJointTypes();++jtI)
+    {
+        vector<Index> types=bg.JointToIndividualTypeIndices(jtI);
+        for(Index agI=0;agI!=types.size();++agI)
+            types[agI]=perm[agI][types[agI]];
+        Index orig=bg.IndividualToJointTypeIndices(types);
+        permuted->SetProbability(jtI, bg.GetProbability(orig));
+        for(Index jaI=0;jaI!=bg.GetNrJointActions();++jaI)
+            permuted->SetUtility(jtI, jaI, bg.GetUtility(orig, jaI));
+    }
+    return(permuted);
+}
+
+/// The solutions from the cache should be the best ones of bg, and have
+/// their value in bg.
+void checkSolutions(const BGIP_constPtr &bg, const Solutions &cached,
+                    size_t nrSolutions, const string &what)
+{
+    bool exhausted;
+    Solutions solved=Solve(bg, nrSolutions, exhausted);
+    if(cached.size()!=solved.size())
+        fail(what+": wrong number of solutions");
+    for(Index solI=0;solI!=cached.size();++solI)
+    {
+        double v=bg->ComputeValueJPol(*cached[solI]->GetJPPV());
+        if(std::abs(cached[solI]->GetValue()-v)>1e-9 ||
+           std::abs(solved[solI]->GetValue()-v)>1e-9)
+        {
+            stringstream ss;
+            ss << what << ": solution " << solI << " has value "
+               << cached[solI]->GetValue() << " (" << v
+               << " in the BG), the solver found "
+               << solved[solI]->GetValue();
+            fail(ss.str());
+        }
+    }
+}
+
+/// A stored BG is found, also when its types are numbered differently,
+/// as long as the requested solutions and bounds are covered.
+void testLookup()
+{
+    srand(7);
+    BGIP_sharedPtr bg=RandomBG(3, 3);
+    BGIP_SolutionCache cache;
+    Solutions solutions, cached;
+    bool exhausted;
+
+    solutions=Solve(bg, 3, exhausted);
+    cache.Store(bg, -DBL_MAX, DBL_MAX, solutions, exhausted);
+    if(!cache.Lookup(bg, 3, -DBL_MAX, DBL_MAX, cached))
+        fail("the stored BG is not found");
+    checkSolutions(bg, cached, 3, "stored BG");
+    if(cache.Lookup(bg, 4, -DBL_MAX, DBL_MAX, cached))
+        fail("found 4 solutions, while 3 are stored");
+    if(!cache.Lookup(bg, 2, 0, DBL_MAX, cached))
+        fail("the solutions are not used for a tighter lower bound");
+
+    BGIP_SolutionCache bounded;
+    bounded.Store(bg, 0, DBL_MAX, solutions, exhausted);
+    if(bounded.Lookup(bg, 3, -DBL_MAX, DBL_MAX, cached))
+        fail("solutions found with a lower bound are used without it");
+
+    vector<vector<Index> > perm(2);
+    Index perm0[] = {2, 0, 1}, perm1[] = {1, 2, 0};
+    perm[0].assign(perm0, perm0+3);
+    perm[1].assign(perm1, perm1+3);
+    BGIP_sharedPtr permuted=PermuteTypes(*bg, perm);
+    if(!cache.Lookup(permuted, 3, -DBL_MAX, DBL_MAX, cached))
+        fail("the BG with renumbered types is not found");
+    checkSolutions(permuted, cached, 3, "BG with renumbered types");
+
+    if(cache.GetNrLookups()!=4 || cache.GetNrHits()!=3)
+        fail("wrong number of lookups or hits");
+    cout << "BGIP_SolutionCache: stored solutions are found" << endl;
+}
+
+/// Types with the same probability and payoff, but a different content,
+/// are ordered by content: renumbering them does not change the
+/// canonical form.
+void testTies()
+{
+    srand(11);
+    BGIP_sharedPtr bg=RandomBG(2, 3);
+    // type 1 of agent 0 gets the probabilities of type 0, and its
+    // payoffs with the actions of agent 0 swapped, such that the sums
+    // of both are equal
+    for(Index t=0;t!=3;++t)
+    {
+        vector<Index> types(2, t);
+        types[0]=0;
+        Index jt0=bg->IndividualToJointTypeIndices(types);
+        types[0]=1;
+        Index jt1=bg->IndividualToJointTypeIndices(types);
+        bg->SetProbability(jt1, bg->GetProbability(jt0));
+        for(Index a0=0;a0!=2;++a0)
+            for(Index a1=0;a1!=2;++a1)
+            {
+                vector<Index> as(2, a1);
+                as[0]=a0;
+                Index ja=bg->IndividualToJointActionIndices(as);
+                as[0]=1-a0;
+                Index jaSwapped=bg->IndividualToJointActionIndices(as);
+                bg->SetUtility(jt1, ja, bg->GetUtility(jt0, jaSwapped));
+            }
+    }
+
+    BGIP_SolutionCache cache;
+    bool exhausted;
+    Solutions cached, solutions=Solve(bg, 2, exhausted);
+    cache.Store(bg, -DBL_MAX, DBL_MAX, solutions, exhausted);
+
+    vector<vector<Index> > perm(2);
+    Index perm0[] = {1, 0, 2}, perm1[] = {0, 1, 2};
+    perm[0].assign(perm0, perm0+3);
+    perm[1].assign(perm1, perm1+3);
+    BGIP_sharedPtr permuted=PermuteTypes(*bg, perm);
+    if(!cache.Lookup(permuted, 2, -DBL_MAX, DBL_MAX, cached))
+        fail("the BG with swapped tied types is not found");
+    checkSolutions(permuted, cached, 2, "BG with swapped tied types");
+    cout << "BGIP_SolutionCache: tied types are ordered by content" << endl;
+}
+
+/// The cache stays within its number of bytes, removing the least
+/// recently used BGs.
+void testBytes()
+{
+    srand(3);
+    vector<BGIP_sharedPtr> bgs;
+    vector<Solutions> solutions;
+    vector<bool> exhausted;
+    for(Index i=0;i!=10;++i)
+    {
+        bool e;
+        bgs.push_back(RandomBG(2, 2));
+        solutions.push_back(Solve(bgs.back(), 4, e));
+        exhausted.push_back(e);
+    }
+
+    // the size of a single entry
+    BGIP_SolutionCache one;
+    one.Store(bgs[0], -DBL_MAX, DBL_MAX, solutions[0], exhausted[0]);
+    size_t entryBytes=one.GetNrBytes();
+    if(entryBytes==0)
+        fail("an entry uses no bytes");
+
+    BGIP_SolutionCache cache(3*entryBytes);
+    Solutions cached;
+    for(Index i=0;i!=bgs.size();++i)
+    {
+        cache.Store(bgs[i], -DBL_MAX, DBL_MAX, solutions[i], exhausted[i]);
+        if(cache.GetNrBytes()>cache.GetMaxNrBytes())
+            fail("the cache uses more bytes than its maximum");
+        // keep the first BG in use
+        if(!cache.Lookup(bgs[0], 4, -DBL_MAX, DBL_MAX, cached))
+            fail("the most recently used BG was removed");
+    }
+    if(cache.GetNrEntries()!=3)
+        fail("the cache does not hold 3 BGs");
+    if(!cache.Lookup(bgs[9], 4, -DBL_MAX, DBL_MAX, cached) ||
+       cache.Lookup(bgs[7], 4, -DBL_MAX, DBL_MAX, cached))
+        fail("the wrong BGs were removed");
+
+    cache.SetMaxNrBytes(entryBytes);
+    if(cache.GetNrEntries()!=1 || cache.GetNrBytes()!=entryBytes)
+        fail("SetMaxNrBytes() does not remove BGs");
+    cache.Clear();
+    if(cache.GetNrEntries()!=0 || cache.GetNrBytes()!=0)
+        fail("Clear() does not remove all BGs");
+    cout << "BGIP_SolutionCache: the number of bytes is bounded" << endl;
+}
+
+int main()
+{
+    try
+    {
+        testLookup();
+        testTies();
+        testBytes();
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "BGIP_SolutionCache tests passed" << endl;
+    return(0);
+}
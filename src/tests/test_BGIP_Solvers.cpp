@@ -18,6 +18,7 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <cmath>
 
 #include "Globals.h"
 #include "PolicyGlobals.h"
@@ -30,6 +31,15 @@
 #include "BGIP_SolverMaxPlus.h"
 #include "BGIP_SolverBranchAndBound.h"
 #include "Timing.h"
+#include "DecPOMDPDiscrete.h"
+#include "MADPParser.h"
+#include "NullPlanner.h"
+#include "QMDP.h"
+#include "BayesianGameForDecPOMDPStage.h"
+#include "PartialJointPolicyPureVector.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define BEEP 1
 
@@ -55,6 +65,10 @@ using namespace std;
 using namespace BGIP_BnB;
 
 void testBGIP_Solvers();
+void testCompactUtilities();
+void testParallelBranchAndBound();
+void testBruteForceSearch();
+void testIncrementalBGs();
 
 //the structure in which the options are put
 ArgumentHandlers::Arguments args;
@@ -66,6 +80,10 @@ int main(int argc, char **argv)
     try
     {
         testBGIP_Solvers();
+        testCompactUtilities();
+        testParallelBranchAndBound();
+        testBruteForceSearch();
+        testIncrementalBGs();
     }catch(E& e)
     {
         e.Print();
@@ -236,3 +254,310 @@ void testBGIP_Solvers()
     if(args.verbose >= 0 && !args.testMode)
         Time.PrintSummary();
 }
+
+namespace {
+
+/// The number of threads used for the multithreaded solves.
+const int NR_TEST_THREADS=4;
+
+/// Uses nrThreads threads in the following solves (if compiled with OpenMP).
+void SetNrThreads(int nrThreads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(nrThreads);
+#endif
+}
+
+/// Generates the random BGs the solvers are compared on.
+vector<BGIP_sharedPtr> GenerateTestBGs(size_t nrBGs)
+{
+    srand(42);
+    vector<BGIP_sharedPtr> bgs;
+    for(Index i=0;i!=nrBGs;++i)
+    {
+        size_t nrAgents=2+i%2;
+        vector<size_t> acs(nrAgents), obs(nrAgents);
+        for(Index agI=0;agI!=nrAgents;++agI)
+        {
+            acs[agI]=nrAgents==2 ? 3 : 2;
+            obs[agI]=nrAgents==2 ? 3+(i+agI)%2 : 2+(i+agI)%2;
+        }
+        bgs.push_back(BGIP_sharedPtr(
+            new BayesianGameIdenticalPayoff(
+                BayesianGameIdenticalPayoff::GenerateRandomBG(nrAgents,
+                                                              acs, obs))));
+    }
+    return(bgs);
+}
+
+/// Returns the path of a problem in the problems directory of the source tree.
+string GetProblemFilename(const string &unixName)
+{
+    // 'make check' sets srcdir, also when building outside the source tree
+    const char *srcdir=getenv("srcdir");
+    return(string(srcdir ? srcdir : ".") + "/../../problems/" +
+           unixName + ".dpomdp");
+}
+
+void Check(bool ok, const string &what, Index bgI)
+{
+    if(!ok)
+    {
+        stringstream ss;
+        ss << what << " (random BG " << bgI << ")";
+        throw(E(ss.str()));
+    }
+}
+
+}
+
+/// Checks that only keeping the utilities of joint types with a positive
+/// probability changes neither the utilities that are kept nor the
+/// solution.
+void testCompactUtilities()
+{
+    vector<BGIP_sharedPtr> bgs=GenerateTestBGs(6);
+    for(Index i=0;i!=bgs.size();++i)
+    {
+        BayesianGameIdenticalPayoff &bg=*bgs[i];
+        // give every third joint type zero probability
+        double sum=0;
+        for(Index jt=0;jt!=bg.GetNrJointTypes();++jt)
+        {
+            if(jt%3==1)
+                bg.SetProbability(jt,0);
+            sum+=bg.GetProbability(jt);
+        }
+        for(Index jt=0;jt!=bg.GetNrJointTypes();++jt)
+            bg.SetProbability(jt,bg.GetProbability(jt)/sum);
+
+        BGIP_sharedPtr compact(new BayesianGameIdenticalPayoff(bg));
+        compact->RemapUtilitiesToPositiveProbabilityTypes();
+        Check(compact->GetNrUtilityRows()==
+              bg.GetNrJointTypes()-(bg.GetNrJointTypes()+1)/3+1,
+              "compact table should have a row per positive probability type, and one of zeros",i);
+        for(Index jt=0;jt!=bg.GetNrJointTypes();++jt)
+            for(Index ja=0;ja!=bg.GetNrJointActions();++ja)
+                Check(compact->GetUtility(jt,ja)==
+                      (jt%3==1 ? 0.0 : bg.GetUtility(jt,ja)),
+                      "compact table changed a utility",i);
+        // setting the utility of a zero probability type has no effect
+        compact->SetUtility(1,0,1.0);
+        Check(compact->GetUtility(1,0)==0.0 && compact->GetUtility(4,0)==0.0,
+              "zero probability types should share a row of zeros",i);
+
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> bnb(bgs[i]);
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> bnbCompact(compact);
+        double v=bnb.Solve(), vCompact=bnbCompact.Solve();
+        Check(std::abs(v-vCompact)<1e-9,
+              "compact table changed the value of the BG",i);
+    }
+    cout << "compact utilities: same utilities and values on "
+         << bgs.size() << " random BGs" << endl;
+}
+
+/// Checks that BnB returns the same value and policy with one and with
+/// several threads.
+void testParallelBranchAndBound()
+{
+    vector<BGIP_sharedPtr> bgs=GenerateTestBGs(10);
+    for(Index i=0;i!=bgs.size();++i)
+    {
+        for(Index o=0;o!=2;++o)
+        {
+            BnB_JointTypeOrdering jto= o==0 ? IdentityMapping : MaxContribution;
+            SetNrThreads(1);
+            BGIP_SolverBranchAndBound<JointPolicyPureVector> serial(bgs[i],0,1,false,jto);
+            double vSerial=serial.Solve();
+            SetNrThreads(NR_TEST_THREADS);
+            BGIP_SolverBranchAndBound<JointPolicyPureVector> parallel(bgs[i],0,1,false,jto);
+            double vParallel=parallel.Solve();
+            Check(std::abs(vSerial-vParallel)<1e-9,
+                  "BnB with several threads found a different value",i);
+            Check(serial.GetJointPolicyPureVector().GetIndex()==
+                  parallel.GetJointPolicyPureVector().GetIndex(),
+                  "BnB with several threads found a different policy",i);
+        }
+    }
+    SetNrThreads(1);
+    cout << "BnB: same value and policy with 1 and " << NR_TEST_THREADS
+         << " threads on " << bgs.size() << " random BGs" << endl;
+
+    // many policies have the same value when the utilities are small
+    // integers, which tests the tie breaking
+    for(Index i=0;i!=bgs.size();++i)
+    {
+        for(Index jt=0;jt!=bgs[i]->GetNrJointTypes();++jt)
+        {
+            bgs[i]->SetProbability(jt,1.0/bgs[i]->GetNrJointTypes());
+            for(Index ja=0;ja!=bgs[i]->GetNrJointActions();++ja)
+                bgs[i]->SetUtility(jt,ja,rand()%3);
+        }
+        SetNrThreads(1);
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> serial(bgs[i]);
+        serial.Solve();
+        SetNrThreads(NR_TEST_THREADS);
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> parallel(bgs[i]);
+        parallel.Solve();
+        Check(serial.GetJointPolicyPureVector().GetIndex()==
+              parallel.GetJointPolicyPureVector().GetIndex(),
+              "BnB with several threads broke a tie differently",i);
+    }
+    SetNrThreads(1);
+    cout << "BnB: same tied policy with 1 and " << NR_TEST_THREADS
+         << " threads" << endl;
+
+    // resuming the search, as GMAA-ICE does, returns the same sequence
+    // of next-best policies
+    const size_t nrNext=10;
+    for(Index i=0;i!=bgs.size();++i)
+    {
+        SetNrThreads(1);
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> serial(bgs[i],-1);
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> parallel(bgs[i],-1);
+        for(Index k=0;k!=nrNext;++k)
+        {
+            boost::shared_ptr<JointPolicyDiscretePure> jpolSerial,
+                jpolParallel;
+            double vSerial=0, vParallel=0;
+            SetNrThreads(1);
+            bool foundSerial=
+                serial.GetNextJointPolicyAndValue(jpolSerial,vSerial);
+            SetNrThreads(NR_TEST_THREADS);
+            bool foundParallel=
+                parallel.GetNextJointPolicyAndValue(jpolParallel,vParallel);
+            Check(foundSerial==foundParallel,
+                  "BnB with several threads ran out of solutions differently",
+                  i);
+            if(!foundSerial)
+                break;
+            Check(std::abs(vSerial-vParallel)<1e-9,
+                  "BnB with several threads found a different next value",i);
+            Check(jpolSerial->ToJointPolicyPureVector()->GetIndex()==
+                  jpolParallel->ToJointPolicyPureVector()->GetIndex(),
+                  "BnB with several threads found a different next policy",i);
+        }
+    }
+    SetNrThreads(1);
+    cout << "BnB: same " << nrNext << " next-best policies with 1 and "
+         << NR_TEST_THREADS << " threads" << endl;
+}
+
+/// Checks that brute force search finds the values of BnB, with one and
+/// with several threads, and that it stops at the first policy (in its
+/// order) that hits the CBG upper bound, no matter the number of threads.
+void testBruteForceSearch()
+{
+    vector<BGIP_sharedPtr> bgs=GenerateTestBGs(10);
+    for(Index i=0;i!=bgs.size();++i)
+    {
+        BGIP_SolverBranchAndBound<JointPolicyPureVector> bnb(bgs[i]);
+        double vBnB=bnb.Solve();
+
+        SetNrThreads(1);
+        BGIP_SolverBruteForceSearch<JointPolicyPureVector> serial(bgs[i],0,1);
+        double vSerial=serial.Solve();
+        SetNrThreads(NR_TEST_THREADS);
+        BGIP_SolverBruteForceSearch<JointPolicyPureVector> parallel(bgs[i],0,1);
+        double vParallel=parallel.Solve();
+        Check(std::abs(vSerial-vBnB)<1e-9,
+              "brute force search found a different value than BnB",i);
+        Check(std::abs(vSerial-vParallel)<1e-9 &&
+              serial.GetJointPolicyPureVector().GetIndex()==
+              parallel.GetJointPolicyPureVector().GetIndex(),
+              "brute force search with several threads found a different policy",i);
+        Check(serial.GetJointPolicyPureVector().GetIndex()==
+              bnb.GetJointPolicyPureVector().GetIndex(),
+              "brute force search found a different policy than BnB",i);
+
+        // an upper bound that many policies hit
+        double upperBound=vSerial-10;
+        SetNrThreads(1);
+        BGIP_SolverBruteForceSearch<JointPolicyPureVector> serialUB(bgs[i],0,1);
+        serialUB.SetCBGupperBound(upperBound);
+        double vSerialUB=serialUB.Solve();
+        SetNrThreads(NR_TEST_THREADS);
+        BGIP_SolverBruteForceSearch<JointPolicyPureVector> parallelUB(bgs[i],0,1);
+        parallelUB.SetCBGupperBound(upperBound);
+        double vParallelUB=parallelUB.Solve();
+        Check(vSerialUB>=upperBound-PROB_PRECISION,
+              "brute force search returned a policy below the CBG upper bound",i);
+        Check(std::abs(vSerialUB-vParallelUB)<1e-9 &&
+              serialUB.GetJointPolicyPureVector().GetIndex()==
+              parallelUB.GetJointPolicyPureVector().GetIndex(),
+              "brute force search with several threads hit the CBG upper bound with a different policy",i);
+    }
+    SetNrThreads(1);
+    cout << "brute force search: values of BnB, same policy with 1 and "
+         << NR_TEST_THREADS << " threads on " << bgs.size()
+         << " random BGs" << endl;
+}
+
+/// Checks that the BG for a stage that is constructed from the BG of the
+/// previous stage (as GMAA does) has the same types, probabilities and
+/// utilities as the BG constructed from scratch.
+void testIncrementalBGs()
+{
+    srand(42);
+    ProblemDecTiger dectiger;
+    DecPOMDPDiscrete broadcast("","",GetProblemFilename("broadcastChannel"));
+    MADPParser parser(&broadcast);
+    DecPOMDPDiscreteInterface* problems[] = {&dectiger, &broadcast};
+    size_t nrChecked=0;
+    for(Index p=0;p!=2;++p)
+        for(size_t h=2;h<=3;++h)
+        {
+            NullPlanner np(h, problems[p]);
+            QMDP q(&np);
+            q.Compute();
+            boost::shared_ptr<PartialJointPolicyPureVector> pastJPol(
+                new PartialJointPolicyPureVector(&np, OHIST_INDEX, 0.0));
+            pastJPol->SetDepth(0);
+            boost::shared_ptr<const BayesianGameForDecPOMDPStage> bg(
+                new BayesianGameForDecPOMDPStage(&np, &q, pastJPol));
+            for(Index ts=1;ts!=h;++ts)
+            {
+                // extend the past policy with a random policy for the BG
+                JointPolicyPureVector jpolBG(bg, TYPE_INDEX);
+                jpolBG.RandomInitialization();
+                boost::shared_ptr<PartialJointPolicyPureVector> jpol(
+                    new PartialJointPolicyPureVector(*pastJPol));
+                jpol->SetDepth(ts);
+                for(Index agI=0;agI!=np.GetNrAgents();++agI)
+                {
+                    Index firstOHI=CastLIndexToIndex(
+                        np.GetFirstObservationHistoryIndex(agI, ts-1));
+                    for(Index tI=0;tI!=bg->GetNrTypes(agI);++tI)
+                        jpol->SetAction(agI, firstOHI+tI,
+                                        jpolBG.GetActionIndex(agI, tI));
+                }
+
+                boost::shared_ptr<const BayesianGameForDecPOMDPStage>
+                    incremental(new BayesianGameForDecPOMDPStage(bg, jpol));
+                BayesianGameForDecPOMDPStage scratch(&np, &q, jpol);
+                stringstream ss;
+                ss << "incremental BG differs from the BG from scratch ("
+                   << problems[p]->GetUnixName() << " h=" << h << " ts="
+                   << ts << ")";
+                bool same=incremental->GetNrTypes()==scratch.GetNrTypes() &&
+                    incremental->GetNrJointTypes()==scratch.GetNrJointTypes();
+                for(Index jt=0;same && jt!=scratch.GetNrJointTypes();++jt)
+                {
+                    same=std::abs(incremental->GetProbability(jt)-
+                                  scratch.GetProbability(jt))<1e-12;
+                    for(Index ja=0;same && ja!=scratch.GetNrJointActions();
+                        ++ja)
+                        same=std::abs(incremental->GetUtility(jt,ja)-
+                                      scratch.GetUtility(jt,ja))<1e-9;
+                }
+                if(!same)
+                    throw(E(ss.str()));
+                bg=incremental;
+                pastJPol=jpol;
+                nrChecked++;
+            }
+        }
+    cout << "incremental BGs: same types, probabilities and utilities as "
+         << "from scratch for " << nrChecked
+         << " stages of dectiger and broadcastChannel (h=2,3)" << endl;
+}
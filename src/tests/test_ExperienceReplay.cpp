@@ -0,0 +1,141 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox. 
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For 
+ * more information, see the included COPYING file. For other information, 
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Philipp Robbel 
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include "Globals.h"
+#include "ExperienceReplayBuffer.h"
+#include "AgentQLearner.h"
+#include "ProblemDecTiger.h"
+#include "NullPlanner.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Checks that transitions are sampled proportional to their priority.
+void testSamplingFrequencies(size_t capacity, const vector<double> &priorities)
+{
+    ExperienceReplayBuffer buffer(capacity, true);
+    for(Index k=0;k!=capacity;++k)
+        buffer.Add(k,0,0,0);
+    double total=0;
+    for(Index k=0;k!=capacity;++k)
+    {
+        buffer.SetPriority(k,priorities[k]);
+        total+=priorities[k];
+    }
+
+    size_t nrSamples=200000;
+    vector<size_t> counts(capacity,0);
+    for(Index n=0;n!=nrSamples;++n)
+        counts[buffer.Sample(rand()/(RAND_MAX+1.0))]++;
+
+    for(Index k=0;k!=capacity;++k)
+    {
+        double expected=priorities[k]/total,
+            observed=static_cast<double>(counts[k])/nrSamples;
+        if(std::abs(expected-observed) > 0.01)
+        {
+            stringstream ss;
+            ss << "transition " << k << " sampled with frequency " << observed
+               << ", expected " << expected;
+            fail(ss.str());
+        }
+    }
+}
+
+/// Checks that a full buffer overwrites the oldest transition, and that
+/// overwritten transitions start with the largest priority seen.
+void testRingBuffer()
+{
+    ExperienceReplayBuffer buffer(3, true);
+    for(Index k=0;k!=5;++k)
+        buffer.Add(k,k,k,k);
+    if(buffer.GetSize()!=3)
+        fail("buffer size should be capped at its capacity");
+    // slots 0 and 1 were overwritten by transitions 3 and 4
+    if(buffer.GetState(0)!=3 || buffer.GetState(1)!=4 || buffer.GetState(2)!=2)
+        fail("the oldest transitions should be overwritten first");
+
+    buffer.SetPriority(0,0.0);
+    buffer.SetPriority(1,4.0);
+    buffer.SetPriority(2,0.0);
+    for(Index n=0;n!=1000;++n)
+        if(buffer.Sample(rand()/(RAND_MAX+1.0))!=1)
+            fail("transitions with priority 0 should not be sampled");
+    // overwrites the oldest transition, in slot 2, with the max priority 4
+    buffer.Add(5,5,5,5);
+    if(buffer.GetState(2)!=5)
+        fail("the oldest transitions should be overwritten first");
+    size_t count=0;
+    for(Index n=0;n!=10000;++n)
+        if(buffer.Sample(rand()/(RAND_MAX+1.0))==2)
+            count++;
+    if(std::abs(count/10000.0-0.5) > 0.03)
+        fail("new transitions should get the largest priority seen");
+}
+
+/// Checks that replayed updates converge to the one-step returns: with
+/// gamma=0, Q(s,ja) has to converge to the reward of (s,ja).
+void testLearnFromReplay(bool prioritized)
+{
+    ProblemDecTiger dectiger;
+    NullPlanner np(&dectiger);
+    AgentQLearner agent(&np, 0, 0.0, 0.0, 0.5, 0.0);
+    agent.SetExperienceReplay(16, 4, 2, prioritized);
+    agent.Act(0, 0, 0);
+
+    // 8 distinct transitions, half the buffer's capacity
+    size_t nrS=dectiger.GetNrStates(), nrJA=4;
+    for(Index n=0;n!=200;++n)
+        for(Index sI=0;sI!=nrS;++sI)
+            for(Index jaI=0;jaI!=nrJA;++jaI)
+                agent.Learn(jaI, 10.0*sI+jaI, 0, sI);
+
+    QTable Q=agent.GetQTable();
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            if(std::abs(Q(sI,jaI)-(10.0*sI+jaI)) > 1e-3)
+            {
+                stringstream ss;
+                ss << "Q(" << sI << "," << jaI << ")=" << Q(sI,jaI)
+                   << " after replay, expected " << 10.0*sI+jaI;
+                fail(ss.str());
+            }
+}
+
+int main()
+{
+    srand(42);
+
+    double p1[] = {1,2,3,4,0.5};
+    testSamplingFrequencies(5, vector<double>(p1, p1 + 5));
+    vector<double> p2(12);
+    for(Index k=0;k!=p2.size();++k)
+        p2[k]=(k%3==0) ? 0.0 : 1.0+k;
+    testSamplingFrequencies(p2.size(), p2);
+
+    testRingBuffer();
+
+    testLearnFromReplay(false);
+    testLearnFromReplay(true);
+
+    cout << "ExperienceReplay tests passed" << endl;
+    return(0);
+}
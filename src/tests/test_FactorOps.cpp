@@ -0,0 +1,220 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Globals.h"
+#include "E.h"
+#include "factor.h"
+#include "ndp.h"
+
+using namespace std;
+using libDAI::Var;
+using libDAI::VarSet;
+using libDAI::Factor;
+using libDAI::VarStride;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+Factor RandomFactor(const VarSet &vs)
+{
+    Factor f(vs, 0.0);
+    for(size_t i=0;i!=f.stateSpace();++i)
+        f[i]=rand()/(double)RAND_MAX-0.5;
+    return(f);
+}
+
+/// partSum() as computed by stepping an Index, i.e., without VarStride.
+Factor PartSumIndex(const Factor &f, const VarSet &ns)
+{
+    Factor res(ns, 0.0);
+    libDAI::Index i_res(ns, f.vars());
+    for(size_t i=0;i!=f.stateSpace();++i, ++i_res)
+        res[i_res]+=f[i];
+    return(res);
+}
+
+/// partMax() as computed by stepping an Index.
+Factor PartMaxIndex(const Factor &f, const VarSet &ns)
+{
+    Factor res(ns, -INFINITY);
+    libDAI::Index i_res(ns, f.vars());
+    for(size_t i=0;i!=f.stateSpace();++i, ++i_res)
+        res[i_res]=max(res[i_res], f[i]);
+    return(res);
+}
+
+/// operator* as computed by stepping an Index.
+Factor ProductIndex(const Factor &f, const Factor &g)
+{
+    Factor prod(f.vars() | g.vars(), 0.0);
+    libDAI::Index i1(f.vars(), prod.vars());
+    libDAI::Index i2(g.vars(), prod.vars());
+    for(size_t i=0;i!=prod.stateSpace();++i, ++i1, ++i2)
+        prod[i]+=f[i1]*g[i2];
+    return(prod);
+}
+
+/// The results should be bitwise identical, as the fast paths perform the
+/// same operations in the same order.
+void checkEqual(const Factor &a, const Factor &b, const string &what)
+{
+    bool same=a.vars()==b.vars() && a.stateSpace()==b.stateSpace();
+    for(size_t i=0;same && i!=a.stateSpace();++i)
+        same=a[i]==b[i];
+    if(!same)
+    {
+        stringstream ss;
+        ss << what << " differs from the Index computation: " << a
+           << " vs " << b;
+        fail(ss.str());
+    }
+}
+
+/// Compares the fast paths of partSum/partMax/operator* and the slices
+/// read by NDP through a VarStride to the Index computations, for a
+/// factor over the variables of shapes.
+void testShape(const vector<Var> &vars, const string &name)
+{
+    VarSet vs;
+    for(Index i=0;i!=vars.size();++i)
+        vs|=vars[i];
+    Factor f=RandomFactor(vs);
+
+    for(Index i=0;i!=vars.size();++i)
+    {
+        const Var &v=vars[i];
+        stringstream what;
+        what << name << " v" << v.label();
+
+        checkEqual(f.partSum(VarSet(v)), PartSumIndex(f, VarSet(v)),
+                   what.str()+" partSum");
+        checkEqual(f.partMax(VarSet(v)), PartMaxIndex(f, VarSet(v)),
+                   what.str()+" partMax");
+
+        // single-variable operand, on either side
+        Factor g=RandomFactor(VarSet(v));
+        checkEqual(f*g, ProductIndex(f, g), what.str()+" f*g");
+        checkEqual(g*f, ProductIndex(g, f), what.str()+" g*f");
+
+        // the slice of f for a state r of the other variables, as read
+        // by NDP::EliminateVariable()
+        VarStride st(v, vs);
+        VarSet rest=vs / v;
+        for(size_t r=0;r!=rest.stateSpace();++r)
+        {
+            Factor slice=f.slice(rest, r);
+            size_t base=st.embed(r);
+            for(size_t s=0;s!=st.states;++s)
+                if(f[base+st.offset(s, 0)]!=slice[s])
+                {
+                    stringstream ss;
+                    ss << what.str() << " slice " << r << " state " << s
+                       << " differs from Factor::slice()";
+                    fail(ss.str());
+                }
+        }
+    }
+
+    // equal variables
+    Factor h=RandomFactor(vs);
+    checkEqual(f*h, ProductIndex(f, h), name+" equal varsets f*h");
+
+    // a general shape, which takes the Index path
+    if(vars.size()>1)
+    {
+        VarSet other(vars[0], Var(99, 2));
+        Factor g=RandomFactor(other);
+        checkEqual(f*g, ProductIndex(f, g), name+" general f*g");
+        VarSet ns(vars[0], vars.back());
+        checkEqual(f.partSum(ns), PartSumIndex(f, ns), name+" general partSum");
+    }
+    cout << name << ": VarStride paths equal the Index computation" << endl;
+}
+
+/// Checks that NDP finds the maximum of a small random factor graph, as
+/// found by enumerating all joint states.
+void testNDP()
+{
+    vector<Var> vars;
+    for(long i=0;i!=5;++i)
+        vars.push_back(Var(i, 2+i%3));
+    vector<Factor> facs;
+    facs.push_back(RandomFactor(VarSet(vars[0], vars[1])));
+    facs.push_back(RandomFactor(VarSet(vars[1], vars[2]) | vars[3]));
+    facs.push_back(RandomFactor(VarSet(vars[3], vars[4])));
+    facs.push_back(RandomFactor(VarSet(vars[0], vars[4])));
+    facs.push_back(RandomFactor(VarSet(vars[2])));
+    libDAI::FactorGraph fg(facs);
+
+    VarSet all;
+    for(Index i=0;i!=vars.size();++i)
+        all|=vars[i];
+    double best=-INFINITY;
+    for(size_t j=0;j!=all.stateSpace();++j)
+    {
+        double val=0;
+        for(Index fI=0;fI!=facs.size();++fI)
+        {
+            // the state of the variables of facs[fI] in joint state j
+            libDAI::Index idx(facs[fI].vars(), all);
+            for(size_t k=0;k!=j;++k)
+                ++idx;
+            val+=facs[fI][idx];
+        }
+        best=max(best, val);
+    }
+
+    libDAI::Properties props;
+    props.Set("verbose", (size_t)0);
+    libDAI::NDP ndp(fg, props);
+    ndp.init();
+    double val=ndp.run();
+    if(std::abs(val-best)>1e-9)
+    {
+        stringstream ss;
+        ss << "NDP found value " << val << ", the maximum is " << best;
+        fail(ss.str());
+    }
+    cout << "NDP: found the maximum of a random factor graph" << endl;
+}
+
+int main()
+{
+    try
+    {
+        srand(42);
+        vector<Var> vars;
+        vars.push_back(Var(3, 4));
+        testShape(vars, "single variable");
+        vars.push_back(Var(5, 3));
+        testShape(vars, "binary");
+        vars.insert(vars.begin(), Var(1, 2));
+        testShape(vars, "ternary");
+        vars.push_back(Var(7, 5));
+        testShape(vars, "four variables");
+        testNDP();
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "FactorOps tests passed" << endl;
+    return(0);
+}
@@ -0,0 +1,400 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <pthread.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Globals.h"
+#include "ProblemFireFightingFactored.h"
+#include "ProblemFOBSFireFightingFactored.h"
+#include "FactoredFlatModelEvaluator.h"
+#include "CPDKroneckerDelta.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/**FireFighting in which fire spreads within a stage: when the next fire
+ * level of house h+1 is the maximum, house h also gets the maximum fire
+ * level with probability 0.5. The successor factors therefore have to be
+ * assigned in the order 2, 1, 0, not in index order.
+ *
+ * The rewards of FireFighting depend on the next-stage fire levels, which
+ * FactoredDecPOMDPDiscrete can only back-project without within-stage
+ * dependencies. So the problem is first initialized without spreading,
+ * which sets the rewards, and then the 2DBN is initialized again (without
+ * constructing the observations again, as Initialize2DBN() would). */
+class ProblemFireFightingSpreading : public ProblemFOBSFireFightingFactored
+{
+private:
+    bool _m_spreading;
+
+protected:
+    void SetYScopes()
+    {
+        ProblemFOBSFireFightingFactored::SetYScopes();
+        if(!_m_spreading)
+            return;
+        for(Index yI=0; yI+1 < _m_nrHouses; yI++)
+        {
+            Scope x=GetXSoI_Y(yI), a=GetASoI_Y(yI), y;
+            y.Insert(yI+1);
+            SetSoI_Y(yI,x,a,y);
+        }
+    }
+
+    double ComputeTransitionProb(Index y,
+                                 Index yVal,
+                                 const std::vector< Index>& Xs,
+                                 const std::vector< Index>& As,
+                                 const std::vector< Index>& Ys) const
+    {
+        double p=ProblemFOBSFireFightingFactored::ComputeTransitionProb(
+            y,yVal,Xs,As,Ys);
+        if(!Ys.empty() && Ys[0]==_m_nrFireLevels-1)
+            p=0.5*p + (yVal==_m_nrFireLevels-1 ? 0.5 : 0.0);
+        return(p);
+    }
+
+public:
+    ProblemFireFightingSpreading() :
+        ProblemFOBSFireFightingFactored(2,3,3,0.0,false,false),
+        _m_spreading(false)
+    {
+        InitializePFFF();
+        _m_spreading=true;
+        BoundScopeFunctor<FactoredMMDPDiscrete> sf(
+            this,&FactoredMMDPDiscrete::SetScopes);
+        BoundTransitionProbFunctor<FactoredMMDPDiscrete> tf(
+            this,&FactoredMMDPDiscrete::ComputeTransitionProb);
+        EmptyObservationProbFunctor of;
+        MultiAgentDecisionProcessDiscreteFactoredStates::Initialize2DBN(
+            sf,tf,of);
+        for(Index agI=0; agI < GetNrAgents(); agI++)
+            Get2DBN()->SetCPD_O(agI, new CPDKroneckerDelta());
+    }
+};
+
+void Check(const MultiAgentDecisionProcessDiscreteFactoredStates &p,
+           bool ok, const string &what, Index sI, Index jaI, Index sucSI,
+           double value, double expected)
+{
+    if(!ok)
+    {
+        stringstream ss;
+        ss << p.GetUnixName() << ": " << what << " for s=" << sI << " ja="
+           << jaI << " s'=" << sucSI << " is " << value << ", expected "
+           << expected;
+        fail(ss.str());
+    }
+}
+
+/// Checks the transition and reward models computed with the
+/// FactoredFlatModelEvaluator of p against the 2DBN and the LRFs, and
+/// against the cached flat models of flat.
+/** The flat models are themselves cached with the evaluator, so the 2DBN
+ * and the LRFs are the independent reference. */
+void testFlatModels(const FactoredDecPOMDPDiscrete &p,
+                    FactoredDecPOMDPDiscrete &flat)
+{
+    flat.CacheFlatModels(false);
+    const FactoredFlatModelEvaluator *eval=p.GetFlatModelEvaluator();
+    if(!eval)
+        fail("the factored model should have a flat model evaluator");
+    const TwoStageDynamicBayesianNetwork &dbn=*p.Get2DBN();
+
+    size_t nrS=p.GetNrStates(), nrJA=p.GetNrJointActions();
+    vector<Index> sucSIs;
+    vector<double> probs;
+    for(Index sI=0;sI!=nrS;++sI)
+    {
+        vector<Index> X=p.StateIndexToFactorValueIndices(sI);
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+        {
+            vector<Index> A=p.JointToIndividualActionIndices(jaI);
+            double r=p.GetReward(X,A);
+            Check(p,std::abs(p.GetReward(sI,jaI)-r)<1e-12,"GetReward()",
+                  sI,jaI,0,p.GetReward(sI,jaI),r);
+            Check(p,std::abs(flat.GetReward(sI,jaI)-r)<1e-12,
+                  "the cached GetReward()",sI,jaI,0,flat.GetReward(sI,jaI),r);
+
+            eval->GetSuccessors(sI,jaI,sucSIs,probs);
+            Index k=0;
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+            {
+                vector<Index> Y=p.StateIndexToFactorValueIndices(sucSI);
+                double q=dbn.GetYProbability(X,A,Y);
+                Check(p,std::abs(eval->GetTransitionProbability(sI,jaI,sucSI)
+                                 -q)<1e-12,"GetTransitionProbability()",
+                      sI,jaI,sucSI,
+                      eval->GetTransitionProbability(sI,jaI,sucSI),q);
+                Check(p,std::abs(p.GetTransitionProbability(sI,jaI,sucSI)-q)
+                      <1e-12,"the non-cached GetTransitionProbability()",
+                      sI,jaI,sucSI,p.GetTransitionProbability(sI,jaI,sucSI),q);
+                Check(p,std::abs(flat.GetTransitionProbability(sI,jaI,sucSI)
+                                 -q)<1e-12,
+                      "the cached GetTransitionProbability()",sI,jaI,sucSI,
+                      flat.GetTransitionProbability(sI,jaI,sucSI),q);
+                if(q==0)
+                    continue;
+                // the successors have to be returned in increasing order
+                if(k==sucSIs.size() || sucSIs[k]!=sucSI)
+                    Check(p,false,"the successor returned by GetSuccessors()",
+                          sI,jaI,sucSI,k<sucSIs.size() ? sucSIs[k] : -1.0,
+                          sucSI);
+                Check(p,std::abs(probs[k]-q)<1e-12,"GetSuccessors()",
+                      sI,jaI,sucSI,probs[k],q);
+                k++;
+            }
+            if(k!=sucSIs.size())
+                Check(p,false,"the nr. of successors",sI,jaI,0,
+                      sucSIs.size(),k);
+        }
+    }
+    cout << p.GetUnixName() << ": transitions and rewards agree with the "
+         << "2DBN and the cached flat models" << endl;
+}
+
+/// The transition probabilities of an evaluator, in the order s, ja, s'.
+vector<double> TransitionTable(const FactoredFlatModelEvaluator &eval,
+                               size_t nrS, size_t nrJA)
+{
+    vector<double> T;
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+                T.push_back(eval.GetTransitionProbability(sI,jaI,sucSI));
+    return(T);
+}
+
+/// What a thread evaluates: two evaluators alternately, whose tables
+/// have to equal the expected ones.
+struct EvaluationTask
+{
+    const FactoredFlatModelEvaluator *eval[2];
+    size_t nrS[2], nrJA[2];
+    const vector<double> *expected[2];
+    bool nested;
+    size_t nrErrors;
+};
+
+void *Evaluate(void *arg)
+{
+    EvaluationTask &task=*static_cast<EvaluationTask*>(arg);
+    task.nrErrors=0;
+    for(Index rep=0;rep!=4;++rep)
+    {
+        Index e=rep%2;
+        const vector<double> &expected=*task.expected[e];
+        size_t nrS=task.nrS[e], nrJA=task.nrJA[e], nrErrors=0;
+        long nrRows=static_cast<long>(nrS*nrJA);
+        // with nested set, an OpenMP team evaluates the rows, whose
+        // thread numbers equal those of the other threads' teams
+#pragma omp parallel for num_threads(2) reduction(+:nrErrors) if(task.nested)
+        for(long row=0;row<nrRows;++row)
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+                if(task.eval[e]->GetTransitionProbability(
+                       row/nrJA,row%nrJA,sucSI)!=expected[row*nrS+sucSI])
+                    nrErrors++;
+        task.nrErrors+=nrErrors;
+    }
+    return(0);
+}
+
+/// Evaluates the transition models of p and q from several threads that
+/// are not created by OpenMP, some of which start OpenMP teams, and each
+/// of which switches between the two evaluators.
+void testConcurrentEvaluation(const FactoredDecPOMDPDiscrete &p,
+                              const FactoredDecPOMDPDiscrete &q)
+{
+    const FactoredFlatModelEvaluator *evals[2] = {p.GetFlatModelEvaluator(),
+                                                  q.GetFlatModelEvaluator()};
+    const FactoredDecPOMDPDiscrete *problems[2] = {&p, &q};
+    vector<double> expected[2];
+    for(Index e=0;e!=2;++e)
+        expected[e]=TransitionTable(*evals[e],problems[e]->GetNrStates(),
+                                    problems[e]->GetNrJointActions());
+
+    const size_t nrThreads=4;
+    vector<EvaluationTask> tasks(nrThreads);
+    vector<pthread_t> threads(nrThreads);
+    for(Index t=0;t!=nrThreads;++t)
+    {
+        for(Index e=0;e!=2;++e)
+        {
+            // the threads start with different evaluators
+            Index k=(e+t)%2;
+            tasks[t].eval[e]=evals[k];
+            tasks[t].nrS[e]=problems[k]->GetNrStates();
+            tasks[t].nrJA[e]=problems[k]->GetNrJointActions();
+            tasks[t].expected[e]=&expected[k];
+        }
+        tasks[t].nested=t%2==1;
+        if(pthread_create(&threads[t],0,Evaluate,&tasks[t])!=0)
+            fail("could not create a thread");
+    }
+    for(Index t=0;t!=nrThreads;++t)
+    {
+        pthread_join(threads[t],0);
+        if(tasks[t].nrErrors>0)
+        {
+            stringstream ss;
+            ss << "thread " << t << " evaluated " << tasks[t].nrErrors
+               << " transition probabilities differently";
+            fail(ss.str());
+        }
+    }
+    cout << p.GetUnixName() << ", " << q.GetUnixName() << ": evaluated "
+         << "concurrently from " << nrThreads << " threads" << endl;
+}
+
+/// Two threads decompose states that map to the same memo slot.
+struct MemoTask
+{
+    const FactoredFlatModelEvaluator *eval;
+    pthread_barrier_t *barrier;
+    Index sI;
+    size_t nrSF;
+    bool first;
+    bool ok;
+};
+
+void *DecomposeState(void *arg)
+{
+    MemoTask &task=*static_cast<MemoTask*>(arg);
+    vector<Index> buffer;
+    task.ok=true;
+    if(task.first)
+    {
+        // the values have to remain valid until this thread's next call,
+        // whatever the other thread does in between
+        const Index *X=task.eval->GetStateFactorValues(task.sI,buffer);
+        vector<Index> copy(X,X+task.nrSF);
+        pthread_barrier_wait(task.barrier);
+        pthread_barrier_wait(task.barrier);
+        task.ok=equal(copy.begin(),copy.end(),X);
+    }
+    else
+    {
+        pthread_barrier_wait(task.barrier);
+        task.eval->GetStateFactorValues(task.sI,buffer);
+        pthread_barrier_wait(task.barrier);
+    }
+    return(0);
+}
+
+/// Checks that threads that are not created by OpenMP (and so all have
+/// OpenMP thread number 0) do not share their memo.
+void testThreadMemos(const FactoredDecPOMDPDiscrete &p)
+{
+    const FactoredFlatModelEvaluator *eval=p.GetFlatModelEvaluator();
+    if(p.GetNrStates()<=64)
+        fail("testThreadMemos needs more states than memo slots");
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier,0,2);
+    MemoTask tasks[2];
+    pthread_t threads[2];
+    for(Index t=0;t!=2;++t)
+    {
+        tasks[t].eval=eval;
+        tasks[t].barrier=&barrier;
+        // states 1 and 65 use the same slot of a memo
+        tasks[t].sI=1+64*t;
+        tasks[t].nrSF=p.GetNrStateFactors();
+        tasks[t].first=t==0;
+        if(pthread_create(&threads[t],0,DecomposeState,&tasks[t])!=0)
+            fail("could not create a thread");
+    }
+    for(Index t=0;t!=2;++t)
+        pthread_join(threads[t],0);
+    pthread_barrier_destroy(&barrier);
+    if(!tasks[0].ok)
+        fail("the state factor values of a thread were overwritten by "
+             "another thread");
+    cout << p.GetUnixName() << ": threads have their own memo" << endl;
+}
+
+/// Caches the flat models of two instances of FireFighting with more
+/// states than a caching block, one with one thread and one with
+/// several, and checks that they agree entry for entry.
+void testParallelCaching(bool sparse)
+{
+    // 625 states, so the rows of a joint action span several blocks
+    ProblemFireFightingFactored serial(2,4,5), parallel(2,4,5);
+#ifdef _OPENMP
+    int maxThreads=omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    serial.CacheFlatModels(sparse);
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    parallel.CacheFlatModels(sparse);
+#ifdef _OPENMP
+    omp_set_num_threads(maxThreads);
+#endif
+
+    size_t nrS=serial.GetNrStates(), nrJA=serial.GetNrJointActions();
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+        {
+            Check(serial,parallel.GetReward(sI,jaI)==serial.GetReward(sI,jaI),
+                  "the reward cached in parallel",sI,jaI,0,
+                  parallel.GetReward(sI,jaI),serial.GetReward(sI,jaI));
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+            {
+                double p=parallel.GetTransitionProbability(sI,jaI,sucSI),
+                    q=serial.GetTransitionProbability(sI,jaI,sucSI);
+                Check(serial,p==q,"the transition probability cached in "
+                      "parallel",sI,jaI,sucSI,p,q);
+            }
+        }
+    cout << serial.GetUnixName() << ": the " << (sparse ? "sparse" : "dense")
+         << " flat models cached in parallel equal the serial ones" << endl;
+}
+
+int main()
+{
+    try
+    {
+        ProblemFireFightingFactored ff(2,3,3), ffFlat(2,3,3);
+        testFlatModels(ff,ffFlat);
+
+        ProblemFireFightingSpreading spreading, spreadingFlat;
+        if(spreading.GetYSoI_Y(0).empty())
+            fail("the next-stage fire level of house 0 should depend on "
+                 "that of house 1");
+        testFlatModels(spreading,spreadingFlat);
+
+        testConcurrentEvaluation(ff,spreading);
+
+        ProblemFireFightingFactored ff4(2,4,3);
+        testThreadMemos(ff4);
+
+        testParallelCaching(false);
+        testParallelCaching(true);
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "FactoredFlatModels tests passed" << endl;
+    return(0);
+}
@@ -0,0 +1,191 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Globals.h"
+#include "E.h"
+#include "ProblemFireFightingFactored.h"
+#include "TwoStageDynamicBayesianNetwork.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// The number of threads that sample concurrently, each with its own seed.
+const size_t nrThreads=4;
+/// The number of samples drawn per seed.
+const size_t nrSamples=5000;
+
+/// Returns the index of vals in the joint space of factors of sizes nrVals.
+Index JointIndex(const vector<Index> &vals, const vector<size_t> &nrVals)
+{
+    Index i=0;
+    for(Index k=0;k!=vals.size();++k)
+        i=i*nrVals[k]+vals[k];
+    return(i);
+}
+
+/// Returns the values of the factors of sizes nrVals for joint index i.
+vector<Index> Values(Index i, const vector<size_t> &nrVals)
+{
+    vector<Index> vals(nrVals.size());
+    for(Index k=nrVals.size();k-- > 0;)
+    {
+        vals[k]=i%nrVals[k];
+        i/=nrVals[k];
+    }
+    return(vals);
+}
+
+size_t NrJoint(const vector<size_t> &nrVals)
+{
+    size_t n=1;
+    for(Index k=0;k!=nrVals.size();++k)
+        n*=nrVals[k];
+    return(n);
+}
+
+/// Draws nrSamples successor states and observations for X,A with seed,
+/// and returns their joint indices, as a sequence of (Y,O) pairs.
+vector<Index> SampleSequence(const TwoStageDynamicBayesianNetwork &bn,
+                             const vector<Index> &X, const vector<Index> &A,
+                             const vector<size_t> &nrY,
+                             const vector<size_t> &nrO, unsigned int seed)
+{
+    vector<Index> seq, Y, O;
+    seq.reserve(2*nrSamples);
+    for(Index i=0;i!=nrSamples;++i)
+    {
+        bn.SampleY(X, A, Y, &seed);
+        bn.SampleO(X, A, Y, O, &seed);
+        seq.push_back(JointIndex(Y, nrY));
+        seq.push_back(JointIndex(O, nrO));
+    }
+    return(seq);
+}
+
+/// Checks that the frequencies of the (Y,O) pairs in the sequences are
+/// within tol of the probabilities P(Y,O|X,A).
+void checkDistribution(const TwoStageDynamicBayesianNetwork &bn,
+                       const vector<Index> &X, const vector<Index> &A,
+                       const vector<size_t> &nrY, const vector<size_t> &nrO,
+                       const vector<vector<Index> > &seqs, double tol,
+                       const string &what)
+{
+    size_t nrJY=NrJoint(nrY), nrJO=NrJoint(nrO), total=0;
+    vector<size_t> counts(nrJY*nrJO, 0);
+    for(Index k=0;k!=seqs.size();++k)
+        for(Index i=0;i+1<seqs[k].size();i+=2, ++total)
+            counts[seqs[k][i]*nrJO+seqs[k][i+1]]++;
+
+    double sum=0;
+    for(Index y=0;y!=nrJY;++y)
+        for(Index o=0;o!=nrJO;++o)
+        {
+            vector<Index> Y=Values(y, nrY), O=Values(o, nrO);
+            double p=bn.GetYProbability(X, A, Y)*bn.GetOProbability(X, A, Y, O);
+            double freq=counts[y*nrJO+o]/static_cast<double>(total);
+            sum+=p;
+            if(std::abs(freq-p)>tol)
+            {
+                stringstream ss;
+                ss << what << ": (Y,O)=(" << y << "," << o << ") sampled "
+                   << "with frequency " << freq << ", its probability is "
+                   << p;
+                fail(ss.str());
+            }
+        }
+    if(std::abs(sum-1)>1e-9)
+        fail(what+": the probabilities do not sum to 1");
+}
+
+/// Samples concurrently from nrThreads threads, each with its own seed,
+/// and compares the sequences to sampling the same seeds serially, and
+/// the distribution to that of the rand() sampler and of the 2DBN.
+void testConcurrentSampling(const ProblemFireFightingFactored &problem,
+                            const vector<Index> &X, const vector<Index> &A)
+{
+    const TwoStageDynamicBayesianNetwork &bn=*problem.Get2DBN();
+    vector<size_t> nrY, nrO;
+    for(Index y=0;y!=problem.GetNrStateFactors();++y)
+        nrY.push_back(problem.GetNrValuesForFactor(y));
+    for(Index agI=0;agI!=problem.GetNrAgents();++agI)
+        nrO.push_back(problem.GetNrObservations(agI));
+
+    vector<vector<Index> > parallel(nrThreads);
+#pragma omp parallel for num_threads(nrThreads) schedule(static,1)
+    for(int k=0;k<static_cast<int>(nrThreads);++k)
+        parallel[k]=SampleSequence(bn, X, A, nrY, nrO, k+1);
+
+    vector<vector<Index> > serial(nrThreads);
+    for(Index k=0;k!=nrThreads;++k)
+    {
+        serial[k]=SampleSequence(bn, X, A, nrY, nrO, k+1);
+        if(serial[k]!=parallel[k])
+        {
+            stringstream ss;
+            ss << "seed " << k+1 << " gives a different sequence when "
+               << "sampling concurrently";
+            fail(ss.str());
+        }
+    }
+    if(parallel[0]==parallel[1])
+        fail("different seeds give the same sequence");
+
+    // the vector-returning overloads sample using rand()
+    srand(42);
+    vector<vector<Index> > unseeded(1);
+    for(Index i=0;i!=nrThreads*nrSamples;++i)
+    {
+        vector<Index> Y=bn.SampleY(X, A), O=bn.SampleO(X, A, Y);
+        unseeded[0].push_back(JointIndex(Y, nrY));
+        unseeded[0].push_back(JointIndex(O, nrO));
+    }
+
+    checkDistribution(bn, X, A, nrY, nrO, parallel, 0.02,
+                      "concurrent sampling");
+    checkDistribution(bn, X, A, nrY, nrO, unseeded, 0.02, "serial sampling");
+}
+
+int main()
+{
+    try
+    {
+        // 2 agents, 3 houses and 3 fire levels
+        ProblemFireFightingFactored problem(2, 3, 3);
+        Index x[] = {2, 0, 1}, a[] = {0, 1};
+        testConcurrentSampling(problem, vector<Index>(x, x+3),
+                               vector<Index>(a, a+2));
+        cout << "FactoredSampling: " << nrThreads << " seeds sampled "
+             << "concurrently give the serial sequences and distribution"
+             << endl;
+        Index x2[] = {1, 1, 2}, a2[] = {1, 1};
+        testConcurrentSampling(problem, vector<Index>(x2, x2+3),
+                               vector<Index>(a2, a2+2));
+        cout << "FactoredSampling: also with both agents at the same house"
+             << endl;
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "FactoredSampling tests passed" << endl;
+    return(0);
+}
@@ -0,0 +1,367 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <float.h>
+#include "Globals.h"
+#include "ProblemDecTiger.h"
+#include "ProblemFireFighting.h"
+#include "ProblemFOBSFireFightingGraph.h"
+#include "NullPlanner.h"
+#include "MDPValueIteration.h"
+#include "MDPPolicyIteration.h"
+#include "FactoredMMDPDecoupledValueIteration.h"
+#include "OnlineMDPPlannerMCTS.h"
+#include "ParallelQLearner.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Computes Q of an infinite-horizon problem by Jacobi value iteration,
+/// recomputing max_a Q(s',a) for every (s,a,s') triple like the original
+/// MDPValueIteration did.
+QTable ReferenceValueIteration(const PlanningUnitDecPOMDPDiscrete &pu,
+                               double tolerance)
+{
+    size_t nrS=pu.GetNrStates(), nrJA=pu.GetNrJointActions();
+    double gamma=pu.GetDiscount();
+    QTable Q(nrS,nrJA), Q1(nrS,nrJA);
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            Q(sI,jaI)=0;
+
+    double residual=DBL_MAX;
+    while(residual > tolerance)
+    {
+        residual=0;
+        for(Index sI=0;sI!=nrS;++sI)
+            for(Index jaI=0;jaI!=nrJA;++jaI)
+            {
+                double future=0;
+                for(Index s1=0;s1!=nrS;++s1)
+                {
+                    double maxQ=-DBL_MAX;
+                    for(Index a1=0;a1!=nrJA;++a1)
+                        maxQ=max(maxQ,Q(s1,a1));
+                    future+=pu.GetTransitionProbability(sI,jaI,s1)*maxQ;
+                }
+                Q1(sI,jaI)=pu.GetReward(sI,jaI)+gamma*future;
+                residual=max(residual,std::abs(Q1(sI,jaI)-Q(sI,jaI)));
+            }
+        Q=Q1;
+    }
+    return(Q);
+}
+
+/// Checks that the Q-values of solver are within maxError of Q.
+void CheckQ(const string &name, const PlanningUnitDecPOMDPDiscrete &pu,
+            const MDPSolver &solver, const QTable &Q, double maxError)
+{
+    for(Index sI=0;sI!=pu.GetNrStates();++sI)
+        for(Index jaI=0;jaI!=pu.GetNrJointActions();++jaI)
+            if(std::abs(solver.GetQ(sI,jaI)-Q(sI,jaI)) > maxError)
+            {
+                stringstream ss;
+                ss << name << " " << pu.GetProblem()->GetUnixName()
+                   << ": Q(" << sI << "," << jaI << ")="
+                   << solver.GetQ(sI,jaI) << ", expected " << Q(sI,jaI);
+                fail(ss.str());
+            }
+    cout << name << " " << pu.GetProblem()->GetUnixName()
+         << ": Q-values agree with the reference" << endl;
+}
+
+/// Checks that each update type of MDPValueIteration converges to the
+/// Q-values of the reference implementation.
+void testValueIteration(const PlanningUnitDecPOMDPDiscrete &pu,
+                        const QTable &Q)
+{
+    const char *names[] = {"VI_JACOBI", "VI_GAUSS_SEIDEL",
+                           "VI_PRIORITIZED_SWEEPING"};
+    MDPValueIterationUpdateType types[] = {VI_JACOBI, VI_GAUSS_SEIDEL,
+                                           VI_PRIORITIZED_SWEEPING};
+    for(Index k=0;k!=3;++k)
+    {
+        MDPValueIteration vi(pu);
+        vi.SetUpdateType(types[k]);
+        vi.SetTolerance(1e-9);
+        vi.Plan();
+        CheckQ(names[k], pu, vi, Q, 1e-6);
+    }
+}
+
+/// Checks that modified policy iteration and policy iteration with
+/// BiCGSTAB evaluation converge to the Q-values of the reference
+/// implementation, with one and with several threads.
+void testPolicyIteration(const PlanningUnitDecPOMDPDiscrete &pu,
+                         const QTable &Q)
+{
+    const char *names[] = {"PI_MODIFIED", "PI_BICGSTAB"};
+    MDPPolicyIterationEvaluationType types[] = {PI_MODIFIED, PI_BICGSTAB};
+    for(Index k=0;k!=2;++k)
+        for(size_t nrThreads=1;nrThreads<=4;nrThreads+=3)
+        {
+            MDPPolicyIteration pi(pu);
+            pi.SetEvaluationType(types[k]);
+            pi.SetTolerance(1e-9);
+            pi.SetNrThreads(nrThreads);
+            pi.Plan();
+            stringstream ss;
+            ss << names[k] << " (" << nrThreads << " threads)";
+            CheckQ(ss.str(), pu, pi, Q, 1e-6);
+        }
+}
+
+/// Checks FactoredMMDPDecoupledValueIteration against flat value
+/// iteration. With a single local Q-function that spans all state factors
+/// and agents it has to be exact. With the reward scopes it is an
+/// approximation: its Q-values have to be within 20% of the largest
+/// absolute Q-value of the reference, closer to it than those of the
+/// local MDPs solved on their own (no joint backups), and the factor
+/// graph has to find actions that maximize the summed local Q-functions.
+void testDecoupledValueIteration(const FactoredMMDPDiscrete &fmmdp,
+                                 const PlanningUnitDecPOMDPDiscrete &pu,
+                                 const QTable &Q)
+{
+    size_t nrS=pu.GetNrStates(), nrJA=pu.GetNrJointActions();
+    Scope allSFs, allAgents;
+    for(Index i=0;i!=fmmdp.GetNrStateFactors();++i)
+        allSFs.Insert(i);
+    for(Index i=0;i!=fmmdp.GetNrAgents();++i)
+        allAgents.Insert(i);
+    FactoredQFunctionScopeForStage fullScope;
+    fullScope.AddLocalQ(allSFs,allAgents);
+
+    FactoredMMDPDecoupledValueIteration full(&fmmdp,fullScope);
+    full.SetTolerance(1e-9);
+    full.Plan();
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            if(std::abs(full.GetQ(sI,jaI)-Q(sI,jaI)) > 1e-6)
+            {
+                stringstream ss;
+                ss << "FactoredMMDPDecoupledValueIteration with full scope: Q("
+                   << sI << "," << jaI << ")=" << full.GetQ(sI,jaI)
+                   << ", expected " << Q(sI,jaI);
+                fail(ss.str());
+            }
+    cout << "FactoredMMDPDecoupledValueIteration with full scope "
+         << fmmdp.GetUnixName() << ": Q-values agree with the reference"
+         << endl;
+
+    FactoredMMDPDecoupledValueIteration decoupled(&fmmdp);
+    decoupled.SetFGSolverType(FG_Solver::FGSt_NDP);
+    decoupled.SetTolerance(1e-9);
+    decoupled.Plan();
+    double maxError=0;
+    for(Index sI=0;sI!=nrS;++sI)
+    {
+        double maxQ=-DBL_MAX;
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+        {
+            maxQ=max(maxQ,decoupled.GetQ(sI,jaI));
+            maxError=max(maxError,std::abs(decoupled.GetQ(sI,jaI)-Q(sI,jaI)));
+        }
+        Index jaI=decoupled.GetMaximizingAction(sI);
+        if(decoupled.GetQ(sI,jaI) < maxQ-1e-4)
+        {
+            stringstream ss;
+            ss << "FactoredMMDPDecoupledValueIteration: joint action " << jaI
+               << " has Q(" << sI << ",.)=" << decoupled.GetQ(sI,jaI)
+               << " but the maximum is " << maxQ;
+            fail(ss.str());
+        }
+    }
+
+    FactoredMMDPDecoupledValueIteration local(&fmmdp);
+    local.SetTolerance(1e-9);
+    local.SetMaxNrIterations(0);
+    local.Plan();
+    double maxQ=0, maxErrorLocal=0;
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+        {
+            maxQ=max(maxQ,std::abs(Q(sI,jaI)));
+            maxErrorLocal=max(maxErrorLocal,
+                              std::abs(local.GetQ(sI,jaI)-Q(sI,jaI)));
+        }
+    if(maxError > 0.2*maxQ || maxError >= maxErrorLocal)
+    {
+        stringstream ss;
+        ss << "FactoredMMDPDecoupledValueIteration with reward scopes "
+           << fmmdp.GetUnixName() << ": max. difference with the reference "
+           << maxError << ", without joint backups " << maxErrorLocal
+           << ", largest Q-value " << maxQ;
+        fail(ss.str());
+    }
+    cout << "FactoredMMDPDecoupledValueIteration with reward scopes "
+         << fmmdp.GetUnixName() << ": Q-values within 20% of the reference"
+         << endl;
+}
+
+/// Checks that UCT chooses an optimal first action in each state, with
+/// one and with several trees, and that the subtree below the chosen
+/// action and observed state keeps its visits for the next decision.
+void testMCTS(const PlanningUnitDecPOMDPDiscrete &pu, const QTable &Q)
+{
+    size_t nrS=pu.GetNrStates(), nrJA=pu.GetNrJointActions();
+    size_t nrIterations=4000;
+    for(size_t nrThreads=1;nrThreads<=2;++nrThreads)
+        for(Index sI=0;sI!=nrS;++sI)
+        {
+            OnlineMDPPlannerMCTS mcts(&pu, nrThreads);
+            mcts.SetIterationBudget(nrIterations);
+            Index jaI=mcts.SearchForAction(sI, 0);
+            double maxQ=-DBL_MAX;
+            for(Index ja=0;ja!=nrJA;++ja)
+                maxQ=max(maxQ,Q(sI,ja));
+            if(Q(sI,jaI) < maxQ-1e-6)
+            {
+                stringstream ss;
+                ss << "OnlineMDPPlannerMCTS (" << nrThreads << " threads) "
+                   << "chose joint action " << jaI << " in state " << sI
+                   << " with Q=" << Q(sI,jaI) << ", the maximum is " << maxQ;
+                fail(ss.str());
+            }
+            if(mcts.GetNrVisits()!=nrIterations)
+                fail("OnlineMDPPlannerMCTS: the root was not visited once "
+                     "per iteration");
+
+            // continue from the most visited successor of the chosen
+            // action, whose subtree is reused
+            Index sucSI=0;
+            for(Index s=1;s!=nrS;++s)
+                if(mcts.GetNrVisits(jaI, s) > mcts.GetNrVisits(jaI, sucSI))
+                    sucSI=s;
+            size_t nrVisits=mcts.GetNrVisits(jaI, sucSI);
+            if(nrVisits==0)
+                fail("OnlineMDPPlannerMCTS: the chosen action has no children");
+            mcts.SearchForAction(sucSI, 0);
+            if(mcts.GetNrVisits()!=nrVisits+nrIterations)
+            {
+                stringstream ss;
+                ss << "OnlineMDPPlannerMCTS (" << nrThreads << " threads): "
+                   << "the reused root has " << mcts.GetNrVisits()
+                   << " visits, expected " << nrVisits << " + "
+                   << nrIterations;
+                fail(ss.str());
+            }
+
+            mcts.Reset();
+            mcts.SearchForAction(sucSI, 0);
+            if(mcts.GetNrVisits()!=nrIterations)
+                fail("OnlineMDPPlannerMCTS: Reset() kept the tree");
+        }
+    cout << "OnlineMDPPlannerMCTS " << pu.GetProblem()->GetUnixName()
+         << ": optimal first actions, subtrees are reused" << endl;
+}
+
+/// Checks that ParallelQLearner, with one and with several actors,
+/// learns Q-values within 10% of the largest Q-value of the reference,
+/// and a greedy policy whose actions are within 5% of optimal.
+void testParallelQLearner(const PlanningUnitDecPOMDPDiscrete &pu,
+                          const QTable &Q)
+{
+    size_t nrS=pu.GetNrStates(), nrJA=pu.GetNrJointActions();
+    double maxQ=0;
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            maxQ=max(maxQ,std::abs(Q(sI,jaI)));
+
+    for(size_t nrActors=1;nrActors<=4;nrActors+=3)
+    {
+        ParallelQLearner learner(&pu, 0, 0.3, 0.05, pu.GetDiscount());
+        learner.Learn(100000, 50, nrActors, 42);
+        QTable learned=learner.GetQTable();
+        double maxError=0;
+        for(Index sI=0;sI!=nrS;++sI)
+        {
+            Index best=0;
+            for(Index jaI=0;jaI!=nrJA;++jaI)
+            {
+                maxError=max(maxError,std::abs(learned(sI,jaI)-Q(sI,jaI)));
+                if(learned(sI,jaI) > learned(sI,best))
+                    best=jaI;
+            }
+            double V=Q(sI,0);
+            for(Index jaI=1;jaI!=nrJA;++jaI)
+                V=max(V,Q(sI,jaI));
+            if(Q(sI,best) < V-0.05*maxQ)
+            {
+                stringstream ss;
+                ss << "ParallelQLearner (" << nrActors << " actors) "
+                   << "learned greedy joint action " << best << " in state "
+                   << sI << " with Q=" << Q(sI,best) << ", the maximum is "
+                   << V;
+                fail(ss.str());
+            }
+        }
+        if(maxError > 0.1*maxQ)
+        {
+            stringstream ss;
+            ss << "ParallelQLearner (" << nrActors << " actors): max. "
+               << "difference with the reference " << maxError
+               << ", largest Q-value " << maxQ;
+            fail(ss.str());
+        }
+    }
+    cout << "ParallelQLearner " << pu.GetProblem()->GetUnixName()
+         << ": Q-values within 10% of the reference, near-optimal greedy "
+         << "policy"
+         << endl;
+}
+
+int main()
+{
+    try
+    {
+        ProblemDecTiger dectiger;
+        dectiger.SetDiscount(0.9);
+        ProblemFireFighting fireFighting(2,3,3);
+        fireFighting.SetDiscount(0.95);
+        DecPOMDPDiscreteInterface *problems[] = {&dectiger, &fireFighting};
+
+        for(Index p=0;p!=2;++p)
+        {
+            NullPlanner np(MAXHORIZON, problems[p]);
+            QTable Q=ReferenceValueIteration(np, 1e-10);
+            testValueIteration(np, Q);
+            testPolicyIteration(np, Q);
+            if(p==0)
+                testMCTS(np, Q);
+            testParallelQLearner(np, Q);
+        }
+
+        for(size_t nrAgents=2;nrAgents<=3;++nrAgents)
+        {
+            ProblemFOBSFireFightingGraph fireFightingGraph(nrAgents,
+                                                           nrAgents+1);
+            fireFightingGraph.SetDiscount(0.9);
+            NullPlanner np(MAXHORIZON, &fireFightingGraph);
+            testDecoupledValueIteration(fireFightingGraph, np,
+                                        ReferenceValueIteration(np, 1e-10));
+        }
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "MDPSolvers tests passed" << endl;
+    return(0);
+}
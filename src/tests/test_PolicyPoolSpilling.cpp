@@ -0,0 +1,184 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Globals.h"
+#include "E.h"
+#include "ProblemDecTiger.h"
+#include "NullPlanner.h"
+#include "PartialJointPolicyPureVector.h"
+#include "PartialJPDPValuePair.h"
+#include "PolicyPoolPartialJPolValPair.h"
+#include "PolicyPoolPartialJPolValPairSpilling.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Returns an item with a random policy of the given depth.
+PartialJPDPValuePair_sharedPtr RandomItem(const NullPlanner &np, size_t depth,
+                                          double value)
+{
+    PJPDP_sharedPtr jpol(new PartialJointPolicyPureVector(
+                             &np, OHIST_INDEX, rand()/(double)RAND_MAX));
+    jpol->SetDepth(depth);
+    for(Index agI=0;agI!=np.GetNrAgents();++agI)
+        for(Index ohI=0;ohI!=np.GetNrPolicyDomainElements(agI, OHIST_INDEX,
+                                                           depth);++ohI)
+            jpol->SetAction(agI, ohI, rand()%np.GetNrActions(agI));
+    return(PartialJPDPValuePair_sharedPtr(new PartialJPDPValuePair(jpol,
+                                                                   value)));
+}
+
+/// Checks that the items selected from both pools have the same value,
+/// past reward and policy.
+void checkSameSelect(const NullPlanner &np, const PartialPolicyPoolInterface &pool,
+                     const PartialPolicyPoolInterface &reference,
+                     const string &what)
+{
+    PartialJPDPValuePair_sharedPtr a=
+        boost::dynamic_pointer_cast<PartialJPDPValuePair>(pool.Select());
+    PartialJPDPValuePair_sharedPtr b=
+        boost::dynamic_pointer_cast<PartialJPDPValuePair>(reference.Select());
+    const PartialJointPolicyDiscretePure &ja=*a->GetJPol(), &jb=*b->GetJPol();
+    bool same=a->GetValue()==b->GetValue() &&
+        ja.GetPastReward()==jb.GetPastReward() &&
+        ja.GetDepth()==jb.GetDepth();
+    for(Index agI=0;same && agI!=np.GetNrAgents();++agI)
+        for(Index ohI=0;same && ohI!=np.GetNrPolicyDomainElements(
+                agI, OHIST_INDEX, jb.GetDepth());++ohI)
+            same=ja.GetActionIndex(agI, ohI)==jb.GetActionIndex(agI, ohI);
+    if(!same)
+    {
+        stringstream ss;
+        ss << what << ": selected item with value " << a->GetValue()
+           << " differs from the in-memory pool (value " << b->GetValue()
+           << ")";
+        fail(ss.str());
+    }
+}
+
+/// Returns the memory used for an item of the given depth.
+size_t ItemSize(const NullPlanner &np, size_t depth)
+{
+    PolicyPoolPartialJPolValPairSpilling pool;
+    pool.Insert(RandomItem(np, depth, 0));
+    return(pool.GetMemoryUsed());
+}
+
+/// Inserts, prunes and pops random items in a pool with a small budget
+/// and in the in-memory pool, and compares the items they select.
+void testSameOrder(const NullPlanner &np)
+{
+    srand(42);
+    PolicyPoolPartialJPolValPairSpilling pool(20*ItemSize(np, 3));
+    PolicyPoolPartialJPolValPair reference;
+    pool.Init(&np);
+    reference.Init(&np);
+    pool.Pop();
+    reference.Pop();
+
+    size_t maxNrSpilled=0, nrSelected=0;
+    for(Index i=0;i!=400;++i)
+    {
+        PartialJPDPValuePair_sharedPtr item=
+            RandomItem(np, 1+rand()%3, rand()/(double)RAND_MAX);
+        pool.Insert(item);
+        reference.Insert(item);
+        maxNrSpilled=max(maxNrSpilled, pool.GetNrSpilledItems());
+        if(i%7==0)
+        {
+            checkSameSelect(np, pool, reference, "during insertion");
+            pool.Pop();
+            reference.Pop();
+            nrSelected++;
+        }
+        if(i==200)
+        {
+            pool.Prune(0.2);
+            reference.Prune(0.2);
+        }
+        if(pool.Size()!=reference.Size())
+            fail("the pools have a different size");
+    }
+    if(maxNrSpilled==0)
+        fail("no items were spilled");
+    while(!reference.Empty())
+    {
+        checkSameSelect(np, pool, reference, "after insertion");
+        pool.Pop();
+        reference.Pop();
+        nrSelected++;
+    }
+    if(!pool.Empty() || pool.GetSpillFileSize()!=0)
+        fail("the pool is not empty after popping all items");
+    cout << "spilling pool: same " << nrSelected << " items as the "
+         << "in-memory pool, up to " << maxNrSpilled << " on disk" << endl;
+}
+
+/// Pruning the lowest spilled items leaves a single free extent, in
+/// which larger items fit.
+void testMergeFreeExtents(const NullPlanner &np)
+{
+    srand(7);
+    PolicyPoolPartialJPolValPairSpilling pool(20*ItemSize(np, 3));
+    // as the values increase, the items are spilled in the order of
+    // their value
+    for(Index i=1;i<=200;++i)
+        pool.Insert(RandomItem(np, 2, i));
+    size_t nrSpilled=pool.GetNrSpilledItems();
+    size_t fileSize=pool.GetSpillFileSize();
+    if(nrSpilled<20)
+        fail("too few items were spilled");
+    pool.Prune(nrSpilled/2);
+    if(pool.GetSpillFileSize()!=fileSize)
+        fail("pruning the first items changed the end of the spill file");
+
+    // items of depth 3 use more bytes than those of depth 2, they are
+    // spilled as soon as the pool exceeds its budget
+    size_t nrLeft=pool.GetNrSpilledItems();
+    for(Index i=1;pool.GetNrSpilledItems()==nrLeft;++i)
+        pool.Insert(RandomItem(np, 3, -static_cast<double>(i)));
+    if(pool.GetSpillFileSize()!=fileSize)
+    {
+        stringstream ss;
+        ss << "the spill file grew from " << fileSize << " to "
+           << pool.GetSpillFileSize() << " bytes, although "
+           << nrSpilled/2 << " adjacent items were pruned";
+        fail(ss.str());
+    }
+    cout << "spilling pool: freed extents are merged and reused" << endl;
+}
+
+int main()
+{
+    try
+    {
+        ProblemDecTiger dectiger;
+        NullPlanner np(4, &dectiger);
+        testSameOrder(np);
+        testMergeFreeExtents(np);
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "PolicyPoolSpilling tests passed" << endl;
+    return(0);
+}
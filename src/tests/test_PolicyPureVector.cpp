@@ -0,0 +1,250 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Globals.h"
+#include "E.h"
+#include "PolicyPureVector.h"
+#include "Interface_ProblemToPolicyDiscretePure.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// A single-agent problem with nrA actions and nrO observations, whose
+/// observation histories of length t are indexed after those of length
+/// t-1, as in PlanningUnitMADPDiscrete.
+class TestProblem : public Interface_ProblemToPolicyDiscretePure
+{
+private:
+    size_t _m_nrA, _m_nrO, _m_horizon;
+public:
+    TestProblem(size_t nrA, size_t nrO, size_t horizon) :
+        _m_nrA(nrA), _m_nrO(nrO), _m_horizon(horizon)
+    {}
+
+    bool AreCachedJointToIndivIndices(
+        const PolicyGlobals::PolicyDomainCategory pdc) const
+    { return(false); }
+    size_t GetNrAgents() const { return(1); }
+    size_t GetNrActions(Index agentI) const { return(_m_nrA); }
+    size_t GetNrPolicyDomainElements(Index agentI,
+                                     PolicyGlobals::PolicyDomainCategory cat,
+                                     size_t depth=MAXHORIZON) const
+    {
+        size_t d=min(depth, _m_horizon), nr=0, nrOH=1;
+        for(size_t t=0;t!=d;++t, nrOH*=_m_nrO)
+            nr+=nrOH;
+        return(nr);
+    }
+    Index IndividualToJointActionIndices(const Index* indivIndices) const
+    { return(indivIndices[0]); }
+    Index IndividualToJointActionIndices(
+        const vector<Index>& indivIndices) const
+    { return(indivIndices[0]); }
+    PolicyGlobals::PolicyDomainCategory GetDefaultIndexDomCat() const
+    { return(PolicyGlobals::OHIST_INDEX); }
+    vector<Index> JointToIndividualPolicyDomainIndices(Index jdI,
+        PolicyGlobals::PolicyDomainCategory cat) const
+    { return(vector<Index>(1, jdI)); }
+    const vector<Index>& JointToIndividualPolicyDomainIndicesRef(
+        Index jdI, PolicyGlobals::PolicyDomainCategory cat) const
+    { throw(E("TestProblem: no cached indices")); }
+    string SoftPrintPolicyDomainElement(Index agentI, Index dIndex,
+        PolicyGlobals::PolicyDomainCategory cat) const
+    { stringstream ss; ss << "oh" << dIndex; return(ss.str()); }
+    string SoftPrintAction(Index agentI, Index actionI) const
+    { stringstream ss; ss << "a" << actionI; return(ss.str()); }
+};
+
+/// A deterministic action for domain index i, which is nrA-1 for every
+/// third index so that all bits of an entry are used.
+Index TestAction(Index i, size_t nrA)
+{
+    if(i%3==0)
+        return(nrA-1);
+    return((i*2654435761u+1)%nrA);
+}
+
+/// Returns the number of observation histories of a policy of depth d.
+size_t NrOH(const TestProblem &problem, size_t d)
+{
+    return(problem.GetNrPolicyDomainElements(0, PolicyGlobals::OHIST_INDEX,
+                                             d));
+}
+
+void checkActions(const PolicyPureVector &pol, size_t nrOH, size_t nrA,
+                  Index offset, const string &what)
+{
+    for(Index i=0;i!=nrOH;++i)
+        if(pol.GetActionIndex(i)!=TestAction(i+offset, nrA))
+        {
+            stringstream ss;
+            ss << what << ": domain index " << i << " has action "
+               << pol.GetActionIndex(i) << ", expected "
+               << TestAction(i+offset, nrA);
+            fail(ss.str());
+        }
+}
+
+/// Stores and reads back actions for numbers of actions that need 1, 2,
+/// 4, 8, 16 and 32 bits, over several words and stages.
+void testBitWidths()
+{
+    size_t nrAs[] = {2, 3, 4, 5, 16, 17, 255, 256, 257, 65536, 65537,
+                     4294967295u};
+    for(Index k=0;k!=sizeof(nrAs)/sizeof(size_t);++k)
+    {
+        size_t nrA=nrAs[k];
+        TestProblem problem(nrA, 3, 5); // 121 observation histories
+        PolicyPureVector pol(&problem, 0, PolicyGlobals::OHIST_INDEX, 5);
+        size_t nrOH=NrOH(problem, 5);
+        for(Index i=0;i!=nrOH;++i)
+            pol.SetAction(i, TestAction(i, nrA));
+        stringstream what;
+        what << nrA << " actions";
+        checkActions(pol, nrOH, nrA, 0, what.str());
+
+        bool thrown=false;
+        try { pol.SetAction(0, nrA); }
+        catch(E& e) { thrown=true; }
+        if(!thrown)
+            fail(what.str()+": SetAction() accepted action index nrA");
+    }
+    cout << "PolicyPureVector: actions read back for 1 to 32 bits" << endl;
+}
+
+/// Changing a copy does not change the original, and vice versa.
+void testCopyOnWrite()
+{
+    size_t nrA=5;
+    TestProblem problem(nrA, 2, 4);
+    PolicyPureVector pol(&problem, 0, PolicyGlobals::OHIST_INDEX, 4);
+    size_t nrOH=NrOH(problem, 4);
+    for(Index i=0;i!=nrOH;++i)
+        pol.SetAction(i, TestAction(i, nrA));
+
+    PolicyPureVector copy(pol);
+    PolicyPureVector assigned(&problem, 0, PolicyGlobals::OHIST_INDEX, 4);
+    assigned=pol;
+    for(Index i=0;i!=nrOH;++i)
+        copy.SetAction(i, TestAction(i+1, nrA));
+    checkActions(pol, nrOH, nrA, 0, "original after changing the copy");
+    checkActions(copy, nrOH, nrA, 1, "changed copy");
+    checkActions(assigned, nrOH, nrA, 0,
+                 "assigned policy after changing a copy");
+
+    // change a single entry of the last stage of the original
+    Index last=nrOH-1;
+    pol.SetAction(last, (pol.GetActionIndex(last)+1)%nrA);
+    if(assigned.GetActionIndex(last)!=TestAction(last, nrA))
+        fail("assigned policy changed with the original");
+    pol.SetAction(last, TestAction(last, nrA));
+    checkActions(pol, nrOH, nrA, 0, "original after restoring an entry");
+    cout << "PolicyPureVector: copies are independent" << endl;
+}
+
+/// Growing the depth keeps the actions of the earlier stages, sets the
+/// new ones to 0 and does not change a copy with the old depth.
+void testSetDepth()
+{
+    size_t nrA=3;
+    TestProblem problem(nrA, 3, 6);
+    PolicyPureVector pol(&problem, 0, PolicyGlobals::OHIST_INDEX, 1);
+    pol.SetDepth(1);
+    for(size_t d=1;d!=6;++d)
+    {
+        Index nrOld=NrOH(problem, d);
+        for(Index i=0;i!=nrOld;++i)
+            pol.SetAction(i, TestAction(i, nrA));
+        PolicyPureVector old(pol);
+
+        pol.SetDepth(d+1);
+        Index nrNew=NrOH(problem, d+1);
+        for(Index i=0;i!=nrNew;++i)
+        {
+            Index expected=(i<nrOld) ? TestAction(i, nrA) : 0;
+            if(pol.GetActionIndex(i)!=expected)
+            {
+                stringstream ss;
+                ss << "after SetDepth(" << d+1 << ") domain index " << i
+                   << " has action " << pol.GetActionIndex(i)
+                   << ", expected " << expected;
+                fail(ss.str());
+            }
+        }
+        for(Index i=nrOld;i!=nrNew;++i)
+            pol.SetAction(i, nrA-1);
+        checkActions(old, nrOld, nrA, 0,
+                     "copy after SetDepth() of the original");
+        bool thrown=false;
+        try { old.SetAction(nrOld, 0); }
+        catch(E& e) { thrown=true; }
+        if(!thrown)
+            fail("SetDepth() changed the size of a copy");
+    }
+    cout << "PolicyPureVector: SetDepth() keeps the earlier stages" << endl;
+}
+
+/// Increment() enumerates the policies in the order of their index.
+void testIncrement()
+{
+    size_t nrA=3;
+    TestProblem problem(nrA, 2, 3);
+    PolicyPureVector pol(&problem, 0, PolicyGlobals::OHIST_INDEX, 3);
+    pol.SetDepth(3);
+    LIndex nrPols=problem.GetNrPolicies(0, PolicyGlobals::OHIST_INDEX, 3);
+    for(LIndex k=1;k<=nrPols;++k)
+    {
+        bool carry=pol.Increment();
+        LIndex expected=k%nrPols;
+        if(carry!=(expected==0) || pol.GetIndex()!=expected)
+        {
+            stringstream ss;
+            ss << "after " << k << " increments the policy has index "
+               << pol.GetIndex() << ", expected " << expected;
+            fail(ss.str());
+        }
+        PolicyPureVector fromIndex(&problem, 0, PolicyGlobals::OHIST_INDEX, 3);
+        fromIndex.SetDepth(3);
+        fromIndex.SetIndex(expected);
+        for(Index i=0;i!=NrOH(problem, 3);++i)
+            if(fromIndex.GetActionIndex(i)!=pol.GetActionIndex(i))
+                fail("Increment() differs from SetIndex()");
+    }
+    cout << "PolicyPureVector: Increment() enumerates all " << nrPols
+         << " policies" << endl;
+}
+
+int main()
+{
+    try
+    {
+        testBitWidths();
+        testCopyOnWrite();
+        testSetDepth();
+        testIncrement();
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "PolicyPureVector tests passed" << endl;
+    return(0);
+}
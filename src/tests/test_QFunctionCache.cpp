@@ -0,0 +1,126 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "Globals.h"
+#include "E.h"
+#include "DecPOMDPDiscrete.h"
+#include "MADPParser.h"
+#include "NullPlanner.h"
+#include "QFunctionCache.h"
+#include "QTable.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Returns the path of a problem in the problems directory of the source tree.
+string GetProblemFilename(const string &unixName)
+{
+    // 'make check' sets srcdir, also when building outside the source tree
+    const char *srcdir=getenv("srcdir");
+    return(string(srcdir ? srcdir : ".") + "/../../problems/" +
+           unixName + ".dpomdp");
+}
+
+/// The fingerprint does not depend on whether the model is stored
+/// sparsely, and changes with a single probability.
+void testFingerprint()
+{
+    DecPOMDPDiscrete dense("","",GetProblemFilename("broadcastChannel"));
+    MADPParser denseParser(&dense);
+    DecPOMDPDiscrete sparse("","",GetProblemFilename("broadcastChannel"));
+    sparse.SetSparse(true);
+    MADPParser sparseParser(&sparse);
+
+    NullPlanner npDense(3, &dense), npSparse(3, &sparse);
+    unsigned long long fp=QFunctionCache::ComputeFingerprint(&npDense);
+    if(QFunctionCache::ComputeFingerprint(&npSparse)!=fp)
+        fail("the sparse and dense model have a different fingerprint");
+
+    // move some probability mass between two successor states
+    double p0=sparse.GetTransitionProbability(0, 0, 0),
+        p1=sparse.GetTransitionProbability(0, 0, 1);
+    sparse.SetTransitionProbability(0, 0, 0, p0/2);
+    sparse.SetTransitionProbability(0, 0, 1, p1+p0/2);
+    if(QFunctionCache::ComputeFingerprint(&npSparse)==fp)
+        fail("changing a transition probability keeps the fingerprint");
+    sparse.SetTransitionProbability(0, 0, 0, p0);
+    sparse.SetTransitionProbability(0, 0, 1, p1);
+
+    Index joI=0;
+    double o0=sparse.GetObservationProbability(0, 0, joI);
+    sparse.SetObservationProbability(0, 0, joI, o0>0.5 ? o0/2 : o0+0.25);
+    if(QFunctionCache::ComputeFingerprint(&npSparse)==fp)
+        fail("changing an observation probability keeps the fingerprint");
+    cout << "QFunctionCache: the fingerprint identifies the model, not its "
+         << "storage" << endl;
+}
+
+/// A saved table is loaded for the same model, and not for another one.
+void testSaveLoad()
+{
+    DecPOMDPDiscrete broadcast("","",GetProblemFilename("broadcastChannel"));
+    MADPParser parser(&broadcast);
+    NullPlanner np(3, &broadcast);
+    size_t nrS=np.GetNrStates(), nrJA=np.GetNrJointActions();
+    QTable Q(nrS, nrJA);
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            Q(sI,jaI)=rand()/(double)RAND_MAX;
+
+    string filename="tst_QFunctionCache.tmp";
+    QFunctionCache cache(&np, "test");
+    cache.Save(Q, filename);
+    QTable loaded;
+    if(!cache.Load(filename, nrS, nrJA, loaded))
+        fail("the saved table is not loaded");
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+            if(loaded(sI,jaI)!=Q(sI,jaI))
+                fail("the loaded table differs from the saved one");
+
+    QFunctionCache other(&np, "other heuristic");
+    if(other.Load(filename, nrS, nrJA, loaded))
+        fail("a table of another heuristic is loaded");
+    broadcast.SetTransitionProbability(0, 0, 0,
+        1-broadcast.GetTransitionProbability(0, 0, 0));
+    QFunctionCache changed(&np, "test");
+    if(changed.Load(filename, nrS, nrJA, loaded))
+        fail("a table of another model is loaded");
+    remove(filename.c_str());
+    cout << "QFunctionCache: saved tables are loaded for the same model only"
+         << endl;
+}
+
+int main()
+{
+    try
+    {
+        testFingerprint();
+        testSaveLoad();
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "QFunctionCache tests passed" << endl;
+    return(0);
+}
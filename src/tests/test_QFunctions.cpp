@@ -0,0 +1,94 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include "Globals.h"
+#include "DecPOMDPDiscrete.h"
+#include "MADPParser.h"
+#include "NullPlanner.h"
+#include "QPOMDP.h"
+#include "QBG.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+/// Returns the path of a problem in the problems directory of the source tree.
+string GetProblemFilename(const string &unixName)
+{
+    // 'make check' sets srcdir, also when building outside the source tree
+    const char *srcdir=getenv("srcdir");
+    return(string(srcdir ? srcdir : ".") + "/../../problems/" +
+           unixName + ".dpomdp");
+}
+
+/// Checks that the Qvalues computed stage by stage (with beliefs shared
+/// between histories) equal the recursively computed ones.
+template <class Q>
+void testStagewise(const string &name, DecPOMDPDiscrete *decpomdp, size_t h)
+{
+    PlanningUnitMADPDiscreteParameters params;
+    params.SetComputeAll(true);
+    NullPlanner np(h, decpomdp, &params);
+
+    Q recursive(&np), stagewise(&np);
+    recursive.SetComputeStagewise(false);
+    recursive.Compute();
+    stagewise.SetComputeStagewise(true);
+    stagewise.Compute();
+
+    for(Index jaohI=0;jaohI!=np.GetNrJointActionObservationHistories();
+        ++jaohI)
+        for(Index jaI=0;jaI!=np.GetNrJointActions();++jaI)
+            if(std::abs(recursive.GetQ(jaohI,jaI)-
+                        stagewise.GetQ(jaohI,jaI)) > 1e-9)
+            {
+                stringstream ss;
+                ss << name << " " << decpomdp->GetUnixName() << " h=" << h
+                   << ": Q(" << jaohI << "," << jaI << ")="
+                   << stagewise.GetQ(jaohI,jaI) << " stagewise, "
+                   << recursive.GetQ(jaohI,jaI) << " recursively";
+                fail(ss.str());
+            }
+    cout << name << " " << decpomdp->GetUnixName() << " h=" << h
+         << ": stagewise and recursive Qvalues agree" << endl;
+}
+
+int main()
+{
+    try
+    {
+        const char *problems[] = {"dectiger", "broadcastChannel"};
+        for(Index p=0;p!=2;++p)
+        {
+            DecPOMDPDiscrete decpomdp("","",GetProblemFilename(problems[p]));
+            MADPParser parser(&decpomdp);
+            for(size_t h=3;h<=4;++h)
+            {
+                testStagewise<QPOMDP>("QPOMDP", &decpomdp, h);
+                testStagewise<QBG>("QBG", &decpomdp, h);
+            }
+        }
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "QFunctions tests passed" << endl;
+    return(0);
+}
@@ -0,0 +1,297 @@
+/* This file is part of the Multiagent Decision Process (MADP) Toolbox.
+ *
+ * The majority of MADP is free software released under GNUP GPL v.3. However,
+ * some of the included libraries are released under a different license. For
+ * more information, see the included COPYING file. For other information,
+ * please refer to the included README file.
+ *
+ * This file has been written and/or modified by the following people:
+ *
+ * Frans Oliehoek
+ * Matthijs Spaan
+ *
+ * For contact information please see the included AUTHORS file.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include "Globals.h"
+#include "TOIDecPOMDPDiscrete.h"
+#include "TransitionModelTOI.h"
+#include "ObservationModelTOI.h"
+#include "JointBelief.h"
+#include "JointBeliefSparse.h"
+
+using namespace std;
+
+void fail(const string &msg)
+{
+    cerr << "ERROR: " << msg << endl;
+    exit(1);
+}
+
+void Check(bool ok, const string &what, Index sI, Index jaI, double value,
+           double expected)
+{
+    if(!ok)
+    {
+        stringstream ss;
+        ss.precision(17);
+        ss << what << " for s=" << sI << " ja=" << jaI << " is " << value
+           << ", the cached flat model gives " << expected;
+        fail(ss.str());
+    }
+}
+
+bool Equal(double x, double y)
+{
+    return(std::abs(x-y) <= 1e-12);
+}
+
+/// Returns a random probability distribution over n values, in which
+/// some of the values have probability 0.
+vector<double> RandomDistribution(size_t n)
+{
+    vector<double> p(n,0);
+    double sum=0;
+    while(sum==0)
+        for(Index k=0;k!=n;++k)
+        {
+            p[k]=(rand()%5<2) ? 0 : rand()/(RAND_MAX+1.0);
+            sum+=p[k];
+        }
+    for(Index k=0;k!=n;++k)
+        p[k]/=sum;
+    return(p);
+}
+
+/// Fills toi with three agents with random local models, in the same way
+/// as ParserTOIDecPOMDPDiscrete does. The models only depend on seed.
+void CreateRandomTOI(TOIDecPOMDPDiscrete &toi, unsigned int seed)
+{
+    srand(seed);
+    size_t nrAgents=3, nrStates[]={3,4,2}, nrActions[]={2,3,2},
+        nrObservations[]={2,2,3};
+    toi.SetNrAgents(nrAgents);
+    toi.SetDiscount(0.9);
+    for(Index agI=0;agI!=nrAgents;++agI)
+    {
+        DecPOMDPDiscrete *decpomdp=new DecPOMDPDiscrete("","","");
+        decpomdp->SetNrAgents(1);
+        for(Index sI=0;sI!=nrStates[agI];++sI)
+        {
+            stringstream ss;
+            ss << "s" << sI;
+            decpomdp->AddState(ss.str());
+        }
+        decpomdp->SetUniformISD();
+        for(Index aI=0;aI!=nrActions[agI];++aI)
+        {
+            stringstream ss;
+            ss << "a" << aI;
+            decpomdp->AddAction(0,ss.str());
+        }
+        decpomdp->ConstructJointActions();
+        decpomdp->SetActionsInitialized(true);
+        for(Index oI=0;oI!=nrObservations[agI];++oI)
+        {
+            stringstream ss;
+            ss << "o" << oI;
+            decpomdp->AddObservation(0,ss.str());
+        }
+        decpomdp->ConstructJointObservations();
+        decpomdp->SetObservationsInitialized(true);
+
+        decpomdp->CreateNewTransitionModel();
+        decpomdp->CreateNewObservationModel();
+        for(Index aI=0;aI!=nrActions[agI];++aI)
+            for(Index sI=0;sI!=nrStates[agI];++sI)
+            {
+                vector<double> T=RandomDistribution(nrStates[agI]),
+                    O=RandomDistribution(nrObservations[agI]);
+                for(Index sucSI=0;sucSI!=nrStates[agI];++sucSI)
+                    decpomdp->SetTransitionProbability(sI,aI,sucSI,T[sucSI]);
+                for(Index oI=0;oI!=nrObservations[agI];++oI)
+                    decpomdp->SetObservationProbability(aI,sI,oI,O[oI]);
+            }
+        decpomdp->CreateNewRewardModel();
+        decpomdp->SetInitialized(true);
+
+        decpomdp->ExtractMADPDiscrete(toi.GetIndividualMADPD(agI));
+        toi.SetIndividualDecPOMDPD(decpomdp,agI);
+    }
+    toi.CreateNewRewardModel();
+    toi.SetInitialized(true);
+}
+
+/// Checks Get() and GetSuccessors() of the implicit transition model
+/// against the flat model.
+void testTransitions(const TransitionModelTOI &T,
+                     const MultiAgentDecisionProcessDiscreteInterface &flat)
+{
+    size_t nrS=flat.GetNrStates(), nrJA=flat.GetNrJointActions();
+    vector<Index> sucSIs;
+    vector<double> probs;
+    for(Index sI=0;sI!=nrS;++sI)
+        for(Index jaI=0;jaI!=nrJA;++jaI)
+        {
+            T.GetSuccessors(sI,jaI,sucSIs,probs);
+            Index k=0;
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+            {
+                double p=flat.GetTransitionProbability(sI,jaI,sucSI);
+                Check(Equal(T.Get(sI,jaI,sucSI),p),"Get()",sI,jaI,
+                      T.Get(sI,jaI,sucSI),p);
+                if(p==0)
+                    continue;
+                // the successors have to be returned in increasing order
+                if(k==sucSIs.size() || sucSIs[k]!=sucSI)
+                    fail("GetSuccessors() does not return all successors in "
+                         "increasing order");
+                Check(Equal(probs[k],p),"GetSuccessors()",sI,jaI,probs[k],p);
+                k++;
+            }
+            if(k!=sucSIs.size())
+                fail("GetSuccessors() returns states with probability 0");
+        }
+    cout << "TransitionModelTOI: Get() and GetSuccessors() agree with the "
+         << "cached flat model" << endl;
+}
+
+/// Checks Multiply() and MultiplyTransposed() against products computed
+/// with the flat model.
+void testMultiply(const TransitionModelTOI &T,
+                  const MultiAgentDecisionProcessDiscreteInterface &flat)
+{
+    size_t nrS=flat.GetNrStates(), nrJA=flat.GetNrJointActions();
+    vector<double> v(nrS), b=RandomDistribution(nrS), Tv, bT;
+    for(Index sI=0;sI!=nrS;++sI)
+        v[sI]=rand()/(RAND_MAX+1.0);
+
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+    {
+        T.Multiply(jaI,v,Tv);
+        for(Index sI=0;sI!=nrS;++sI)
+        {
+            double x=0;
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+                x+=flat.GetTransitionProbability(sI,jaI,sucSI)*v[sucSI];
+            Check(std::abs(Tv[sI]-x)<1e-9,"Multiply()",sI,jaI,Tv[sI],x);
+        }
+
+        T.MultiplyTransposed(jaI,b,bT);
+        vector<double> x(nrS,0);
+        for(Index sI=0;sI!=nrS;++sI)
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+                x[sucSI]+=b[sI]*flat.GetTransitionProbability(sI,jaI,sucSI);
+        for(Index sucSI=0;sucSI!=nrS;++sucSI)
+            Check(std::abs(bT[sucSI]-x[sucSI])<1e-9,"MultiplyTransposed()",
+                  sucSI,jaI,bT[sucSI],x[sucSI]);
+    }
+    cout << "TransitionModelTOI: Multiply() and MultiplyTransposed() agree "
+         << "with the cached flat model" << endl;
+}
+
+/// Checks Get() and GetProbabilities() of the implicit observation model
+/// against the flat model.
+void testObservations(const ObservationModelTOI &O,
+                      const MultiAgentDecisionProcessDiscreteInterface &flat)
+{
+    size_t nrS=flat.GetNrStates(), nrJA=flat.GetNrJointActions(),
+        nrJO=flat.GetNrJointObservations();
+    vector<double> probs;
+    for(Index jaI=0;jaI!=nrJA;++jaI)
+        for(Index joI=0;joI!=nrJO;++joI)
+        {
+            O.GetProbabilities(jaI,joI,probs);
+            for(Index sucSI=0;sucSI!=nrS;++sucSI)
+            {
+                double p=flat.GetObservationProbability(jaI,sucSI,joI);
+                Check(Equal(O.Get(jaI,sucSI,joI),p),
+                      "ObservationModelTOI::Get()",sucSI,jaI,
+                      O.Get(jaI,sucSI,joI),p);
+                Check(Equal(probs[sucSI],p),"GetProbabilities()",sucSI,jaI,
+                      probs[sucSI],p);
+            }
+        }
+    cout << "ObservationModelTOI: Get() and GetProbabilities() agree with "
+         << "the cached flat model" << endl;
+}
+
+/// Checks that the belief updates with the implicit models (which use
+/// UpdateTOI()) equal those with the cached flat models, along a
+/// simulated trajectory.
+void testBeliefUpdates(const MultiAgentDecisionProcessDiscreteInterface &toi,
+                       const MultiAgentDecisionProcessDiscreteInterface &flat)
+{
+    size_t nrS=flat.GetNrStates(), nrJA=flat.GetNrJointActions(),
+        nrJO=flat.GetNrJointObservations();
+    vector<double> isd=flat.GetISD()->ToVectorOfDoubles();
+    JointBelief b(isd), bFlat(isd);
+    JointBeliefSparse bSparse(isd);
+
+    Index sI=0;
+    while(isd[sI]==0)
+        sI++;
+    for(Index t=0;t!=20;++t)
+    {
+        // sample the next state and joint observation
+        Index jaI=rand()%nrJA, sucSI=0, joI=0;
+        double r=rand()/(RAND_MAX+1.0);
+        while(sucSI+1<nrS &&
+              (r-=flat.GetTransitionProbability(sI,jaI,sucSI)) >= 0)
+            sucSI++;
+        r=rand()/(RAND_MAX+1.0);
+        while(joI+1<nrJO &&
+              (r-=flat.GetObservationProbability(jaI,sucSI,joI)) >= 0)
+            joI++;
+        sI=sucSI;
+
+        double p=bFlat.Update(flat,jaI,joI),
+            pDense=b.Update(toi,jaI,joI),
+            pSparse=bSparse.Update(toi,jaI,joI);
+        Check(std::abs(pDense-p)<1e-9,"JointBelief::Update()",sI,jaI,
+              pDense,p);
+        Check(std::abs(pSparse-p)<1e-9,"JointBeliefSparse::Update()",sI,jaI,
+              pSparse,p);
+        for(Index s=0;s!=nrS;++s)
+        {
+            Check(std::abs(b.Get(s)-bFlat.Get(s))<1e-9,
+                  "the JointBelief after Update()",s,jaI,b.Get(s),
+                  bFlat.Get(s));
+            Check(std::abs(bSparse.Get(s)-bFlat.Get(s))<1e-9,
+                  "the JointBeliefSparse after Update()",s,jaI,
+                  bSparse.Get(s),bFlat.Get(s));
+        }
+    }
+    cout << "TOI belief updates agree with the cached flat models" << endl;
+}
+
+int main()
+{
+    try
+    {
+        TOIDecPOMDPDiscrete toi, flat("","","",true);
+        CreateRandomTOI(toi,42);
+        CreateRandomTOI(flat,42);
+
+        const TransitionModelTOI *T=dynamic_cast<const TransitionModelTOI*>(
+            toi.GetTransitionModelDiscretePtr());
+        const ObservationModelTOI *O=dynamic_cast<const ObservationModelTOI*>(
+            toi.GetObservationModelDiscretePtr());
+        if(!T || !O)
+            fail("without cached flat models the TOI models should be implicit");
+        if(dynamic_cast<const TransitionModelTOI*>(
+               flat.GetTransitionModelDiscretePtr()))
+            fail("with cached flat models the TOI models should be flat");
+
+        testTransitions(*T,flat);
+        testMultiply(*T,flat);
+        testObservations(*O,flat);
+        testBeliefUpdates(toi,flat);
+    }
+    catch(E& e){ e.Print(); return(1); }
+
+    cout << "TOIModels tests passed" << endl;
+    return(0);
+}